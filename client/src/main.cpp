@@ -10,17 +10,36 @@
 #include "ui/main_window.hpp"
 
 namespace {
-QString getServerAddressFromArguments(const QApplication &app) {
+struct Arguments {
+  QString serverAddress;
+  grpc_compression_algorithm compression = GRPC_COMPRESS_NONE;
+};
+
+Arguments parseArguments(const QApplication &app) {
   QCommandLineParser parser;
   parser.setApplicationDescription("Chat gRPC client");
   parser.addHelpOption();
   QCommandLineOption serverOption({"s", "server"},
                                   "gRPC server address (host:port).", "address",
                                   "localhost:50051");
+  QCommandLineOption compressionOption(
+      {"c", "compression"},
+      "Compression accepted from the server (none, gzip, deflate).",
+      "algorithm", "gzip");
   parser.addOption(serverOption);
+  parser.addOption(compressionOption);
   parser.process(app);
 
-  return parser.value(serverOption);
+  Arguments arguments{.serverAddress = parser.value(serverOption)};
+  const QString compression = parser.value(compressionOption);
+  if (compression == "gzip") {
+    arguments.compression = GRPC_COMPRESS_GZIP;
+  } else if (compression == "deflate") {
+    arguments.compression = GRPC_COMPRESS_DEFLATE;
+  } else if (compression != "none") {
+    qWarning() << "Unknown compression" << compression << "- using none";
+  }
+  return arguments;
 }
 
 void useExternalStyleSheet(QApplication &app, const QString &cssFilePath) {
@@ -38,7 +57,7 @@ int main(int argc, char *argv[]) {
   QApplication app(argc, argv);
 
   // parse command line arguments
-  const QString serverAddress = getServerAddressFromArguments(app);
+  const auto [serverAddress, compression] = parseArguments(app);
 
   // apply external stylesheet
   useExternalStyleSheet(app, "./client/src/ui/style.css");
@@ -48,8 +67,8 @@ int main(int argc, char *argv[]) {
                         std::make_shared<database::DatabaseManagerSQLite>());
   auto *loginView = mainWindow.loginView();
   auto *chatWindow = mainWindow.chatWindow();
-  auto *grpcChatClient =
-      new ChatServiceGrpc(serverAddress.toStdString(), &mainWindow);
+  auto *grpcChatClient = new ChatServiceGrpc(serverAddress.toStdString(),
+                                             compression, &mainWindow);
 
   // signals LoginView -> grpc
   QObject::connect(loginView, &LoginView::connectRequested, grpcChatClient,
@@ -1,11 +1,18 @@
 #include "service/chat_service_grpc.hpp"
 
+#include <array>
 #include <chrono>
+#include <cstddef>
 #include <qobject.h>
 #include <utility>
 
-ChatServiceGrpc::ChatServiceGrpc(std::string serverAddress, QObject *parent)
-    : QObject(parent), serverAddress_(std::move(serverAddress)) {}
+#include <google/protobuf/arena.h>
+
+ChatServiceGrpc::ChatServiceGrpc(std::string serverAddress,
+                                 grpc_compression_algorithm compression,
+                                 QObject *parent)
+    : QObject(parent), serverAddress_(std::move(serverAddress)),
+      compression_(compression) {}
 
 ChatServiceGrpc::~ChatServiceGrpc() {
   stopMessageStream();
@@ -105,12 +112,19 @@ ChatServiceGrpc::connect(std::string_view pseudonym, std::string_view gender,
   request.set_pseudonym(std::string(pseudonym));
   request.set_gender(std::string(gender));
   request.set_country(std::string(country));
+  if (sessionPseudonym_ == pseudonym) {
+    request.set_session_token(sessionToken_);
+  }
 
   chat::ConnectResponse response;
   grpc::ClientContext context;
   context.set_deadline(std::chrono::system_clock::now() +
                        std::chrono::seconds(5));
   const auto status = stub_->Connect(&context, request, &response);
+  if (status.ok() && response.accepted()) {
+    sessionPseudonym_ = std::string(pseudonym);
+    sessionToken_ = response.session_token();
+  }
 
   return {.status = status, .response = response};
 }
@@ -132,15 +146,26 @@ grpc::Status ChatServiceGrpc::sendMessage(
     std::string_view content,
     const std::optional<std::string> &privateRecipient) {
   ensureStub();
-  chat::SendMessageRequest request;
-  request.set_content(std::string(content));
+
+  // Request and response share a stack-backed arena, so building them does
+  // not go through the heap for typical message sizes
+  alignas(std::max_align_t) std::array<char, 1024> arenaBlock;
+  google::protobuf::ArenaOptions arenaOptions;
+  arenaOptions.initial_block = arenaBlock.data();
+  arenaOptions.initial_block_size = arenaBlock.size();
+  google::protobuf::Arena arena(arenaOptions);
+
+  auto *request =
+      google::protobuf::Arena::CreateMessage<chat::SendMessageRequest>(&arena);
+  request->set_content(std::string(content));
   if (privateRecipient.has_value()) {
-    request.set_private_message_pseudonym(*privateRecipient);
+    request->set_private_message_pseudonym(*privateRecipient);
   }
 
+  auto *response =
+      google::protobuf::Arena::CreateMessage<google::protobuf::Empty>(&arena);
   grpc::ClientContext context;
-  google::protobuf::Empty response;
-  return stub_->SendMessage(&context, request, &response);
+  return stub_->SendMessage(&context, *request, response);
 }
 
 void ChatServiceGrpc::startMessageStream(MessageCallback onMessage,
@@ -236,8 +261,14 @@ void ChatServiceGrpc::checkServerAvailability() {
 void ChatServiceGrpc::ensureStub() {
   std::lock_guard<std::mutex> lock(stubMutex_);
   if (!stub_) {
-    channel_ =
-        grpc::CreateChannel(serverAddress_, grpc::InsecureChannelCredentials());
+    // Advertised in every call, so that the server compresses its responses
+    // with this algorithm or not at all. Requests are short chat lines and
+    // go uncompressed.
+    grpc::ChannelArguments arguments;
+    arguments.SetInt(GRPC_COMPRESSION_CHANNEL_ENABLED_ALGORITHMS_BITSET,
+                     (1 << GRPC_COMPRESS_NONE) | (1 << compression_));
+    channel_ = grpc::CreateCustomChannel(
+        serverAddress_, grpc::InsecureChannelCredentials(), arguments);
     stub_ = chat::ChatService::NewStub(channel_);
   }
 }
@@ -23,8 +23,12 @@ public:
   using ChatClient::ErrorCallback;
   using ChatClient::MessageCallback;
 
-  explicit ChatServiceGrpc(std::string serverAddress,
-                           QObject *parent = nullptr);
+  // `compression` is the only algorithm, besides none, the server may use
+  // for its responses
+  explicit ChatServiceGrpc(
+      std::string serverAddress,
+      grpc_compression_algorithm compression = GRPC_COMPRESS_NONE,
+      QObject *parent = nullptr);
   ~ChatServiceGrpc() override;
 
   ChatServiceGrpc(const ChatServiceGrpc &) = delete;
@@ -76,8 +80,13 @@ private:
   void ensureStub();
 
   std::string serverAddress_;
+  grpc_compression_algorithm compression_;
   std::shared_ptr<grpc::Channel> channel_;
   std::unique_ptr<chat::ChatService::Stub> stub_;
+  // Session of the last accepted connect, presented when the same pseudonym
+  // connects again so that the server hands it back
+  std::string sessionPseudonym_;
+  std::string sessionToken_;
 
   std::atomic<bool> messageStreamRunning_{false};
   std::thread messageStreamThread_;
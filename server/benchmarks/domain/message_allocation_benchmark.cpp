@@ -0,0 +1,187 @@
+#include <benchmark/benchmark.h>
+
+#include "domain/client_registry.hpp"
+#include "domain/message_broadcaster.hpp"
+#include "domain/private_message_broadcaster.hpp"
+#include "service/events/chat_service_events_dispatcher.hpp"
+#include "service/validation/validation_pipeline.hpp"
+#include "service/validation/validators/content_validator.hpp"
+#include "service/validation/validators/rate_limit_validator.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+// Counts heap allocations made by the calling thread. Replacing the global
+// operator new covers every allocation in this binary, including the ones
+// made inside protobuf and the standard library.
+namespace {
+thread_local std::int64_t tAllocationCount = 0;
+} // namespace
+
+void *operator new(std::size_t size) {
+  ++tAllocationCount;
+  if (void *pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+
+void operator delete(void *pointer, [[maybe_unused]] std::size_t size) noexcept {
+  std::free(pointer);
+}
+
+namespace domain {
+namespace {
+
+// Typical chat line, long enough to defeat the small string optimization
+const std::string kContent(300, 'x');
+
+std::string peerAddress(int index) {
+  return "ipv4:127.0.0.1:" + std::to_string(50000 + index);
+}
+
+// Everything runs on the benchmark thread so that tAllocationCount sees the
+// whole path: payload creation, dispatch, and delivery to every subscriber.
+class AllocationFixture {
+public:
+  explicit AllocationFixture(int subscriberCount)
+      : broadcaster_(std::make_shared<MessageBroadcaster>(
+            registry_, OutboundQueueConfig{.capacity = 1 << 20})),
+        privateBroadcaster_(std::make_shared<PrivateMessageBroadcaster>(
+            registry_, OutboundQueueConfig{.capacity = 1 << 20})) {
+    dispatcher_.registerObserver(broadcaster_);
+    dispatcher_.registerObserver(privateBroadcaster_);
+
+    for (int i = 0; i < subscriberCount; ++i) {
+      peers_.push_back(peerAddress(i));
+      events::ClientConnectedEvent event{.peer = peers_.back(),
+                                         .pseudonym = "user" + std::to_string(i),
+                                         .gender = "",
+                                         .country = ""};
+      registry_.asObserver()->onClientConnected(event);
+      broadcaster_->normalizeMessageIndex(peers_.back());
+      privateBroadcaster_->normalizePrivateMessageIndex(peers_.back());
+    }
+  }
+
+  void publishAndDrain() {
+    dispatcher_.notifyMessageSent(events::MessageSentEvent{
+        .peer = peers_.front(),
+        .pseudonym = "user0",
+        .room = "general",
+        .message = events::makeChatMessage("user0", kContent, "general")});
+
+    for (const auto &peer : peers_) {
+      broadcaster_->nextMessage(peer, std::chrono::milliseconds(0), out_);
+    }
+  }
+
+  void sendAndDrainPrivate() {
+    dispatcher_.notifyPrivateMessageSent(events::PrivateMessageSentEvent{
+        .senderPeer = peers_.front(),
+        .senderPseudonym = "user0",
+        .recipientPeer = peers_.back(),
+        .recipientPseudonym = "recipient",
+        .message = events::makeChatMessage("user0", kContent, {}, true)});
+
+    privateBroadcaster_->nextPrivateMessage(
+        peers_.back(), std::chrono::milliseconds(0), out_);
+  }
+
+private:
+  ClientRegistry registry_;
+  std::shared_ptr<MessageBroadcaster> broadcaster_;
+  std::shared_ptr<PrivateMessageBroadcaster> privateBroadcaster_;
+  events::EventDispatcher dispatcher_;
+  std::vector<std::string> peers_;
+  events::ChatMessagePtr out_;
+};
+
+void reportAllocations(benchmark::State &state, std::int64_t allocations) {
+  state.counters["allocs_per_message"] = benchmark::Counter(
+      static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+
+void BM_PublicMessageAllocations(benchmark::State &state) {
+  AllocationFixture fixture(static_cast<int>(state.range(0)));
+
+  std::int64_t allocations = 0;
+  for (auto _ : state) {
+    const std::int64_t before = tAllocationCount;
+    fixture.publishAndDrain();
+    allocations += tAllocationCount - before;
+  }
+
+  reportAllocations(state, allocations);
+}
+
+void BM_PrivateMessageAllocations(benchmark::State &state) {
+  AllocationFixture fixture(2);
+
+  std::int64_t allocations = 0;
+  for (auto _ : state) {
+    const std::int64_t before = tAllocationCount;
+    fixture.sendAndDrainPrivate();
+    allocations += tAllocationCount - before;
+  }
+
+  reportAllocations(state, allocations);
+}
+
+// SendMessage's validation of an accepted message, once every sender has an
+// entry in the rate limiter
+void BM_ValidationAllocations(benchmark::State &state) {
+  using namespace service::validation;
+  ValidationPipeline<ContentValidator, RateLimitValidator> pipeline(
+      ContentValidator::Config{}, std::chrono::milliseconds(1));
+  auto now = std::chrono::steady_clock::now();
+  std::vector<std::string> peers;
+  for (int i = 0; i < 256; ++i) {
+    peers.push_back(peerAddress(i));
+  }
+  for (const auto &peer : peers) {
+    pipeline.validate({.peer = peer,
+                       .pseudonym = "user",
+                       .content = kContent,
+                       .timestamp = now});
+  }
+
+  // Each peer sends again well after the rate limit interval
+  std::int64_t allocations = 0;
+  std::size_t next = 0;
+  for (auto _ : state) {
+    now += std::chrono::milliseconds(1);
+    const std::int64_t before = tAllocationCount;
+    const auto result = pipeline.validate({.peer = peers[next],
+                                           .pseudonym = "user",
+                                           .content = kContent,
+                                           .timestamp = now});
+    allocations += tAllocationCount - before;
+    benchmark::DoNotOptimize(result.valid);
+    next = (next + 1) % peers.size();
+  }
+
+  reportAllocations(state, allocations);
+}
+
+// The count per message must not grow with the number of subscribers
+BENCHMARK(BM_PublicMessageAllocations)
+    ->ArgName("subscribers")
+    ->Arg(1)
+    ->Arg(16)
+    ->Arg(256);
+
+BENCHMARK(BM_PrivateMessageAllocations);
+
+// Must stay at zero
+BENCHMARK(BM_ValidationAllocations);
+
+} // namespace
+} // namespace domain
@@ -0,0 +1,93 @@
+#include <benchmark/benchmark.h>
+
+#include "domain/client_registry.hpp"
+#include "domain/message_broadcaster.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace domain {
+namespace {
+
+constexpr int kMessagesPerIteration = 64;
+
+// Subscribers drain the broadcaster on their own threads, the same way each
+// gRPC SubscribeMessages call does, while the benchmark thread publishes.
+class FanOutFixture {
+public:
+  FanOutFixture(std::size_t shardCount, int subscriberCount)
+      : broadcaster_(registry_, OutboundQueueConfig{.capacity = 1 << 20},
+                     shardCount) {
+    for (int i = 0; i < subscriberCount; ++i) {
+      const std::string peer = "peer" + std::to_string(i);
+      events::ClientConnectedEvent event{.peer = peer,
+                                         .pseudonym = "user" + std::to_string(i),
+                                         .gender = "",
+                                         .country = ""};
+      registry_.asObserver()->onClientConnected(event);
+      broadcaster_.normalizeMessageIndex(peer);
+      subscribers_.emplace_back([this, peer](const std::stop_token &stop) {
+        events::ChatMessagePtr out;
+        while (!stop.stop_requested()) {
+          if (broadcaster_.nextMessage(peer, std::chrono::milliseconds(20),
+                                       out) == NextMessageStatus::kOk) {
+            delivered_.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+      });
+    }
+  }
+
+  ~FanOutFixture() {
+    for (auto &subscriber : subscribers_) {
+      subscriber.request_stop();
+    }
+  }
+
+  void publishAndDrain(std::int64_t expectedDeliveries) {
+    for (int i = 0; i < kMessagesPerIteration; ++i) {
+      broadcaster_.onMessageSent(events::MessageSentEvent{
+          .peer = "peer0",
+          .pseudonym = "user0",
+          .message = events::makeChatMessage("user0", "benchmark")});
+    }
+    while (delivered_.load(std::memory_order_relaxed) < expectedDeliveries) {
+      std::this_thread::yield();
+    }
+  }
+
+private:
+  ClientRegistry registry_;
+  MessageBroadcaster broadcaster_;
+  std::atomic<std::int64_t> delivered_{0};
+  std::vector<std::jthread> subscribers_;
+};
+
+void BM_PublicFanOut(benchmark::State &state) {
+  const auto shardCount = static_cast<std::size_t>(state.range(0));
+  const auto subscriberCount = static_cast<int>(state.range(1));
+  FanOutFixture fixture(shardCount, subscriberCount);
+
+  std::int64_t expectedDeliveries = 0;
+  for (auto _ : state) {
+    expectedDeliveries +=
+        static_cast<std::int64_t>(kMessagesPerIteration) * subscriberCount;
+    fixture.publishAndDrain(expectedDeliveries);
+  }
+
+  state.SetItemsProcessed(expectedDeliveries);
+  state.counters["subscribers"] = subscriberCount;
+}
+
+BENCHMARK(BM_PublicFanOut)
+    ->ArgNames({"shards", "subscribers"})
+    ->ArgsProduct({{1, 2, 4, 8}, {64, 256}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace
+} // namespace domain
@@ -0,0 +1,112 @@
+#include <benchmark/benchmark.h>
+
+#include "service/events/chat_message.hpp"
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+namespace service {
+namespace {
+
+// gRPC's message compression: zlib at the default level, in the zlib
+// (deflate) or gzip format
+int compressedSize(const std::string &input, bool gzip, std::string &output) {
+  z_stream stream{};
+  deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+               15 | (gzip ? 16 : 0), 8, Z_DEFAULT_STRATEGY);
+  output.resize(deflateBound(&stream, input.size()));
+  stream.next_in =
+      reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+  stream.avail_in = static_cast<uInt>(input.size());
+  stream.next_out = reinterpret_cast<Bytef *>(output.data());
+  stream.avail_out = static_cast<uInt>(output.size());
+  deflate(&stream, Z_FINISH);
+  const auto size = static_cast<int>(stream.total_out);
+  deflateEnd(&stream);
+  return size;
+}
+
+// Encoded room messages of `minLength` to `maxLength` characters of chat
+// text: short words, repeated vocabulary and pseudonyms
+std::vector<std::string> chatTraffic(std::size_t count, int minLength,
+                                     int maxLength) {
+  static constexpr std::array<const char *, 24> kWords = {
+      "hi",    "hello", "ok",   "yes",  "no",     "thanks", "lol",  "the",
+      "is",    "it",    "you",  "what", "where",  "when",   "game", "tonight",
+      "later", "see",   "good", "nice", "really", "agree",  "idea", "maybe"};
+  static constexpr std::array<const char *, 6> kAuthors = {
+      "alice", "bob", "carol", "dave", "erin", "frank"};
+
+  std::mt19937 random(7);
+  std::uniform_int_distribution<int> length(minLength, maxLength);
+  std::uniform_int_distribution<std::size_t> word(0, kWords.size() - 1);
+  std::uniform_int_distribution<std::size_t> author(0, kAuthors.size() - 1);
+
+  std::vector<std::string> traffic;
+  traffic.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    std::string content;
+    const auto target = static_cast<std::size_t>(length(random));
+    while (content.size() < target) {
+      content += kWords[word(random)];
+      content += ' ';
+    }
+    content.resize(target);
+    const auto message = events::makeChatMessage(kAuthors[author(random)],
+                                                 std::move(content));
+    traffic.push_back(message->proto().SerializeAsString());
+  }
+  return traffic;
+}
+
+// Compresses room traffic as a stream would: `batch` messages per write
+// (1 is what gRPC does, one message per write), with deflate (0) or gzip
+// (1). `ratio` is compressed over raw bytes; time is the CPU a stream
+// spends on it.
+void BM_CompressChatTraffic(benchmark::State &state) {
+  const bool gzip = state.range(0) != 0;
+  const auto batch = static_cast<std::size_t>(state.range(1));
+  const int maxLength = static_cast<int>(state.range(2));
+  const auto traffic = chatTraffic(256, std::max(maxLength / 10, 1),
+                                   maxLength);
+
+  std::vector<std::string> writes;
+  for (std::size_t i = 0; i < traffic.size(); i += batch) {
+    std::string write;
+    for (std::size_t j = i; j < i + batch && j < traffic.size(); ++j) {
+      write += traffic[j];
+    }
+    writes.push_back(std::move(write));
+  }
+
+  std::string output;
+  std::int64_t rawBytes = 0;
+  std::int64_t compressedBytes = 0;
+  for (auto _ : state) {
+    for (const auto &write : writes) {
+      compressedBytes += compressedSize(write, gzip, output);
+      rawBytes += static_cast<std::int64_t>(write.size());
+    }
+  }
+
+  state.counters["ratio"] = static_cast<double>(compressedBytes) /
+                            static_cast<double>(std::max<std::int64_t>(
+                                rawBytes, 1));
+  state.counters["raw_bytes_per_message"] =
+      static_cast<double>(rawBytes) /
+      static_cast<double>(state.iterations() * traffic.size());
+  state.SetBytesProcessed(rawBytes);
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(traffic.size()));
+}
+BENCHMARK(BM_CompressChatTraffic)
+    ->ArgNames({"gzip", "batch", "max_chars"})
+    ->ArgsProduct({{0, 1}, {1, 16}, {120, 1000}});
+
+} // namespace
+} // namespace service
@@ -0,0 +1,87 @@
+#include <benchmark/benchmark.h>
+
+#include "service/delivery_pool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace service {
+namespace {
+
+constexpr std::int64_t kSubscribers = 10'000;
+
+// Stands in for a stream starting a write: copies a chat message and
+// reports the delivery
+class CopyingTarget final : public IDeliveryTarget {
+public:
+  CopyingTarget(const std::array<char, 300> &message,
+                std::atomic<std::int64_t> &delivered)
+      : message_(message), delivered_(delivered) {}
+
+  void deliver() override {
+    std::memcpy(buffer_.data(), message_.data(), buffer_.size());
+    benchmark::DoNotOptimize(buffer_.data());
+    delivered_.fetch_add(1, std::memory_order_release);
+  }
+
+private:
+  const std::array<char, 300> &message_;
+  std::atomic<std::int64_t> &delivered_;
+  std::array<char, 300> buffer_{};
+};
+
+// One public message reaching the 10k subscribers of its room with
+// `range(0)` workers: time is from the publish to the last subscriber's
+// delivery
+void BM_PublishToLastDelivery(benchmark::State &state) {
+  DeliveryPool pool({.workers = static_cast<std::size_t>(state.range(0))});
+  std::array<char, 300> message{};
+  message.fill('x');
+  std::atomic<std::int64_t> delivered = 0;
+  for (std::int64_t i = 0; i < kSubscribers; ++i) {
+    pool.add("peer" + std::to_string(i), "",
+             std::make_shared<CopyingTarget>(message, delivered));
+  }
+
+  std::vector<double> latencies;
+  std::int64_t expected = 0;
+  for (auto _ : state) {
+    expected += kSubscribers;
+    const auto start = std::chrono::steady_clock::now();
+    pool.wakeRoom("");
+    while (delivered.load(std::memory_order_acquire) < expected) {
+      std::this_thread::yield();
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    state.SetIterationTime(elapsed.count());
+    latencies.push_back(elapsed.count());
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  const auto percentile = [&latencies](double rank) {
+    return latencies[static_cast<std::size_t>(
+        rank * static_cast<double>(latencies.size() - 1))];
+  };
+  state.counters["p50_us"] = percentile(0.50) * 1e6;
+  state.counters["p99_us"] = percentile(0.99) * 1e6;
+  state.SetItemsProcessed(state.iterations() * kSubscribers);
+}
+BENCHMARK(BM_PublishToLastDelivery)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->UseManualTime()
+    ->Unit(benchmark::kMicrosecond);
+
+} // namespace
+} // namespace service
@@ -0,0 +1,52 @@
+#include <benchmark/benchmark.h>
+
+#include "service/validation/keyword_automaton.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace service::validation {
+namespace {
+
+std::string randomWord(std::mt19937 &random, int minLength, int maxLength) {
+  std::uniform_int_distribution<int> length(minLength, maxLength);
+  std::uniform_int_distribution<int> letter('a', 'z');
+  std::string word(static_cast<std::size_t>(length(random)), ' ');
+  for (auto &byte : word) {
+    byte = static_cast<char>(letter(random));
+  }
+  return word;
+}
+
+// A clean 300-byte chat message scanned against `range(0)` banned terms:
+// the whole text is read, as for most messages
+void BM_BannedTermsScan(benchmark::State &state) {
+  std::mt19937 random(5);
+  std::vector<std::string> terms;
+  for (int i = 0; i < state.range(0); ++i) {
+    terms.push_back(randomWord(random, 5, 12));
+  }
+  const auto automaton = KeywordAutomaton::compile(terms);
+
+  std::string message;
+  while (message.size() < 300) {
+    message += randomWord(random, 2, 8) + ' ';
+  }
+  message.resize(300);
+  if (automaton.matches(message)) {
+    state.SkipWithError("message contains a banned term");
+    return;
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(automaton.matches(message));
+  }
+  state.counters["states"] = static_cast<double>(automaton.stateCount());
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<std::int64_t>(message.size()));
+}
+BENCHMARK(BM_BannedTermsScan)->Arg(1000)->Arg(10000);
+
+} // namespace
+} // namespace service::validation
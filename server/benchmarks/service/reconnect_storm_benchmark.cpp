@@ -0,0 +1,161 @@
+#include <benchmark/benchmark.h>
+
+#include "chat.pb.h"
+#include "domain/client_registry.hpp"
+#include "service/events/async_event_observer.hpp"
+#include "service/events/chat_service_events_dispatcher.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <grpcpp/impl/codegen/proto_utils.h>
+#include <grpcpp/support/byte_buffer.h>
+
+namespace service {
+namespace {
+
+constexpr std::int64_t kClients = 10'000;
+
+// Stands in for the database logger: every event costs a round trip
+class SlowObserver : public events::IServiceEventObserver {
+public:
+  void onClientConnected(const events::ClientConnectedEvent &) override {
+    std::this_thread::sleep_for(std::chrono::microseconds(20));
+  }
+  void onClientDisconnected(const events::ClientDisconnectedEvent &) override {
+    std::this_thread::sleep_for(std::chrono::microseconds(20));
+  }
+  void onMessageSent(const events::MessageSentEvent &) override {}
+  void onPrivateMessageSent(const events::PrivateMessageSentEvent &) override {
+  }
+};
+
+// Every client of a node reconnects at once after a restart: each Connect
+// reserves its pseudonym, reads the roster and publishes the connect event.
+// The first argument selects a logger called on the connecting thread (0) or
+// one behind an AsyncEventObserver (1); time is wall clock for the storm.
+void BM_ReconnectStorm(benchmark::State &state) {
+  const bool useAsyncLogger = state.range(0) != 0;
+  const auto threads = state.range(1);
+
+  std::vector<std::string> pseudonyms;
+  pseudonyms.reserve(kClients);
+  for (std::int64_t i = 0; i < kClients; ++i) {
+    pseudonyms.push_back("user" + std::to_string(i));
+  }
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto registry = std::make_shared<domain::ClientRegistry>();
+    auto logger = std::make_shared<SlowObserver>();
+    std::shared_ptr<events::AsyncEventObserver> asyncLogger;
+    events::EventDispatcher dispatcher;
+    dispatcher.registerObserver(registry);
+    if (useAsyncLogger) {
+      asyncLogger = std::make_shared<events::AsyncEventObserver>(logger);
+      dispatcher.registerObserver(asyncLogger);
+    } else {
+      dispatcher.registerObserver(logger);
+    }
+    state.ResumeTiming();
+
+    std::vector<std::jthread> workers;
+    workers.reserve(threads);
+    for (std::int64_t t = 0; t < threads; ++t) {
+      workers.emplace_back([&, t] {
+        for (std::int64_t i = t; i < kClients; i += threads) {
+          const auto &pseudonym = pseudonyms[i];
+          const std::string peer = "peer" + std::to_string(i);
+          if (!registry->reservePseudonym(peer, pseudonym)) {
+            continue;
+          }
+          benchmark::DoNotOptimize(registry->getRosterSnapshot());
+          dispatcher.notifyClientConnected(
+              {.peer = peer, .pseudonym = pseudonym});
+        }
+      });
+    }
+    workers.clear();
+
+    state.PauseTiming();
+    // The queued log writes are still done, just not by the handlers
+    if (asyncLogger) {
+      asyncLogger->flush();
+    }
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(state.iterations() * kClients);
+}
+
+std::shared_ptr<domain::ClientRegistry> makeRegistry(std::int64_t clients) {
+  auto registry = std::make_shared<domain::ClientRegistry>();
+  events::EventDispatcher dispatcher;
+  dispatcher.registerObserver(registry);
+  for (std::int64_t i = 0; i < clients; ++i) {
+    dispatcher.notifyClientConnected({.peer = "peer" + std::to_string(i),
+                                      .pseudonym =
+                                          "user" + std::to_string(i)});
+  }
+  return registry;
+}
+
+// Builds one Connect response over a stable roster, copying every pseudonym
+// into the message as the typed handler did.
+void BM_ConnectResponseCopiedRoster(benchmark::State &state) {
+  const auto registry = makeRegistry(state.range(0));
+
+  for (auto _ : state) {
+    chat::ConnectResponse response;
+    response.set_accepted(true);
+    for (auto &name : registry->getConnectedPseudonyms()) {
+      response.add_connected_pseudonyms(std::move(name));
+    }
+    grpc::ByteBuffer buffer;
+    bool ownBuffer = false;
+    auto status = grpc::SerializationTraits<chat::ConnectResponse>::Serialize(
+        response, &buffer, &ownBuffer);
+    benchmark::DoNotOptimize(status);
+    benchmark::DoNotOptimize(buffer);
+  }
+}
+
+// Same response with the shared snapshot's bytes appended to the header.
+void BM_ConnectResponseSharedRoster(benchmark::State &state) {
+  const auto registry = makeRegistry(state.range(0));
+
+  for (auto _ : state) {
+    chat::ConnectResponse response;
+    response.set_accepted(true);
+    const auto roster = registry->getRosterSnapshot();
+    grpc::Slice slices[] = {
+        grpc::Slice(response.SerializeAsString()),
+        grpc::Slice(roster->wire.data(), roster->wire.size(),
+                    grpc::Slice::STATIC_SLICE)};
+    grpc::ByteBuffer buffer(slices, 2);
+    benchmark::DoNotOptimize(buffer);
+  }
+}
+
+BENCHMARK(BM_ConnectResponseCopiedRoster)
+    ->ArgName("clients")
+    ->Arg(100)
+    ->Arg(10'000);
+
+BENCHMARK(BM_ConnectResponseSharedRoster)
+    ->ArgName("clients")
+    ->Arg(100)
+    ->Arg(10'000);
+
+BENCHMARK(BM_ReconnectStorm)
+    ->ArgNames({"async", "threads"})
+    ->ArgsProduct({{0, 1}, {8}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+} // namespace
+} // namespace service
@@ -0,0 +1,55 @@
+#include <benchmark/benchmark.h>
+
+#include "service/validation/utf8_scanner.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace service::validation {
+namespace {
+
+// Mostly ASCII chat text with accents, CJK and emoji mixed in, cut to
+// `size` bytes on a code point boundary
+std::string makeMessage(std::size_t size) {
+  constexpr std::string_view kSample =
+      "Bonjour \xC3\xA0 tous, \xC3\xA7" "a va ? \xE4\xBD\xA0\xE5\xA5\xBD "
+      "\xF0\x9F\x99\x82 see you at 10:30, d\xC3\xA9j\xC3\xA0 vu. ";
+  std::string message;
+  while (message.size() < size) {
+    message += kSample;
+  }
+  message.resize(size);
+  while ((static_cast<unsigned char>(message.back()) & 0xC0) == 0x80 ||
+         static_cast<unsigned char>(message.back()) >= 0xC0) {
+    message.back() = ' ';
+  }
+  return message;
+}
+
+void runScan(benchmark::State &state, Utf8Kernel kernel) {
+  const auto message = makeMessage(static_cast<std::size_t>(state.range(0)));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(scanUtf8(message, kernel));
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<std::int64_t>(message.size()));
+}
+
+// Byte at a time, the fallback
+void BM_Utf8ScanScalar(benchmark::State &state) {
+  runScan(state, Utf8Kernel::Scalar);
+}
+BENCHMARK(BM_Utf8ScanScalar)->Arg(300)->Arg(64 << 10);
+
+// The widest kernel this CPU supports
+void BM_Utf8ScanVectorized(benchmark::State &state) {
+  state.SetLabel(detectUtf8Kernel() == Utf8Kernel::Avx2   ? "avx2"
+                 : detectUtf8Kernel() == Utf8Kernel::Sse4 ? "sse4"
+                                                          : "scalar");
+  runScan(state, detectUtf8Kernel());
+}
+BENCHMARK(BM_Utf8ScanVectorized)->Arg(300)->Arg(64 << 10);
+
+} // namespace
+} // namespace service::validation
@@ -0,0 +1,82 @@
+#include <benchmark/benchmark.h>
+
+#include "timing/timer_wheel.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace timing {
+namespace {
+
+// Timeout churn as seen by per-client timers: with `pending` timers
+// outstanding, each iteration cancels one and schedules its replacement
+// further out, while the clock moves one tick every 64 iterations. Timers
+// are rearmed well before they are due, as idle timeouts of active clients.
+
+std::vector<std::uint64_t> makeDistances(std::size_t count) {
+  std::mt19937_64 random(7);
+  std::uniform_int_distribution<std::uint64_t> distance(2000, 60000);
+  std::vector<std::uint64_t> distances(count);
+  for (auto &value : distances) {
+    value = distance(random);
+  }
+  return distances;
+}
+
+void BM_TimerWheelRearm(benchmark::State &state) {
+  const auto pending = static_cast<std::size_t>(state.range(0));
+  const auto distances = makeDistances(pending);
+  TimerWheel wheel;
+  std::vector<TimerId> ids(pending);
+  for (std::size_t i = 0; i < pending; ++i) {
+    ids[i] = wheel.schedule(distances[i], [] {});
+  }
+
+  std::vector<TimerWheel::Fired> fired;
+  std::size_t next = 0;
+  std::uint64_t iteration = 0;
+  for (auto _ : state) {
+    wheel.cancel(ids[next]);
+    ids[next] = wheel.schedule(wheel.now() + distances[next], [] {});
+    next = next + 1 == pending ? 0 : next + 1;
+    if (++iteration % 64 == 0) {
+      wheel.advance(wheel.now() + 1, fired);
+      fired.clear();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TimerWheelRearm)->Arg(1000)->Arg(100000);
+
+// Baseline: the same churn on an ordered map of deadlines
+void BM_OrderedMapRearm(benchmark::State &state) {
+  using Timers = std::multimap<std::uint64_t, std::function<void()>>;
+  const auto pending = static_cast<std::size_t>(state.range(0));
+  const auto distances = makeDistances(pending);
+  Timers timers;
+  std::vector<Timers::iterator> ids(pending);
+  for (std::size_t i = 0; i < pending; ++i) {
+    ids[i] = timers.emplace(distances[i], [] {});
+  }
+
+  std::uint64_t now = 0;
+  std::size_t next = 0;
+  std::uint64_t iteration = 0;
+  for (auto _ : state) {
+    timers.erase(ids[next]);
+    ids[next] = timers.emplace(now + distances[next], [] {});
+    next = next + 1 == pending ? 0 : next + 1;
+    if (++iteration % 64 == 0) {
+      ++now;
+      benchmark::DoNotOptimize(timers.begin()->first <= now);
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_OrderedMapRearm)->Arg(1000)->Arg(100000);
+
+} // namespace
+} // namespace timing
@@ -0,0 +1,431 @@
+#include "cluster/event_codec.hpp"
+
+#include <type_traits>
+#include <utility>
+
+#include "chat.pb.h"
+
+namespace cluster {
+namespace {
+
+enum class EventKind : std::uint8_t {
+  kClientConnected = 1,
+  kClientDisconnected = 2,
+  kMessageSent = 3,
+  kPrivateMessageSent = 4,
+  kNodeHello = 5,
+  kPresenceSnapshot = 6,
+  kPseudonymClaim = 7,
+  kPseudonymClaimReply = 8,
+  kPseudonymRelease = 9,
+};
+
+// Integers are little-endian on the wire, whatever the host order
+template <typename T> void storeInteger(char *out, T value) {
+  auto bits = static_cast<std::make_unsigned_t<T>>(value);
+  for (std::size_t i = 0; i < sizeof(T); ++i) {
+    out[i] = static_cast<char>(bits & 0xFFU);
+    bits = static_cast<decltype(bits)>(bits >> 8U);
+  }
+}
+
+template <typename T> T loadInteger(const char *in) {
+  std::make_unsigned_t<T> bits = 0;
+  for (std::size_t i = sizeof(T); i-- > 0;) {
+    bits = static_cast<decltype(bits)>(
+        (bits << 8U) | static_cast<unsigned char>(in[i]));
+  }
+  return static_cast<T>(bits);
+}
+
+class FrameWriter {
+public:
+  FrameWriter(std::string &out, EventKind kind)
+      : out_(out), start_(out.size()) {
+    out_.append(kFrameHeaderSize, '\0');
+    writeByte(static_cast<std::uint8_t>(kind));
+  }
+
+  ~FrameWriter() {
+    storeInteger(out_.data() + start_,
+                 static_cast<std::uint32_t>(out_.size() - start_ -
+                                            kFrameHeaderSize));
+  }
+
+  FrameWriter(const FrameWriter &) = delete;
+  FrameWriter &operator=(const FrameWriter &) = delete;
+
+  void writeByte(std::uint8_t value) {
+    out_.push_back(static_cast<char>(value));
+  }
+
+  template <typename T> void writeValue(T value) {
+    const std::size_t offset = out_.size();
+    out_.append(sizeof(T), '\0');
+    storeInteger(out_.data() + offset, value);
+  }
+
+  void writeString(std::string_view value) {
+    writeValue(static_cast<std::uint32_t>(value.size()));
+    out_.append(value);
+  }
+
+  void writeMessage(const events::ChatMessagePtr &message) {
+    if (!message) {
+      writeString({});
+      return;
+    }
+    const auto &wire = message->wire();
+    writeString(std::string_view(reinterpret_cast<const char *>(wire.begin()),
+                                 wire.size()));
+  }
+
+private:
+  std::string &out_;
+  const std::size_t start_;
+};
+
+class FrameReader {
+public:
+  explicit FrameReader(std::string_view body) : body_(body) {}
+
+  bool readByte(std::uint8_t &value) { return readValue(value); }
+
+  template <typename T> bool readValue(T &value) {
+    if (body_.size() < sizeof(value)) {
+      return false;
+    }
+    value = loadInteger<T>(body_.data());
+    body_.remove_prefix(sizeof(value));
+    return true;
+  }
+
+  // The view points into the frame body
+  bool readBytes(std::string_view &value) {
+    std::uint32_t size = 0;
+    if (!readValue(size) || body_.size() < size) {
+      return false;
+    }
+    value = body_.substr(0, size);
+    body_.remove_prefix(size);
+    return true;
+  }
+
+  bool readString(std::string &value) {
+    std::string_view bytes;
+    if (!readBytes(bytes)) {
+      return false;
+    }
+    value.assign(bytes);
+    return true;
+  }
+
+  bool readMessage(events::ChatMessagePtr &message) {
+    std::string_view wire;
+    if (!readBytes(wire)) {
+      return false;
+    }
+    if (wire.empty()) {
+      message.reset();
+      return true;
+    }
+
+    chat::InformClientsNewMessageResponse proto;
+    if (!proto.ParseFromArray(wire.data(), static_cast<int>(wire.size()))) {
+      return false;
+    }
+    message = events::makeChatMessage(
+        std::move(*proto.mutable_author()), std::move(*proto.mutable_content()),
+        std::move(*proto.mutable_room()), proto.isprivate());
+    return true;
+  }
+
+  bool done() const { return body_.empty(); }
+
+private:
+  std::string_view body_;
+};
+
+void writeFields(FrameWriter &writer,
+                 const events::ClientConnectedEvent &event) {
+  writer.writeString(event.peer);
+  writer.writeString(event.pseudonym);
+  writer.writeString(event.gender);
+  writer.writeString(event.country);
+  writer.writeString(event.resumedPeer);
+}
+
+bool readFields(FrameReader &reader, events::ClientConnectedEvent &event) {
+  return reader.readString(event.peer) && reader.readString(event.pseudonym) &&
+         reader.readString(event.gender) && reader.readString(event.country) &&
+         reader.readString(event.resumedPeer);
+}
+
+void writeFields(FrameWriter &writer,
+                 const events::ClientDisconnectedEvent &event) {
+  writer.writeString(event.peer);
+  writer.writeString(event.pseudonym);
+  writer.writeValue(static_cast<std::int64_t>(event.connectionDuration.count()));
+}
+
+bool readFields(FrameReader &reader, events::ClientDisconnectedEvent &event) {
+  std::int64_t duration = 0;
+  if (!reader.readString(event.peer) || !reader.readString(event.pseudonym) ||
+      !reader.readValue(duration)) {
+    return false;
+  }
+  event.connectionDuration = std::chrono::steady_clock::duration(duration);
+  return true;
+}
+
+void writeFields(FrameWriter &writer, const events::MessageSentEvent &event) {
+  writer.writeString(event.peer);
+  writer.writeString(event.pseudonym);
+  writer.writeString(event.room);
+  writer.writeMessage(event.message);
+}
+
+bool readFields(FrameReader &reader, events::MessageSentEvent &event) {
+  return reader.readString(event.peer) && reader.readString(event.pseudonym) &&
+         reader.readString(event.room) && reader.readMessage(event.message);
+}
+
+void writeFields(FrameWriter &writer,
+                 const events::PrivateMessageSentEvent &event) {
+  writer.writeString(event.senderPeer);
+  writer.writeString(event.senderPseudonym);
+  writer.writeString(event.recipientPeer);
+  writer.writeString(event.recipientPseudonym);
+  writer.writeMessage(event.message);
+}
+
+bool readFields(FrameReader &reader, events::PrivateMessageSentEvent &event) {
+  return reader.readString(event.senderPeer) &&
+         reader.readString(event.senderPseudonym) &&
+         reader.readString(event.recipientPeer) &&
+         reader.readString(event.recipientPseudonym) &&
+         reader.readMessage(event.message);
+}
+
+void writeFields(FrameWriter &writer, const NodeHello &hello) {
+  writer.writeString(hello.nodeId);
+}
+
+bool readFields(FrameReader &reader, NodeHello &hello) {
+  return reader.readString(hello.nodeId);
+}
+
+void writeFields(FrameWriter &writer, const PresenceSnapshot &snapshot) {
+  writer.writeValue(static_cast<std::uint32_t>(snapshot.clients.size()));
+  for (const auto &client : snapshot.clients) {
+    writeFields(writer, client);
+  }
+}
+
+bool readFields(FrameReader &reader, PresenceSnapshot &snapshot) {
+  std::uint32_t count = 0;
+  if (!reader.readValue(count)) {
+    return false;
+  }
+  for (std::uint32_t i = 0; i < count; ++i) {
+    if (!readFields(reader, snapshot.clients.emplace_back())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void writeFields(FrameWriter &writer, const PseudonymClaim &claim) {
+  writer.writeValue(claim.requestId);
+  writer.writeString(claim.pseudonym);
+  writer.writeString(claim.peer);
+  writer.writeValue(claim.token);
+}
+
+bool readFields(FrameReader &reader, PseudonymClaim &claim) {
+  return reader.readValue(claim.requestId) &&
+         reader.readString(claim.pseudonym) && reader.readString(claim.peer) &&
+         reader.readValue(claim.token);
+}
+
+void writeFields(FrameWriter &writer, const PseudonymClaimReply &reply) {
+  writer.writeValue(reply.requestId);
+  writer.writeString(reply.pseudonym);
+  writer.writeByte(static_cast<std::uint8_t>(reply.result));
+  writer.writeValue(reply.token);
+}
+
+bool readFields(FrameReader &reader, PseudonymClaimReply &reply) {
+  std::uint8_t result = 0;
+  if (!reader.readValue(reply.requestId) ||
+      !reader.readString(reply.pseudonym) || !reader.readByte(result) ||
+      result > static_cast<std::uint8_t>(domain::ClaimResult::kUnavailable)) {
+    return false;
+  }
+  reply.result = static_cast<domain::ClaimResult>(result);
+  return reader.readValue(reply.token);
+}
+
+void writeFields(FrameWriter &writer, const PseudonymRelease &release) {
+  writer.writeString(release.pseudonym);
+  writer.writeString(release.peer);
+  writer.writeValue(release.token);
+}
+
+bool readFields(FrameReader &reader, PseudonymRelease &release) {
+  return reader.readString(release.pseudonym) &&
+         reader.readString(release.peer) && reader.readValue(release.token);
+}
+
+template <typename Event>
+void encode(EventKind kind, const Event &event, std::uint64_t sequence,
+            std::string &out) {
+  FrameWriter writer(out, kind);
+  writer.writeValue(sequence);
+  writeFields(writer, event);
+}
+
+template <typename Event>
+std::optional<DecodedFrame> decode(FrameReader &reader,
+                                   std::uint64_t sequence) {
+  Event event;
+  if (!readFields(reader, event) || !reader.done()) {
+    return std::nullopt;
+  }
+  return DecodedFrame{.sequence = sequence, .event = std::move(event)};
+}
+
+} // namespace
+
+void encodeEvent(const events::ClientConnectedEvent &event,
+                 std::uint64_t sequence, std::string &out) {
+  encode(EventKind::kClientConnected, event, sequence, out);
+}
+
+void encodeEvent(const events::ClientDisconnectedEvent &event,
+                 std::uint64_t sequence, std::string &out) {
+  encode(EventKind::kClientDisconnected, event, sequence, out);
+}
+
+void encodeEvent(const events::MessageSentEvent &event, std::uint64_t sequence,
+                 std::string &out) {
+  encode(EventKind::kMessageSent, event, sequence, out);
+}
+
+void encodeEvent(const events::PrivateMessageSentEvent &event,
+                 std::uint64_t sequence, std::string &out) {
+  encode(EventKind::kPrivateMessageSent, event, sequence, out);
+}
+
+void encodeEvent(const NodeHello &hello, std::uint64_t sequence,
+                 std::string &out) {
+  encode(EventKind::kNodeHello, hello, sequence, out);
+}
+
+void encodeEvent(const PresenceSnapshot &snapshot, std::uint64_t sequence,
+                 std::string &out) {
+  encode(EventKind::kPresenceSnapshot, snapshot, sequence, out);
+}
+
+void encodeEvent(const ClaimMessage &message, std::uint64_t sequence,
+                 std::string &out) {
+  std::visit(
+      [sequence, &out](const auto &claim) {
+        using Message = std::decay_t<decltype(claim)>;
+        if constexpr (std::is_same_v<Message, PseudonymClaim>) {
+          encode(EventKind::kPseudonymClaim, claim, sequence, out);
+        } else if constexpr (std::is_same_v<Message, PseudonymClaimReply>) {
+          encode(EventKind::kPseudonymClaimReply, claim, sequence, out);
+        } else {
+          encode(EventKind::kPseudonymRelease, claim, sequence, out);
+        }
+      },
+      message);
+}
+
+std::optional<std::size_t> frameBodySize(std::string_view buffer) {
+  std::uint32_t bodySize = 0;
+  if (!FrameReader(buffer).readValue(bodySize)) {
+    return std::nullopt;
+  }
+  return bodySize;
+}
+
+std::optional<DecodedFrame> decodeEvent(std::string_view body) {
+  FrameReader reader(body);
+  std::uint8_t kind = 0;
+  std::uint64_t sequence = 0;
+  if (!reader.readByte(kind) || !reader.readValue(sequence)) {
+    return std::nullopt;
+  }
+
+  switch (static_cast<EventKind>(kind)) {
+  case EventKind::kClientConnected:
+    return decode<events::ClientConnectedEvent>(reader, sequence);
+  case EventKind::kClientDisconnected:
+    return decode<events::ClientDisconnectedEvent>(reader, sequence);
+  case EventKind::kMessageSent:
+    return decode<events::MessageSentEvent>(reader, sequence);
+  case EventKind::kPrivateMessageSent:
+    return decode<events::PrivateMessageSentEvent>(reader, sequence);
+  case EventKind::kNodeHello:
+    return decode<NodeHello>(reader, sequence);
+  case EventKind::kPresenceSnapshot:
+    return decode<PresenceSnapshot>(reader, sequence);
+  case EventKind::kPseudonymClaim:
+    return decode<PseudonymClaim>(reader, sequence);
+  case EventKind::kPseudonymClaimReply:
+    return decode<PseudonymClaimReply>(reader, sequence);
+  case EventKind::kPseudonymRelease:
+    return decode<PseudonymRelease>(reader, sequence);
+  }
+
+  return std::nullopt;
+}
+
+void setOriginNode(RelayedEvent &event, const std::string &nodeId) {
+  if (auto *connected = std::get_if<events::ClientConnectedEvent>(&event)) {
+    connected->node = nodeId;
+  } else if (auto *snapshot = std::get_if<PresenceSnapshot>(&event)) {
+    for (auto &client : snapshot->clients) {
+      client.node = nodeId;
+    }
+  }
+}
+
+std::optional<ClaimMessage> takeClaimMessage(RelayedEvent &event) {
+  return std::visit(
+      [](auto &decoded) -> std::optional<ClaimMessage> {
+        using Event = std::decay_t<decltype(decoded)>;
+        if constexpr (std::is_same_v<Event, PseudonymClaim> ||
+                      std::is_same_v<Event, PseudonymClaimReply> ||
+                      std::is_same_v<Event, PseudonymRelease>) {
+          return ClaimMessage(std::move(decoded));
+        } else {
+          return std::nullopt;
+        }
+      },
+      event);
+}
+
+void dispatchEvent(const RelayedEvent &event,
+                   events::EventDispatcher &dispatcher) {
+  std::visit(
+      [&dispatcher](const auto &decoded) {
+        using Event = std::decay_t<decltype(decoded)>;
+        if constexpr (std::is_same_v<Event, events::ClientConnectedEvent>) {
+          dispatcher.notifyClientConnected(decoded);
+        } else if constexpr (std::is_same_v<Event,
+                                            events::ClientDisconnectedEvent>) {
+          dispatcher.notifyClientDisconnected(decoded);
+        } else if constexpr (std::is_same_v<Event, events::MessageSentEvent>) {
+          dispatcher.notifyMessageSent(decoded);
+        } else if constexpr (std::is_same_v<Event,
+                                            events::PrivateMessageSentEvent>) {
+          dispatcher.notifyPrivateMessageSent(decoded);
+        }
+      },
+      event);
+}
+
+} // namespace cluster
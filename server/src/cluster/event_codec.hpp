@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "domain/pseudonym_arbiter.hpp"
+#include "service/events/chat_service_events.hpp"
+#include "service/events/chat_service_events_dispatcher.hpp"
+
+namespace cluster {
+
+// Wire format of the events exchanged between server nodes.
+//
+// Each frame is a 32-bit body length followed by the body: one kind byte, the
+// sender's sequence number and the fields, integers in little-endian order.
+// Chat payloads travel as their already serialized proto, so a relayed
+// message is not encoded again. Node identities are not part of the events:
+// a bus learns them from the hello that opens every link.
+
+// First frame on every link, naming the node at the sending end
+struct NodeHello {
+  std::string nodeId;
+};
+
+// Every client held by the sending node, periodically sent so that peers
+// can repair a presence directory that missed events
+struct PresenceSnapshot {
+  std::vector<events::ClientConnectedEvent> clients;
+};
+
+// Asks the owner of a pseudonym for a lease; a non-zero token renews one
+struct PseudonymClaim {
+  std::uint64_t requestId = 0;
+  std::string pseudonym;
+  std::string peer;
+  std::uint64_t token = 0;
+};
+
+// The owner's answer; renewals are answered with request id 0
+struct PseudonymClaimReply {
+  std::uint64_t requestId = 0;
+  std::string pseudonym;
+  domain::ClaimResult result = domain::ClaimResult::kUnavailable;
+  std::uint64_t token = 0;
+};
+
+struct PseudonymRelease {
+  std::string pseudonym;
+  std::string peer;
+  std::uint64_t token = 0;
+};
+
+using ClaimMessage =
+    std::variant<PseudonymClaim, PseudonymClaimReply, PseudonymRelease>;
+
+using RelayedEvent =
+    std::variant<events::ClientConnectedEvent, events::ClientDisconnectedEvent,
+                 events::MessageSentEvent, events::PrivateMessageSentEvent,
+                 NodeHello, PresenceSnapshot, PseudonymClaim,
+                 PseudonymClaimReply, PseudonymRelease>;
+
+struct DecodedFrame {
+  // Position in the sender's stream of frames
+  std::uint64_t sequence = 0;
+  RelayedEvent event;
+};
+
+inline constexpr std::size_t kFrameHeaderSize = sizeof(std::uint32_t);
+
+// Append one complete frame carrying the event to `out`.
+void encodeEvent(const events::ClientConnectedEvent &event,
+                 std::uint64_t sequence, std::string &out);
+void encodeEvent(const events::ClientDisconnectedEvent &event,
+                 std::uint64_t sequence, std::string &out);
+void encodeEvent(const events::MessageSentEvent &event, std::uint64_t sequence,
+                 std::string &out);
+void encodeEvent(const events::PrivateMessageSentEvent &event,
+                 std::uint64_t sequence, std::string &out);
+void encodeEvent(const NodeHello &hello, std::uint64_t sequence,
+                 std::string &out);
+void encodeEvent(const PresenceSnapshot &snapshot, std::uint64_t sequence,
+                 std::string &out);
+void encodeEvent(const ClaimMessage &message, std::uint64_t sequence,
+                 std::string &out);
+
+// Body length announced by the frame header at the start of `buffer`.
+std::optional<std::size_t> frameBodySize(std::string_view buffer);
+
+// Decode a frame body; nullopt when it is truncated or malformed.
+std::optional<DecodedFrame> decodeEvent(std::string_view body);
+
+// Record that a decoded event comes from `nodeId`: clients it connects are
+// held there.
+void setOriginNode(RelayedEvent &event, const std::string &nodeId);
+
+// The pseudonym claim message carried by `event`, if any.
+std::optional<ClaimMessage> takeClaimMessage(RelayedEvent &event);
+
+// Notify `dispatcher` of a decoded chat event; frames meant for the bus
+// itself are ignored here.
+void dispatchEvent(const RelayedEvent &event,
+                   events::EventDispatcher &dispatcher);
+
+} // namespace cluster
@@ -0,0 +1,62 @@
+#include "cluster/hash_ring.hpp"
+
+#include <algorithm>
+
+namespace cluster {
+
+HashRing::HashRing(std::size_t virtualNodes)
+    : virtualNodes_(std::max<std::size_t>(virtualNodes, 1)) {}
+
+void HashRing::addNode(const std::string &node) {
+  const auto position = std::lower_bound(nodes_.begin(), nodes_.end(), node);
+  if (position != nodes_.end() && *position == node) {
+    return;
+  }
+  nodes_.insert(position, node);
+
+  for (std::size_t i = 0; i < virtualNodes_; ++i) {
+    points_.emplace_back(hash(node + "#" + std::to_string(i)), node);
+  }
+  // Ties are broken by node name so that every member sorts alike
+  std::sort(points_.begin(), points_.end());
+}
+
+void HashRing::removeNode(const std::string &node) {
+  std::erase(nodes_, node);
+  std::erase_if(points_,
+                [&node](const auto &point) { return point.second == node; });
+}
+
+const std::string &HashRing::ownerOf(std::string_view key) const {
+  static const std::string kNoOwner;
+  if (points_.empty()) {
+    return kNoOwner;
+  }
+
+  const std::uint64_t point = hash(key);
+  auto it = std::lower_bound(points_.cbegin(), points_.cend(), point,
+                             [](const auto &entry, std::uint64_t value) {
+                               return entry.first < value;
+                             });
+  if (it == points_.cend()) {
+    it = points_.cbegin();
+  }
+  return it->second;
+}
+
+std::uint64_t HashRing::hash(std::string_view key) {
+  // FNV-1a, then the splitmix64 finalizer to spread similar keys
+  std::uint64_t value = 14695981039346656037ULL;
+  for (const char c : key) {
+    value ^= static_cast<unsigned char>(c);
+    value *= 1099511628211ULL;
+  }
+  value ^= value >> 30U;
+  value *= 0xbf58476d1ce4e5b9ULL;
+  value ^= value >> 27U;
+  value *= 0x94d049bb133111ebULL;
+  value ^= value >> 31U;
+  return value;
+}
+
+} // namespace cluster
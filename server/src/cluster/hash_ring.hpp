@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace cluster {
+
+// Consistent hash ring mapping keys to nodes.
+//
+// Each node is placed at `virtualNodes` points of the ring and owns the keys
+// hashing between its points and the previous ones, so adding or removing a
+// node only moves about 1/N of the keys. The hash is computed the same way
+// on every build, so all nodes agree on owners.
+class HashRing {
+public:
+  explicit HashRing(std::size_t virtualNodes = 64);
+
+  void addNode(const std::string &node);
+  void removeNode(const std::string &node);
+
+  // Node owning `key`; empty when the ring has no node.
+  const std::string &ownerOf(std::string_view key) const;
+
+  // Member nodes, sorted
+  const std::vector<std::string> &nodes() const { return nodes_; }
+
+  static std::uint64_t hash(std::string_view key);
+
+private:
+  std::size_t virtualNodes_;
+  std::vector<std::string> nodes_;
+  // (point, node), sorted by point
+  std::vector<std::pair<std::uint64_t, std::string>> points_;
+};
+
+} // namespace cluster
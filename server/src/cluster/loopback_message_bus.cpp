@@ -0,0 +1,75 @@
+#include "cluster/loopback_message_bus.hpp"
+
+#include <string_view>
+#include <utility>
+
+#include "cluster/event_codec.hpp"
+
+namespace cluster {
+
+void LoopbackMessageBus::Hub::deliver(const LoopbackMessageBus &sender,
+                                      const std::string &frame,
+                                      const std::string &targetNode) {
+  auto decoded = decodeEvent(std::string_view(frame).substr(kFrameHeaderSize));
+  if (!decoded) {
+    return;
+  }
+  setOriginNode(decoded->event, sender.nodeId_);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const LoopbackMessageBus *bus : buses_) {
+    if (bus == &sender || bus->remote_ == nullptr ||
+        (!targetNode.empty() && bus->nodeId_ != targetNode)) {
+      continue;
+    }
+    dispatchEvent(decoded->event, *bus->remote_);
+  }
+}
+
+LoopbackMessageBus::LoopbackMessageBus(std::shared_ptr<Hub> hub,
+                                       std::string nodeId)
+    : hub_(std::move(hub)), nodeId_(std::move(nodeId)) {
+  std::lock_guard<std::mutex> lock(hub_->mutex_);
+  hub_->buses_.push_back(this);
+}
+
+LoopbackMessageBus::~LoopbackMessageBus() {
+  std::lock_guard<std::mutex> lock(hub_->mutex_);
+  std::erase(hub_->buses_, this);
+}
+
+void LoopbackMessageBus::publish(const events::ClientConnectedEvent &event) {
+  publishEvent(event);
+}
+
+void LoopbackMessageBus::publish(
+    const events::ClientDisconnectedEvent &event) {
+  publishEvent(event);
+}
+
+void LoopbackMessageBus::publish(const events::MessageSentEvent &event) {
+  publishEvent(event);
+}
+
+void LoopbackMessageBus::publish(
+    const events::PrivateMessageSentEvent &event) {
+  // A recipient on this node was served by the local observers
+  if (!event.recipientNode.empty()) {
+    publishEvent(event, event.recipientNode);
+  }
+}
+
+void LoopbackMessageBus::start(events::EventDispatcher &remote) {
+  std::lock_guard<std::mutex> lock(hub_->mutex_);
+  remote_ = &remote;
+}
+
+template <typename Event>
+void LoopbackMessageBus::publishEvent(const Event &event,
+                                      const std::string &targetNode) {
+  std::string frame;
+  encodeEvent(event, 0, frame);
+  hub_->deliver(*this, frame, targetNode);
+}
+
+} // namespace cluster
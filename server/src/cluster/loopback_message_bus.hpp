@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "service/events/chat_service_events_dispatcher.hpp"
+#include "service/events/message_bus.hpp"
+
+namespace cluster {
+
+// In-process bus connecting nodes that live in the same process, for tests.
+//
+// Buses created on the same Hub see each other's events, and a private
+// message reaches only the recipient's node. Delivery is synchronous but goes
+// through the wire codec, so remote nodes observe exactly what a socket bus
+// would hand them.
+class LoopbackMessageBus final : public events::IMessageBus {
+public:
+  class Hub {
+  public:
+    // Deliver to every other bus, or only to `targetNode` when it is set.
+    void deliver(const LoopbackMessageBus &sender, const std::string &frame,
+                 const std::string &targetNode);
+
+  private:
+    friend class LoopbackMessageBus;
+
+    std::mutex mutex_;
+    std::vector<LoopbackMessageBus *> buses_;
+  };
+
+  LoopbackMessageBus(std::shared_ptr<Hub> hub, std::string nodeId);
+  ~LoopbackMessageBus() override;
+
+  LoopbackMessageBus(const LoopbackMessageBus &) = delete;
+  LoopbackMessageBus &operator=(const LoopbackMessageBus &) = delete;
+  LoopbackMessageBus(LoopbackMessageBus &&) = delete;
+  LoopbackMessageBus &operator=(LoopbackMessageBus &&) = delete;
+
+  void publish(const events::ClientConnectedEvent &event) override;
+  void publish(const events::ClientDisconnectedEvent &event) override;
+  void publish(const events::MessageSentEvent &event) override;
+  void publish(const events::PrivateMessageSentEvent &event) override;
+
+  void start(events::EventDispatcher &remote) override;
+
+private:
+  template <typename Event>
+  void publishEvent(const Event &event, const std::string &targetNode = {});
+
+  const std::shared_ptr<Hub> hub_;
+  const std::string nodeId_;
+  events::EventDispatcher *remote_ = nullptr;
+};
+
+} // namespace cluster
@@ -0,0 +1,48 @@
+#include "cluster/pseudonym_leases.hpp"
+
+namespace cluster {
+
+PseudonymLeases::Grant
+PseudonymLeases::claim(const std::string &pseudonym, const Holder &holder,
+                       std::uint64_t token, Clock::time_point now,
+                       Clock::time_point expiry) {
+  auto it = leases_.find(pseudonym);
+  if (it != leases_.end() && it->second.expiry > now) {
+    Lease &lease = it->second;
+    if (lease.holder != holder || (token != 0 && token != lease.token)) {
+      return {.granted = false, .token = lease.token};
+    }
+    lease.expiry = expiry;
+    return {.granted = true, .token = lease.token};
+  }
+
+  const std::uint64_t granted = nextToken_++;
+  leases_.insert_or_assign(
+      pseudonym, Lease{.holder = holder, .token = granted, .expiry = expiry});
+  return {.granted = true, .token = granted};
+}
+
+bool PseudonymLeases::release(std::string_view pseudonym, const Holder &holder,
+                              std::uint64_t token) {
+  auto it = leases_.find(pseudonym);
+  if (it == leases_.end() || it->second.holder != holder ||
+      it->second.token != token) {
+    return false;
+  }
+  leases_.erase(it);
+  return true;
+}
+
+bool PseudonymLeases::isHeld(std::string_view pseudonym,
+                             Clock::time_point now) const {
+  auto it = leases_.find(pseudonym);
+  return it != leases_.end() && it->second.expiry > now;
+}
+
+std::size_t PseudonymLeases::expire(Clock::time_point now) {
+  return std::erase_if(leases_, [now](const auto &entry) {
+    return entry.second.expiry <= now;
+  });
+}
+
+} // namespace cluster
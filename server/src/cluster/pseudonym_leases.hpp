@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace cluster {
+
+// Leases granted by the owner of a set of pseudonyms.
+//
+// A lease names the node and peer holding the pseudonym and lasts until its
+// expiry unless renewed. Every new grant carries a larger fencing token, so
+// that a holder whose lease was lost and granted again cannot renew or
+// release the newer one.
+class PseudonymLeases {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Holder {
+    std::string node;
+    std::string peer;
+
+    bool operator==(const Holder &) const = default;
+  };
+
+  struct Grant {
+    bool granted = false;
+    // Token of the current lease, granted or not
+    std::uint64_t token = 0;
+  };
+
+  // Grants or renews the lease for `holder` until `expiry`. A renewal with
+  // a non-zero `token` must match the current lease, if there is one.
+  Grant claim(const std::string &pseudonym, const Holder &holder,
+              std::uint64_t token, Clock::time_point now,
+              Clock::time_point expiry);
+
+  // Ends the lease if `holder` still holds it under `token`.
+  bool release(std::string_view pseudonym, const Holder &holder,
+               std::uint64_t token);
+
+  // True when someone holds an unexpired lease on `pseudonym`.
+  bool isHeld(std::string_view pseudonym, Clock::time_point now) const;
+
+  // Drops expired leases; returns how many.
+  std::size_t expire(Clock::time_point now);
+
+  std::size_t size() const { return leases_.size(); }
+
+private:
+  struct Lease {
+    Holder holder;
+    std::uint64_t token = 0;
+    Clock::time_point expiry;
+  };
+
+  struct StringHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view value) const {
+      return std::hash<std::string_view>{}(value);
+    }
+  };
+
+  std::unordered_map<std::string, Lease, StringHash, std::equal_to<>> leases_;
+  std::uint64_t nextToken_ = 1;
+};
+
+} // namespace cluster
@@ -0,0 +1,286 @@
+#include "cluster/pseudonym_ownership.hpp"
+
+#include <iostream>
+#include <optional>
+#include <tuple>
+
+namespace cluster {
+
+using domain::ClaimResult;
+
+PseudonymOwnership::PseudonymOwnership(Config config, Now now)
+    : config_(std::move(config)), now_(std::move(now)),
+      ring_(config_.virtualNodes), previousRing_(config_.virtualNodes),
+      graceUntil_(now_() + config_.leaseDuration) {
+  ring_.addNode(config_.nodeId);
+}
+
+void PseudonymOwnership::attachTransport(
+    std::weak_ptr<IClaimTransport> transport) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  transport_ = std::move(transport);
+}
+
+void PseudonymOwnership::claim(const std::string &peer,
+                               const std::string &pseudonym,
+                               ClaimCallback done) {
+  const auto now = now_();
+  Outbox outbox;
+  std::optional<ClaimResult> decided;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::string &owner = ring_.ownerOf(pseudonym);
+    if (owner == config_.nodeId) {
+      const auto [result, token] = grantLocked(
+          pseudonym, {.node = config_.nodeId, .peer = peer}, 0, now);
+      if (result == ClaimResult::kGranted) {
+        held_[pseudonym] = HeldLease{.peer = peer, .token = token};
+      }
+      decided = result;
+    } else {
+      const std::uint64_t requestId = nextRequestId_++;
+      outbox.emplace_back(owner, PseudonymClaim{.requestId = requestId,
+                                                .pseudonym = pseudonym,
+                                                .peer = peer,
+                                                .token = 0});
+      pending_.emplace(requestId,
+                       PendingClaim{.peer = peer,
+                                    .deadline = now + config_.claimTimeout,
+                                    .done = std::move(done)});
+    }
+  }
+
+  if (decided) {
+    done(*decided);
+    return;
+  }
+  send(outbox);
+}
+
+void PseudonymOwnership::receive(const std::string &node,
+                                 const ClaimMessage &message) {
+  const auto now = now_();
+  Outbox outbox;
+  std::vector<std::pair<ClaimCallback, ClaimResult>> completed;
+  LostLeases lost;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (const auto *claim = std::get_if<PseudonymClaim>(&message)) {
+      PseudonymClaimReply reply{.requestId = claim->requestId,
+                                .pseudonym = claim->pseudonym,
+                                .result = ClaimResult::kUnavailable,
+                                .token = 0};
+      // A claimant with another view of the membership retries later
+      if (ring_.ownerOf(claim->pseudonym) == config_.nodeId) {
+        std::tie(reply.result, reply.token) =
+            grantLocked(claim->pseudonym, {.node = node, .peer = claim->peer},
+                        claim->token, now);
+      }
+      outbox.emplace_back(node, std::move(reply));
+    } else if (const auto *reply =
+                   std::get_if<PseudonymClaimReply>(&message)) {
+      receiveReply(*reply, completed, lost);
+    } else if (const auto *release = std::get_if<PseudonymRelease>(&message)) {
+      leases_.release(release->pseudonym,
+                      {.node = node, .peer = release->peer}, release->token);
+    }
+  }
+
+  send(outbox);
+  for (auto &[done, result] : completed) {
+    done(result);
+  }
+  notifyLost(lost);
+}
+
+void PseudonymOwnership::setMembers(const std::vector<std::string> &nodes) {
+  const auto now = now_();
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  HashRing ring(config_.virtualNodes);
+  ring.addNode(config_.nodeId);
+  for (const auto &node : nodes) {
+    ring.addNode(node);
+  }
+  if (ring.nodes() == ring_.nodes()) {
+    return;
+  }
+
+  // Within a grace period, keep the view from before its first change
+  if (now >= graceUntil_) {
+    previousRing_ = std::move(ring_);
+  }
+  ring_ = std::move(ring);
+  graceUntil_ = now + config_.leaseDuration;
+  // Let the new owners hear from the holders right away
+  nextRenewal_ = now;
+}
+
+void PseudonymOwnership::tick() {
+  const auto now = now_();
+  Outbox outbox;
+  std::vector<ClaimCallback> overdue;
+  LostLeases lost;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::erase_if(pending_, [now, &overdue](auto &entry) {
+      if (entry.second.deadline > now) {
+        return false;
+      }
+      overdue.push_back(std::move(entry.second.done));
+      return true;
+    });
+    leases_.expire(now);
+
+    if (now >= nextRenewal_) {
+      nextRenewal_ = now + config_.leaseDuration / 3;
+      for (auto it = held_.begin(); it != held_.end();) {
+        const std::string &owner = ring_.ownerOf(it->first);
+        if (owner != config_.nodeId) {
+          outbox.emplace_back(owner, PseudonymClaim{.requestId = 0,
+                                                    .pseudonym = it->first,
+                                                    .peer = it->second.peer,
+                                                    .token = it->second.token});
+          ++it;
+          continue;
+        }
+
+        const auto [result, token] = grantLocked(
+            it->first, {.node = config_.nodeId, .peer = it->second.peer},
+            it->second.token, now);
+        if (result == ClaimResult::kTaken) {
+          std::cerr << "Lost the lease on pseudonym '" << it->first << "'"
+                    << std::endl;
+          lost.emplace_back(std::move(it->second.peer), it->first);
+          it = held_.erase(it);
+          continue;
+        }
+        it->second.token = token;
+        ++it;
+      }
+    }
+  }
+
+  send(outbox);
+  for (auto &done : overdue) {
+    done(ClaimResult::kUnavailable);
+  }
+  notifyLost(lost);
+}
+
+std::string PseudonymOwnership::ownerOf(std::string_view pseudonym) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return ring_.ownerOf(pseudonym);
+}
+
+void PseudonymOwnership::onClientConnected(
+    [[maybe_unused]] const events::ClientConnectedEvent &event) {}
+
+void PseudonymOwnership::onClientDisconnected(
+    const events::ClientDisconnectedEvent &event) {
+  Outbox outbox;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = held_.find(event.pseudonym);
+    if (it == held_.end() || it->second.peer != event.peer) {
+      return;
+    }
+    const std::uint64_t token = it->second.token;
+    held_.erase(it);
+
+    const std::string &owner = ring_.ownerOf(event.pseudonym);
+    if (owner == config_.nodeId) {
+      leases_.release(event.pseudonym,
+                      {.node = config_.nodeId, .peer = event.peer}, token);
+    } else {
+      outbox.emplace_back(owner, PseudonymRelease{.pseudonym = event.pseudonym,
+                                                  .peer = event.peer,
+                                                  .token = token});
+    }
+  }
+  send(outbox);
+}
+
+void PseudonymOwnership::onMessageSent(
+    [[maybe_unused]] const events::MessageSentEvent &event) {}
+
+void PseudonymOwnership::onPrivateMessageSent(
+    [[maybe_unused]] const events::PrivateMessageSentEvent &event) {}
+
+std::pair<ClaimResult, std::uint64_t>
+PseudonymOwnership::grantLocked(const std::string &pseudonym,
+                                const PseudonymLeases::Holder &holder,
+                                std::uint64_t token, Clock::time_point now) {
+  // A lease granted by the previous owner may still be live; only its holder
+  // may claim the pseudonym until the grace period ends
+  if (token == 0 && now < graceUntil_ && !leases_.isHeld(pseudonym, now) &&
+      previousRing_.ownerOf(pseudonym) != config_.nodeId) {
+    return {ClaimResult::kUnavailable, 0};
+  }
+
+  const auto grant =
+      leases_.claim(pseudonym, holder, token, now, now + config_.leaseDuration);
+  return {grant.granted ? ClaimResult::kGranted : ClaimResult::kTaken,
+          grant.token};
+}
+
+void PseudonymOwnership::receiveReply(
+    const PseudonymClaimReply &reply,
+    std::vector<std::pair<ClaimCallback, ClaimResult>> &completed,
+    LostLeases &lost) {
+  if (reply.requestId != 0) {
+    auto pending = pending_.find(reply.requestId);
+    if (pending == pending_.end()) {
+      // Answered after the claim timed out; the lease expires unrenewed
+      return;
+    }
+    if (reply.result == ClaimResult::kGranted) {
+      held_[reply.pseudonym] =
+          HeldLease{.peer = pending->second.peer, .token = reply.token};
+    }
+    completed.emplace_back(std::move(pending->second.done), reply.result);
+    pending_.erase(pending);
+    return;
+  }
+
+  auto held = held_.find(reply.pseudonym);
+  if (held == held_.end()) {
+    return;
+  }
+  if (reply.result == ClaimResult::kGranted) {
+    held->second.token = reply.token;
+  } else if (reply.result == ClaimResult::kTaken) {
+    std::cerr << "Lost the lease on pseudonym '" << reply.pseudonym << "'"
+              << std::endl;
+    lost.emplace_back(std::move(held->second.peer), reply.pseudonym);
+    held_.erase(held);
+  }
+}
+
+void PseudonymOwnership::send(const Outbox &outbox) {
+  if (outbox.empty()) {
+    return;
+  }
+  std::shared_ptr<IClaimTransport> transport;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    transport = transport_.lock();
+  }
+  if (!transport) {
+    return;
+  }
+  for (const auto &[node, message] : outbox) {
+    transport->sendClaim(node, message);
+  }
+}
+
+void PseudonymOwnership::notifyLost(const LostLeases &lost) const {
+  if (!config_.leaseLost) {
+    return;
+  }
+  for (const auto &[peer, pseudonym] : lost) {
+    config_.leaseLost(peer, pseudonym);
+  }
+}
+
+} // namespace cluster
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cluster/event_codec.hpp"
+#include "cluster/hash_ring.hpp"
+#include "cluster/pseudonym_leases.hpp"
+#include "domain/pseudonym_arbiter.hpp"
+#include "service/events/chat_service_events.hpp"
+
+namespace cluster {
+
+// Carries claim messages to another node.
+class IClaimTransport {
+public:
+  virtual ~IClaimTransport() = default;
+
+  virtual void sendClaim(const std::string &node,
+                         const ClaimMessage &message) = 0;
+};
+
+// Cluster-wide pseudonym uniqueness without a central store.
+//
+// Each pseudonym is owned by the node a consistent hash ring maps it to, and
+// a connect claims a lease from that owner, which grants it to one client at
+// a time. Holders renew their leases three times per lease period and release
+// them on disconnect; the leases of a node that stops renewing expire, and a
+// holder that finds its lease granted to another client disconnects it. After
+// a membership change, a node grants no new lease on a pseudonym it just took
+// over until one lease period has passed, leaving the current holders time
+// to renew with it. The same holds at startup, before peers are known.
+class PseudonymOwnership final : public domain::IPseudonymArbiter,
+                                 public events::IServiceEventObserver {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Now = std::function<Clock::time_point()>;
+  // Called with the peer and pseudonym of a client of this node whose lease
+  // was granted to another client
+  using LeaseLost = std::function<void(const std::string &peer,
+                                       const std::string &pseudonym)>;
+
+  struct Config {
+    std::string nodeId;
+    std::size_t virtualNodes = 64;
+    std::chrono::milliseconds leaseDuration{6000};
+    // Claims the owner has not answered by then are unavailable
+    std::chrono::milliseconds claimTimeout{2000};
+    // Runs outside of the lock, on the thread of the tick or receive that
+    // found the lease lost; the client must be disconnected, as its
+    // pseudonym now belongs to someone else
+    LeaseLost leaseLost;
+  };
+
+  explicit PseudonymOwnership(Config config, Now now = Clock::now);
+
+  void attachTransport(std::weak_ptr<IClaimTransport> transport);
+
+  // IPseudonymArbiter
+  void claim(const std::string &peer, const std::string &pseudonym,
+             ClaimCallback done) override;
+
+  // Handles a claim message sent by `node`.
+  void receive(const std::string &node, const ClaimMessage &message);
+
+  // Sets the other nodes currently reachable.
+  void setMembers(const std::vector<std::string> &nodes);
+
+  // Renews held leases when due, fails overdue claims and drops expired
+  // leases; call it several times per lease period.
+  void tick();
+
+  // Node owning `pseudonym` in the current membership
+  std::string ownerOf(std::string_view pseudonym) const;
+
+  // IServiceEventObserver, registered on the local dispatcher to release
+  // the leases of clients leaving this node
+  void onClientConnected(const events::ClientConnectedEvent &event) override;
+  void
+  onClientDisconnected(const events::ClientDisconnectedEvent &event) override;
+  void onMessageSent(const events::MessageSentEvent &event) override;
+  void
+  onPrivateMessageSent(const events::PrivateMessageSentEvent &event) override;
+
+private:
+  struct HeldLease {
+    std::string peer;
+    std::uint64_t token = 0;
+  };
+
+  struct PendingClaim {
+    std::string peer;
+    Clock::time_point deadline;
+    ClaimCallback done;
+  };
+
+  using Outbox = std::vector<std::pair<std::string, ClaimMessage>>;
+  // Peer and pseudonym of each lease lost
+  using LostLeases = std::vector<std::pair<std::string, std::string>>;
+
+  std::pair<domain::ClaimResult, std::uint64_t>
+  grantLocked(const std::string &pseudonym,
+              const PseudonymLeases::Holder &holder, std::uint64_t token,
+              Clock::time_point now);
+  void receiveReply(const PseudonymClaimReply &reply,
+                    std::vector<std::pair<ClaimCallback, domain::ClaimResult>>
+                        &completed,
+                    LostLeases &lost);
+  void send(const Outbox &outbox);
+  void notifyLost(const LostLeases &lost) const;
+
+  const Config config_;
+  const Now now_;
+
+  mutable std::mutex mutex_;
+  HashRing ring_;
+  // Membership before the changes of the current grace period
+  HashRing previousRing_;
+  Clock::time_point graceUntil_;
+  Clock::time_point nextRenewal_;
+  PseudonymLeases leases_;
+  // Leases held for clients of this node, by pseudonym
+  std::unordered_map<std::string, HeldLease> held_;
+  std::unordered_map<std::uint64_t, PendingClaim> pending_;
+  std::uint64_t nextRequestId_ = 1;
+  std::weak_ptr<IClaimTransport> transport_;
+};
+
+} // namespace cluster
@@ -0,0 +1,721 @@
+#include "cluster/socket_message_bus.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <span>
+#include <string_view>
+#include <system_error>
+#include <unordered_set>
+#include <utility>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "cluster/event_codec.hpp"
+
+namespace cluster {
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr std::string_view kUnixPrefix = "unix:";
+// Upper bound on the time the bus thread takes to notice a stop request
+constexpr int kPollTimeoutMs = 200;
+constexpr auto kReconnectInterval = 1s;
+// Larger frames can only come from a corrupt stream
+constexpr std::size_t kMaxFrameBodySize = 64U << 20U;
+// Connections still not established after this are abandoned and retried
+constexpr auto kConnectTimeout = 1s;
+// Snapshots a node may miss before its clients expire
+constexpr int kMissedSnapshotsBeforeExpiry = 3;
+
+bool isUnixAddress(std::string_view address) {
+  return address.starts_with(kUnixPrefix);
+}
+
+std::system_error addressError(const std::string &address) {
+  return {errno, std::generic_category(), "cluster address '" + address + "'"};
+}
+
+// Opens a listening (`listen`) stream socket, or a non-blocking one whose
+// connection is under way: it polls writable once established, and its
+// SO_ERROR tells how that went. -1 and errno set on failure.
+int openUnixSocket(std::string_view path, bool listen) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  path.copy(address.sun_path, path.size());
+
+  const int fd = ::socket(
+      AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | (listen ? 0 : SOCK_NONBLOCK), 0);
+  if (fd < 0) {
+    return -1;
+  }
+
+  const auto *raw = reinterpret_cast<const sockaddr *>(&address);
+  if (listen) {
+    // Remove the socket file left by a previous run
+    ::unlink(address.sun_path);
+    if (::bind(fd, raw, sizeof(address)) == 0 &&
+        ::listen(fd, SOMAXCONN) == 0) {
+      return fd;
+    }
+  } else if (::connect(fd, raw, sizeof(address)) == 0 ||
+             errno == EINPROGRESS) {
+    return fd;
+  }
+
+  const int error = errno;
+  ::close(fd);
+  errno = error;
+  return -1;
+}
+
+int openTcpSocket(std::string_view address, bool listen) {
+  const auto colon = address.rfind(':');
+  if (colon == std::string_view::npos) {
+    errno = EINVAL;
+    return -1;
+  }
+  std::string host(address.substr(0, colon));
+  const std::string port(address.substr(colon + 1));
+  if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+    host = host.substr(1, host.size() - 2);
+  }
+
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = listen ? AI_PASSIVE : 0;
+  addrinfo *results = nullptr;
+  if (::getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(),
+                    &hints, &results) != 0) {
+    errno = EADDRNOTAVAIL;
+    return -1;
+  }
+
+  int fd = -1;
+  int error = 0;
+  for (const addrinfo *info = results; info != nullptr; info = info->ai_next) {
+    fd = ::socket(info->ai_family,
+                  info->ai_socktype | SOCK_CLOEXEC |
+                      (listen ? 0 : SOCK_NONBLOCK),
+                  info->ai_protocol);
+    if (fd < 0) {
+      error = errno;
+      continue;
+    }
+
+    const int enable = 1;
+    if (listen) {
+      ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+      if (::bind(fd, info->ai_addr, info->ai_addrlen) == 0 &&
+          ::listen(fd, SOMAXCONN) == 0) {
+        break;
+      }
+    } else {
+      // The next address is only tried when this one fails right away
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+      if (::connect(fd, info->ai_addr, info->ai_addrlen) == 0 ||
+          errno == EINPROGRESS) {
+        break;
+      }
+    }
+
+    error = errno;
+    ::close(fd);
+    fd = -1;
+  }
+
+  ::freeaddrinfo(results);
+  errno = error;
+  return fd;
+}
+
+// A client by peer and pseudonym, viewing the strings of its event
+using ClientKey = std::pair<std::string_view, std::string_view>;
+
+struct ClientKeyHash {
+  std::size_t operator()(const ClientKey &key) const {
+    const std::hash<std::string_view> hash;
+    const std::size_t peer = hash(key.first);
+    return peer ^
+           (hash(key.second) + 0x9e3779b9 + (peer << 6U) + (peer >> 2U));
+  }
+};
+
+using ClientKeys = std::unordered_set<ClientKey, ClientKeyHash>;
+
+ClientKeys keysOf(const std::vector<events::ClientConnectedEvent> &clients) {
+  ClientKeys keys;
+  keys.reserve(clients.size());
+  for (const auto &client : clients) {
+    keys.emplace(client.peer, client.pseudonym);
+  }
+  return keys;
+}
+
+int openSocket(const std::string &address, bool listen) {
+  if (isUnixAddress(address)) {
+    return openUnixSocket(std::string_view(address).substr(kUnixPrefix.size()),
+                          listen);
+  }
+  return openTcpSocket(address, listen);
+}
+
+} // namespace
+
+std::string defaultNodeId() {
+  std::array<char, 256> host{};
+  if (::gethostname(host.data(), host.size() - 1) != 0) {
+    host[0] = '\0';
+  }
+  return std::string(host.data()) + ":" + std::to_string(::getpid());
+}
+
+SocketMessageBus::Link::~Link() { ::close(fd); }
+
+SocketMessageBus::SocketMessageBus(Config config)
+    : nodeId_(config.nodeId.empty() ? defaultNodeId()
+                                    : std::move(config.nodeId)),
+      presence_(std::move(config.presence)),
+      snapshotInterval_(config.snapshotInterval),
+      ownership_(std::move(config.ownership)),
+      maxOutboxBytes_(config.maxOutboxBytes),
+      listenAddress_(std::move(config.listenAddress)),
+      peerAddresses_(std::move(config.peerAddresses)) {
+  if (::pipe2(wakeFds_.data(), O_NONBLOCK | O_CLOEXEC) != 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "cluster bus wake pipe");
+  }
+
+  for (const int fd : config.links) {
+    addLink(fd, std::string(), false);
+  }
+
+  if (!listenAddress_.empty()) {
+    listenFd_ = openSocket(listenAddress_, true);
+    if (listenFd_ < 0) {
+      throw addressError(listenAddress_);
+    }
+  }
+}
+
+SocketMessageBus::~SocketMessageBus() {
+  stop();
+
+  {
+    std::lock_guard<std::mutex> lock(linksMutex_);
+    links_.clear();
+  }
+  for (const auto &connect : connecting_) {
+    ::close(connect.fd);
+  }
+
+  if (listenFd_ >= 0) {
+    ::close(listenFd_);
+    if (isUnixAddress(listenAddress_)) {
+      ::unlink(listenAddress_.c_str() + kUnixPrefix.size());
+    }
+  }
+  ::close(wakeFds_[0]);
+  ::close(wakeFds_[1]);
+}
+
+// The dispatcher publishes under its lock, so the sequence follows the order
+// in which the frames are sent
+void SocketMessageBus::publish(const events::ClientConnectedEvent &event) {
+  publishEvent(event, ++sequence_);
+}
+
+void SocketMessageBus::publish(const events::ClientDisconnectedEvent &event) {
+  publishEvent(event, ++sequence_);
+}
+
+void SocketMessageBus::publish(const events::MessageSentEvent &event) {
+  publishEvent(event, ++sequence_);
+}
+
+void SocketMessageBus::publish(const events::PrivateMessageSentEvent &event) {
+  // A recipient on this node was served by the local observers
+  if (!event.recipientNode.empty()) {
+    publishEvent(event, ++sequence_, event.recipientNode);
+  }
+}
+
+void SocketMessageBus::start(events::EventDispatcher &remote) {
+  remote_ = &remote;
+  worker_ = std::jthread(
+      [this](const std::stop_token &stopToken) { run(stopToken); });
+}
+
+void SocketMessageBus::stop() {
+  worker_.request_stop();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+void SocketMessageBus::sendClaim(const std::string &node,
+                                 const ClaimMessage &message) {
+  // Claims are not events: they leave the sequence alone
+  publishEvent(message, 0, node);
+}
+
+std::string SocketMessageBus::listenAddress() const {
+  if (listenFd_ < 0 || isUnixAddress(listenAddress_)) {
+    return listenAddress_;
+  }
+
+  sockaddr_storage bound{};
+  socklen_t length = sizeof(bound);
+  if (::getsockname(listenFd_, reinterpret_cast<sockaddr *>(&bound),
+                    &length) != 0) {
+    return listenAddress_;
+  }
+  const auto port = bound.ss_family == AF_INET6
+                        ? reinterpret_cast<sockaddr_in6 &>(bound).sin6_port
+                        : reinterpret_cast<sockaddr_in &>(bound).sin_port;
+  return listenAddress_.substr(0, listenAddress_.rfind(':') + 1) +
+         std::to_string(ntohs(port));
+}
+
+std::size_t SocketMessageBus::connectedPeers() const {
+  std::lock_guard<std::mutex> lock(linksMutex_);
+  return static_cast<std::size_t>(
+      std::count_if(links_.cbegin(), links_.cend(), [](const auto &link) {
+        return !link->accepted && link->open.load(std::memory_order_relaxed);
+      }));
+}
+
+template <typename Event>
+void SocketMessageBus::publishEvent(const Event &event, std::uint64_t sequence,
+                                    const std::string &targetNode) {
+  std::vector<std::shared_ptr<Link>> links;
+  {
+    std::lock_guard<std::mutex> lock(linksMutex_);
+    for (const auto &link : links_) {
+      if (!link->accepted &&
+          (targetNode.empty() || link->nodeId == targetNode)) {
+        links.push_back(link);
+      }
+    }
+  }
+  if (links.empty()) {
+    if (!targetNode.empty()) {
+      std::cerr << "No cluster link to node " << targetNode
+                << ", dropping frame" << std::endl;
+    }
+    return;
+  }
+
+  std::string frame;
+  encodeEvent(event, sequence, frame);
+
+  for (const auto &link : links) {
+    send(*link, frame);
+  }
+}
+
+void SocketMessageBus::send(Link &link, std::string_view frame) {
+  if (!link.open.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  bool wakeBus = false;
+  {
+    std::lock_guard<std::mutex> lock(link.outboxMutex);
+    const std::size_t queued = link.outbox.size() - link.outboxSent;
+    if (queued + frame.size() > maxOutboxBytes_) {
+      closeLink(link, "outbox overflowed");
+      return;
+    }
+
+    if (link.outboxSent > link.outbox.size() / 2) {
+      link.outbox.erase(0, link.outboxSent);
+      link.outboxSent = 0;
+    }
+    link.outbox.append(frame);
+
+    // Otherwise the bus thread is already writing the outbox
+    if (queued == 0) {
+      if (!flushLocked(link)) {
+        closeLink(link, std::strerror(errno));
+        return;
+      }
+      wakeBus = !link.outbox.empty();
+    }
+  }
+
+  if (wakeBus) {
+    wake();
+  }
+}
+
+bool SocketMessageBus::flushLocked(Link &link) {
+  while (link.outboxSent < link.outbox.size()) {
+    const ssize_t sent =
+        ::send(link.fd, link.outbox.data() + link.outboxSent,
+               link.outbox.size() - link.outboxSent,
+               MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    link.outboxSent += static_cast<std::size_t>(sent);
+  }
+
+  link.outbox.clear();
+  link.outboxSent = 0;
+  return true;
+}
+
+void SocketMessageBus::closeLink(Link &link, std::string_view reason) {
+  if (!link.open.exchange(false, std::memory_order_relaxed)) {
+    return;
+  }
+  std::cerr << "Dropping cluster link: " << reason << std::endl;
+  // Wakes the bus thread, which drops the link
+  ::shutdown(link.fd, SHUT_RDWR);
+}
+
+void SocketMessageBus::wake() {
+  const char byte = 0;
+  // A full pipe already wakes the bus thread
+  [[maybe_unused]] const ssize_t written = ::write(wakeFds_[1], &byte, 1);
+}
+
+void SocketMessageBus::addLink(int fd, std::string peerAddress,
+                               bool accepted) {
+  auto link = std::make_shared<Link>(fd, std::move(peerAddress), accepted);
+
+  std::string hello;
+  encodeEvent(NodeHello{.nodeId = nodeId_}, 0, hello);
+  send(*link, hello);
+  if (!link->open.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(linksMutex_);
+  links_.push_back(std::move(link));
+}
+
+void SocketMessageBus::run(const std::stop_token &stopToken) {
+  std::vector<pollfd> fds;
+  std::vector<std::shared_ptr<Link>> polled;
+
+  while (!stopToken.stop_requested()) {
+    connectPeers();
+
+    const auto now = std::chrono::steady_clock::now();
+    if (presence_ && now >= nextSnapshot_) {
+      sendSnapshot();
+      expireSilentNodes();
+      nextSnapshot_ = now + snapshotInterval_;
+    }
+    if (ownership_) {
+      updateMembers();
+      ownership_->tick();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(linksMutex_);
+      polled = links_;
+    }
+    fds.clear();
+    for (const auto &link : polled) {
+      short events = POLLIN;
+      {
+        std::lock_guard<std::mutex> lock(link->outboxMutex);
+        if (!link->outbox.empty()) {
+          events |= POLLOUT;
+        }
+      }
+      fds.push_back({.fd = link->fd, .events = events, .revents = 0});
+    }
+    for (const auto &connect : connecting_) {
+      fds.push_back({.fd = connect.fd, .events = POLLOUT, .revents = 0});
+    }
+    const std::size_t wakeIndex = fds.size();
+    fds.push_back({.fd = wakeFds_[0], .events = POLLIN, .revents = 0});
+    if (listenFd_ >= 0) {
+      fds.push_back({.fd = listenFd_, .events = POLLIN, .revents = 0});
+    }
+
+    const int ready = ::poll(fds.data(), fds.size(), kPollTimeoutMs);
+    if (ready < 0 && errno != EINTR) {
+      std::cerr << "Cluster bus poll failed: " << std::strerror(errno)
+                << std::endl;
+      return;
+    }
+    finishConnects(std::span(fds).subspan(polled.size(), connecting_.size()));
+    if (ready <= 0) {
+      continue;
+    }
+
+    std::vector<std::shared_ptr<Link>> closed;
+    for (std::size_t i = 0; i < polled.size(); ++i) {
+      Link &link = *polled[i];
+      if ((fds[i].revents & POLLOUT) != 0) {
+        std::lock_guard<std::mutex> lock(link.outboxMutex);
+        if (!flushLocked(link)) {
+          closeLink(link, std::strerror(errno));
+        }
+      }
+      if ((fds[i].revents & ~POLLOUT) != 0 && !readFrom(link)) {
+        link.open.store(false, std::memory_order_relaxed);
+        closed.push_back(polled[i]);
+      }
+    }
+
+    if (fds[wakeIndex].revents != 0) {
+      std::array<char, 64> drained;
+      while (::read(wakeFds_[0], drained.data(), drained.size()) > 0) {
+      }
+    }
+
+    if (!closed.empty()) {
+      std::lock_guard<std::mutex> lock(linksMutex_);
+      std::erase_if(links_, [&closed](const auto &link) {
+        return std::find(closed.cbegin(), closed.cend(), link) !=
+               closed.cend();
+      });
+    }
+
+    if (listenFd_ >= 0 && fds.back().revents != 0) {
+      const int fd = ::accept4(listenFd_, nullptr, nullptr, SOCK_CLOEXEC);
+      if (fd >= 0) {
+        addLink(fd, std::string(), true);
+      }
+    }
+  }
+}
+
+void SocketMessageBus::connectPeers() {
+  const auto now = std::chrono::steady_clock::now();
+  if (peerAddresses_.empty() || now < nextConnectAttempt_) {
+    return;
+  }
+
+  std::vector<std::string> missing;
+  {
+    std::lock_guard<std::mutex> lock(linksMutex_);
+    for (const auto &address : peerAddresses_) {
+      if (std::none_of(links_.cbegin(), links_.cend(),
+                       [&address](const auto &link) {
+                         return link->peerAddress == address;
+                       }) &&
+          std::none_of(connecting_.cbegin(), connecting_.cend(),
+                       [&address](const auto &connect) {
+                         return connect.peerAddress == address;
+                       })) {
+        missing.push_back(address);
+      }
+    }
+  }
+
+  // Only started here: the connections complete in the poll loop, so an
+  // unreachable peer never holds up the bus thread
+  for (auto &address : missing) {
+    const int fd = openSocket(address, false);
+    if (fd < 0) {
+      nextConnectAttempt_ = now + kReconnectInterval;
+      continue;
+    }
+    connecting_.push_back({.fd = fd,
+                           .peerAddress = std::move(address),
+                           .deadline = now + kConnectTimeout});
+  }
+}
+
+void SocketMessageBus::finishConnects(std::span<const pollfd> fds) {
+  const auto now = std::chrono::steady_clock::now();
+  std::vector<PendingConnect> established;
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < connecting_.size(); ++i) {
+    PendingConnect &connect = connecting_[i];
+    int error = 0;
+    if (i < fds.size() && fds[i].revents != 0) {
+      socklen_t length = sizeof(error);
+      if (::getsockopt(connect.fd, SOL_SOCKET, SO_ERROR, &error, &length) !=
+          0) {
+        error = errno;
+      }
+      if (error == 0) {
+        established.push_back(std::move(connect));
+        continue;
+      }
+    } else if (now < connect.deadline) {
+      if (kept != i) {
+        connecting_[kept] = std::move(connect);
+      }
+      ++kept;
+      continue;
+    }
+
+    ::close(connect.fd);
+    nextConnectAttempt_ = now + kReconnectInterval;
+  }
+  connecting_.resize(kept);
+
+  for (auto &connect : established) {
+    addLink(connect.fd, std::move(connect.peerAddress), false);
+  }
+}
+
+bool SocketMessageBus::readFrom(Link &link) {
+  std::array<char, 64 * 1024> chunk;
+  const ssize_t received = ::recv(link.fd, chunk.data(), chunk.size(), 0);
+  // Outgoing sockets are non-blocking
+  if (received < 0 &&
+      (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return true;
+  }
+  if (received <= 0) {
+    return false;
+  }
+  link.pending.append(chunk.data(), static_cast<std::size_t>(received));
+
+  std::string_view buffer(link.pending);
+  while (const auto bodySize = frameBodySize(buffer)) {
+    if (*bodySize > kMaxFrameBodySize) {
+      std::cerr << "Closing cluster link on oversized frame" << std::endl;
+      return false;
+    }
+    if (buffer.size() < kFrameHeaderSize + *bodySize) {
+      break;
+    }
+    if (auto frame = decodeEvent(buffer.substr(kFrameHeaderSize, *bodySize))) {
+      receive(link, std::move(*frame));
+    } else {
+      std::cerr << "Dropping malformed event from cluster link" << std::endl;
+    }
+    buffer.remove_prefix(kFrameHeaderSize + *bodySize);
+  }
+  link.pending.erase(0, link.pending.size() - buffer.size());
+  return true;
+}
+
+void SocketMessageBus::receive(Link &link, DecodedFrame frame) {
+  const auto now = std::chrono::steady_clock::now();
+  if (const auto *hello = std::get_if<NodeHello>(&frame.event)) {
+    {
+      std::lock_guard<std::mutex> lock(linksMutex_);
+      link.nodeId = hello->nodeId;
+    }
+    remoteNodes_[hello->nodeId].lastHeard = now;
+    return;
+  }
+
+  // Only the bus thread writes the node id, so it is read without the lock
+  if (link.nodeId.empty()) {
+    std::cerr << "Dropping event received before the cluster hello"
+              << std::endl;
+    return;
+  }
+  auto &node = remoteNodes_[link.nodeId];
+  node.lastHeard = now;
+
+  if (auto claim = takeClaimMessage(frame.event)) {
+    if (ownership_) {
+      ownership_->receive(link.nodeId, *claim);
+    }
+    return;
+  }
+
+  setOriginNode(frame.event, link.nodeId);
+
+  if (const auto *snapshot = std::get_if<PresenceSnapshot>(&frame.event)) {
+    // Events sent after the snapshot was taken were already applied
+    if (presence_ && frame.sequence >= node.lastSequence) {
+      reconcile(link.nodeId, *snapshot);
+    }
+    return;
+  }
+
+  node.lastSequence = std::max(node.lastSequence, frame.sequence);
+  dispatchEvent(frame.event, *remote_);
+}
+
+void SocketMessageBus::reconcile(const std::string &node,
+                                 const PresenceSnapshot &snapshot) {
+  const auto known = presence_->getClientsOnNode(node);
+  // Both sides list every client of the node: compared through hash sets,
+  // not pairwise
+  const ClientKeys knownKeys = keysOf(known);
+  const ClientKeys snapshotKeys = keysOf(snapshot.clients);
+
+  for (const auto &client : known) {
+    if (!snapshotKeys.contains({client.peer, client.pseudonym})) {
+      remote_->notifyClientDisconnected(
+          {.peer = client.peer,
+           .pseudonym = client.pseudonym,
+           .connectionDuration = std::chrono::steady_clock::duration::zero()});
+    }
+  }
+  for (const auto &client : snapshot.clients) {
+    if (!knownKeys.contains({client.peer, client.pseudonym})) {
+      remote_->notifyClientConnected(client);
+    }
+  }
+}
+
+void SocketMessageBus::updateMembers() {
+  std::vector<std::string> members;
+  {
+    std::lock_guard<std::mutex> lock(linksMutex_);
+    for (const auto &link : links_) {
+      if (!link->accepted && !link->nodeId.empty() &&
+          link->open.load(std::memory_order_relaxed)) {
+        members.push_back(link->nodeId);
+      }
+    }
+  }
+  std::sort(members.begin(), members.end());
+  members.erase(std::unique(members.begin(), members.end()), members.end());
+
+  if (members != members_) {
+    members_ = std::move(members);
+    ownership_->setMembers(members_);
+  }
+}
+
+void SocketMessageBus::sendSnapshot() {
+  // Taken before reading the registry: an event published meanwhile gets a
+  // later number, and receivers that applied it ignore this snapshot
+  const std::uint64_t sequence = sequence_.load();
+  publishEvent(PresenceSnapshot{.clients = presence_->getClientsOnNode("")},
+               sequence);
+}
+
+void SocketMessageBus::expireSilentNodes() {
+  const auto deadline = std::chrono::steady_clock::now() -
+                        kMissedSnapshotsBeforeExpiry * snapshotInterval_;
+  for (auto it = remoteNodes_.begin(); it != remoteNodes_.end();) {
+    if (it->second.lastHeard >= deadline) {
+      ++it;
+      continue;
+    }
+    std::cerr << "Cluster node " << it->first
+              << " went silent, expiring its clients" << std::endl;
+    reconcile(it->first, PresenceSnapshot{});
+    it = remoteNodes_.erase(it);
+  }
+}
+
+} // namespace cluster
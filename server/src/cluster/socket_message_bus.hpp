@@ -0,0 +1,210 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+
+#include "cluster/event_codec.hpp"
+#include "cluster/pseudonym_ownership.hpp"
+#include "domain/client_registry.hpp"
+#include "service/events/chat_service_events_dispatcher.hpp"
+#include "service/events/message_bus.hpp"
+
+namespace cluster {
+
+// "hostname:pid", unique among the nodes of a cluster
+std::string defaultNodeId();
+
+// Message bus over stream sockets, for worker processes of one host and for
+// the nodes of a local cluster.
+//
+// Addresses are "unix:/path" or "host:port". The bus accepts connections on
+// its listen address and reads the events other nodes send there; it
+// publishes on one outgoing connection per peer address, re-established in
+// the background while the peer is down. Events published while a peer is
+// unreachable are not replayed to it. Already connected sockets (worker
+// socket pairs) are used in both directions.
+//
+// Publishing never blocks: frames are queued on a bounded outbox per link
+// and written as the socket takes them, by the publisher while the outbox
+// is empty and by the bus thread afterwards. A link whose peer lets its
+// outbox overflow is dropped, and re-established if it is outgoing.
+//
+// Every link opens with a hello naming its node, which the bus records on
+// the clients that node connects; a private message is only sent to the node
+// holding its recipient. With a presence registry, each node also sends the
+// clients it holds every few seconds, and the receivers reconcile their
+// directory with it: entries missed through a lost link are repaired, and
+// those of a node gone silent expire. Pseudonym claims travel on the same
+// links, and the nodes with an open outgoing link make up the membership
+// given to the ownership.
+class SocketMessageBus final : public events::IMessageBus,
+                               public IClaimTransport {
+public:
+  struct Config {
+    std::string listenAddress;
+    std::vector<std::string> peerAddresses;
+    std::vector<int> links;
+    // Identity announced to the peers; defaults to "hostname:pid"
+    std::string nodeId;
+    // Directory the remote events are applied to; snapshots are neither sent
+    // nor reconciled without it
+    std::shared_ptr<const domain::ClientRegistry> presence;
+    // Period of the snapshots; a node unheard for three periods is expired
+    std::chrono::milliseconds snapshotInterval{5000};
+    // Pseudonym ownership fed with claims, membership and ticks, if any
+    std::shared_ptr<PseudonymOwnership> ownership;
+    // Bytes queued for a peer that reads too slowly before its link is
+    // dropped
+    std::size_t maxOutboxBytes = 8U << 20U;
+
+    bool enabled() const {
+      return !listenAddress.empty() || !peerAddresses.empty() ||
+             !links.empty();
+    }
+  };
+
+  // Binds the listen address; throws std::system_error when it cannot.
+  // Takes ownership of the links.
+  explicit SocketMessageBus(Config config);
+  ~SocketMessageBus() override;
+
+  SocketMessageBus(const SocketMessageBus &) = delete;
+  SocketMessageBus &operator=(const SocketMessageBus &) = delete;
+  SocketMessageBus(SocketMessageBus &&) = delete;
+  SocketMessageBus &operator=(SocketMessageBus &&) = delete;
+
+  void publish(const events::ClientConnectedEvent &event) override;
+  void publish(const events::ClientDisconnectedEvent &event) override;
+  void publish(const events::MessageSentEvent &event) override;
+  void publish(const events::PrivateMessageSentEvent &event) override;
+
+  void start(events::EventDispatcher &remote) override;
+
+  // Joins the bus thread; nothing is received afterwards. The owner must call
+  // it before letting go of the bus: the bus thread may otherwise end up
+  // with the last reference, taken through the ownership's transport or a
+  // dispatcher, and cannot join itself. Also run by the destructor.
+  void stop();
+
+  // IClaimTransport
+  void sendClaim(const std::string &node, const ClaimMessage &message) override;
+
+  // Listen address with the port the system picked for "host:0"
+  std::string listenAddress() const;
+
+  // Outgoing links currently connected to a peer, including socket pairs
+  std::size_t connectedPeers() const;
+
+  const std::string &nodeId() const { return nodeId_; }
+
+private:
+  struct Link {
+    Link(int fd, std::string peerAddress, bool accepted)
+        : fd(fd), peerAddress(std::move(peerAddress)), accepted(accepted) {}
+    ~Link();
+
+    const int fd;
+    // Set for outgoing connections, which are re-established when lost
+    const std::string peerAddress;
+    // Accepted connections only carry events from the peer that opened them
+    const bool accepted;
+    // Frames not yet written, from `outboxSent` on; whole frames are queued
+    // under the lock, so they never interleave on the socket
+    std::mutex outboxMutex;
+    std::string outbox;
+    std::size_t outboxSent = 0;
+    std::atomic<bool> open{true};
+    // Bytes received but not yet forming a complete frame
+    std::string pending;
+    // Node at the other end, known once its hello arrived; written by the
+    // bus thread under linksMutex_
+    std::string nodeId;
+  };
+
+  // Outgoing connection under way, kept by the bus thread
+  struct PendingConnect {
+    int fd;
+    std::string peerAddress;
+    std::chrono::steady_clock::time_point deadline;
+  };
+
+  // What the bus knows of a remote node, kept by the bus thread
+  struct RemoteNode {
+    std::uint64_t lastSequence = 0;
+    std::chrono::steady_clock::time_point lastHeard;
+  };
+
+  // Sends to every outgoing link, or to the links of `targetNode` if set.
+  template <typename Event>
+  void publishEvent(const Event &event, std::uint64_t sequence,
+                    const std::string &targetNode = {});
+  // Queues `frame` on the link's outbox, writing it right away if nothing
+  // is queued before it. Never blocks; drops the link when the outbox
+  // overflows or the socket fails.
+  void send(Link &link, std::string_view frame);
+  // Writes what the socket takes of the outbox without blocking; false when
+  // the socket failed.
+  static bool flushLocked(Link &link);
+  // Marks the link closed and wakes the bus thread, which drops it.
+  static void closeLink(Link &link, std::string_view reason);
+  // Has the bus thread poll again, for a link with frames left to write.
+  void wake();
+  // Adds a link with the hello queued first on it.
+  void addLink(int fd, std::string peerAddress, bool accepted);
+  void run(const std::stop_token &stopToken);
+  // Starts connecting to the peers without a link, once per retry interval.
+  void connectPeers();
+  // Turns the connections `fds` reports established into links; drops those
+  // that failed or timed out. `fds` are the poll entries of connecting_.
+  void finishConnects(std::span<const pollfd> fds);
+  // Reads what is available on the link; false once it is closed.
+  bool readFrom(Link &link);
+  void receive(Link &link, DecodedFrame frame);
+  void reconcile(const std::string &node, const PresenceSnapshot &snapshot);
+  void updateMembers();
+  void sendSnapshot();
+  void expireSilentNodes();
+
+  const std::string nodeId_;
+  const std::shared_ptr<const domain::ClientRegistry> presence_;
+  const std::chrono::milliseconds snapshotInterval_;
+  // Numbers the published events, so that a snapshot can tell whether it is
+  // older than what a receiver already applied
+  std::atomic<std::uint64_t> sequence_{0};
+  std::map<std::string, RemoteNode, std::less<>> remoteNodes_;
+  std::chrono::steady_clock::time_point nextSnapshot_;
+  const std::shared_ptr<PseudonymOwnership> ownership_;
+  std::vector<std::string> members_;
+  const std::size_t maxOutboxBytes_;
+  // Pipe interrupting the bus thread's poll
+  std::array<int, 2> wakeFds_{-1, -1};
+
+  int listenFd_ = -1;
+  std::string listenAddress_;
+  std::vector<std::string> peerAddresses_;
+  std::chrono::steady_clock::time_point nextConnectAttempt_;
+  std::vector<PendingConnect> connecting_;
+
+  mutable std::mutex linksMutex_;
+  std::vector<std::shared_ptr<Link>> links_;
+
+  events::EventDispatcher *remote_ = nullptr;
+
+  // Declared last so that the thread is joined before members go away
+  std::jthread worker_;
+};
+
+} // namespace cluster
@@ -0,0 +1,180 @@
+#include "cluster/worker_pool.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <system_error>
+#include <vector>
+
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace cluster {
+namespace {
+
+std::system_error lastError(const char *what) {
+  return {errno, std::generic_category(), what};
+}
+
+void pinToCpus(std::size_t index, std::size_t count) {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (::sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    throw lastError("sched_getaffinity");
+  }
+
+  std::vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &allowed)) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  cpu_set_t pinned;
+  CPU_ZERO(&pinned);
+  for (const int cpu : cpusForWorker(cpus, index, count)) {
+    CPU_SET(cpu, &pinned);
+  }
+  if (::sched_setaffinity(0, sizeof(pinned), &pinned) != 0) {
+    throw lastError("sched_setaffinity");
+  }
+}
+
+[[noreturn]] void runWorker(
+    const WorkerContext &context, bool pinCpus, std::size_t count,
+    const std::function<int(const WorkerContext &)> &worker) {
+  int status = 1;
+  try {
+    if (pinCpus) {
+      pinToCpus(context.index, count);
+    }
+    status = worker(context);
+  } catch (const std::exception &ex) {
+    std::cerr << "Exception in worker " << context.index << ": " << ex.what()
+              << std::endl;
+  }
+  std::cout.flush();
+  std::fflush(nullptr);
+  // Skip the destructors of the state inherited from the parent
+  ::_exit(status);
+}
+
+} // namespace
+
+std::vector<int> cpusForWorker(const std::vector<int> &cpus, std::size_t index,
+                               std::size_t count) {
+  if (cpus.empty() || count == 0) {
+    return {};
+  }
+  if (count >= cpus.size()) {
+    return {cpus[index % cpus.size()]};
+  }
+
+  const std::size_t first = index * cpus.size() / count;
+  const std::size_t last = (index + 1) * cpus.size() / count;
+  return {cpus.begin() + static_cast<std::ptrdiff_t>(first),
+          cpus.begin() + static_cast<std::ptrdiff_t>(last)};
+}
+
+int runWorkers(std::size_t count, bool pinCpus,
+               const std::function<int(const WorkerContext &)> &worker) {
+  // links[i][j] is worker i's end of the pair it shares with worker j
+  std::vector<std::vector<int>> links(count, std::vector<int>(count, -1));
+  for (std::size_t i = 0; i < count; ++i) {
+    for (std::size_t j = i + 1; j < count; ++j) {
+      int pair[2];
+      if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0) {
+        throw lastError("socketpair");
+      }
+      links[i][j] = pair[0];
+      links[j][i] = pair[1];
+    }
+  }
+
+  // Signals are taken synchronously by the parent, workers restore them
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  sigaddset(&signals, SIGCHLD);
+  sigset_t previous;
+  ::sigprocmask(SIG_BLOCK, &signals, &previous);
+
+  std::vector<pid_t> pids;
+  for (std::size_t i = 0; i < count; ++i) {
+    const pid_t pid = ::fork();
+    if (pid < 0) {
+      const auto error = lastError("fork");
+      for (const pid_t started : pids) {
+        ::kill(started, SIGTERM);
+      }
+      throw error;
+    }
+
+    if (pid == 0) {
+      ::sigprocmask(SIG_SETMASK, &previous, nullptr);
+      WorkerContext context;
+      context.index = i;
+      for (std::size_t j = 0; j < count; ++j) {
+        for (std::size_t k = 0; k < count; ++k) {
+          if (j == i && k != i) {
+            context.links.push_back(links[j][k]);
+          } else if (j != i && links[j][k] >= 0) {
+            ::close(links[j][k]);
+          }
+        }
+      }
+      runWorker(context, pinCpus, count, worker);
+    }
+
+    pids.push_back(pid);
+  }
+
+  for (const auto &row : links) {
+    for (const int fd : row) {
+      if (fd >= 0) {
+        ::close(fd);
+      }
+    }
+  }
+
+  int exitStatus = 0;
+  bool stopping = false;
+  while (!pids.empty()) {
+    int received = 0;
+    ::sigwait(&signals, &received);
+
+    if (received != SIGCHLD) {
+      stopping = true;
+    }
+
+    int status = 0;
+    pid_t pid;
+    while ((pid = ::waitpid(-1, &status, WNOHANG)) > 0) {
+      std::erase(pids, pid);
+      const int workerStatus =
+          WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+      std::cerr << "Worker " << pid << " exited with status " << workerStatus
+                << std::endl;
+      if (workerStatus != 0 && exitStatus == 0) {
+        exitStatus = workerStatus;
+        stopping = true;
+      }
+    }
+
+    if (stopping) {
+      for (const pid_t worker : pids) {
+        ::kill(worker, SIGTERM);
+      }
+    }
+  }
+
+  ::sigprocmask(SIG_SETMASK, &previous, nullptr);
+  return exitStatus;
+}
+
+} // namespace cluster
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace cluster {
+
+struct WorkerContext {
+  std::size_t index = 0;
+  // Connected stream sockets, one per sibling worker
+  std::vector<int> links;
+};
+
+// Forks `count` worker processes, each running `worker` and exiting with its
+// return value. Must be called before any thread is started. Every pair of
+// workers shares a Unix socket pair; with `pinCpus`, each worker is bound to
+// its own slice of the CPUs this process may run on.
+//
+// The parent only supervises: SIGINT and SIGTERM are forwarded to the
+// workers, and once one of them fails the others are stopped too. Returns
+// the first non-zero exit status, or 0.
+int runWorkers(std::size_t count, bool pinCpus,
+               const std::function<int(const WorkerContext &)> &worker);
+
+// CPUs given to worker `index` out of `count`: contiguous slices of `cpus`,
+// or a single CPU shared round-robin when workers outnumber CPUs.
+std::vector<int> cpusForWorker(const std::vector<int> &cpus, std::size_t index,
+                               std::size_t count);
+
+} // namespace cluster
@@ -22,8 +22,9 @@ OptionalErrorMessage DatabaseManagerSQLite::init() {
   }
 
   try {
-    db_ = std::make_unique<SQLite::Database>(dbPath_, SQLite::OPEN_READWRITE |
-                                                          SQLite::OPEN_CREATE);
+    // Worker processes share the file: wait for a writer instead of failing
+    db_ = std::make_unique<SQLite::Database>(
+        dbPath_, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE, kBusyTimeoutMs);
   } catch (const std::exception &ex) {
     db_.reset();
     return std::string("Failed to open database: ") + ex.what();
@@ -39,6 +39,8 @@ public:
 private:
   [[nodiscard]] OptionalErrorMessage ensureOpen();
 
+  static constexpr int kBusyTimeoutMs = 5000;
+
   const std::string statisticsTable_ = "Statistics";
   std::string dbPath_;
   std::unique_ptr<SQLite::Database> db_;
@@ -18,6 +18,8 @@ void ClientEventBroadcaster::broadcastClientEvent(
   chat::ClientEventData payload;
   payload.set_event_type(eventType);
   payload.set_pseudonym(std::string(pseudonym));
+  // The registry has applied the change already, it is the first observer
+  payload.set_roster_version(clientRegistry_.membershipVersion());
 
   {
     std::lock_guard<std::mutex> lock(mutex_);
@@ -49,7 +51,9 @@ NextClientEventStatus ClientEventBroadcaster::nextClientEvent(
     return NextClientEventStatus::kOk;
   }
 
-  clientEventCv_.wait_for(lock, waitFor);
+  if (!draining_) {
+    clientEventCv_.wait_for(lock, waitFor);
+  }
 
   if (!clientRegistry_.isPeerConnected(peer)) {
     peerIndices_.erase(peerKey);
@@ -70,6 +74,12 @@ NextClientEventStatus ClientEventBroadcaster::nextClientEvent(
   return NextClientEventStatus::kNoEvent;
 }
 
+void ClientEventBroadcaster::drain() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  draining_ = true;
+  clientEventCv_.notify_all();
+}
+
 bool ClientEventBroadcaster::normalizeClientEventIndex(std::string_view peer) {
   std::lock_guard<std::mutex> lock(mutex_);
   const std::string peerKey(peer);
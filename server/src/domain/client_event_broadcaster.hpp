@@ -33,6 +33,10 @@ public:
                   chat::ClientEventData &out) = 0;
 
   virtual bool normalizeClientEventIndex(std::string_view peer) = 0;
+
+  // Stored events are still handed out, but nextClientEvent no longer waits
+  // for more.
+  virtual void drain() = 0;
 };
 
 class ClientEventBroadcaster : public IClientEventBroadcaster,
@@ -50,6 +54,8 @@ public:
 
   bool normalizeClientEventIndex(std::string_view peer) override;
 
+  void drain() override;
+
   // IServiceEventObserver interface
   void onClientConnected(const events::ClientConnectedEvent &event) override;
   void onClientDisconnected(const events::ClientDisconnectedEvent &event) override;
@@ -62,6 +68,7 @@ private:
   std::condition_variable clientEventCv_;
   std::vector<chat::ClientEventData> clientEvents_;
   std::unordered_map<std::string, std::size_t> peerIndices_;
+  bool draining_ = false;
 };
 
 } // namespace domain
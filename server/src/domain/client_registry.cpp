@@ -2,26 +2,70 @@
 
 #include <algorithm>
 
+#include "chat.pb.h"
 #include "service/events/chat_service_events.hpp"
 
 namespace domain {
 
+namespace {
+
+// Appends the same bytes a serializer would write for one more entry of
+// ConnectResponse.connected_pseudonyms.
+void appendRosterEntry(RosterSnapshot &roster, const std::string &pseudonym) {
+  constexpr std::uint32_t kLengthDelimited = 2;
+  constexpr std::uint32_t kTag =
+      (chat::ConnectResponse::kConnectedPseudonymsFieldNumber << 3U) |
+      kLengthDelimited;
+
+  static_assert(kTag < 0x80, "the tag must fit in one varint byte");
+
+  roster.wire.push_back(static_cast<char>(kTag));
+  auto length = static_cast<std::uint32_t>(pseudonym.size());
+  while (length >= 0x80) {
+    roster.wire.push_back(static_cast<char>((length & 0x7FU) | 0x80U));
+    length >>= 7U;
+  }
+  roster.wire.push_back(static_cast<char>(length));
+  roster.wire.append(pseudonym);
+
+  roster.pseudonyms.push_back(pseudonym);
+}
+
+} // namespace
+
 bool ClientRegistry::isPseudonymAvailable(std::string_view peer,
                                           std::string_view pseudonym) const {
   std::lock_guard<std::mutex> lock(mutex_);
+  return isPseudonymAvailableLocked(peer, pseudonym);
+}
+
+bool ClientRegistry::reservePseudonym(std::string_view peer,
+                                      std::string_view pseudonym,
+                                      std::string_view replacing) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (!isPseudonymAvailableLocked(peer, pseudonym, replacing)) {
+    return false;
+  }
+  reservations_.insert_or_assign(std::string(pseudonym), std::string(peer));
+  return true;
+}
+
+void ClientRegistry::cancelReservation(std::string_view peer,
+                                       std::string_view pseudonym) {
+  std::lock_guard<std::mutex> lock(mutex_);
 
-  return !std::any_of(
-      clients_.cbegin(), clients_.cend(),
-      [&pseudonym, &peer](const auto &entry) {
-        return entry.first != peer && entry.second.pseudonym == pseudonym;
-      });
+  auto it = reservations_.find(pseudonym);
+  if (it != reservations_.end() && it->second == peer) {
+    reservations_.erase(it);
+  }
 }
 
 bool ClientRegistry::getPseudonymForPeer(std::string_view peer,
                                          std::string &out) const {
   std::lock_guard<std::mutex> lock(mutex_);
 
-  auto it = clients_.find(std::string(peer));
+  auto it = clients_.find(peer);
   if (it == clients_.end()) {
     return false;
   }
@@ -34,24 +78,33 @@ bool ClientRegistry::getPeerForPseudonym(std::string_view pseudonym,
                                          std::string &out) const {
   std::lock_guard<std::mutex> lock(mutex_);
 
-  auto it = std::find_if(clients_.cbegin(), clients_.cend(),
-                         [&pseudonym](const auto &entry) {
-                           return entry.second.pseudonym == pseudonym;
-                         });
-
-  if (it == clients_.end()) {
+  auto it = peersByPseudonym_.find(pseudonym);
+  if (it == peersByPseudonym_.end()) {
     return false;
   }
 
-  out = it->first;
+  out = it->second;
   return true;
 }
 
+std::optional<ClientLocation>
+ClientRegistry::locate(std::string_view pseudonym) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = peersByPseudonym_.find(pseudonym);
+  if (it == peersByPseudonym_.end()) {
+    return std::nullopt;
+  }
+
+  return ClientLocation{.peer = it->second,
+                        .node = clients_.find(it->second)->second.node};
+}
+
 std::optional<std::chrono::steady_clock::duration>
 ClientRegistry::getConnectionDuration(std::string_view peer) const {
   std::lock_guard<std::mutex> lock(mutex_);
 
-  auto it = clients_.find(std::string(peer));
+  auto it = clients_.find(peer);
   if (it == clients_.end()) {
     return std::nullopt;
   }
@@ -74,7 +127,74 @@ std::vector<std::string> ClientRegistry::getConnectedPseudonyms() const {
 
 bool ClientRegistry::isPeerConnected(std::string_view peer) const {
   std::lock_guard<std::mutex> lock(mutex_);
-  return clients_.find(std::string(peer)) != clients_.end();
+  return clients_.find(peer) != clients_.end();
+}
+
+bool ClientRegistry::isRemotePeer(std::string_view peer) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = clients_.find(peer);
+  return it != clients_.end() && !it->second.node.empty();
+}
+
+std::vector<events::ClientConnectedEvent>
+ClientRegistry::getClientsOnNode(std::string_view node) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::vector<events::ClientConnectedEvent> clients;
+  for (const auto &[peer, info] : clients_) {
+    if (info.node == node) {
+      clients.push_back({.peer = peer,
+                         .pseudonym = info.pseudonym,
+                         .gender = info.gender,
+                         .country = info.country,
+                         .node = info.node});
+    }
+  }
+
+  return clients;
+}
+
+std::shared_ptr<const RosterSnapshot>
+ClientRegistry::getRosterSnapshot() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (!roster_ || roster_->version != membershipVersion_) {
+    auto roster = std::make_shared<RosterSnapshot>();
+    roster->version = membershipVersion_;
+    roster->pseudonyms.reserve(clients_.size());
+    for (const auto &entry : clients_) {
+      appendRosterEntry(*roster, entry.second.pseudonym);
+    }
+    roster_ = std::move(roster);
+  }
+
+  return roster_;
+}
+
+std::uint64_t ClientRegistry::membershipVersion() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return membershipVersion_;
+}
+
+void ClientRegistry::restoreClients(
+    const std::vector<events::ClientConnectedEvent> &clients,
+    std::uint64_t membershipVersion) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  const auto now = std::chrono::steady_clock::now();
+  for (const auto &client : clients) {
+    if (peersByPseudonym_.contains(client.pseudonym)) {
+      continue;
+    }
+    clients_.insert_or_assign(client.peer,
+                              ClientInfo{.pseudonym = client.pseudonym,
+                                         .gender = client.gender,
+                                         .country = client.country,
+                                         .initialTimePoint = now,
+                                         .node = client.node});
+    peersByPseudonym_.insert_or_assign(client.pseudonym, client.peer);
+  }
+  membershipVersion_ = std::max(membershipVersion_ + 1, membershipVersion);
 }
 
 events::IServiceEventObserver *ClientRegistry::asObserver() { return this; }
@@ -88,23 +208,99 @@ void ClientRegistry::onClientConnected(
       .gender = event.gender,
       .country = event.country,
       .initialTimePoint = std::chrono::steady_clock::now(),
+      .node = event.node,
   };
 
-  clients_[event.peer] = std::move(info);
+  // A resumed session keeps its place in the roster under the new peer
+  bool replaced = false;
+  if (!event.resumedPeer.empty() && event.resumedPeer != event.peer) {
+    auto previous = clients_.find(event.resumedPeer);
+    if (previous != clients_.end() &&
+        previous->second.pseudonym == event.pseudonym) {
+      clients_.erase(previous);
+      replaced = true;
+    }
+  }
+
+  auto [it, inserted] = clients_.try_emplace(event.peer);
+  if (!inserted) {
+    // The peer reconnected, possibly under another pseudonym
+    auto previous = peersByPseudonym_.find(it->second.pseudonym);
+    if (previous != peersByPseudonym_.end() &&
+        previous->second == event.peer) {
+      peersByPseudonym_.erase(previous);
+    }
+  }
+  it->second = std::move(info);
+  peersByPseudonym_.insert_or_assign(event.pseudonym, event.peer);
+
+  auto reservation = reservations_.find(event.pseudonym);
+  if (reservation != reservations_.end() &&
+      reservation->second == event.peer) {
+    reservations_.erase(reservation);
+  }
+
+  if (replaced && inserted) {
+    // Same pseudonyms as before, so the roster and its version still hold
+    return;
+  }
+
+  // Snapshots are only handed out under the mutex, so a current one nobody
+  // else holds can grow in place; this keeps a burst of connects linear
+  const bool current = roster_ && roster_->version == membershipVersion_;
+  ++membershipVersion_;
+  if (inserted && current && roster_.use_count() == 1) {
+    appendRosterEntry(*roster_, event.pseudonym);
+    roster_->version = membershipVersion_;
+  }
 }
 
 void ClientRegistry::onClientDisconnected(
     const events::ClientDisconnectedEvent &event) {
   std::lock_guard<std::mutex> lock(mutex_);
+  ++membershipVersion_;
 
-  auto it = std::find_if(clients_.begin(), clients_.end(),
-                         [&event](const auto &entry) {
-                           return entry.second.pseudonym == event.pseudonym;
-                         });
+  // The same pseudonym may be connected on two nodes for a while (lease
+  // handover, split brain): the peer tells which client leaves
+  auto it = clients_.end();
+  if (!event.peer.empty()) {
+    it = clients_.find(event.peer);
+    if (it != clients_.end() && it->second.pseudonym != event.pseudonym) {
+      // The peer has reconnected under another pseudonym since
+      it = clients_.end();
+    }
+  } else if (auto indexed = peersByPseudonym_.find(event.pseudonym);
+             indexed != peersByPseudonym_.end()) {
+    it = clients_.find(indexed->second);
+  } else {
+    // Only a pseudonym connected twice on different nodes is not indexed
+    it = std::find_if(clients_.begin(), clients_.end(),
+                      [&event](const auto &entry) {
+                        return entry.second.pseudonym == event.pseudonym;
+                      });
+  }
+  if (it == clients_.end()) {
+    return;
+  }
+
+  auto indexed = peersByPseudonym_.find(event.pseudonym);
+  if (indexed != peersByPseudonym_.end() && indexed->second == it->first) {
+    peersByPseudonym_.erase(indexed);
+  }
+  clients_.erase(it);
+}
 
-  if (it != clients_.end()) {
-    clients_.erase(it);
+bool ClientRegistry::isPseudonymAvailableLocked(
+    std::string_view peer, std::string_view pseudonym,
+    std::string_view replacing) const {
+  auto it = peersByPseudonym_.find(pseudonym);
+  if (it != peersByPseudonym_.end() && it->second != peer &&
+      (replacing.empty() || it->second != replacing)) {
+    return false;
   }
+
+  auto reservation = reservations_.find(pseudonym);
+  return reservation == reservations_.end() || reservation->second == peer;
 }
 
 void ClientRegistry::onMessageSent(
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
@@ -17,6 +21,23 @@ struct ClientInfo {
   std::string gender;
   std::string country;
   std::chrono::steady_clock::time_point initialTimePoint;
+  // Node holding the client's stream, empty for this node
+  std::string node;
+};
+
+struct ClientLocation {
+  std::string peer;
+  std::string node;
+};
+
+// Pseudonyms connected at one version of the membership. It is not modified
+// once handed out, so every Connect reading that version shares it.
+struct RosterSnapshot {
+  std::uint64_t version = 0;
+  std::vector<std::string> pseudonyms;
+  // The pseudonyms encoded as ConnectResponse.connected_pseudonyms, to be
+  // appended to an already serialized response
+  std::string wire;
 };
 
 class ClientRegistry : public events::IServiceEventObserver {
@@ -24,17 +45,46 @@ public:
   bool isPseudonymAvailable(std::string_view peer,
                             std::string_view pseudonym) const;
 
+  // Checks and holds `pseudonym` for `peer` in one step, so that concurrent
+  // connects cannot both get it. The reservation ends when the client's
+  // connect event arrives or it is cancelled. A resumed session may take the
+  // pseudonym over from `replacing`, the peer that held it before.
+  bool reservePseudonym(std::string_view peer, std::string_view pseudonym,
+                        std::string_view replacing = {});
+  void cancelReservation(std::string_view peer, std::string_view pseudonym);
+
   bool getPseudonymForPeer(std::string_view peer, std::string &out) const;
 
   bool getPeerForPseudonym(std::string_view pseudonym, std::string &out) const;
 
+  // Where a pseudonym is connected, in this node or another one
+  std::optional<ClientLocation> locate(std::string_view pseudonym) const;
+
   std::optional<std::chrono::steady_clock::duration>
   getConnectionDuration(std::string_view peer) const;
 
   std::vector<std::string> getConnectedPseudonyms() const;
 
+  // Shared by every caller until a client connects or leaves, then rebuilt
+  // on the next call
+  std::shared_ptr<const RosterSnapshot> getRosterSnapshot() const;
+
+  std::uint64_t membershipVersion() const;
+
+  // Adds the clients of sessions restored from a checkpoint, without events,
+  // and carries on from the membership version saved with them.
+  void restoreClients(const std::vector<events::ClientConnectedEvent> &clients,
+                      std::uint64_t membershipVersion);
+
   bool isPeerConnected(std::string_view peer) const;
 
+  // True when the peer is connected to another server node
+  bool isRemotePeer(std::string_view peer) const;
+
+  // Clients held by `node` (empty for this node), as their connect events
+  std::vector<events::ClientConnectedEvent>
+  getClientsOnNode(std::string_view node) const;
+
   // Grant access to IServiceEventObserver interface for registration
   events::IServiceEventObserver *asObserver();
 
@@ -45,8 +95,30 @@ private:
   void onMessageSent(const events::MessageSentEvent &event) override;
   void onPrivateMessageSent(const events::PrivateMessageSentEvent &event) override;
 
+  bool isPseudonymAvailableLocked(std::string_view peer,
+                                  std::string_view pseudonym,
+                                  std::string_view replacing = {}) const;
+
+  struct StringHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view value) const {
+      return std::hash<std::string_view>{}(value);
+    }
+  };
+
   mutable std::mutex mutex_;
-  std::unordered_map<std::string, ClientInfo> clients_;
+  std::unordered_map<std::string, ClientInfo, StringHash, std::equal_to<>>
+      clients_;
+  // pseudonym -> peer, kept in step with clients_ for O(1) lookups
+  std::unordered_map<std::string, std::string, StringHash, std::equal_to<>>
+      peersByPseudonym_;
+  // pseudonym -> peer, for connects accepted but not yet dispatched
+  std::unordered_map<std::string, std::string, StringHash, std::equal_to<>>
+      reservations_;
+  // Bumped by every connect and disconnect
+  std::uint64_t membershipVersion_ = 0;
+  // Stale once its version lags behind; extended in place while unshared
+  mutable std::shared_ptr<RosterSnapshot> roster_;
 };
 
 } // namespace domain
@@ -0,0 +1,157 @@
+#include "domain/liveness_tracker.hpp"
+
+#include <algorithm>
+
+namespace domain {
+
+LivenessTracker::Stream::~Stream() {
+  if (auto tracker = tracker_.lock()) {
+    tracker->closeStream(peer_, generation_);
+  }
+}
+
+LivenessTracker::Stream::Stream(Stream &&other) noexcept
+    : tracker_(std::exchange(other.tracker_, {})),
+      peer_(std::move(other.peer_)), generation_(other.generation_) {}
+
+LivenessTracker::Stream &
+LivenessTracker::Stream::operator=(Stream &&other) noexcept {
+  if (this != &other) {
+    Stream released(std::move(*this));
+    tracker_ = std::exchange(other.tracker_, {});
+    peer_ = std::move(other.peer_);
+    generation_ = other.generation_;
+  }
+  return *this;
+}
+
+LivenessTracker::LivenessTracker(Config config, Clock::time_point now)
+    : start_(now),
+      tick_(std::max<Clock::duration>(config.tick, std::chrono::milliseconds(1))),
+      timeoutTicks_(static_cast<std::uint64_t>(
+          (Clock::duration(config.idleTimeout) + tick_ - Clock::duration(1)) /
+          tick_)),
+      // A deadline is at most timeoutTicks_ + 1 ticks ahead
+      wheel_(timeoutTicks_ + 2) {}
+
+void LivenessTracker::touch(std::string_view peer, Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = clients_.find(std::string(peer));
+  if (it == clients_.end()) {
+    return;
+  }
+  // Moved lazily: the entry is rescheduled when its old slot comes up
+  it->second.deadline = tickAt(now) + timeoutTicks_ + 1;
+}
+
+LivenessTracker::Stream LivenessTracker::openStream(std::string_view peer,
+                                                    Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = clients_.find(std::string(peer));
+  if (it == clients_.end()) {
+    return {};
+  }
+  ++it->second.streams;
+  it->second.deadline = tickAt(now) + timeoutTicks_ + 1;
+  return {weak_from_this(), it->first, it->second.generation};
+}
+
+std::vector<std::string> LivenessTracker::advance(Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::vector<std::string> idle;
+  const std::uint64_t target = tickAt(now);
+  while (currentTick_ < target) {
+    ++currentTick_;
+    Slot due;
+    due.swap(wheel_[currentTick_ % wheel_.size()]);
+
+    for (auto &[peer, generation] : due) {
+      auto it = clients_.find(peer);
+      if (it == clients_.end() || it->second.generation != generation) {
+        // Disconnected, or connected again since it was scheduled
+        continue;
+      }
+      auto &client = it->second;
+      if (client.streams > 0) {
+        client.deadline = currentTick_ + timeoutTicks_ + 1;
+      }
+      if (client.deadline > currentTick_) {
+        scheduleLocked(peer, generation, client.deadline);
+        continue;
+      }
+      clients_.erase(it);
+      idle.push_back(std::move(peer));
+    }
+  }
+  return idle;
+}
+
+std::size_t LivenessTracker::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return clients_.size();
+}
+
+void LivenessTracker::onClientConnected(
+    const events::ClientConnectedEvent &event) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // The session's previous connection is gone without a disconnect event
+  if (!event.resumedPeer.empty()) {
+    clients_.erase(event.resumedPeer);
+  }
+
+  auto &client = clients_[event.peer];
+  client = Client{.generation = ++nextGeneration_,
+                  .deadline = tickAt(Clock::now()) + timeoutTicks_ + 1};
+  scheduleLocked(event.peer, client.generation, client.deadline);
+}
+
+void LivenessTracker::onClientDisconnected(
+    const events::ClientDisconnectedEvent &event) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Its wheel entry is skipped when it comes up
+  clients_.erase(event.peer);
+}
+
+void LivenessTracker::onMessageSent(const events::MessageSentEvent &event) {
+  touch(event.peer);
+}
+
+void LivenessTracker::onPrivateMessageSent(
+    const events::PrivateMessageSentEvent &event) {
+  touch(event.senderPeer);
+}
+
+std::uint64_t LivenessTracker::tickAt(Clock::time_point now) const {
+  if (now <= start_) {
+    return 0;
+  }
+  return static_cast<std::uint64_t>((now - start_) / tick_);
+}
+
+void LivenessTracker::scheduleLocked(const std::string &peer,
+                                     std::uint64_t generation,
+                                     std::uint64_t deadline) {
+  // Never in the slot being visited, which would defer it a full turn
+  deadline = std::max(deadline, currentTick_ + 1);
+  wheel_[deadline % wheel_.size()].emplace_back(peer, generation);
+}
+
+void LivenessTracker::closeStream(const std::string &peer,
+                                  std::uint64_t generation) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = clients_.find(peer);
+  if (it == clients_.end() || it->second.generation != generation ||
+      it->second.streams == 0) {
+    return;
+  }
+  --it->second.streams;
+  // The idle timeout runs from the end of the last stream
+  it->second.deadline = tickAt(Clock::now()) + timeoutTicks_ + 1;
+}
+
+} // namespace domain
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "service/events/chat_service_events.hpp"
+
+namespace domain {
+
+// Finds the clients of this node that went away without calling Disconnect.
+//
+// A client is alive while it has a stream open; gRPC keepalive cancels the
+// streams of a client whose connection died. Without a stream, any call or
+// message counts as activity, and a client idle for the timeout is reaped.
+//
+// Deadlines sit in a timing wheel with one slot per tick. Activity only
+// records the new deadline; an entry whose deadline moved is put back in its
+// new slot when its old one comes up. Each tick therefore costs one visit per
+// entry due, and memory follows the connected clients.
+class LivenessTracker
+    : public events::IServiceEventObserver,
+      public std::enable_shared_from_this<LivenessTracker> {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Config {
+    // Zero disables reaping
+    std::chrono::milliseconds idleTimeout{60000};
+    std::chrono::milliseconds tick{1000};
+  };
+
+  // Keeps its client alive until destroyed. Empty when default constructed.
+  class Stream {
+  public:
+    Stream() = default;
+    ~Stream();
+    Stream(Stream &&other) noexcept;
+    Stream &operator=(Stream &&other) noexcept;
+    Stream(const Stream &) = delete;
+    Stream &operator=(const Stream &) = delete;
+
+  private:
+    friend class LivenessTracker;
+    Stream(std::weak_ptr<LivenessTracker> tracker, std::string peer,
+           std::uint64_t generation)
+        : tracker_(std::move(tracker)), peer_(std::move(peer)),
+          generation_(generation) {}
+
+    std::weak_ptr<LivenessTracker> tracker_;
+    std::string peer_;
+    std::uint64_t generation_ = 0;
+  };
+
+  explicit LivenessTracker(Config config, Clock::time_point now = Clock::now());
+
+  // Counts as activity of a connected client; unknown peers are ignored.
+  void touch(std::string_view peer, Clock::time_point now = Clock::now());
+
+  // A stream of `peer` opened; the client is alive until the handle goes.
+  // The tracker must be owned by a shared_ptr.
+  Stream openStream(std::string_view peer, Clock::time_point now = Clock::now());
+
+  // Turns the wheel up to `now` and returns the peers found idle, which are
+  // no longer tracked.
+  std::vector<std::string> advance(Clock::time_point now);
+
+  std::size_t size() const;
+
+  // IServiceEventObserver: clients are tracked from connect to disconnect
+  void onClientConnected(const events::ClientConnectedEvent &event) override;
+  void
+  onClientDisconnected(const events::ClientDisconnectedEvent &event) override;
+  void onMessageSent(const events::MessageSentEvent &event) override;
+  void
+  onPrivateMessageSent(const events::PrivateMessageSentEvent &event) override;
+
+private:
+  struct Client {
+    std::uint64_t generation = 0;
+    std::uint64_t deadline = 0;
+    std::size_t streams = 0;
+  };
+
+  // Peer and the generation of the client it was scheduled for
+  using Slot = std::vector<std::pair<std::string, std::uint64_t>>;
+
+  std::uint64_t tickAt(Clock::time_point now) const;
+  void scheduleLocked(const std::string &peer, std::uint64_t generation,
+                      std::uint64_t deadline);
+  void closeStream(const std::string &peer, std::uint64_t generation);
+
+  const Clock::time_point start_;
+  const Clock::duration tick_;
+  // Ticks a client may stay idle, rounded up
+  const std::uint64_t timeoutTicks_;
+
+  mutable std::mutex mutex_;
+  std::vector<Slot> wheel_;
+  // Last tick whose slot was visited
+  std::uint64_t currentTick_ = 0;
+  std::uint64_t nextGeneration_ = 0;
+  std::unordered_map<std::string, Client> clients_;
+};
+
+} // namespace domain
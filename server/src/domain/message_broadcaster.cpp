@@ -1,93 +1,351 @@
 #include "domain/message_broadcaster.hpp"
 
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+
 namespace domain {
 
-MessageBroadcaster::MessageBroadcaster(const ClientRegistry &clientRegistry)
-    : clientRegistry_(clientRegistry) {}
+MessageBroadcaster::MessageBroadcaster(const ClientRegistry &clientRegistry,
+                                       OutboundQueueConfig queueConfig,
+                                       std::size_t shardCount)
+    : clientRegistry_(clientRegistry), queueConfig_(queueConfig) {
+  shardCount = std::max<std::size_t>(shardCount, 1);
+  shards_.reserve(shardCount);
+  for (std::size_t i = 0; i < shardCount; ++i) {
+    shards_.push_back(std::make_unique<Shard>());
+  }
+}
 
-NextMessageStatus
-MessageBroadcaster::nextMessage(std::string_view peer,
-                                std::chrono::milliseconds waitFor,
-                                chat::InformClientsNewMessageResponse &out) {
-  std::unique_lock<std::mutex> lock(mutex_);
-  const std::string peerKey(peer);
+MessageBroadcaster::Shard &
+MessageBroadcaster::shardFor(std::string_view peer) const {
+  return *shards_[std::hash<std::string_view>{}(peer) % shards_.size()];
+}
 
-  if (!clientRegistry_.isPeerConnected(peer)) {
-    peerIndices_.erase(peerKey);
-    return NextMessageStatus::kPeerMissing;
+// The read side of one peer. Its cursor is used by whoever holds busy_:
+// the stream reading, or the publisher moving a stalled cursor, which only
+// tries and skips a subscription being read.
+class MessageBroadcaster::Subscription final : public IMessageSubscription {
+public:
+  Subscription(MessageBroadcaster &broadcaster,
+               std::unique_ptr<MessageLog::Cursor> cursor)
+      : broadcaster_(broadcaster), cursor_(std::move(cursor)) {}
+
+  NextMessageStatus next(events::ChatMessagePtr &out) override {
+    acquire();
+    NextMessageStatus status = NextMessageStatus::kOk;
+    if (state_ == State::kLeft) {
+      status = NextMessageStatus::kPeerMissing;
+    } else if (state_ == State::kOverflowed) {
+      status = NextMessageStatus::kOverflow;
+    } else {
+      status = broadcaster_.takeNext(*cursor_, out);
+      if (status == NextMessageStatus::kOverflow) {
+        endLocked(State::kOverflowed);
+      }
+    }
+    release();
+    return status;
+  }
+
+  std::size_t pending() override { return depth().value_or(0); }
+
+  // Pending messages, none once ended
+  std::optional<std::size_t> depth() {
+    acquire();
+    std::optional<std::size_t> pending;
+    if (cursor_) {
+      pending = cursor_->pending();
+    }
+    release();
+    return pending;
+  }
+
+  bool active() {
+    acquire();
+    const bool active = state_ == State::kActive;
+    release();
+    return active;
   }
 
-  auto it = peerIndices_.find(peerKey);
-  if (it == peerIndices_.end()) {
-    it = peerIndices_.emplace(peerKey, messageHistory_.size()).first;
+  // Holds the cursor to the capacity behind the tail at `size`, unless its
+  // reader is on it: that read applies the policy itself.
+  void enforceCapacity(std::uint64_t size, std::size_t capacity,
+                       SlowConsumerPolicy policy) {
+    if (busy_.test_and_set(std::memory_order_acquire)) {
+      return;
+    }
+    if (cursor_ && cursor_->pending() > capacity) {
+      if (policy == SlowConsumerPolicy::kDisconnect) {
+        endLocked(State::kOverflowed);
+      } else {
+        // The reader still folds the backlog under kCoalesce
+        cursor_->skipTo(size - capacity);
+      }
+    }
+    release();
   }
 
-  if (it->second < messageHistory_.size()) {
-    out = messageHistory_[it->second];
-    ++it->second;
-    return NextMessageStatus::kOk;
+  // Ends the subscription once its peer has left
+  void leave() {
+    acquire();
+    if (state_ == State::kActive) {
+      endLocked(State::kLeft);
+    }
+    release();
   }
 
-  messageCv_.wait_for(lock, waitFor);
+private:
+  enum class State { kActive, kOverflowed, kLeft };
 
+  void acquire() {
+    // Only held for a read or a cursor move, never across a wait
+    while (busy_.test_and_set(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  }
+
+  void release() { busy_.clear(std::memory_order_release); }
+
+  // Frees the cursor, so that the log is no longer held for this peer
+  void endLocked(State state) {
+    state_ = state;
+    cursor_.reset();
+  }
+
+  MessageBroadcaster &broadcaster_;
+  std::atomic_flag busy_;
+  // Guarded by busy_; the cursor is null once the subscription ended
+  State state_ = State::kActive;
+  std::unique_ptr<MessageLog::Cursor> cursor_;
+};
+
+std::shared_ptr<MessageBroadcaster::Subscription>
+MessageBroadcaster::subscriptionFor(std::string_view peer, bool renew) {
+  Shard &shard = shardFor(peer);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  auto it = shard.subscriptions.find(peer);
+  if (it != shard.subscriptions.end() &&
+      (!renew || it->second->active())) {
+    return it->second;
+  }
   if (!clientRegistry_.isPeerConnected(peer)) {
-    peerIndices_.erase(peerKey);
-    return NextMessageStatus::kPeerMissing;
+    if (it != shard.subscriptions.end()) {
+      shard.subscriptions.erase(it);
+    }
+    return nullptr;
   }
 
-  it = peerIndices_.find(peerKey);
-  if (it == peerIndices_.end()) {
+  // New subscribers start at the current tail
+  auto subscription =
+      std::make_shared<Subscription>(*this, messageLog_.subscribe());
+  if (it != shard.subscriptions.end()) {
+    it->second = subscription;
+  } else {
+    shard.subscriptions.emplace(std::string(peer), subscription);
+  }
+  return subscription;
+}
+
+NextMessageStatus
+MessageBroadcaster::nextMessage(std::string_view peer,
+                                std::chrono::milliseconds waitFor,
+                                events::ChatMessagePtr &out) {
+  // Only new subscribers hit the registry here
+  const auto subscription = subscriptionFor(peer, false);
+  if (!subscription) {
     return NextMessageStatus::kPeerMissing;
   }
 
-  if (it->second < messageHistory_.size()) {
-    out = messageHistory_[it->second];
-    ++it->second;
-    return NextMessageStatus::kOk;
+  auto status = subscription->next(out);
+  if (status == NextMessageStatus::kNoMessage) {
+    waitForMessage(shardFor(peer), *subscription, waitFor);
+    status = subscription->next(out);
+    if (status == NextMessageStatus::kNoMessage &&
+        !clientRegistry_.isPeerConnected(peer)) {
+      status = NextMessageStatus::kPeerMissing;
+    }
+  }
+
+  if (status == NextMessageStatus::kPeerMissing ||
+      status == NextMessageStatus::kOverflow) {
+    // Told once; the next call starts over, as a new subscriber would
+    Shard &shard = shardFor(peer);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.subscriptions.find(peer);
+    if (it != shard.subscriptions.end() && it->second == subscription) {
+      shard.subscriptions.erase(it);
+    }
+  }
+  return status;
+}
+
+void MessageBroadcaster::waitForMessage(Shard &shard,
+                                        Subscription &subscription,
+                                        std::chrono::milliseconds waitFor) {
+  if (waitFor.count() <= 0) {
+    return;
   }
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  // Counted before the check: a publish either sees the waiter and wakes
+  // it, or is seen by the check
+  shard.waiters.fetch_add(1);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  shard.messageCv.wait_for(lock, waitFor, [this, &subscription] {
+    return subscription.depth().value_or(1) != 0 || draining_;
+  });
+  shard.waiters.fetch_sub(1);
+}
+
+std::shared_ptr<IMessageSubscription>
+MessageBroadcaster::subscribe(std::string_view peer) {
+  return subscriptionFor(peer, true);
+}
 
-  return NextMessageStatus::kNoMessage;
+void MessageBroadcaster::drain() {
+  draining_ = true;
+  // Taking each shard lock orders the flag before any waiter's next check
+  for (const auto &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->messageCv.notify_all();
+  }
 }
 
 bool MessageBroadcaster::normalizeMessageIndex(std::string_view peer) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  const std::string peerKey(peer);
+  // Cursors never run past the published tail, existing ones are kept as is
+  return subscriptionFor(peer, true) != nullptr;
+}
 
-  if (!clientRegistry_.isPeerConnected(peer)) {
-    peerIndices_.erase(peerKey);
-    return false;
+std::optional<std::size_t>
+MessageBroadcaster::queueDepth(std::string_view peer) const {
+  Shard &shard = shardFor(peer);
+  std::shared_ptr<Subscription> subscription;
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.subscriptions.find(peer);
+    if (it == shard.subscriptions.end()) {
+      return std::nullopt;
+    }
+    subscription = it->second;
+  }
+  return subscription->depth();
+}
+
+NextMessageStatus
+MessageBroadcaster::takeNext(MessageLog::Cursor &cursor,
+                             events::ChatMessagePtr &out) {
+  const std::size_t capacity = std::max<std::size_t>(queueConfig_.capacity, 1);
+  const bool lagging = cursor.pending() > capacity;
+
+  if (lagging) {
+    if (queueConfig_.policy == SlowConsumerPolicy::kDisconnect) {
+      return NextMessageStatus::kOverflow;
+    }
+    cursor.skipTo(messageLog_.size() - capacity);
   }
 
-  auto it = peerIndices_.find(peerKey);
-  if (it == peerIndices_.end()) {
-    peerIndices_[peerKey] = messageHistory_.size();
-    return true;
+  const events::ChatMessagePtr *entry = cursor.peek();
+  if (entry == nullptr) {
+    return NextMessageStatus::kNoMessage;
   }
+  out = *entry;
+  cursor.advance();
 
-  if (it->second > messageHistory_.size()) {
-    it->second = messageHistory_.size();
+  if (lagging && queueConfig_.policy == SlowConsumerPolicy::kCoalesce) {
+    // The text is folded first and the payload built once; past the cap the
+    // next message is delivered on its own
+    std::string content = out->content();
+    bool folded = false;
+    while ((entry = cursor.peek()) != nullptr &&
+           canCoalesce(*out, content.size(), **entry,
+                       queueConfig_.maxCoalescedBytes)) {
+      appendCoalesced(content, **entry);
+      folded = true;
+      cursor.advance();
+    }
+    if (folded) {
+      out = events::makeChatMessage(out->author(), std::move(content),
+                                    out->room(), out->isprivate());
+    }
   }
 
-  return true;
+  return NextMessageStatus::kOk;
+}
+
+void MessageBroadcaster::enforceCapacity() {
+  const std::size_t capacity = std::max<std::size_t>(queueConfig_.capacity, 1);
+  const std::uint64_t size = messageLog_.size();
+  if (size <= capacity) {
+    return;
+  }
+
+  for (const auto &shard : shards_) {
+    // Only keeps the map still; readers do not take it to read
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    for (const auto &entry : shard->subscriptions) {
+      entry.second->enforceCapacity(size, capacity, queueConfig_.policy);
+    }
+  }
+
+  messageLog_.reclaim();
 }
 
 void MessageBroadcaster::onClientConnected(
     [[maybe_unused]] const events::ClientConnectedEvent &event) {}
 
 void MessageBroadcaster::onClientDisconnected(
-    [[maybe_unused]] const events::ClientDisconnectedEvent &event) {}
+    const events::ClientDisconnectedEvent &event) {
+  // Only the leaving peer's shard is touched
+  Shard &shard = shardFor(event.peer);
+  std::shared_ptr<Subscription> subscription;
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.subscriptions.find(event.peer);
+    if (it == shard.subscriptions.end()) {
+      return;
+    }
+    subscription = std::move(it->second);
+    shard.subscriptions.erase(it);
+  }
+
+  // Its stream finds the subscription ended, now or once its wait wakes up
+  subscription->leave();
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+  }
+  shard.messageCv.notify_all();
+}
 
 void MessageBroadcaster::onMessageSent(const events::MessageSentEvent &event) {
-  chat::InformClientsNewMessageResponse payload;
-  payload.set_author(event.pseudonym);
-  payload.set_content(event.content);
+  if (!event.message) {
+    return;
+  }
 
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    messageHistory_.push_back(payload);
+  // The log shares the event's payload, no per-publish copy
+  messageLog_.append(event.message);
+  // Once per segment, so that stalled readers hold at most the queue
+  // capacity and a segment of the log
+  if (messageLog_.size() % MessageLog::segmentSize() == 0) {
+    enforceCapacity();
   }
 
-  messageCv_.notify_all();
+  // Pairs with the fence of waitForMessage: a waiter counted after this
+  // sees the append
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  for (const auto &shard : shards_) {
+    if (shard->waiters.load() == 0) {
+      continue;
+    }
+    // Taking the shard lock lets a waiter between its check and its wait
+    // get there first, so the notification cannot be lost
+    {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+    }
+    shard->messageCv.notify_all();
+  }
 }
 
 void MessageBroadcaster::onPrivateMessageSent(
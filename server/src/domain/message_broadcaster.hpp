@@ -1,9 +1,13 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <cstddef>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -11,6 +15,8 @@
 
 #include "chat.pb.h"
 #include "domain/client_registry.hpp"
+#include "domain/outbound_queue_policy.hpp"
+#include "domain/spmc_append_log.hpp"
 #include "service/events/chat_service_events.hpp"
 
 namespace domain {
@@ -19,31 +25,84 @@ enum class NextMessageStatus {
   kOk,
   kNoMessage,
   kPeerMissing,
+  // The peer fell behind its outbound capacity under kDisconnect policy.
+  kOverflow,
+};
+
+// A peer's read side of one room, held by its stream.
+class IMessageSubscription {
+public:
+  virtual ~IMessageSubscription() = default;
+
+  // Takes the next message without waiting. kPeerMissing once the peer has
+  // left, kOverflow once it fell behind under kDisconnect.
+  virtual NextMessageStatus next(events::ChatMessagePtr &out) = 0;
+
+  // Messages pending delivery; 0 once the subscription has ended.
+  virtual std::size_t pending() = 0;
 };
 
 class IMessageBroadcaster {
 public:
   virtual ~IMessageBroadcaster() = default;
 
-  virtual NextMessageStatus
-  nextMessage(std::string_view peer, std::chrono::milliseconds waitFor,
-              chat::InformClientsNewMessageResponse &out) = 0;
+  // Hands out the shared payload itself; subscribers never copy it.
+  virtual NextMessageStatus nextMessage(std::string_view peer,
+                                        std::chrono::milliseconds waitFor,
+                                        events::ChatMessagePtr &out) = 0;
 
   virtual bool normalizeMessageIndex(std::string_view peer) = 0;
+
+  // Subscribes `peer` as normalizeMessageIndex does and returns its read
+  // side, or null when the peer is not connected. The subscription must not
+  // outlive the broadcaster.
+  virtual std::shared_ptr<IMessageSubscription>
+  subscribe(std::string_view peer) = 0;
+
+  // Number of public messages pending delivery for `peer`, if subscribed.
+  virtual std::optional<std::size_t>
+  queueDepth(std::string_view peer) const = 0;
+
+  // Pending messages are still handed out, but from now on nextMessage
+  // returns at once instead of waiting for more. Used to end streams when
+  // the server shuts down.
+  virtual void drain() = 0;
 };
 
+// Public message fan-out engine.
+//
+// Published messages are appended once to a shared, immutable message log
+// that subscribers read through lock-free cursors. A stream reads through
+// its subscription without taking any lock: the only thing it shares with
+// the publisher is a per-subscription flag, which the publisher tries once
+// per log segment to move a stalled cursor and otherwise leaves alone.
+// Subscriptions are partitioned across shards by peer hash; a shard's mutex
+// guards its subscription map and the idle waits of nextMessage, and a
+// publish only takes it when the shard has readers asleep.
 class MessageBroadcaster : public IMessageBroadcaster,
                            public events::IServiceEventObserver {
 public:
-  explicit MessageBroadcaster(const ClientRegistry &clientRegistry);
+  explicit MessageBroadcaster(const ClientRegistry &clientRegistry,
+                              OutboundQueueConfig queueConfig = {},
+                              std::size_t shardCount = 1);
 
   // IMessageBroadcaster
   NextMessageStatus nextMessage(std::string_view peer,
                                 std::chrono::milliseconds waitFor,
-                                chat::InformClientsNewMessageResponse &out) override;
+                                events::ChatMessagePtr &out) override;
 
   bool normalizeMessageIndex(std::string_view peer) override;
 
+  std::shared_ptr<IMessageSubscription>
+  subscribe(std::string_view peer) override;
+
+  std::optional<std::size_t>
+  queueDepth(std::string_view peer) const override;
+
+  void drain() override;
+
+  std::size_t shardCount() const { return shards_.size(); }
+
   // IServiceEventObserver
   void onClientConnected(const events::ClientConnectedEvent &event) override;
   void onClientDisconnected(const events::ClientDisconnectedEvent &event) override;
@@ -51,11 +110,60 @@ public:
   void onPrivateMessageSent(const events::PrivateMessageSentEvent &event) override;
 
 private:
+  using MessageLog = SpmcAppendLog<events::ChatMessagePtr>;
+
+  // Lets the delivery path look peers up without building a key string
+  struct PeerHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view peer) const {
+      return std::hash<std::string_view>{}(peer);
+    }
+  };
+
+  class Subscription;
+
+  struct Shard {
+    // Guards the subscription map and pairs with messageCv for idle waits
+    std::mutex mutex;
+    std::condition_variable messageCv;
+    // Readers asleep on messageCv; a publish skips shards without any
+    std::atomic<std::size_t> waiters{0};
+    // Peer -> its read position in the message log. Ended subscriptions
+    // stay until their peer is told or subscribes again.
+    std::unordered_map<std::string, std::shared_ptr<Subscription>, PeerHash,
+                       std::equal_to<>>
+        subscriptions;
+  };
+
+  Shard &shardFor(std::string_view peer) const;
+
+  // The subscription of `peer`, created when missing if the peer is
+  // connected; an ended one is replaced when `renew` is set.
+  std::shared_ptr<Subscription> subscriptionFor(std::string_view peer,
+                                                bool renew);
+
+  // Sleeps until `subscription` has a message, ends, the broadcaster
+  // drains, or `waitFor` elapses.
+  void waitForMessage(Shard &shard, Subscription &subscription,
+                      std::chrono::milliseconds waitFor);
+
+  // Applies the slow-consumer policy to every cursor lagging more than the
+  // queue capacity, then frees the log segments they held. Run by the
+  // publisher, so a subscriber that never reads cannot pin the log.
+  void enforceCapacity();
+
+  // Pops the entry at `cursor` into `out`, applying the slow-consumer policy
+  // first when the peer lags more than the queue capacity. Only the holder
+  // of the cursor's subscription may call it.
+  NextMessageStatus takeNext(MessageLog::Cursor &cursor,
+                             events::ChatMessagePtr &out);
+
   const ClientRegistry &clientRegistry_;
-  mutable std::mutex mutex_;
-  std::condition_variable messageCv_;
-  std::vector<chat::InformClientsNewMessageResponse> messageHistory_;
-  std::unordered_map<std::string, std::size_t> peerIndices_;
+  const OutboundQueueConfig queueConfig_;
+  // Declared before the shards so that cursors are destroyed first
+  MessageLog messageLog_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::atomic<bool> draining_{false};
 };
 
 } // namespace domain
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "service/events/chat_service_events.hpp"
+
+namespace domain {
+
+// Behaviour applied when a subscriber falls further behind than its outbound
+// queue capacity allows.
+enum class SlowConsumerPolicy {
+  // Discard the oldest pending messages so that at most `capacity` remain.
+  kDropOldest,
+  // Like kDropOldest, but while the subscriber is backlogged consecutive
+  // messages from the same author are folded into a single payload of at
+  // most `maxCoalescedBytes` of text.
+  kCoalesce,
+  // Terminate the session stream with RESOURCE_EXHAUSTED.
+  kDisconnect,
+};
+
+struct OutboundQueueConfig {
+  std::size_t capacity = 1024;
+  SlowConsumerPolicy policy = SlowConsumerPolicy::kDropOldest;
+  // Keeps folded payloads well below the client's receive limit
+  std::size_t maxCoalescedBytes = 64 * 1024;
+};
+
+inline std::optional<SlowConsumerPolicy>
+slowConsumerPolicyFromString(std::string_view name) {
+  if (name == "drop-oldest") {
+    return SlowConsumerPolicy::kDropOldest;
+  }
+  if (name == "coalesce") {
+    return SlowConsumerPolicy::kCoalesce;
+  }
+  if (name == "disconnect") {
+    return SlowConsumerPolicy::kDisconnect;
+  }
+  return std::nullopt;
+}
+
+// Whether `next` can be folded into `into` once its text is `bytes` long:
+// both come from the same author through the same channel, and the folded
+// text stays within `maxBytes`.
+inline bool canCoalesce(const events::ChatMessage &into, std::size_t bytes,
+                        const events::ChatMessage &next,
+                        std::size_t maxBytes) {
+  return into.author() == next.author() &&
+         into.isprivate() == next.isprivate() &&
+         bytes + 1 + next.content().size() <= maxBytes;
+}
+
+// Appends the text of `next` to a folded text.
+inline void appendCoalesced(std::string &content,
+                            const events::ChatMessage &next) {
+  content += '\n';
+  content += next.content();
+}
+
+// Copy-on-write fold of `next` into the shared payload `into`.
+inline void coalesceInto(events::ChatMessagePtr &into,
+                         const events::ChatMessage &next) {
+  std::string content = into->content();
+  appendCoalesced(content, next);
+  into = events::makeChatMessage(into->author(), std::move(content),
+                                 into->room(), into->isprivate());
+}
+
+} // namespace domain
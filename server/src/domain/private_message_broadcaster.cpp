@@ -1,14 +1,16 @@
 #include "domain/private_message_broadcaster.hpp"
 
+#include <algorithm>
+
 namespace domain {
 
 PrivateMessageBroadcaster::PrivateMessageBroadcaster(
-    const ClientRegistry &clientRegistry)
-    : clientRegistry_(clientRegistry) {}
+    const ClientRegistry &clientRegistry, OutboundQueueConfig queueConfig)
+    : clientRegistry_(clientRegistry), queueConfig_(queueConfig) {}
 
 NextPrivateMessageStatus PrivateMessageBroadcaster::nextPrivateMessage(
     std::string_view peer, std::chrono::milliseconds waitFor,
-    chat::InformClientsNewMessageResponse &out) {
+    events::ChatMessagePtr &out) {
   std::unique_lock<std::mutex> lock(mutex_);
   const std::string peerKey(peer);
 
@@ -17,6 +19,11 @@ NextPrivateMessageStatus PrivateMessageBroadcaster::nextPrivateMessage(
     return NextPrivateMessageStatus::kPeerMissing;
   }
 
+  if (overflowedPeers_.erase(peerKey) != 0) {
+    peerMessageQueues_.erase(peerKey);
+    return NextPrivateMessageStatus::kOverflow;
+  }
+
   auto &queue = peerMessageQueues_[peerKey];
 
   if (!queue.empty()) {
@@ -25,13 +32,20 @@ NextPrivateMessageStatus PrivateMessageBroadcaster::nextPrivateMessage(
     return NextPrivateMessageStatus::kOk;
   }
 
-  messageCv_.wait_for(lock, waitFor);
+  if (!draining_) {
+    messageCv_.wait_for(lock, waitFor);
+  }
 
   if (!clientRegistry_.isPeerConnected(peer)) {
     peerMessageQueues_.erase(peerKey);
     return NextPrivateMessageStatus::kPeerMissing;
   }
 
+  if (overflowedPeers_.erase(peerKey) != 0) {
+    peerMessageQueues_.erase(peerKey);
+    return NextPrivateMessageStatus::kOverflow;
+  }
+
   auto queueIt = peerMessageQueues_.find(peerKey);
   if (queueIt == peerMessageQueues_.end() || queueIt->second.empty()) {
     return NextPrivateMessageStatus::kNoMessage;
@@ -42,6 +56,12 @@ NextPrivateMessageStatus PrivateMessageBroadcaster::nextPrivateMessage(
   return NextPrivateMessageStatus::kOk;
 }
 
+void PrivateMessageBroadcaster::drain() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  draining_ = true;
+  messageCv_.notify_all();
+}
+
 bool PrivateMessageBroadcaster::normalizePrivateMessageIndex(
     std::string_view peer) {
   std::lock_guard<std::mutex> lock(mutex_);
@@ -57,6 +77,49 @@ bool PrivateMessageBroadcaster::normalizePrivateMessageIndex(
   return true;
 }
 
+std::optional<std::size_t>
+PrivateMessageBroadcaster::queueDepth(std::string_view peer) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = peerMessageQueues_.find(std::string(peer));
+  if (it == peerMessageQueues_.end()) {
+    return std::nullopt;
+  }
+
+  return it->second.size();
+}
+
+bool PrivateMessageBroadcaster::makeRoomLocked(
+    const std::string &peer,
+    std::deque<events::ChatMessagePtr> &queue,
+    const events::ChatMessage &payload) {
+  const std::size_t capacity = std::max<std::size_t>(queueConfig_.capacity, 1);
+  if (queue.size() < capacity) {
+    return true;
+  }
+
+  switch (queueConfig_.policy) {
+  case SlowConsumerPolicy::kDisconnect:
+    overflowedPeers_.insert(peer);
+    queue.clear();
+    return false;
+  case SlowConsumerPolicy::kCoalesce:
+    if (canCoalesce(*queue.back(), queue.back()->content().size(), payload,
+                    queueConfig_.maxCoalescedBytes)) {
+      coalesceInto(queue.back(), payload);
+      return false;
+    }
+    break;
+  case SlowConsumerPolicy::kDropOldest:
+    break;
+  }
+
+  while (queue.size() >= capacity) {
+    queue.pop_front();
+  }
+  return true;
+}
+
 void PrivateMessageBroadcaster::onClientConnected(
     [[maybe_unused]] const events::ClientConnectedEvent &event) {}
 
@@ -66,6 +129,7 @@ void PrivateMessageBroadcaster::onClientDisconnected(
   // Clean up message queue for disconnected peer
   for (auto it = peerMessageQueues_.begin(); it != peerMessageQueues_.end();) {
     if (!clientRegistry_.isPeerConnected(it->first)) {
+      overflowedPeers_.erase(it->first);
       it = peerMessageQueues_.erase(it);
     } else {
       ++it;
@@ -78,15 +142,23 @@ void PrivateMessageBroadcaster::onMessageSent(
 
 void PrivateMessageBroadcaster::onPrivateMessageSent(
     const events::PrivateMessageSentEvent &event) {
-  chat::InformClientsNewMessageResponse payload;
-  payload.set_author(event.senderPseudonym);
-  payload.set_content(event.content);
-  payload.set_isprivate(true);
+  if (!event.message) {
+    return;
+  }
+
+  // The node holding the recipient's stream queues it
+  if (clientRegistry_.isRemotePeer(event.recipientPeer)) {
+    return;
+  }
 
   {
     std::lock_guard<std::mutex> lock(mutex_);
     // Add message to recipient's queue
-    peerMessageQueues_[event.recipientPeer].push_back(payload);
+    auto &queue = peerMessageQueues_[event.recipientPeer];
+    if (!overflowedPeers_.contains(event.recipientPeer) &&
+        makeRoomLocked(event.recipientPeer, queue, *event.message)) {
+      queue.push_back(event.message);
+    }
   }
 
   messageCv_.notify_all();
@@ -4,12 +4,15 @@
 #include <condition_variable>
 #include <deque>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "chat.pb.h"
 #include "domain/client_registry.hpp"
+#include "domain/outbound_queue_policy.hpp"
 #include "service/events/chat_service_events.hpp"
 
 namespace domain {
@@ -18,6 +21,8 @@ enum class NextPrivateMessageStatus {
   kOk,
   kNoMessage,
   kPeerMissing,
+  // The peer's queue overflowed under kDisconnect policy.
+  kOverflow,
 };
 
 class IPrivateMessageBroadcaster {
@@ -26,23 +31,37 @@ public:
 
   virtual NextPrivateMessageStatus
   nextPrivateMessage(std::string_view peer, std::chrono::milliseconds waitFor,
-                     chat::InformClientsNewMessageResponse &out) = 0;
+                     events::ChatMessagePtr &out) = 0;
 
   virtual bool normalizePrivateMessageIndex(std::string_view peer) = 0;
+
+  // Number of private messages queued for `peer`, if it has a queue.
+  virtual std::optional<std::size_t>
+  queueDepth(std::string_view peer) const = 0;
+
+  // Queued messages are still handed out, but nextPrivateMessage no longer
+  // waits for more.
+  virtual void drain() = 0;
 };
 
 class PrivateMessageBroadcaster : public IPrivateMessageBroadcaster,
                                    public events::IServiceEventObserver {
 public:
-  explicit PrivateMessageBroadcaster(const ClientRegistry &clientRegistry);
+  explicit PrivateMessageBroadcaster(const ClientRegistry &clientRegistry,
+                                     OutboundQueueConfig queueConfig = {});
 
   // IPrivateMessageBroadcaster
   NextPrivateMessageStatus
   nextPrivateMessage(std::string_view peer, std::chrono::milliseconds waitFor,
-                     chat::InformClientsNewMessageResponse &out) override;
+                     events::ChatMessagePtr &out) override;
 
   bool normalizePrivateMessageIndex(std::string_view peer) override;
 
+  std::optional<std::size_t>
+  queueDepth(std::string_view peer) const override;
+
+  void drain() override;
+
   // IServiceEventObserver
   void onClientConnected(const events::ClientConnectedEvent &event) override;
   void
@@ -52,13 +71,22 @@ public:
   onPrivateMessageSent(const events::PrivateMessageSentEvent &event) override;
 
 private:
+  // Applies the slow-consumer policy before queuing into a full queue.
+  // Returns false when the message must not be queued. Lock must be held.
+  bool makeRoomLocked(const std::string &peer,
+                      std::deque<events::ChatMessagePtr> &queue,
+                      const events::ChatMessage &payload);
+
   const ClientRegistry &clientRegistry_;
+  const OutboundQueueConfig queueConfig_;
   mutable std::mutex mutex_;
   std::condition_variable messageCv_;
   // Per-peer message queues: peer -> deque of private messages for that peer
-  std::unordered_map<std::string,
-                     std::deque<chat::InformClientsNewMessageResponse>>
+  std::unordered_map<std::string, std::deque<events::ChatMessagePtr>>
       peerMessageQueues_;
+  // Peers whose queue overflowed under kDisconnect policy
+  std::unordered_set<std::string> overflowedPeers_;
+  bool draining_ = false;
 };
 
 } // namespace domain
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+namespace domain {
+
+enum class ClaimResult {
+  kGranted,
+  kTaken,
+  // The owner could not decide in time, or ownership is being rebalanced
+  kUnavailable,
+};
+
+// Decides which client may use a pseudonym across every server node.
+class IPseudonymArbiter {
+public:
+  using ClaimCallback = std::function<void(ClaimResult)>;
+
+  virtual ~IPseudonymArbiter() = default;
+
+  // Claims `pseudonym` for `peer` of this node. `done` runs once, possibly
+  // on another thread after the call returned.
+  virtual void claim(const std::string &peer, const std::string &pseudonym,
+                     ClaimCallback done) = 0;
+};
+
+} // namespace domain
@@ -0,0 +1,129 @@
+#include "domain/room_registry.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace domain {
+
+RoomRegistry::RoomRegistry(const ClientRegistry &clientRegistry,
+                           OutboundQueueConfig queueConfig,
+                           std::size_t shardsPerRoom, std::size_t maxRooms)
+    : clientRegistry_(clientRegistry), queueConfig_(queueConfig),
+      shardsPerRoom_(shardsPerRoom),
+      maxRooms_(std::max<std::size_t>(maxRooms, 1)),
+      defaultRoom_(makeRoom()) {
+  rooms_.emplace(kDefaultRoom, defaultRoom_);
+}
+
+std::string RoomRegistry::normalizeRoomId(std::string_view roomId) {
+  return std::string(roomId.empty() ? kDefaultRoom : roomId);
+}
+
+bool RoomRegistry::isValidRoomId(std::string_view roomId) {
+  return roomId.size() <= kMaxRoomIdLength &&
+         std::ranges::all_of(roomId, [](char c) {
+           return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                  (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.';
+         });
+}
+
+std::expected<std::shared_ptr<IMessageBroadcaster>, RoomError>
+RoomRegistry::room(std::string_view roomId) {
+  if (!isValidRoomId(roomId)) {
+    return std::unexpected(RoomError::kInvalidId);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  const std::string roomKey = normalizeRoomId(roomId);
+
+  auto it = rooms_.find(roomKey);
+  if (it != rooms_.end()) {
+    if (auto broadcaster = it->second.lock()) {
+      return broadcaster;
+    }
+  }
+
+  eraseAbandonedLocked();
+  if (rooms_.size() >= maxRooms_) {
+    return std::unexpected(RoomError::kLimitReached);
+  }
+
+  auto broadcaster = makeRoom();
+  if (draining_) {
+    broadcaster->drain();
+  }
+  rooms_.insert_or_assign(roomKey, broadcaster);
+  return broadcaster;
+}
+
+void RoomRegistry::drain() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  draining_ = true;
+  for (const auto &entry : rooms_) {
+    if (auto broadcaster = entry.second.lock()) {
+      broadcaster->drain();
+    }
+  }
+}
+
+std::size_t RoomRegistry::roomCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return static_cast<std::size_t>(
+      std::ranges::count_if(rooms_, [](const auto &entry) {
+        return !entry.second.expired();
+      }));
+}
+
+std::shared_ptr<MessageBroadcaster> RoomRegistry::makeRoom() const {
+  // Not make_shared: the map's weak references would keep the memory of an
+  // abandoned room, history included, until it is erased
+  return std::shared_ptr<MessageBroadcaster>(
+      new MessageBroadcaster(clientRegistry_, queueConfig_, shardsPerRoom_));
+}
+
+std::shared_ptr<MessageBroadcaster>
+RoomRegistry::find(std::string_view roomId) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = rooms_.find(normalizeRoomId(roomId));
+  return it != rooms_.end() ? it->second.lock() : nullptr;
+}
+
+void RoomRegistry::eraseAbandonedLocked() {
+  std::erase_if(rooms_,
+                [](const auto &entry) { return entry.second.expired(); });
+}
+
+void RoomRegistry::onClientConnected(
+    [[maybe_unused]] const events::ClientConnectedEvent &event) {}
+
+void RoomRegistry::onClientDisconnected(
+    const events::ClientDisconnectedEvent &event) {
+  std::vector<std::shared_ptr<MessageBroadcaster>> rooms;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    eraseAbandonedLocked();
+    rooms.reserve(rooms_.size());
+    for (const auto &entry : rooms_) {
+      if (auto broadcaster = entry.second.lock()) {
+        rooms.push_back(std::move(broadcaster));
+      }
+    }
+  }
+
+  // Forward outside of the map lock so rooms are cleaned up independently
+  for (const auto &broadcaster : rooms) {
+    broadcaster->onClientDisconnected(event);
+  }
+}
+
+void RoomRegistry::onMessageSent(const events::MessageSentEvent &event) {
+  // Nobody on this node would read it
+  if (auto broadcaster = find(event.room)) {
+    broadcaster->onMessageSent(event);
+  }
+}
+
+void RoomRegistry::onPrivateMessageSent(
+    [[maybe_unused]] const events::PrivateMessageSentEvent &event) {}
+
+} // namespace domain
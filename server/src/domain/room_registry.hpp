@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "domain/client_registry.hpp"
+#include "domain/message_broadcaster.hpp"
+#include "domain/outbound_queue_policy.hpp"
+#include "service/events/chat_service_events.hpp"
+
+namespace domain {
+
+enum class RoomError {
+  kInvalidId,
+  kLimitReached,
+};
+
+class IRoomRegistry {
+public:
+  virtual ~IRoomRegistry() = default;
+
+  // Broadcaster owning the history of `roomId`, created on first use. The
+  // room lives while a subscriber holds it.
+  virtual std::expected<std::shared_ptr<IMessageBroadcaster>, RoomError>
+  room(std::string_view roomId) = 0;
+
+  // Drains every room, including those created afterwards.
+  virtual void drain() = 0;
+};
+
+// Owns one MessageBroadcaster per chat room so that fan-out and lock
+// contention scale with the room population instead of the whole server.
+//
+// Rooms other than the default one are held by their subscribers only: the
+// room and its history go away with its last message stream, and messages
+// sent to a room without subscribers on this node are dropped. At most
+// `maxRooms` rooms, the default one included, exist at a time.
+class RoomRegistry : public IRoomRegistry, public events::IServiceEventObserver {
+public:
+  static constexpr std::string_view kDefaultRoom = "general";
+  static constexpr std::size_t kMaxRoomIdLength = 64;
+
+  explicit RoomRegistry(const ClientRegistry &clientRegistry,
+                        OutboundQueueConfig queueConfig = {},
+                        std::size_t shardsPerRoom = 1,
+                        std::size_t maxRooms = 1024);
+
+  // Maps an empty room id to kDefaultRoom.
+  static std::string normalizeRoomId(std::string_view roomId);
+
+  // Up to kMaxRoomIdLength ASCII letters, digits, '-', '_' and '.'; empty
+  // is the default room.
+  static bool isValidRoomId(std::string_view roomId);
+
+  // IRoomRegistry
+  std::expected<std::shared_ptr<IMessageBroadcaster>, RoomError>
+  room(std::string_view roomId) override;
+
+  void drain() override;
+
+  // Rooms with at least one subscriber, and the default room
+  std::size_t roomCount() const;
+
+  // IServiceEventObserver
+  void onClientConnected(const events::ClientConnectedEvent &event) override;
+  void
+  onClientDisconnected(const events::ClientDisconnectedEvent &event) override;
+  void onMessageSent(const events::MessageSentEvent &event) override;
+  void
+  onPrivateMessageSent(const events::PrivateMessageSentEvent &event) override;
+
+private:
+  std::shared_ptr<MessageBroadcaster> makeRoom() const;
+  // Null when the room has no subscriber left
+  std::shared_ptr<MessageBroadcaster> find(std::string_view roomId) const;
+  void eraseAbandonedLocked();
+
+  const ClientRegistry &clientRegistry_;
+  const OutboundQueueConfig queueConfig_;
+  const std::size_t shardsPerRoom_;
+  const std::size_t maxRooms_;
+  const std::shared_ptr<MessageBroadcaster> defaultRoom_;
+  // Guards the room map only; each broadcaster has its own lock
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, std::weak_ptr<MessageBroadcaster>> rooms_;
+  bool draining_ = false;
+};
+
+} // namespace domain
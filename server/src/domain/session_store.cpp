@@ -0,0 +1,293 @@
+#include "domain/session_store.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <system_error>
+#include <utility>
+
+namespace domain {
+
+namespace {
+
+// File layout: magic, format version, membership version, session count,
+// then the five strings of each session. Integers are little-endian and
+// strings are prefixed with their 32-bit length.
+constexpr std::string_view kMagic = "CHATSESS";
+constexpr std::uint32_t kFormatVersion = 1;
+
+template <typename Integer> void writeInteger(std::string &out, Integer value) {
+  for (std::size_t i = 0; i < sizeof(Integer); ++i) {
+    out.push_back(static_cast<char>(static_cast<std::uint64_t>(value) >>
+                                    (8U * i)));
+  }
+}
+
+void writeString(std::string &out, const std::string &value) {
+  writeInteger(out, static_cast<std::uint32_t>(value.size()));
+  out.append(value);
+}
+
+class CheckpointReader {
+public:
+  explicit CheckpointReader(std::string_view data) : data_(data) {}
+
+  template <typename Integer> bool readInteger(Integer &value) {
+    if (data_.size() < sizeof(Integer)) {
+      return false;
+    }
+    std::uint64_t result = 0;
+    for (std::size_t i = 0; i < sizeof(Integer); ++i) {
+      result |= static_cast<std::uint64_t>(static_cast<unsigned char>(data_[i]))
+                << (8U * i);
+    }
+    value = static_cast<Integer>(result);
+    data_.remove_prefix(sizeof(Integer));
+    return true;
+  }
+
+  bool readString(std::string &value) {
+    std::uint32_t size = 0;
+    if (!readInteger(size) || data_.size() < size) {
+      return false;
+    }
+    value.assign(data_.substr(0, size));
+    data_.remove_prefix(size);
+    return true;
+  }
+
+  bool skip(std::string_view expected) {
+    if (!data_.starts_with(expected)) {
+      return false;
+    }
+    data_.remove_prefix(expected.size());
+    return true;
+  }
+
+  bool atEnd() const { return data_.empty(); }
+
+private:
+  std::string_view data_;
+};
+
+} // namespace
+
+SessionStore::SessionStore(TokenGenerator makeToken)
+    : makeToken_(std::move(makeToken)) {}
+
+std::string SessionStore::randomToken() {
+  static constexpr std::string_view kDigits = "0123456789abcdef";
+  std::random_device device;
+  std::string token;
+  token.reserve(32);
+  for (int i = 0; i < 4; ++i) {
+    const std::uint32_t bits = device();
+    for (unsigned shift = 0; shift < 32; shift += 4) {
+      token.push_back(kDigits[(bits >> shift) & 0xFU]);
+    }
+  }
+  return token;
+}
+
+std::string SessionStore::open(const events::ClientConnectedEvent &client,
+                               std::string_view resumedToken) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = sessions_.end();
+  if (!resumedToken.empty()) {
+    it = sessions_.find(std::string(resumedToken));
+    if (it != sessions_.end() &&
+        it->second.record.pseudonym != client.pseudonym) {
+      it = sessions_.end();
+    }
+  }
+
+  if (it == sessions_.end()) {
+    std::string token = makeToken_();
+    it = sessions_.try_emplace(token).first;
+    it->second.record.token = std::move(token);
+  } else {
+    tokensByPeer_.erase(it->second.record.peer);
+  }
+
+  auto &session = it->second;
+  session.record.peer = client.peer;
+  session.record.pseudonym = client.pseudonym;
+  session.record.gender = client.gender;
+  session.record.country = client.country;
+  session.resumeDeadline.reset();
+  tokensByPeer_.insert_or_assign(client.peer, session.record.token);
+  return session.record.token;
+}
+
+std::optional<std::string>
+SessionStore::holder(std::string_view token, std::string_view pseudonym) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = sessions_.find(std::string(token));
+  if (it == sessions_.end() || it->second.record.pseudonym != pseudonym) {
+    return std::nullopt;
+  }
+  return it->second.record.peer;
+}
+
+std::vector<events::ClientConnectedEvent>
+SessionStore::restore(std::vector<SessionRecord> sessions,
+                      Clock::time_point deadline) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::vector<events::ClientConnectedEvent> clients;
+  clients.reserve(sessions.size());
+  for (auto &record : sessions) {
+    record.peer = std::string(kRestoredPeerPrefix) + record.pseudonym;
+    if (record.token.empty() || sessions_.contains(record.token) ||
+        tokensByPeer_.contains(record.peer)) {
+      continue;
+    }
+
+    clients.push_back({.peer = record.peer,
+                       .pseudonym = record.pseudonym,
+                       .gender = record.gender,
+                       .country = record.country});
+    tokensByPeer_.emplace(record.peer, record.token);
+    std::string token = record.token;
+    sessions_.emplace(std::move(token),
+                      Session{.record = std::move(record),
+                              .resumeDeadline = deadline});
+  }
+  return clients;
+}
+
+std::vector<SessionRecord> SessionStore::expire(Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::vector<SessionRecord> expired;
+  for (auto it = sessions_.begin(); it != sessions_.end();) {
+    if (!it->second.resumeDeadline || *it->second.resumeDeadline > now) {
+      ++it;
+      continue;
+    }
+    tokensByPeer_.erase(it->second.record.peer);
+    expired.push_back(std::move(it->second.record));
+    it = sessions_.erase(it);
+  }
+  return expired;
+}
+
+std::vector<SessionRecord> SessionStore::sessions() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::vector<SessionRecord> records;
+  records.reserve(sessions_.size());
+  for (const auto &entry : sessions_) {
+    records.push_back(entry.second.record);
+  }
+  return records;
+}
+
+std::size_t SessionStore::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return sessions_.size();
+}
+
+void SessionStore::onClientConnected(
+    [[maybe_unused]] const events::ClientConnectedEvent &event) {}
+
+void SessionStore::onClientDisconnected(
+    const events::ClientDisconnectedEvent &event) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = tokensByPeer_.find(event.peer);
+  if (it == tokensByPeer_.end()) {
+    return;
+  }
+  sessions_.erase(it->second);
+  tokensByPeer_.erase(it);
+}
+
+void SessionStore::onMessageSent(
+    [[maybe_unused]] const events::MessageSentEvent &event) {}
+
+void SessionStore::onPrivateMessageSent(
+    [[maybe_unused]] const events::PrivateMessageSentEvent &event) {}
+
+std::optional<std::string>
+saveSessionCheckpoint(const std::filesystem::path &file,
+                      const SessionCheckpoint &checkpoint) {
+  std::string data(kMagic);
+  writeInteger(data, kFormatVersion);
+  writeInteger(data, checkpoint.membershipVersion);
+  writeInteger(data, static_cast<std::uint32_t>(checkpoint.sessions.size()));
+  for (const auto &session : checkpoint.sessions) {
+    writeString(data, session.token);
+    writeString(data, session.peer);
+    writeString(data, session.pseudonym);
+    writeString(data, session.gender);
+    writeString(data, session.country);
+  }
+
+  auto temporary = file;
+  temporary += ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    out.flush();
+    if (!out) {
+      return "cannot write session checkpoint '" + temporary.string() + "'";
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporary, file, error);
+  if (error) {
+    return "cannot replace session checkpoint '" + file.string() +
+           "': " + error.message();
+  }
+  return std::nullopt;
+}
+
+std::expected<SessionCheckpoint, std::string>
+loadSessionCheckpoint(const std::filesystem::path &file) {
+  std::ifstream in(file, std::ios::binary);
+  if (!in) {
+    if (!std::filesystem::exists(file)) {
+      return SessionCheckpoint{};
+    }
+    return std::unexpected("cannot open session checkpoint '" +
+                           file.string() + "'");
+  }
+  const std::string data{std::istreambuf_iterator<char>(in),
+                         std::istreambuf_iterator<char>()};
+
+  CheckpointReader reader(data);
+  std::uint32_t formatVersion = 0;
+  SessionCheckpoint checkpoint;
+  std::uint32_t count = 0;
+  if (!reader.skip(kMagic) || !reader.readInteger(formatVersion) ||
+      formatVersion != kFormatVersion ||
+      !reader.readInteger(checkpoint.membershipVersion) ||
+      !reader.readInteger(count)) {
+    return std::unexpected("'" + file.string() +
+                           "' is not a session checkpoint");
+  }
+
+  // The count is checked against the data actually read, not trusted
+  for (std::uint32_t i = 0; i < count; ++i) {
+    SessionRecord session;
+    if (!reader.readString(session.token) || !reader.readString(session.peer) ||
+        !reader.readString(session.pseudonym) ||
+        !reader.readString(session.gender) ||
+        !reader.readString(session.country)) {
+      return std::unexpected("session checkpoint '" + file.string() +
+                             "' is truncated");
+    }
+    checkpoint.sessions.push_back(std::move(session));
+  }
+  if (!reader.atEnd()) {
+    return std::unexpected("session checkpoint '" + file.string() +
+                           "' has trailing data");
+  }
+  return checkpoint;
+}
+
+} // namespace domain
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "service/events/chat_service_events.hpp"
+
+namespace domain {
+
+struct SessionRecord {
+  std::string token;
+  // Peer holding the session; a placeholder for sessions restored from a
+  // checkpoint until their client comes back
+  std::string peer;
+  std::string pseudonym;
+  std::string gender;
+  std::string country;
+};
+
+struct SessionCheckpoint {
+  // Roster version of the registry when the sessions were saved
+  std::uint64_t membershipVersion = 0;
+  std::vector<SessionRecord> sessions;
+};
+
+// Sessions of the clients connected to this node.
+//
+// Every accepted connect opens a session, and the client presents its token
+// when it connects again. The pseudonym then passes from the session's
+// previous peer to the new connection without competing for it, and the
+// roster is not sent again when the client's copy is current. Sessions are
+// checkpointed to disk so that they survive a restart: restored sessions keep
+// their pseudonym for a resume window, then expire.
+class SessionStore : public events::IServiceEventObserver {
+public:
+  using Clock = std::chrono::steady_clock;
+  using TokenGenerator = std::function<std::string()>;
+
+  // Peers given to restored sessions until their client is back
+  static constexpr std::string_view kRestoredPeerPrefix = "resume:";
+
+  explicit SessionStore(TokenGenerator makeToken = randomToken);
+
+  // 128 random bits, hex encoded.
+  static std::string randomToken();
+
+  // Opens a session for a client that just connected, or moves the session
+  // of `resumedToken` to it. Returns the token of the client's session.
+  std::string open(const events::ClientConnectedEvent &client,
+                   std::string_view resumedToken = {});
+
+  // Peer holding the session of `token`, if that session is `pseudonym`'s.
+  std::optional<std::string> holder(std::string_view token,
+                                    std::string_view pseudonym) const;
+
+  // Adds sessions loaded from a checkpoint, held until `deadline`. Returns
+  // their clients, to be added to the registry.
+  std::vector<events::ClientConnectedEvent>
+  restore(std::vector<SessionRecord> sessions, Clock::time_point deadline);
+
+  // Removes and returns the restored sessions not resumed by `now`.
+  std::vector<SessionRecord> expire(Clock::time_point now);
+
+  std::vector<SessionRecord> sessions() const;
+
+  std::size_t size() const;
+
+  // IServiceEventObserver: a session ends with its client
+  void onClientConnected(const events::ClientConnectedEvent &event) override;
+  void
+  onClientDisconnected(const events::ClientDisconnectedEvent &event) override;
+  void onMessageSent(const events::MessageSentEvent &event) override;
+  void
+  onPrivateMessageSent(const events::PrivateMessageSentEvent &event) override;
+
+private:
+  struct Session {
+    SessionRecord record;
+    // Set while a restored session waits for its client
+    std::optional<Clock::time_point> resumeDeadline;
+  };
+
+  TokenGenerator makeToken_;
+  mutable std::mutex mutex_;
+  // token -> session
+  std::unordered_map<std::string, Session> sessions_;
+  // peer -> token
+  std::unordered_map<std::string, std::string> tokensByPeer_;
+};
+
+// Writes the checkpoint next to `file`, then renames it over `file`, so that
+// a crash never leaves a partial checkpoint behind. Returns an error message
+// on failure.
+std::optional<std::string>
+saveSessionCheckpoint(const std::filesystem::path &file,
+                      const SessionCheckpoint &checkpoint);
+
+// A missing file is an empty checkpoint.
+std::expected<SessionCheckpoint, std::string>
+loadSessionCheckpoint(const std::filesystem::path &file);
+
+} // namespace domain
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace domain {
+
+// Append-only log with one (serialized) producer and many lock-free readers.
+//
+// Entries are stored in fixed-size segments linked in append order. The
+// producer publishes the tail with a release store; each reader owns a
+// Cursor and reads entries up to the tail without taking any lock. A segment
+// is reclaimed once every registered cursor has moved past it, so memory is
+// bounded by the slowest reader rather than by the total history.
+//
+// A reader that stops reading pins every segment after its position. Only
+// the thread using a cursor may move it, so the log never does: its owner
+// bounds memory by moving lagging cursors forward (skipTo) while their
+// readers are not using them, then calling reclaim().
+//
+// Producers are serialized by an internal mutex that readers never touch.
+template <typename T, std::size_t kSegmentSize = 256>
+class SpmcAppendLog {
+  static_assert(kSegmentSize > 0, "segments must hold at least one entry");
+
+  struct Segment {
+    explicit Segment(std::uint64_t basePosition) : base(basePosition) {}
+
+    const std::uint64_t base;
+    std::array<T, kSegmentSize> slots{};
+    std::atomic<Segment *> next{nullptr};
+  };
+
+public:
+  // Read position of a single reader. A cursor must only be used by one
+  // thread at a time and must not outlive its log.
+  class Cursor {
+  public:
+    ~Cursor() { log_->unregisterCursor(this); }
+
+    Cursor(const Cursor &) = delete;
+    Cursor &operator=(const Cursor &) = delete;
+    Cursor(Cursor &&) = delete;
+    Cursor &operator=(Cursor &&) = delete;
+
+    std::uint64_t position() const {
+      return position_.load(std::memory_order_relaxed);
+    }
+
+    // Number of published entries not yet consumed by this cursor.
+    std::size_t pending() const {
+      return static_cast<std::size_t>(log_->size() - position());
+    }
+
+    // Entry at the cursor position, or nullptr at the tail. The pointer stays
+    // valid until the cursor advances.
+    const T *peek() {
+      const std::uint64_t position = position_.load(std::memory_order_relaxed);
+      if (position >= log_->size()) {
+        return nullptr;
+      }
+
+      if (position == segment_->base + kSegmentSize) {
+        segment_ = segment_->next.load(std::memory_order_acquire);
+      }
+      return &segment_->slots[position - segment_->base];
+    }
+
+    // Consume the entry returned by the last successful peek().
+    void advance() {
+      position_.store(position_.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_release);
+    }
+
+    // Copy the next entry into `out`. Returns false at the tail.
+    bool next(T &out) {
+      const T *entry = peek();
+      if (entry == nullptr) {
+        return false;
+      }
+
+      out = *entry;
+      advance();
+      return true;
+    }
+
+    // Move forward to `target`, clamped to the tail. Never moves backwards.
+    void skipTo(std::uint64_t target) {
+      target = std::min(target, log_->size());
+      if (target <= position()) {
+        return;
+      }
+
+      // Segments between the current position and `target` cannot be
+      // reclaimed while this cursor still points before them.
+      while (target >= segment_->base + kSegmentSize) {
+        Segment *next = segment_->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+          break;
+        }
+        segment_ = next;
+      }
+      position_.store(target, std::memory_order_release);
+    }
+
+  private:
+    friend class SpmcAppendLog;
+
+    Cursor(SpmcAppendLog *log, Segment *segment, std::uint64_t position)
+        : log_(log), segment_(segment), position_(position) {}
+
+    SpmcAppendLog *log_;
+    Segment *segment_;
+    std::atomic<std::uint64_t> position_;
+  };
+
+  SpmcAppendLog() : head_(new Segment(0)), tail_(head_) {}
+
+  ~SpmcAppendLog() {
+    while (head_ != nullptr) {
+      Segment *next = head_->next.load(std::memory_order_relaxed);
+      delete head_;
+      head_ = next;
+    }
+  }
+
+  SpmcAppendLog(const SpmcAppendLog &) = delete;
+  SpmcAppendLog &operator=(const SpmcAppendLog &) = delete;
+  SpmcAppendLog(SpmcAppendLog &&) = delete;
+  SpmcAppendLog &operator=(SpmcAppendLog &&) = delete;
+
+  // Append one entry and publish it to every reader.
+  void append(T value) {
+    std::lock_guard<std::mutex> lock(producerMutex_);
+    const std::uint64_t position = size_.load(std::memory_order_relaxed);
+
+    if (position == tail_->base + kSegmentSize) {
+      auto *segment = new Segment(position);
+      tail_->next.store(segment, std::memory_order_release);
+      tail_ = segment;
+      reclaimLocked();
+    }
+
+    tail_->slots[position - tail_->base] = std::move(value);
+    size_.store(position + 1, std::memory_order_release);
+  }
+
+  // Number of entries ever appended (the published tail position).
+  std::uint64_t size() const { return size_.load(std::memory_order_acquire); }
+
+  // Entries per segment; appends reclaim each time they start one.
+  static constexpr std::size_t segmentSize() { return kSegmentSize; }
+
+  // Free the segments every cursor has moved past, as appends do when they
+  // start a segment.
+  void reclaim() {
+    std::lock_guard<std::mutex> lock(producerMutex_);
+    reclaimLocked();
+  }
+
+  // Register a reader positioned at the current tail.
+  std::unique_ptr<Cursor> subscribe() {
+    std::lock_guard<std::mutex> lock(producerMutex_);
+    std::unique_ptr<Cursor> cursor(
+        new Cursor(this, tail_, size_.load(std::memory_order_relaxed)));
+    cursors_.push_back(cursor.get());
+    return cursor;
+  }
+
+  // Number of segments still allocated.
+  std::size_t liveSegmentCount() const {
+    std::lock_guard<std::mutex> lock(producerMutex_);
+    std::size_t count = 0;
+    for (Segment *segment = head_; segment != nullptr;
+         segment = segment->next.load(std::memory_order_relaxed)) {
+      ++count;
+    }
+    return count;
+  }
+
+private:
+  void unregisterCursor(const Cursor *cursor) {
+    std::lock_guard<std::mutex> lock(producerMutex_);
+    std::erase(cursors_, cursor);
+  }
+
+  // Free every segment that all cursors have moved strictly past. A cursor
+  // sitting exactly at a segment end still needs that segment's next link.
+  void reclaimLocked() {
+    std::uint64_t minPosition = size_.load(std::memory_order_relaxed);
+    for (const Cursor *cursor : cursors_) {
+      minPosition = std::min(
+          minPosition, cursor->position_.load(std::memory_order_acquire));
+    }
+
+    while (head_ != tail_ && minPosition > head_->base + kSegmentSize) {
+      Segment *next = head_->next.load(std::memory_order_relaxed);
+      delete head_;
+      head_ = next;
+    }
+  }
+
+  mutable std::mutex producerMutex_;
+  Segment *head_;
+  Segment *tail_;
+  std::atomic<std::uint64_t> size_{0};
+  std::vector<const Cursor *> cursors_;
+};
+
+} // namespace domain
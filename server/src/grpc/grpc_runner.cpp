@@ -1,42 +1,130 @@
 #include "grpc/grpc_runner.hpp"
 
+#include <format>
 #include <iostream>
 #include <stdexcept>
+#include <utility>
 
 GrpcRunner::GrpcRunner(std::shared_ptr<database::IDatabaseManager> db,
-                       std::string_view serverAddress)
-    : clientRegistry_(std::make_shared<domain::ClientRegistry>()),
-      messageBroadcaster_(
-          std::make_shared<domain::MessageBroadcaster>(*clientRegistry_)),
+                       Config config)
+    : drainTimeout_(config.drainTimeout), sessionFile_(config.sessionFile),
+      bannedTermsFile_(config.bannedTermsFile),
+      clientRegistry_(std::make_shared<domain::ClientRegistry>()),
+      roomRegistry_(std::make_shared<domain::RoomRegistry>(
+          *clientRegistry_, config.outboundQueue, config.broadcastShards,
+          config.maxRooms)),
       clientEventBroadcaster_(
           std::make_shared<domain::ClientEventBroadcaster>(*clientRegistry_)),
       privateMessageBroadcaster_(
-          std::make_shared<domain::PrivateMessageBroadcaster>(*clientRegistry_)),
-      dbLogger_(std::make_shared<observers::DatabaseEventLogger>(db)) {
+          std::make_shared<domain::PrivateMessageBroadcaster>(
+              *clientRegistry_, config.outboundQueue)),
+      deliveryPool_(std::make_shared<service::DeliveryPool>(config.delivery)),
+      dbLogger_(std::make_shared<observers::DatabaseEventLogger>(db)),
+      asyncDbLogger_(std::make_shared<events::AsyncEventObserver>(dbLogger_)),
+      consoleLogger_(std::make_shared<events::AsyncEventObserver>(
+          std::make_shared<observers::ConsoleEventLogger>())) {
   // Register observers with the event dispatcher
   // ClientRegistry must be registered first to update state before other
   // observers
   eventDispatcher_.registerObserver(clientRegistry_);
   eventDispatcher_.registerObserver(
       std::static_pointer_cast<events::IServiceEventObserver>(
-          messageBroadcaster_));
-  eventDispatcher_.registerObserver(dbLogger_);
+          roomRegistry_));
+  // Persistence and console logging run on their own threads, off the
+  // dispatcher lock
+  eventDispatcher_.registerObserver(asyncDbLogger_);
+  eventDispatcher_.registerObserver(consoleLogger_);
   eventDispatcher_.registerObserver(
       std::static_pointer_cast<events::IServiceEventObserver>(
           clientEventBroadcaster_));
   eventDispatcher_.registerObserver(
       std::static_pointer_cast<events::IServiceEventObserver>(
           privateMessageBroadcaster_));
+  // Streams are woken once the broadcasters have queued the message
+  eventDispatcher_.registerObserver(
+      std::static_pointer_cast<events::IServiceEventObserver>(deliveryPool_));
+
+  const bool workerProcess = !config.messageBus.links.empty();
+  if (config.messageBus.enabled()) {
+    remoteEventDispatcher_.registerObserver(clientRegistry_);
+    remoteEventDispatcher_.registerObserver(
+        std::static_pointer_cast<events::IServiceEventObserver>(
+            roomRegistry_));
+    remoteEventDispatcher_.registerObserver(
+        std::static_pointer_cast<events::IServiceEventObserver>(
+            clientEventBroadcaster_));
+    remoteEventDispatcher_.registerObserver(
+        std::static_pointer_cast<events::IServiceEventObserver>(
+            privateMessageBroadcaster_));
+    remoteEventDispatcher_.registerObserver(
+        std::static_pointer_cast<events::IServiceEventObserver>(
+            deliveryPool_));
+
+    if (config.messageBus.nodeId.empty()) {
+      config.messageBus.nodeId = cluster::defaultNodeId();
+    }
+    pseudonymOwnership_ = std::make_shared<cluster::PseudonymOwnership>(
+        cluster::PseudonymOwnership::Config{
+            .nodeId = config.messageBus.nodeId,
+            .leaseLost = [this](const std::string &peer,
+                                const std::string &pseudonym) {
+              dropClient(peer, pseudonym);
+            }});
+    eventDispatcher_.registerObserver(
+        std::static_pointer_cast<events::IServiceEventObserver>(
+            pseudonymOwnership_));
+
+    config.messageBus.presence = clientRegistry_;
+    config.messageBus.ownership = pseudonymOwnership_;
+    auto messageBus = std::make_shared<cluster::SocketMessageBus>(
+        std::move(config.messageBus));
+    pseudonymOwnership_->attachTransport(messageBus);
+    messageBus_ = std::move(messageBus);
+    messageBus_->start(remoteEventDispatcher_);
+    eventDispatcher_.attachMessageBus(messageBus_);
+  }
+
+  // Sessions are resumed on the node that issued them; a cluster claims
+  // pseudonyms per connection instead
+  if (!sessionFile_.empty() && !config.messageBus.enabled()) {
+    sessionStore_ = std::make_shared<domain::SessionStore>();
+    eventDispatcher_.registerObserver(
+        std::static_pointer_cast<events::IServiceEventObserver>(
+            sessionStore_));
+    restoreSessions(config.resumeWindow);
+  }
+
+  if (config.liveness.idleTimeout.count() > 0) {
+    livenessTracker_ =
+        std::make_shared<domain::LivenessTracker>(config.liveness);
+    eventDispatcher_.registerObserver(
+        std::static_pointer_cast<events::IServiceEventObserver>(
+            livenessTracker_));
+  }
+
+  if (!bannedTermsFile_.empty()) {
+    bannedTerms_ = std::make_shared<service::validation::BannedTerms>();
+    if (auto error = reloadBannedTerms()) {
+      throw std::runtime_error(*error);
+    }
+  }
 
   // Create ChatService with dependencies
   service_ = std::make_unique<ChatService>(
-      clientRegistry_, messageBroadcaster_, privateMessageBroadcaster_,
-      clientEventBroadcaster_, &eventDispatcher_);
+      clientRegistry_, roomRegistry_, privateMessageBroadcaster_,
+      clientEventBroadcaster_, &eventDispatcher_, deliveryPool_,
+      pseudonymOwnership_,
+      sessionStore_, livenessTracker_, bannedTerms_,
+      config.tuning.compressionMinBytes);
 
-  const std::string serverAddressString(serverAddress);
   grpc::ServerBuilder builder;
-  builder.AddListeningPort(serverAddressString,
+  builder.AddListeningPort(config.serverAddress,
                            grpc::InsecureServerCredentials());
+  applyServerTuning(config.tuning, builder);
+  if (workerProcess) {
+    // Workers bind the same address and the kernel spreads connections
+    builder.AddChannelArgument(GRPC_ARG_ALLOW_REUSEPORT, 1);
+  }
   builder.RegisterService(service_.get());
 
   server_ = builder.BuildAndStart();
@@ -44,19 +132,195 @@ GrpcRunner::GrpcRunner(std::shared_ptr<database::IDatabaseManager> db,
     throw std::runtime_error("Failed to start gRPC server.");
   }
 
-  std::cout << "Server listening on " << serverAddressString << std::endl;
+  std::cout << "Server listening on " << config.serverAddress << std::endl;
 
   serverThread_ = std::jthread([this](const std::stop_token &) {
     if (server_) {
       server_->Wait();
     }
   });
+
+  if (sessionStore_) {
+    timers_.scheduleEvery(config.checkpointInterval,
+                          [this] { checkpointSessions(); });
+  }
+  if (livenessTracker_) {
+    timers_.scheduleEvery(config.liveness.tick, [this] { reapIdleClients(); });
+  }
+  if (config.deliveryStatsInterval.count() > 0) {
+    timers_.scheduleEvery(config.deliveryStatsInterval,
+                          [this] { logDispatchLatency(); });
+  }
+  if (bannedTerms_) {
+    timers_.scheduleEvery(config.bannedTermsReloadInterval, [this] {
+      if (auto error = reloadBannedTerms()) {
+        std::cerr << *error << std::endl;
+      }
+    });
+  }
 }
 
-GrpcRunner::~GrpcRunner() {
-  if (server_) {
-    server_->Shutdown();
+GrpcRunner::~GrpcRunner() { shutdown(); }
+
+void GrpcRunner::shutdown() {
+  if (!server_ || shutDown_) {
+    return;
+  }
+  shutDown_ = true;
+
+  const auto deadline = std::chrono::steady_clock::now() + drainTimeout_;
+  // No reaping or checkpoint from here on; the final one is saved below
+  timers_.stop();
+  service_->drain();
+  // Stops accepting calls and waits for the running ones until the deadline
+  server_->Shutdown(std::chrono::system_clock::now() + drainTimeout_);
+  wait();
+
+  // Saved before the sessions end below, so that the clients can resume
+  // them once the server is back
+  if (sessionStore_) {
+    saveSessions();
+  }
+
+  // Sessions still open end here, so that their durations are logged and
+  // other nodes drop the clients without waiting for presence to expire
+  for (auto &client : clientRegistry_->getClientsOnNode("")) {
+    const auto duration = clientRegistry_->getConnectionDuration(client.peer);
+    eventDispatcher_.notifyClientDisconnected(
+        {.peer = std::move(client.peer),
+         .pseudonym = std::move(client.pseudonym),
+         .connectionDuration = duration.value_or(
+             std::chrono::steady_clock::duration::zero())});
+  }
+
+  // Once the disconnects above are published
+  if (messageBus_) {
+    messageBus_->stop();
+  }
+
+  if (!asyncDbLogger_->flushUntil(deadline)) {
+    // The logger still completes them when it is destroyed
+    std::cerr << "Database writes outlasted the drain timeout" << std::endl;
+  }
+}
+
+void GrpcRunner::restoreSessions(std::chrono::milliseconds resumeWindow) {
+  auto checkpoint = domain::loadSessionCheckpoint(sessionFile_);
+  if (!checkpoint) {
+    // The clients connect again as new ones
+    std::cerr << checkpoint.error() << std::endl;
+    return;
+  }
+
+  const auto clients = sessionStore_->restore(
+      std::move(checkpoint->sessions),
+      std::chrono::steady_clock::now() + resumeWindow);
+  clientRegistry_->restoreClients(clients, checkpoint->membershipVersion);
+  if (!clients.empty()) {
+    std::cout << "Restored " << clients.size() << " client sessions"
+              << std::endl;
+  }
+}
+
+void GrpcRunner::checkpointSessions() {
+  for (auto &session :
+       sessionStore_->expire(std::chrono::steady_clock::now())) {
+    const auto duration = clientRegistry_->getConnectionDuration(session.peer);
+    eventDispatcher_.notifyClientDisconnected(
+        {.peer = std::move(session.peer),
+         .pseudonym = std::move(session.pseudonym),
+         .connectionDuration = duration.value_or(
+             std::chrono::steady_clock::duration::zero())});
+  }
+  saveSessions();
+}
+
+void GrpcRunner::saveSessions() {
+  const domain::SessionCheckpoint checkpoint{
+      .membershipVersion = clientRegistry_->membershipVersion(),
+      .sessions = sessionStore_->sessions()};
+  if (auto error = domain::saveSessionCheckpoint(sessionFile_, checkpoint)) {
+    std::cerr << *error << std::endl;
+  }
+}
+
+void GrpcRunner::reapIdleClients() {
+  for (auto &peer :
+       livenessTracker_->advance(std::chrono::steady_clock::now())) {
+    std::string pseudonym;
+    if (!clientRegistry_->getPseudonymForPeer(peer, pseudonym)) {
+      continue;
+    }
+    std::cout << "'" + pseudonym + "' timed out" << std::endl;
+    const auto duration = clientRegistry_->getConnectionDuration(peer);
+    eventDispatcher_.notifyClientDisconnected(
+        {.peer = std::move(peer),
+         .pseudonym = std::move(pseudonym),
+         .connectionDuration = duration.value_or(
+             std::chrono::steady_clock::duration::zero())});
+  }
+}
+
+void GrpcRunner::dropClient(const std::string &peer,
+                            const std::string &pseudonym) {
+  std::string current;
+  // The client may have left, or reconnected as someone else, meanwhile
+  if (!clientRegistry_->getPseudonymForPeer(peer, current) ||
+      current != pseudonym) {
+    return;
+  }
+  std::cout << "'" + pseudonym + "' is taken on another node" << std::endl;
+  const auto duration = clientRegistry_->getConnectionDuration(peer);
+  eventDispatcher_.notifyClientDisconnected(
+      {.peer = peer,
+       .pseudonym = pseudonym,
+       .connectionDuration =
+           duration.value_or(std::chrono::steady_clock::duration::zero())});
+}
+
+void GrpcRunner::logDispatchLatency() {
+  const auto stats = deliveryPool_->takeDispatchLatency();
+  if (stats.passes == 0) {
+    return;
+  }
+  using Micros = std::chrono::duration<double, std::micro>;
+  std::cout << std::format("Delivery passes: {}, wake to dispatch p50 "
+                           "{:.1f}us, p99 {:.1f}us, max {:.1f}us",
+                           stats.passes, Micros(stats.p50).count(),
+                           Micros(stats.p99).count(),
+                           Micros(stats.max).count())
+            << std::endl;
+}
+
+std::optional<std::string> GrpcRunner::reloadBannedTerms() {
+  std::error_code error;
+  const auto modified =
+      std::filesystem::last_write_time(bannedTermsFile_, error);
+  if (error) {
+    return "cannot read banned terms '" + bannedTermsFile_.string() +
+           "': " + error.message();
+  }
+  if (modified == bannedTermsModified_) {
+    return std::nullopt;
+  }
+
+  const auto terms = service::validation::loadKeywordList(bannedTermsFile_);
+  if (!terms) {
+    return terms.error();
+  }
+  try {
+    // Compiled on the timer thread; messages are checked against the
+    // previous terms meanwhile
+    bannedTerms_->replace(
+        service::validation::KeywordAutomaton::compile(*terms));
+  } catch (const std::length_error &e) {
+    return "cannot compile banned terms '" + bannedTermsFile_.string() +
+           "': " + e.what();
   }
+  bannedTermsModified_ = modified;
+  std::cout << "Loaded " << terms->size() << " banned terms from '"
+            << bannedTermsFile_.string() << "'" << std::endl;
+  return std::nullopt;
 }
 
 void GrpcRunner::wait() {
@@ -1,50 +1,139 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
 #include <memory>
-#include <string_view>
+#include <optional>
+#include <string>
 #include <thread>
 
 #include <grpcpp/grpcpp.h>
 
+#include "cluster/socket_message_bus.hpp"
 #include "database/database_event_logger.hpp"
 #include "database/database_manager.hpp"
 #include "domain/client_event_broadcaster.hpp"
 #include "domain/client_registry.hpp"
-#include "domain/message_broadcaster.hpp"
+#include "domain/liveness_tracker.hpp"
+#include "domain/outbound_queue_policy.hpp"
 #include "domain/private_message_broadcaster.hpp"
+#include "domain/room_registry.hpp"
+#include "domain/session_store.hpp"
+#include "grpc/server_tuning.hpp"
 #include "service/chat_service.hpp"
+#include "service/delivery_pool.hpp"
+#include "service/events/async_event_observer.hpp"
 #include "service/events/chat_service_events_dispatcher.hpp"
+#include "service/events/console_event_logger.hpp"
+#include "timing/timer_service.hpp"
 
 class GrpcRunner {
 public:
-  GrpcRunner(std::shared_ptr<database::IDatabaseManager> db,
-             std::string_view serverAddress);
+  struct Config {
+    std::string serverAddress;
+    domain::OutboundQueueConfig outboundQueue;
+    std::size_t broadcastShards = 1;
+    // Rooms open at a time, the default room included
+    std::size_t maxRooms = 1024;
+    ServerTuning tuning;
+    // Other worker processes and cluster nodes, disabled when running alone
+    cluster::SocketMessageBus::Config messageBus;
+    // Time given to streams and database writes to finish on shutdown
+    std::chrono::milliseconds drainTimeout{5000};
+    // Checkpoint of the client sessions, restored on startup so that
+    // clients can resume after a restart; disabled when empty or in a
+    // cluster
+    std::filesystem::path sessionFile;
+    // Time restored sessions keep their pseudonym for their client
+    std::chrono::milliseconds resumeWindow{60000};
+    std::chrono::milliseconds checkpointInterval{10000};
+    // Clients of this node without a stream for the idle timeout are
+    // disconnected
+    domain::LivenessTracker::Config liveness;
+    // Terms rejected in messages, reread when the file changes; disabled
+    // when empty
+    std::filesystem::path bannedTermsFile;
+    std::chrono::milliseconds bannedTermsReloadInterval{5000};
+    // Threads writing to the message streams
+    service::DeliveryPool::Config delivery;
+    // Period of the dispatch latency log; 0 disables it
+    std::chrono::milliseconds deliveryStatsInterval{60000};
+  };
+
+  GrpcRunner(std::shared_ptr<database::IDatabaseManager> db, Config config);
   ~GrpcRunner();
 
   void wait();
 
+  // Drains the server: new connects are refused, streams end once their
+  // queues are written, open sessions are closed and logged, and pending
+  // database writes are flushed, all within the drain timeout. Calls still
+  // running at the deadline are cancelled. Also run by the destructor.
+  void shutdown();
+
   GrpcRunner(const GrpcRunner &) = delete;
   GrpcRunner &operator=(const GrpcRunner &) = delete;
   GrpcRunner(GrpcRunner &&) = delete;
   GrpcRunner &operator=(GrpcRunner &&) = delete;
 
 private:
+  // Restores the sessions of the last checkpoint into the registry.
+  void restoreSessions(std::chrono::milliseconds resumeWindow);
+  // Ends the restored sessions nobody resumed, then saves a checkpoint.
+  void checkpointSessions();
+  void saveSessions();
+  // Disconnects the clients found idle.
+  void reapIdleClients();
+  // Disconnects a client whose pseudonym lease was granted to someone else.
+  void dropClient(const std::string &peer, const std::string &pseudonym);
+  // Logs the delivery pool's dispatch latencies since the last call, if any.
+  void logDispatchLatency();
+  // Recompiles the banned terms if their file has changed since the last
+  // load. On error, the current terms stay.
+  std::optional<std::string> reloadBannedTerms();
+
+  const std::chrono::milliseconds drainTimeout_;
+  const std::filesystem::path sessionFile_;
+  const std::filesystem::path bannedTermsFile_;
+  std::filesystem::file_time_type bannedTermsModified_;
+  bool shutDown_ = false;
+
   // Client registry (single source of truth)
   std::shared_ptr<domain::ClientRegistry> clientRegistry_;
 
   // Domain components
-  std::shared_ptr<domain::MessageBroadcaster> messageBroadcaster_;
+  std::shared_ptr<domain::RoomRegistry> roomRegistry_;
   std::shared_ptr<domain::ClientEventBroadcaster> clientEventBroadcaster_;
   std::shared_ptr<domain::PrivateMessageBroadcaster> privateMessageBroadcaster_;
+  // Outlives the service, whose streams hold on to it
+  std::shared_ptr<service::DeliveryPool> deliveryPool_;
 
   // Observers
   std::shared_ptr<observers::DatabaseEventLogger> dbLogger_;
+  std::shared_ptr<events::AsyncEventObserver> asyncDbLogger_;
+  // Console log of this node's clients and messages
+  std::shared_ptr<events::AsyncEventObserver> consoleLogger_;
+  std::shared_ptr<domain::SessionStore> sessionStore_;
+  std::shared_ptr<domain::LivenessTracker> livenessTracker_;
+  std::shared_ptr<service::validation::BannedTerms> bannedTerms_;
 
   // Event dispatcher
   events::EventDispatcher eventDispatcher_;
 
+  // Events published by other nodes, replayed without the DB logger
+  events::EventDispatcher remoteEventDispatcher_;
+  // Keeps pseudonyms unique across nodes
+  std::shared_ptr<cluster::PseudonymOwnership> pseudonymOwnership_;
+  std::shared_ptr<cluster::SocketMessageBus> messageBus_;
+
   // gRPC components
   std::unique_ptr<ChatService> service_;
   std::unique_ptr<grpc::Server> server_;
   std::jthread serverThread_;
+
+  // Periodic jobs: session checkpoints, idle reaping, banned terms reloads
+  // and delivery latency logs. Declared last so that no job runs while
+  // members go away.
+  timing::TimerService timers_;
 };
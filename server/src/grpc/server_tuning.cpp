@@ -0,0 +1,89 @@
+#include "grpc/server_tuning.hpp"
+
+#include <grpc/grpc.h>
+#include <grpcpp/resource_quota.h>
+
+namespace {
+
+void addIntArgument(grpc::ServerBuilder &builder, const char *name,
+                    int value) {
+  if (value > 0) {
+    builder.AddChannelArgument(name, value);
+  }
+}
+
+} // namespace
+
+void applyServerTuning(const ServerTuning &tuning,
+                       grpc::ServerBuilder &builder) {
+  if (tuning.maxThreads > 0 || tuning.memoryQuotaBytes > 0) {
+    grpc::ResourceQuota quota("chat_server");
+    if (tuning.maxThreads > 0) {
+      quota.SetMaxThreads(tuning.maxThreads);
+    }
+    if (tuning.memoryQuotaBytes > 0) {
+      quota.Resize(tuning.memoryQuotaBytes);
+    }
+    builder.SetResourceQuota(quota);
+  }
+
+  if (tuning.completionQueues > 0) {
+    builder.SetSyncServerOption(grpc::ServerBuilder::SyncServerOption::NUM_CQS,
+                                tuning.completionQueues);
+  }
+  if (tuning.minPollers > 0) {
+    builder.SetSyncServerOption(
+        grpc::ServerBuilder::SyncServerOption::MIN_POLLERS, tuning.minPollers);
+  }
+  if (tuning.maxPollers > 0) {
+    builder.SetSyncServerOption(
+        grpc::ServerBuilder::SyncServerOption::MAX_POLLERS, tuning.maxPollers);
+  }
+
+  addIntArgument(builder, GRPC_ARG_MAX_CONCURRENT_STREAMS,
+                 tuning.maxConcurrentStreams);
+
+  addIntArgument(builder, GRPC_ARG_KEEPALIVE_TIME_MS, tuning.keepaliveTimeMs);
+  addIntArgument(builder, GRPC_ARG_KEEPALIVE_TIMEOUT_MS,
+                 tuning.keepaliveTimeoutMs);
+  if (tuning.keepalivePermitWithoutCalls) {
+    builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+  }
+  addIntArgument(builder, GRPC_ARG_HTTP2_MIN_RECV_PING_INTERVAL_WITHOUT_DATA_MS,
+                 tuning.minPingIntervalWithoutDataMs);
+
+  addIntArgument(builder, GRPC_ARG_HTTP2_STREAM_LOOKAHEAD_BYTES,
+                 tuning.streamWindowBytes);
+  if (!tuning.bdpProbe) {
+    builder.AddChannelArgument(GRPC_ARG_HTTP2_BDP_PROBE, 0);
+  }
+
+  if (tuning.maxReceiveMessageBytes > 0) {
+    builder.SetMaxReceiveMessageSize(tuning.maxReceiveMessageBytes);
+  }
+  if (tuning.maxSendMessageBytes > 0) {
+    builder.SetMaxSendMessageSize(tuning.maxSendMessageBytes);
+  }
+
+  // A level, rather than an algorithm, has each call pick among those its
+  // client accepts: the lowest level prefers gzip, the highest deflate
+  if (tuning.compression == GRPC_COMPRESS_GZIP) {
+    builder.SetDefaultCompressionLevel(GRPC_COMPRESS_LEVEL_LOW);
+  } else if (tuning.compression == GRPC_COMPRESS_DEFLATE) {
+    builder.SetDefaultCompressionLevel(GRPC_COMPRESS_LEVEL_HIGH);
+  }
+}
+
+std::optional<grpc_compression_algorithm>
+compressionAlgorithmFromString(std::string_view name) {
+  if (name == "none") {
+    return GRPC_COMPRESS_NONE;
+  }
+  if (name == "gzip") {
+    return GRPC_COMPRESS_GZIP;
+  }
+  if (name == "deflate") {
+    return GRPC_COMPRESS_DEFLATE;
+  }
+  return std::nullopt;
+}
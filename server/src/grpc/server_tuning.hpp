@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+#include <grpcpp/grpcpp.h>
+
+// Resource and transport settings applied to the gRPC ServerBuilder. A zero
+// value keeps the gRPC default for that setting.
+struct ServerTuning {
+  // Threads available to the sync server (resource quota)
+  int maxThreads = 0;
+  // Memory the server may use for buffers before it pushes back on peers
+  std::size_t memoryQuotaBytes = 0;
+  // Sync server completion queues and pollers per queue
+  int completionQueues = 0;
+  int minPollers = 0;
+  int maxPollers = 0;
+
+  // Concurrent HTTP/2 streams allowed on one client connection
+  int maxConcurrentStreams = 0;
+
+  // Server-initiated keepalive pings, and how often clients may ping
+  int keepaliveTimeMs = 0;
+  int keepaliveTimeoutMs = 0;
+  bool keepalivePermitWithoutCalls = false;
+  int minPingIntervalWithoutDataMs = 0;
+
+  // HTTP/2 flow control: per-stream window, and whether gRPC may grow it
+  // from bandwidth-delay probes
+  int streamWindowBytes = 0;
+  bool bdpProbe = true;
+
+  int maxReceiveMessageBytes = 0;
+  int maxSendMessageBytes = 0;
+
+  // Preferred algorithm for responses (gzip or deflate). Each call uses the
+  // other one when the client only accepts that, and none when the client
+  // accepts neither.
+  grpc_compression_algorithm compression = GRPC_COMPRESS_NONE;
+  // Stream messages below this size are written uncompressed: deflate
+  // framing outweighs what it saves on short chat lines
+  std::size_t compressionMinBytes = 256;
+};
+
+void applyServerTuning(const ServerTuning &tuning,
+                       grpc::ServerBuilder &builder);
+
+// "none", "gzip" or "deflate"
+std::optional<grpc_compression_algorithm>
+compressionAlgorithmFromString(std::string_view name);
@@ -1,10 +1,20 @@
+#include <algorithm>
 #include <boost/program_options.hpp>
+#include <chrono>
+#include <csignal>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include "cluster/worker_pool.hpp"
 #include "database/database_manager.hpp"
 #include "database/database_manager_factory.hpp"
+#include "domain/outbound_queue_policy.hpp"
 #include "grpc/grpc_runner.hpp"
 
 class ArgumentParser {
@@ -14,16 +24,172 @@ public:
 
     boost::program_options::options_description desc("Chat gRPC server");
     desc.add_options()("help,h", "show help message")(
+        "config,c", po::value<std::string>(&configFile_),
+        "Read options from a config file (one 'option = value' per line). "
+        "Command line values take precedence.")(
         "listen,l",
         po::value<std::string>(&serverAddress_)
             ->default_value(defaultListenServerEndpoint_),
-        "gRPC listen address (host:port).");
+        "gRPC listen address (host:port).")(
+        "outbound-queue-capacity",
+        po::value<std::size_t>(&outboundQueueConfig_.capacity)
+            ->default_value(outboundQueueConfig_.capacity),
+        "Maximum number of messages pending delivery per session.")(
+        "slow-consumer-policy",
+        po::value<std::string>(&slowConsumerPolicy_)
+            ->default_value(slowConsumerPolicy_),
+        "Policy applied when a session's outbound queue is full "
+        "(drop-oldest, coalesce, disconnect).")(
+        "coalesce-max-bytes",
+        po::value<std::size_t>(&outboundQueueConfig_.maxCoalescedBytes)
+            ->default_value(outboundQueueConfig_.maxCoalescedBytes),
+        "Maximum text size of a message folded by the coalesce policy; past "
+        "it, messages are handled as with drop-oldest.")(
+        "broadcast-shards",
+        po::value<std::size_t>(&broadcastShards_)
+            ->default_value(broadcastShards_),
+        "Number of subscriber shards per room broadcaster.")(
+        "max-rooms",
+        po::value<std::size_t>(&maxRooms_)->default_value(maxRooms_),
+        "Maximum number of rooms with subscribers, the default room "
+        "included.")(
+        "delivery-workers",
+        po::value<std::size_t>(&delivery_.workers)
+            ->default_value(delivery_.workers),
+        "Number of threads writing messages to the subscriber streams (0 "
+        "for one per hardware thread).")(
+        "delivery-stats-interval-ms",
+        po::value<int>(&deliveryStatsIntervalMs_)
+            ->default_value(deliveryStatsIntervalMs_),
+        "Log the p50, p99 and max time from a wake of the delivery pool "
+        "to its writes being started this often (0 disables).")(
+        "workers",
+        po::value<std::size_t>(&workers_)->default_value(workers_),
+        "Number of server processes sharing the listen address "
+        "(SO_REUSEPORT). Workers relay events to each other locally.")(
+        "pin-workers",
+        po::value<bool>(&pinWorkers_)
+            ->default_value(false)
+            ->implicit_value(true),
+        "Bind each worker process to its own subset of CPUs.")(
+        "cluster-listen",
+        po::value<std::string>(&messageBus_.listenAddress),
+        "Accept events from other cluster nodes on this address "
+        "(host:port or unix:/path).")(
+        "cluster-peer",
+        po::value<std::vector<std::string>>(&messageBus_.peerAddresses)
+            ->composing(),
+        "Cluster-listen address of another node; repeat for each node.")(
+        "drain-timeout-ms",
+        po::value<int>(&drainTimeoutMs_)->default_value(drainTimeoutMs_),
+        "On SIGINT/SIGTERM, time given to streams and database writes to "
+        "finish before the server exits.")(
+        "session-file", po::value<std::string>(&sessionFile_),
+        "Checkpoint client sessions to this file so that clients resume "
+        "them after a restart (single process only).")(
+        "resume-window-ms",
+        po::value<int>(&resumeWindowMs_)->default_value(resumeWindowMs_),
+        "Time a restored session keeps its pseudonym for its client.")(
+        "idle-timeout-ms",
+        po::value<int>(&idleTimeoutMs_)->default_value(idleTimeoutMs_),
+        "Disconnect clients that have no stream open and make no call for "
+        "this long (0 disables). Pair with --grpc-keepalive-time-ms so that "
+        "streams of vanished clients get cancelled.")(
+        "banned-terms", po::value<std::string>(&bannedTermsFile_),
+        "Reject messages containing any of the terms in this file, one per "
+        "line, matched as whole words regardless of case. The file is "
+        "reread when it changes.");
+
+    // gRPC resource and transport tuning, 0 keeps the gRPC default
+    boost::program_options::options_description tuningDesc(
+        "gRPC server tuning (0 keeps the gRPC default)");
+    tuningDesc.add_options()(
+        "grpc-max-threads",
+        po::value<int>(&tuning_.maxThreads)->default_value(0),
+        "Maximum threads for the sync server (resource quota).")(
+        "grpc-memory-quota-bytes",
+        po::value<std::size_t>(&tuning_.memoryQuotaBytes)->default_value(0),
+        "Memory quota for gRPC buffers.")(
+        "grpc-completion-queues",
+        po::value<int>(&tuning_.completionQueues)->default_value(0),
+        "Completion queues of the sync server.")(
+        "grpc-min-pollers",
+        po::value<int>(&tuning_.minPollers)->default_value(0),
+        "Minimum polling threads per completion queue.")(
+        "grpc-max-pollers",
+        po::value<int>(&tuning_.maxPollers)->default_value(0),
+        "Maximum polling threads per completion queue.")(
+        "grpc-max-concurrent-streams",
+        po::value<int>(&tuning_.maxConcurrentStreams)->default_value(0),
+        "Maximum concurrent HTTP/2 streams per client connection.")(
+        "grpc-keepalive-time-ms",
+        po::value<int>(&tuning_.keepaliveTimeMs)->default_value(0),
+        "Interval between server keepalive pings.")(
+        "grpc-keepalive-timeout-ms",
+        po::value<int>(&tuning_.keepaliveTimeoutMs)->default_value(0),
+        "Time to wait for a keepalive ack before closing the connection.")(
+        "grpc-keepalive-permit-without-calls",
+        po::value<bool>(&tuning_.keepalivePermitWithoutCalls)
+            ->default_value(false)
+            ->implicit_value(true),
+        "Keep pinging connections that have no active call.")(
+        "grpc-min-ping-interval-ms",
+        po::value<int>(&tuning_.minPingIntervalWithoutDataMs)
+            ->default_value(0),
+        "Minimum interval accepted between client pings without data.")(
+        "grpc-stream-window-bytes",
+        po::value<int>(&tuning_.streamWindowBytes)->default_value(0),
+        "Initial HTTP/2 flow-control window per stream.")(
+        "grpc-bdp-probe",
+        po::value<bool>(&tuning_.bdpProbe)->default_value(true),
+        "Let gRPC grow flow-control windows from bandwidth probes.")(
+        "grpc-max-receive-message-bytes",
+        po::value<int>(&tuning_.maxReceiveMessageBytes)->default_value(0),
+        "Largest request message accepted.")(
+        "grpc-max-send-message-bytes",
+        po::value<int>(&tuning_.maxSendMessageBytes)->default_value(0),
+        "Largest response message sent.")(
+        "grpc-compression",
+        po::value<std::string>(&compression_)->default_value(compression_),
+        "Compress responses for clients that accept it (none, gzip, "
+        "deflate); the other algorithm is used for clients that only "
+        "accept that one.")(
+        "grpc-compression-min-bytes",
+        po::value<std::size_t>(&tuning_.compressionMinBytes)
+            ->default_value(tuning_.compressionMinBytes),
+        "Stream messages below this size are sent uncompressed.");
+    desc.add(tuningDesc);
 
     try {
       po::variables_map vm;
       // try to parse arguments
       po::store(po::parse_command_line(argc, argv, desc), vm);
+      if (vm.count("config") != 0) {
+        std::ifstream configFile(vm["config"].as<std::string>());
+        if (!configFile) {
+          throw po::error("cannot open config file '" +
+                          vm["config"].as<std::string>() + "'");
+        }
+        // Values already given on the command line are kept
+        po::store(po::parse_config_file(configFile, desc), vm);
+      }
       po::notify(vm);
+
+      const auto policy =
+          domain::slowConsumerPolicyFromString(slowConsumerPolicy_);
+      if (!policy.has_value()) {
+        throw po::invalid_option_value(slowConsumerPolicy_);
+      }
+      outboundQueueConfig_.policy = *policy;
+      const auto compression = compressionAlgorithmFromString(compression_);
+      if (!compression.has_value()) {
+        throw po::invalid_option_value(compression_);
+      }
+      tuning_.compression = *compression;
+      if (workers_ > 1 && messageBus_.enabled()) {
+        throw po::error("--cluster-listen and --cluster-peer cannot be "
+                        "combined with --workers");
+      }
       // help case
       if (vm.count("help") != 0) {
         std::cout << desc << std::endl;
@@ -40,11 +206,109 @@ public:
                                   : std::make_optional(serverAddress_);
   }
 
+  domain::OutboundQueueConfig getOutboundQueueConfig() const {
+    return outboundQueueConfig_;
+  }
+
+  std::size_t getBroadcastShards() const { return broadcastShards_; }
+
+  std::size_t getMaxRooms() const { return maxRooms_; }
+
+  service::DeliveryPool::Config getDeliveryConfig() const { return delivery_; }
+
+  std::chrono::milliseconds getDeliveryStatsInterval() const {
+    return std::chrono::milliseconds(std::max(deliveryStatsIntervalMs_, 0));
+  }
+
+  ServerTuning getServerTuning() const { return tuning_; }
+
+  std::size_t getWorkers() const { return workers_; }
+
+  bool getPinWorkers() const { return pinWorkers_; }
+
+  cluster::SocketMessageBus::Config getMessageBusConfig() const {
+    return messageBus_;
+  }
+
+  std::chrono::milliseconds getDrainTimeout() const {
+    return std::chrono::milliseconds(std::max(drainTimeoutMs_, 0));
+  }
+
+  std::string getSessionFile() const { return sessionFile_; }
+
+  std::chrono::milliseconds getResumeWindow() const {
+    return std::chrono::milliseconds(std::max(resumeWindowMs_, 0));
+  }
+
+  std::string getBannedTermsFile() const { return bannedTermsFile_; }
+
+  domain::LivenessTracker::Config getLivenessConfig() const {
+    return {.idleTimeout =
+                std::chrono::milliseconds(std::max(idleTimeoutMs_, 0))};
+  }
+
 private:
   const std::string defaultListenServerEndpoint_{"0.0.0.0:50051"};
+  std::string configFile_;
   std::string serverAddress_;
+  std::string slowConsumerPolicy_{"drop-oldest"};
+  domain::OutboundQueueConfig outboundQueueConfig_;
+  std::size_t broadcastShards_{
+      std::max(1U, std::thread::hardware_concurrency())};
+  std::size_t maxRooms_{1024};
+  service::DeliveryPool::Config delivery_;
+  int deliveryStatsIntervalMs_{60000};
+  ServerTuning tuning_;
+  std::string compression_{"none"};
+  std::size_t workers_{1};
+  bool pinWorkers_{false};
+  cluster::SocketMessageBus::Config messageBus_;
+  int drainTimeoutMs_{5000};
+  std::string sessionFile_;
+  int resumeWindowMs_{60000};
+  int idleTimeoutMs_{60000};
+  std::string bannedTermsFile_;
 };
 
+std::shared_ptr<database::IDatabaseManager> openDatabase(bool printStatistics) {
+  const auto databaseManagerOrError =
+      database::DatabaseManagerFactory::createDatabaseManagerSQLite();
+  if (!databaseManagerOrError.has_value()) {
+    throw std::runtime_error("Failed to create DatabaseManagerSQLite: " +
+                             databaseManagerOrError.error());
+  }
+  if (printStatistics) {
+    if (const auto error =
+            (*databaseManagerOrError)->printStatisticsTableContent()) {
+      throw std::runtime_error("Failed to print statistics table content: " +
+                               error.value());
+    }
+  }
+  return *databaseManagerOrError;
+}
+
+// Blocks SIGINT and SIGTERM in this thread and the threads it starts, so
+// that gRPC threads never take them, then serves until one arrives and
+// drains the server.
+int serveUntilStopped(std::shared_ptr<database::IDatabaseManager> db,
+                      GrpcRunner::Config config) {
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  sigset_t previous;
+  ::pthread_sigmask(SIG_BLOCK, &signals, &previous);
+
+  GrpcRunner grpcServer(std::move(db), std::move(config));
+  int received = 0;
+  ::sigwait(&signals, &received);
+  std::cout << "Draining before shutdown" << std::endl;
+  grpcServer.shutdown();
+
+  ::pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+  return 0;
+}
+
 int main(int argc, char **argv) {
 
   try {
@@ -55,22 +319,38 @@ int main(int argc, char **argv) {
       throw std::runtime_error("Invalid server address argument.");
     }
 
-    // db manager instanciation and print
-    const auto databaseManagerOrError =
-        database::DatabaseManagerFactory::createDatabaseManagerSQLite();
-    if (!databaseManagerOrError.has_value()) {
-      throw std::runtime_error("Failed to create DatabaseManagerSQLite: " +
-                               databaseManagerOrError.error());
-    }
-    if (const auto error =
-            (*databaseManagerOrError)->printStatisticsTableContent()) {
-      throw std::runtime_error("Failed to print statistics table content: " +
-                               error.value());
+    GrpcRunner::Config config{
+        .serverAddress = serverAddress.value(),
+        .outboundQueue = argParser.getOutboundQueueConfig(),
+        .broadcastShards = argParser.getBroadcastShards(),
+        .maxRooms = argParser.getMaxRooms(),
+        .tuning = argParser.getServerTuning(),
+        .messageBus = argParser.getMessageBusConfig(),
+        .drainTimeout = argParser.getDrainTimeout(),
+        .sessionFile = argParser.getSessionFile(),
+        .resumeWindow = argParser.getResumeWindow(),
+        .liveness = argParser.getLivenessConfig(),
+        .bannedTermsFile = argParser.getBannedTermsFile(),
+        .delivery = argParser.getDeliveryConfig(),
+        .deliveryStatsInterval = argParser.getDeliveryStatsInterval()};
+
+    if (argParser.getWorkers() <= 1) {
+      // db manager instanciation and print
+      const auto databaseManager = openDatabase(true);
+      return serveUntilStopped(databaseManager, std::move(config));
     }
 
-    GrpcRunner grpcServer(*databaseManagerOrError, serverAddress.value());
-    grpcServer.wait();
-    return 0;
+    // A SQLite connection must not cross fork(): statistics are printed from
+    // a connection closed right away and each worker opens its own
+    openDatabase(true);
+    return cluster::runWorkers(
+        argParser.getWorkers(), argParser.getPinWorkers(),
+        [&config](const cluster::WorkerContext &worker) {
+          auto workerConfig = config;
+          workerConfig.messageBus.links = worker.links;
+          return serveUntilStopped(openDatabase(false),
+                                   std::move(workerConfig));
+        });
 
   } catch (const std::exception &ex) {
     std::cerr << "Exception in main: " << ex.what() << std::endl;
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include <google/protobuf/arena.h>
+#include <grpcpp/support/message_allocator.h>
+
+namespace service {
+
+// Message allocator for callback unary methods.
+//
+// The request and response of a call live on one protobuf arena whose first
+// block is embedded in the per-call holder, so a typical call costs a single
+// heap allocation and everything is released at once when the call ends.
+template <typename Request, typename Response,
+          std::size_t kInitialBlockSize = 1024>
+class ArenaMessageAllocator final
+    : public grpc::MessageAllocator<Request, Response> {
+public:
+  grpc::MessageHolder<Request, Response> *AllocateMessages() override {
+    return new Holder();
+  }
+
+private:
+  class Holder final : public grpc::MessageHolder<Request, Response> {
+  public:
+    Holder() : arena_(makeOptions(initialBlock_)) {
+      this->set_request(
+          google::protobuf::Arena::CreateMessage<Request>(&arena_));
+      this->set_response(
+          google::protobuf::Arena::CreateMessage<Response>(&arena_));
+    }
+
+    void Release() override { delete this; }
+
+  private:
+    static google::protobuf::ArenaOptions
+    makeOptions(std::array<char, kInitialBlockSize> &block) {
+      google::protobuf::ArenaOptions options;
+      options.initial_block = block.data();
+      options.initial_block_size = block.size();
+      return options;
+    }
+
+    // Declared before the arena, which must be destroyed first
+    alignas(std::max_align_t) std::array<char, kInitialBlockSize> initialBlock_;
+    google::protobuf::Arena arena_;
+  };
+};
+
+} // namespace service
@@ -1,39 +1,163 @@
 #include "service/chat_service.hpp"
 
-#include <format>
-#include <iostream>
+#include <utility>
 
-#include "service/validation/validators/content_validator.hpp"
-#include "service/validation/validators/rate_limit_validator.hpp"
+#include <grpcpp/support/proto_buffer_reader.h>
+
+#include "service/message_stream_reactor.hpp"
 
 using namespace std::chrono_literals;
 
+namespace {
+
+constexpr const char *kPseudonymTakenMessage =
+    "The pseudo you are using is already in use, please choose another one";
+
+constexpr const char *kShuttingDownMessage = "server is shutting down";
+
+// Ends a raw stream with `status` before anything is written.
+class FinishedWriteReactor final
+    : public grpc::ServerWriteReactor<grpc::ByteBuffer> {
+public:
+  explicit FinishedWriteReactor(grpc::Status status) {
+    Finish(std::move(status));
+  }
+
+  void OnDone() override { delete this; }
+};
+
+// Raw methods receive the request undecoded. Copying the buffer only takes
+// a reference on its slices.
+bool parseRequest(const grpc::ByteBuffer &buffer,
+                  google::protobuf::MessageLite &message) {
+  grpc::ByteBuffer copy(buffer);
+  grpc::ProtoBufferReader reader(&copy);
+  return reader.status().ok() && message.ParseFromZeroCopyStream(&reader);
+}
+
+// Connect messages, kept alive until the pseudonym is decided
+struct ConnectCall {
+  chat::ConnectRequest request;
+  chat::ConnectResponse response;
+};
+
+// Hands the roster's encoded bytes to gRPC without copying them; the slice
+// holds a reference on the snapshot until the response is sent.
+grpc::Slice rosterSlice(std::shared_ptr<const domain::RosterSnapshot> roster) {
+  using Owner = std::shared_ptr<const domain::RosterSnapshot>;
+  auto *owner = new Owner(std::move(roster));
+  auto &wire = (*owner)->wire;
+  return grpc::Slice(
+      const_cast<char *>(wire.data()), wire.size(),
+      [](void *user) { delete static_cast<Owner *>(user); }, owner);
+}
+
+// `response` has no roster of its own: the snapshot's bytes follow it, which
+// parses as the repeated connected_pseudonyms field.
+grpc::ByteBuffer
+serializeConnectResponse(const chat::ConnectResponse &response,
+                         std::shared_ptr<const domain::RosterSnapshot> roster) {
+  grpc::Slice slices[] = {grpc::Slice(response.SerializeAsString()),
+                          grpc::Slice()};
+  if (!roster || roster->wire.empty()) {
+    return grpc::ByteBuffer(slices, 1);
+  }
+  slices[1] = rosterSlice(std::move(roster));
+  return grpc::ByteBuffer(slices, 2);
+}
+
+} // namespace
+
 ChatService::ChatService(
     std::shared_ptr<domain::ClientRegistry> clientRegistry,
-    std::shared_ptr<domain::IMessageBroadcaster> messageBroadcaster,
+    std::shared_ptr<domain::IRoomRegistry> roomRegistry,
     std::shared_ptr<domain::IPrivateMessageBroadcaster>
         privateMessageBroadcaster,
     std::shared_ptr<domain::IClientEventBroadcaster> clientEventBroadcaster,
-    events::EventDispatcher *eventDispatcher)
+    events::EventDispatcher *eventDispatcher,
+    std::shared_ptr<service::DeliveryPool> deliveryPool,
+    std::shared_ptr<domain::IPseudonymArbiter> pseudonymArbiter,
+    std::shared_ptr<domain::SessionStore> sessionStore,
+    std::shared_ptr<domain::LivenessTracker> livenessTracker,
+    std::shared_ptr<const service::validation::BannedTerms> bannedTerms,
+    std::size_t compressionMinBytes)
     : clientRegistry_(std::move(clientRegistry)),
-      messageBroadcaster_(std::move(messageBroadcaster)),
+      roomRegistry_(std::move(roomRegistry)),
       privateMessageBroadcaster_(std::move(privateMessageBroadcaster)),
       clientEventBroadcaster_(std::move(clientEventBroadcaster)),
-      eventDispatcher_(eventDispatcher) {
-  validationChain_
-      .add(std::make_shared<service::validation::ContentValidator>())
-      .add(std::make_shared<service::validation::RateLimitValidator>(1s));
+      eventDispatcher_(eventDispatcher),
+      deliveryPool_(std::move(deliveryPool)),
+      pseudonymArbiter_(std::move(pseudonymArbiter)),
+      sessionStore_(std::move(sessionStore)),
+      livenessTracker_(std::move(livenessTracker)),
+      validationPipeline_(service::validation::ContentValidator::Config{},
+                          std::move(bannedTerms), 1s,
+                          service::validation::FloodValidator::Config{}),
+      compressionMinBytes_(compressionMinBytes) {
+  SetMessageAllocatorFor_SendMessage(&sendMessageAllocator_);
 }
 
 ChatService::~ChatService() = default;
 
-grpc::Status ChatService::Connect(grpc::ServerContext *context,
-                                  const chat::ConnectRequest *request,
-                                  chat::ConnectResponse *response) {
+void ChatService::drain() {
+  // Requested first so that streams woken below see it
+  drainSource_.request_stop();
+  roomRegistry_->drain();
+  privateMessageBroadcaster_->drain();
+  clientEventBroadcaster_->drain();
+  // Streams with nothing left to write end on this pass
+  deliveryPool_->wakeAll();
+}
+
+grpc::ServerUnaryReactor *
+ChatService::Connect(grpc::CallbackServerContext *context,
+                     const grpc::ByteBuffer *request,
+                     grpc::ByteBuffer *response) {
+  auto *reactor = context->DefaultReactor();
+  if (drainSource_.stop_requested()) {
+    // Lets the client retry on another node or worker
+    reactor->Finish(
+        grpc::Status(grpc::StatusCode::UNAVAILABLE, kShuttingDownMessage));
+    return reactor;
+  }
+
+  auto call = std::make_shared<ConnectCall>();
+  if (request == nullptr || !parseRequest(*request, call->request)) {
+    reactor->Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                 "request is required"));
+    return reactor;
+  }
+
+  handleConnect(context, &call->request, &call->response,
+                [reactor, response, call](RosterPtr roster) {
+                  *response = serializeConnectResponse(call->response,
+                                                       std::move(roster));
+                  reactor->Finish(grpc::Status::OK);
+                });
+  return reactor;
+}
+
+grpc::ServerUnaryReactor *
+ChatService::SendMessage(grpc::CallbackServerContext *context,
+                         const chat::SendMessageRequest *request,
+                         google::protobuf::Empty *response) {
+  auto *reactor = context->DefaultReactor();
+  handleSendMessage(context, request, response,
+                    [reactor](grpc::Status status) {
+                      reactor->Finish(std::move(status));
+                    });
+  return reactor;
+}
+
+void ChatService::handleConnect(grpc::ServerContextBase *context,
+                                const chat::ConnectRequest *request,
+                                chat::ConnectResponse *response,
+                                ConnectDone done) {
   if (request == nullptr || request->pseudonym().empty()) {
     response->set_accepted(false);
     response->set_message("pseudonym is required");
-    return grpc::Status::OK;
+    done(nullptr);
+    return;
   }
 
   const std::string peerAddress =
@@ -41,35 +165,102 @@ grpc::Status ChatService::Connect(grpc::ServerContext *context,
   if (peerAddress.empty()) {
     response->set_accepted(false);
     response->set_message("peer information is required");
-    return grpc::Status::OK;
+    done(nullptr);
+    return;
   }
 
-  if (!clientRegistry_->isPseudonymAvailable(peerAddress,
-                                             request->pseudonym())) {
+  // A client presenting its session takes the pseudonym over from the
+  // session's previous connection. Ownership in a cluster is per connection,
+  // so there the pseudonym is claimed again like any other.
+  std::string resumedPeer;
+  if (sessionStore_ && !pseudonymArbiter_ &&
+      !request->session_token().empty()) {
+    resumedPeer = sessionStore_
+                      ->holder(request->session_token(), request->pseudonym())
+                      .value_or(std::string{});
+  }
+
+  // Reserved until the connect event is dispatched, so that concurrent
+  // connects for the same pseudonym cannot both pass
+  if (!clientRegistry_->reservePseudonym(peerAddress, request->pseudonym(),
+                                         resumedPeer)) {
     response->set_accepted(false);
-    response->set_message("The pseudo you are using is already in use, please "
-                          "choose another one");
-    return grpc::Status::OK;
+    response->set_message(kPseudonymTakenMessage);
+    done(nullptr);
+    return;
+  }
+
+  if (!pseudonymArbiter_) {
+    dispatchQueue_.post([this, peerAddress, resumedPeer, request, response,
+                         done = std::move(done)] {
+      done(acceptConnect(peerAddress, resumedPeer, *request, response));
+    });
+    return;
   }
 
+  // The call stays open until the pseudonym's owner answers
+  pseudonymArbiter_->claim(
+      peerAddress, request->pseudonym(),
+      [this, peerAddress, request, response,
+       done = std::move(done)](domain::ClaimResult result) {
+        if (result == domain::ClaimResult::kGranted) {
+          dispatchQueue_.post([this, peerAddress, request, response, done] {
+            done(acceptConnect(peerAddress, {}, *request, response));
+          });
+          return;
+        }
+        clientRegistry_->cancelReservation(peerAddress, request->pseudonym());
+        response->set_accepted(false);
+        response->set_message(result == domain::ClaimResult::kTaken
+                                  ? kPseudonymTakenMessage
+                                  : "The pseudonym service is busy, please "
+                                    "try again in a few seconds");
+        done(nullptr);
+      });
+}
+
+domain::LivenessTracker::Stream
+ChatService::openLivenessStream(const std::string &peer) {
+  if (!livenessTracker_) {
+    return {};
+  }
+  return livenessTracker_->openStream(peer);
+}
+
+ChatService::RosterPtr
+ChatService::acceptConnect(const std::string &peerAddress,
+                           const std::string &resumedPeer,
+                           const chat::ConnectRequest &request,
+                           chat::ConnectResponse *response) {
   response->set_accepted(true);
-  response->set_message("New client '" + request->pseudonym() +
-                        "' is now connected");
-  std::cout << response->message() << std::endl;
-
-  // Populate the initial roster of connected pseudonyms
-  const auto connectedPseudonyms = clientRegistry_->getConnectedPseudonyms();
-  for (const auto &name : connectedPseudonyms) {
-    response->add_connected_pseudonyms(name);
+  response->set_message(
+      resumedPeer.empty()
+          ? "New client '" + request.pseudonym() + "' is now connected"
+          : "Client '" + request.pseudonym() + "' resumed its session");
+
+  // The initial roster is the snapshot shared by every connect, read before
+  // this client joins it
+  auto roster = clientRegistry_->getRosterSnapshot();
+  response->set_roster_version(roster->version);
+  // The client already holds this roster
+  if (request.roster_version() != 0 &&
+      request.roster_version() == roster->version) {
+    response->set_roster_unchanged(true);
+    roster.reset();
   }
 
   events::ClientConnectedEvent event{.peer = peerAddress,
-                                     .pseudonym = request->pseudonym(),
-                                     .gender = request->gender(),
-                                     .country = request->country()};
+                                     .pseudonym = request.pseudonym(),
+                                     .gender = request.gender(),
+                                     .country = request.country()};
+  event.resumedPeer = resumedPeer;
+  if (sessionStore_) {
+    response->set_session_token(
+        sessionStore_->open(event, request.session_token()));
+  }
   eventDispatcher_->notifyClientConnected(event);
 
-  return grpc::Status::OK;
+  return roster;
 }
 
 grpc::Status ChatService::Disconnect(grpc::ServerContext *context,
@@ -92,8 +283,6 @@ grpc::Status ChatService::Disconnect(grpc::ServerContext *context,
   const auto connectionDuration =
       clientRegistry_->getConnectionDuration(peerAddress);
 
-  std::cout << "'" + pseudonym + "' is disconnected" << std::endl;
-
   if (connectionDuration.has_value()) {
     events::ClientDisconnectedEvent event{.peer = peerAddress,
                                           .pseudonym = pseudonym,
@@ -105,25 +294,29 @@ grpc::Status ChatService::Disconnect(grpc::ServerContext *context,
   return grpc::Status::OK;
 }
 
-grpc::Status ChatService::SendMessage(grpc::ServerContext *context,
-                                      const chat::SendMessageRequest *request,
-                                      google::protobuf::Empty *response) {
+void ChatService::handleSendMessage(grpc::ServerContextBase *context,
+                                    const chat::SendMessageRequest *request,
+                                    google::protobuf::Empty *response,
+                                    SendDone done) {
   if (request == nullptr) {
-    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
-                        "request is required");
+    done(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                      "request is required"));
+    return;
   }
 
   const std::string peer =
       (context != nullptr) ? context->peer() : std::string{};
   if (peer.empty()) {
-    return grpc::Status(grpc::StatusCode::UNAUTHENTICATED,
-                        "peer information missing");
+    done(grpc::Status(grpc::StatusCode::UNAUTHENTICATED,
+                      "peer information missing"));
+    return;
   }
 
   std::string pseudonym;
   if (!clientRegistry_->getPseudonymForPeer(peer, pseudonym)) {
-    return grpc::Status(grpc::StatusCode::PERMISSION_DENIED,
-                        "client not connected");
+    done(grpc::Status(grpc::StatusCode::PERMISSION_DENIED,
+                      "client not connected"));
+    return;
   }
 
   // validate the message with validators
@@ -133,13 +326,11 @@ grpc::Status ChatService::SendMessage(grpc::ServerContext *context,
       .content = request->content(),
       .timestamp = std::chrono::steady_clock::now()};
 
-  const auto validationResult = validationChain_.validate(validationCtx);
+  const auto validationResult = validationPipeline_.validate(validationCtx);
   if (!validationResult.valid) {
-    std::cerr << std::format("[{}] Message validation failed: {}", pseudonym,
-                             validationResult.errorMessage)
-              << std::endl;
-    return grpc::Status(validationResult.statusCode,
-                        validationResult.errorMessage);
+    done(grpc::Status(validationResult.statusCode,
+                      validationResult.errorMessage()));
+    return;
   }
 
   if (response != nullptr) {
@@ -151,103 +342,91 @@ grpc::Status ChatService::SendMessage(grpc::ServerContext *context,
       !request->private_message_pseudonym().empty()) {
     const auto &recipientPseudonym = request->private_message_pseudonym();
 
-    std::string recipientPeer;
-    if (!clientRegistry_->getPeerForPseudonym(recipientPseudonym,
-                                              recipientPeer)) {
-      return grpc::Status(grpc::StatusCode::NOT_FOUND,
-                          "recipient not found or not connected");
+    auto recipient = clientRegistry_->locate(recipientPseudonym);
+    if (!recipient) {
+      done(grpc::Status(grpc::StatusCode::NOT_FOUND,
+                        "recipient not found or not connected"));
+      return;
     }
 
-    std::cout << std::format("[{}] -> [{}] (private): {}", pseudonym,
-                             recipientPseudonym, request->content())
-              << std::endl;
-
-    events::PrivateMessageSentEvent event{.senderPeer = peer,
-                                          .senderPseudonym = pseudonym,
-                                          .recipientPeer = recipientPeer,
-                                          .recipientPseudonym =
-                                              recipientPseudonym,
-                                          .content = request->content()};
-    eventDispatcher_->notifyPrivateMessageSent(event);
+    // The content is copied exactly once, into the shared payload
+    events::PrivateMessageSentEvent event{
+        .senderPeer = peer,
+        .senderPseudonym = pseudonym,
+        .recipientPeer = std::move(recipient->peer),
+        .recipientPseudonym = recipientPseudonym,
+        .message = events::makeChatMessage(pseudonym, request->content(), {},
+                                           true),
+        .recipientNode = std::move(recipient->node)};
+    // Completed once the recipient's queue has the message
+    dispatchQueue_.post([this, event = std::move(event), done] {
+      eventDispatcher_->notifyPrivateMessageSent(event);
+      done(grpc::Status::OK);
+    });
   } else {
-    std::cout << std::format("[{}] {}", pseudonym, request->content())
-              << std::endl;
+    // Rooms are created by their subscribers, never by a message
+    if (!domain::RoomRegistry::isValidRoomId(request->room())) {
+      done(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                        "invalid room id"));
+      return;
+    }
+    const std::string room =
+        domain::RoomRegistry::normalizeRoomId(request->room());
 
+    // The content is copied exactly once, into the shared payload
     events::MessageSentEvent event{
-        .peer = peer, .pseudonym = pseudonym, .content = request->content()};
-    eventDispatcher_->notifyMessageSent(event);
+        .peer = peer,
+        .pseudonym = pseudonym,
+        .room = room,
+        .message = events::makeChatMessage(pseudonym, request->content(), room)};
+    // Completed once the room's log has the message
+    dispatchQueue_.post([this, event = std::move(event), done] {
+      eventDispatcher_->notifyMessageSent(event);
+      done(grpc::Status::OK);
+    });
   }
-
-  return grpc::Status::OK;
 }
 
-grpc::Status ChatService::SubscribeMessages(
-    grpc::ServerContext *context,
-    const chat::InformClientsNewMessageRequest *request,
-    grpc::ServerWriter<chat::InformClientsNewMessageResponse> *writer) {
-  if (request == nullptr) {
-    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
-                        "request is required");
+grpc::ServerWriteReactor<grpc::ByteBuffer> *
+ChatService::SubscribeMessages(grpc::CallbackServerContext *context,
+                               const grpc::ByteBuffer *request) {
+  chat::InformClientsNewMessageRequest subscribeRequest;
+  if (request == nullptr || !parseRequest(*request, subscribeRequest)) {
+    return new FinishedWriteReactor(grpc::Status(
+        grpc::StatusCode::INVALID_ARGUMENT, "request is required"));
   }
 
   const std::string peer =
       (context != nullptr) ? context->peer() : std::string{};
   if (peer.empty()) {
-    return grpc::Status(grpc::StatusCode::UNAUTHENTICATED,
-                        "peer information missing");
+    return new FinishedWriteReactor(grpc::Status(
+        grpc::StatusCode::UNAUTHENTICATED, "peer information missing"));
   }
 
-  if (!messageBroadcaster_->normalizeMessageIndex(peer)) {
-    return grpc::Status(grpc::StatusCode::PERMISSION_DENIED,
-                        "client not connected");
+  // Each message stream follows a single room
+  auto room = roomRegistry_->room(subscribeRequest.room());
+  if (!room) {
+    return new FinishedWriteReactor(
+        room.error() == domain::RoomError::kInvalidId
+            ? grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                           "invalid room id")
+            : grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                           "too many rooms"));
+  }
+  auto messageBroadcaster = std::move(*room);
+  auto subscription = messageBroadcaster->subscribe(peer);
+  if (!subscription) {
+    return new FinishedWriteReactor(grpc::Status(
+        grpc::StatusCode::PERMISSION_DENIED, "client not connected"));
   }
 
   privateMessageBroadcaster_->normalizePrivateMessageIndex(peer);
 
-  using namespace std::chrono_literals;
-  while (true) {
-    if (context != nullptr && context->IsCancelled()) {
-      return grpc::Status::CANCELLED;
-    }
-
-    // Check for private messages first (higher priority)
-    chat::InformClientsNewMessageResponse privateMessage;
-    const domain::NextPrivateMessageStatus privateStatus =
-        privateMessageBroadcaster_->nextPrivateMessage(peer, 0ms,
-                                                       privateMessage);
-
-    if (privateStatus == domain::NextPrivateMessageStatus::kPeerMissing) {
-      return grpc::Status(grpc::StatusCode::PERMISSION_DENIED,
-                          "client not connected");
-    }
-
-    if (privateStatus == domain::NextPrivateMessageStatus::kOk) {
-      if (!writer->Write(privateMessage)) {
-        return grpc::Status(grpc::StatusCode::UNKNOWN,
-                            "failed to write private message to client stream");
-      }
-      continue;
-    }
-
-    // Check for public messages
-    chat::InformClientsNewMessageResponse nextMessage;
-    const domain::NextMessageStatus status =
-        messageBroadcaster_->nextMessage(peer, 200ms, nextMessage);
-
-    if (status == domain::NextMessageStatus::kPeerMissing) {
-      return grpc::Status(grpc::StatusCode::PERMISSION_DENIED,
-                          "client not connected");
-    }
-
-    if (status != domain::NextMessageStatus::kOk) {
-      continue;
-    }
-
-    if (!writer->Write(nextMessage)) {
-      return grpc::Status(grpc::StatusCode::UNKNOWN,
-                          "failed to write to client stream");
-    }
-  }
+  return new service::MessageStreamReactor(
+      peer, subscribeRequest.room(), std::move(messageBroadcaster),
+      std::move(subscription), privateMessageBroadcaster_, deliveryPool_,
+      compressionMinBytes_, drainSource_.get_token(),
+      openLivenessStream(peer));
 }
 
 grpc::Status ChatService::SubscribeClientEvents(
@@ -272,6 +451,7 @@ grpc::Status ChatService::SubscribeClientEvents(
   }
 
   clientEventBroadcaster_->normalizeClientEventIndex(peer);
+  const auto liveness = openLivenessStream(peer);
 
   using namespace std::chrono_literals;
   while (true) {
@@ -289,6 +469,10 @@ grpc::Status ChatService::SubscribeClientEvents(
     }
 
     if (status != domain::NextClientEventStatus::kOk) {
+      if (drainSource_.stop_requested()) {
+        return grpc::Status(grpc::StatusCode::UNAVAILABLE,
+                            kShuttingDownMessage);
+      }
       continue;
     }
 
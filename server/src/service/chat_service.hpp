@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cstddef>
+#include <functional>
 #include <memory>
+#include <stop_token>
+#include <string>
 
 #include <google/protobuf/empty.pb.h>
 #include <grpcpp/grpcpp.h>
@@ -8,47 +12,127 @@
 #include "chat.grpc.pb.h"
 #include "domain/client_event_broadcaster.hpp"
 #include "domain/client_registry.hpp"
+#include "domain/liveness_tracker.hpp"
 #include "domain/message_broadcaster.hpp"
 #include "domain/private_message_broadcaster.hpp"
+#include "domain/pseudonym_arbiter.hpp"
+#include "domain/room_registry.hpp"
+#include "domain/session_store.hpp"
+#include "service/arena_message_allocator.hpp"
+#include "service/delivery_pool.hpp"
+#include "service/dispatch_queue.hpp"
 #include "service/events/chat_service_events_dispatcher.hpp"
-#include "service/validation/message_validation_chain.hpp"
+#include "service/validation/validation_pipeline.hpp"
+#include "service/validation/validators/banned_terms_validator.hpp"
+#include "service/validation/validators/content_validator.hpp"
+#include "service/validation/validators/flood_validator.hpp"
+#include "service/validation/validators/rate_limit_validator.hpp"
 
-class ChatService final : public chat::ChatService::Service {
+// SendMessage uses the callback API so that its request and response
+// messages are allocated on a per-call arena. Connect and SubscribeMessages
+// are raw: a Connect response ends with the roster snapshot's pre-serialized
+// bytes, and streams write each payload's pre-serialized bytes.
+using ChatServiceBase = chat::ChatService::WithRawCallbackMethod_Connect<
+    chat::ChatService::WithCallbackMethod_SendMessage<
+        chat::ChatService::WithRawCallbackMethod_SubscribeMessages<
+            chat::ChatService::Service>>>;
+
+class ChatService final : public ChatServiceBase {
 public:
   ChatService(std::shared_ptr<domain::ClientRegistry> clientRegistry,
-              std::shared_ptr<domain::IMessageBroadcaster> messageBroadcaster,
+              std::shared_ptr<domain::IRoomRegistry> roomRegistry,
               std::shared_ptr<domain::IPrivateMessageBroadcaster> privateMessageBroadcaster,
               std::shared_ptr<domain::IClientEventBroadcaster> clientEventBroadcaster,
-              events::EventDispatcher *eventDispatcher);
+              events::EventDispatcher *eventDispatcher,
+              std::shared_ptr<service::DeliveryPool> deliveryPool,
+              std::shared_ptr<domain::IPseudonymArbiter> pseudonymArbiter = nullptr,
+              std::shared_ptr<domain::SessionStore> sessionStore = nullptr,
+              std::shared_ptr<domain::LivenessTracker> livenessTracker = nullptr,
+              std::shared_ptr<const service::validation::BannedTerms>
+                  bannedTerms = nullptr,
+              std::size_t compressionMinBytes = 0);
   ~ChatService() override;
 
-  grpc::Status Connect(grpc::ServerContext *context,
-                       const chat::ConnectRequest *request,
-                       chat::ConnectResponse *response) override;
+  // Refuses new connects and ends each stream once what is queued for it
+  // has been written; other calls keep being served.
+  void drain();
+
+  grpc::ServerUnaryReactor *Connect(grpc::CallbackServerContext *context,
+                                    const grpc::ByteBuffer *request,
+                                    grpc::ByteBuffer *response) override;
 
   grpc::Status Disconnect(grpc::ServerContext *context,
                           const chat::DisconnectRequest *request,
                           google::protobuf::Empty *response) override;
 
-  grpc::Status SendMessage(grpc::ServerContext *context,
-                           const chat::SendMessageRequest *request,
-                           google::protobuf::Empty *response) override;
+  grpc::ServerUnaryReactor *
+  SendMessage(grpc::CallbackServerContext *context,
+              const chat::SendMessageRequest *request,
+              google::protobuf::Empty *response) override;
 
-  grpc::Status
-  SubscribeMessages(grpc::ServerContext *context,
-                    const chat::InformClientsNewMessageRequest *request,
-                    grpc::ServerWriter<chat::InformClientsNewMessageResponse>
-                        *writer) override;
+  grpc::ServerWriteReactor<grpc::ByteBuffer> *
+  SubscribeMessages(grpc::CallbackServerContext *context,
+                    const grpc::ByteBuffer *request) override;
 
   grpc::Status SubscribeClientEvents(
       grpc::ServerContext *context, const google::protobuf::Empty *request,
       grpc::ServerWriter<chat::ClientEventData> *writer) override;
 
 private:
+  using RosterPtr = std::shared_ptr<const domain::RosterSnapshot>;
+  // Receives the roster to append to the response, null when refused
+  using ConnectDone = std::function<void(RosterPtr)>;
+  using SendDone = std::function<void(grpc::Status)>;
+
+  // Calls `done` once the connect is decided, on the dispatch thread when
+  // it is accepted.
+  void handleConnect(grpc::ServerContextBase *context,
+                     const chat::ConnectRequest *request,
+                     chat::ConnectResponse *response, ConnectDone done);
+
+  RosterPtr acceptConnect(const std::string &peerAddress,
+                          const std::string &resumedPeer,
+                          const chat::ConnectRequest &request,
+                          chat::ConnectResponse *response);
+
+  domain::LivenessTracker::Stream openLivenessStream(const std::string &peer);
+
+  // Calls `done` with the call's status once the message is dispatched or
+  // refused.
+  void handleSendMessage(grpc::ServerContextBase *context,
+                         const chat::SendMessageRequest *request,
+                         google::protobuf::Empty *response, SendDone done);
+
+  service::ArenaMessageAllocator<chat::SendMessageRequest,
+                                 google::protobuf::Empty>
+      sendMessageAllocator_;
+
   std::shared_ptr<domain::ClientRegistry> clientRegistry_;
-  std::shared_ptr<domain::IMessageBroadcaster> messageBroadcaster_;
+  std::shared_ptr<domain::IRoomRegistry> roomRegistry_;
   std::shared_ptr<domain::IPrivateMessageBroadcaster> privateMessageBroadcaster_;
   std::shared_ptr<domain::IClientEventBroadcaster> clientEventBroadcaster_;
   events::EventDispatcher *eventDispatcher_;
-  service::validation::MessageValidationChain validationChain_;
+  // Writes to the message streams
+  std::shared_ptr<service::DeliveryPool> deliveryPool_;
+  // Set in a cluster, where the local registry cannot vouch for uniqueness
+  std::shared_ptr<domain::IPseudonymArbiter> pseudonymArbiter_;
+  // Lets reconnecting clients take their pseudonym back; optional
+  std::shared_ptr<domain::SessionStore> sessionStore_;
+  // Streams keep their client from being reaped as idle; optional
+  std::shared_ptr<domain::LivenessTracker> livenessTracker_;
+  // Cheap checks first: a rejected message does not count against the rate.
+  // The flood check comes last, so that it only counts accepted messages.
+  service::validation::ValidationPipeline<
+      service::validation::ContentValidator,
+      service::validation::BannedTermsValidator,
+      service::validation::RateLimitValidator,
+      service::validation::FloodValidator>
+      validationPipeline_;
+  // Stream messages below it are written uncompressed
+  std::size_t compressionMinBytes_;
+  std::stop_source drainSource_;
+  // Runs the dispatcher's fan-out for connects and messages off the gRPC
+  // callback threads. Declared last so that queued calls complete while
+  // the members they use are alive.
+  service::DispatchQueue dispatchQueue_;
 };
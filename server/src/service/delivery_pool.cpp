@@ -0,0 +1,270 @@
+#include "service/delivery_pool.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <string>
+
+#include "domain/room_registry.hpp"
+
+namespace service {
+
+DeliveryPool::DeliveryPool(Config config) {
+  std::size_t workerCount = config.workers;
+  if (workerCount == 0) {
+    workerCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  const std::size_t partitionCount =
+      workerCount * std::max<std::size_t>(config.partitionsPerWorker, 1);
+
+  partitions_.reserve(partitionCount);
+  for (std::size_t i = 0; i < partitionCount; ++i) {
+    partitions_.push_back(std::make_unique<Partition>());
+  }
+  // Every queue exists before any thread may steal from it
+  workers_.reserve(workerCount);
+  for (std::size_t i = 0; i < workerCount; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (std::size_t i = 0; i < workerCount; ++i) {
+    workers_[i]->thread = std::jthread(
+        [this, i](const std::stop_token &stopToken) { run(i, stopToken); });
+  }
+}
+
+DeliveryPool::~DeliveryPool() { stop(); }
+
+void DeliveryPool::stop() {
+  // All stopped before any is joined: a worker may be stealing from another
+  for (const auto &worker : workers_) {
+    worker->thread.request_stop();
+  }
+  for (const auto &worker : workers_) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+}
+
+std::size_t DeliveryPool::partitionOf(std::string_view peer) const {
+  return std::hash<std::string_view>{}(peer) % partitions_.size();
+}
+
+void DeliveryPool::add(std::string_view peer, std::string_view room,
+                       std::shared_ptr<IDeliveryTarget> target) {
+  const std::size_t index = partitionOf(peer);
+  {
+    Partition &partition = *partitions_[index];
+    std::lock_guard<std::mutex> lock(partition.mutex);
+    partition.targets.push_back(std::move(target));
+  }
+
+  std::lock_guard<std::mutex> lock(roomsMutex_);
+  ++rooms_[domain::RoomRegistry::normalizeRoomId(room)][index];
+}
+
+void DeliveryPool::remove(std::string_view peer, std::string_view room,
+                          const IDeliveryTarget *target) {
+  const std::size_t index = partitionOf(peer);
+  {
+    Partition &partition = *partitions_[index];
+    std::lock_guard<std::mutex> lock(partition.mutex);
+    auto &targets = partition.targets;
+    const auto it = std::find_if(
+        targets.begin(), targets.end(),
+        [target](const auto &entry) { return entry.get() == target; });
+    if (it == targets.end()) {
+      return;
+    }
+    *it = std::move(targets.back());
+    targets.pop_back();
+  }
+
+  std::lock_guard<std::mutex> lock(roomsMutex_);
+  const auto roomIt = rooms_.find(domain::RoomRegistry::normalizeRoomId(room));
+  if (roomIt == rooms_.end()) {
+    return;
+  }
+  auto &partitions = roomIt->second;
+  const auto partitionIt = partitions.find(index);
+  if (partitionIt != partitions.end() && --partitionIt->second == 0) {
+    partitions.erase(partitionIt);
+  }
+  if (partitions.empty()) {
+    rooms_.erase(roomIt);
+  }
+}
+
+void DeliveryPool::wake(std::string_view peer) {
+  schedule(partitionOf(peer), Clock::now());
+}
+
+void DeliveryPool::wakeRoom(std::string_view room) {
+  const auto now = Clock::now();
+  std::lock_guard<std::mutex> lock(roomsMutex_);
+  const auto it = rooms_.find(domain::RoomRegistry::normalizeRoomId(room));
+  if (it == rooms_.end()) {
+    return;
+  }
+  for (const auto &[partition, targets] : it->second) {
+    schedule(partition, now);
+  }
+}
+
+void DeliveryPool::wakeAll() {
+  const auto now = Clock::now();
+  for (std::size_t i = 0; i < partitions_.size(); ++i) {
+    schedule(i, now);
+  }
+}
+
+void DeliveryPool::schedule(std::size_t partition, Clock::time_point now) {
+  Partition &target = *partitions_[partition];
+  // Only the wake that queues the partition stamps it; later ones are
+  // served by the same pass
+  if (target.queued.exchange(true, std::memory_order_acq_rel)) {
+    return;
+  }
+  target.wokenAt.store(now.time_since_epoch().count(),
+                       std::memory_order_relaxed);
+
+  // Counted before it is queued, so that the count never drops below the
+  // partitions actually queued
+  {
+    std::lock_guard<std::mutex> lock(idleMutex_);
+    ++pending_;
+  }
+  Worker &owner = *workers_[partition % workers_.size()];
+  {
+    std::lock_guard<std::mutex> lock(owner.mutex);
+    owner.partitions.push_back(partition);
+  }
+  idleCv_.notify_one();
+}
+
+std::optional<std::size_t> DeliveryPool::take(std::size_t self) {
+  {
+    Worker &own = *workers_[self];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.partitions.empty()) {
+      const auto partition = own.partitions.front();
+      own.partitions.pop_front();
+      return partition;
+    }
+  }
+  for (std::size_t offset = 1; offset < workers_.size(); ++offset) {
+    Worker &victim = *workers_[(self + offset) % workers_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.partitions.empty()) {
+      const auto partition = victim.partitions.back();
+      victim.partitions.pop_back();
+      return partition;
+    }
+  }
+  return std::nullopt;
+}
+
+void DeliveryPool::run(std::size_t self, const std::stop_token &stopToken) {
+  // Reused across passes, so that a pass does not allocate
+  std::vector<std::shared_ptr<IDeliveryTarget>> scratch;
+  while (!stopToken.stop_requested()) {
+    if (const auto partition = take(self)) {
+      --pending_;
+      process(*partition, scratch);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(idleMutex_);
+    idleCv_.wait(lock, stopToken, [this] { return pending_ != 0; });
+  }
+}
+
+void DeliveryPool::process(
+    std::size_t index, std::vector<std::shared_ptr<IDeliveryTarget>> &scratch) {
+  Partition &partition = *partitions_[index];
+  const Clock::time_point wokenAt(
+      Clock::duration(partition.wokenAt.load(std::memory_order_relaxed)));
+  // Cleared first: a wake from here on queues another pass
+  partition.queued.store(false, std::memory_order_release);
+
+  {
+    // Targets are called outside the lock, since ending a stream removes
+    // its target from the partition
+    std::lock_guard<std::mutex> lock(partition.mutex);
+    scratch.assign(partition.targets.begin(), partition.targets.end());
+  }
+  for (const auto &target : scratch) {
+    target->deliver();
+  }
+  scratch.clear();
+
+  record(Clock::now() - wokenAt);
+}
+
+void DeliveryPool::record(Clock::duration latency) {
+  const auto nanoseconds = static_cast<std::uint64_t>(std::max<std::int64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count(),
+      1));
+  histogram_[std::bit_width(nanoseconds) - 1].fetch_add(
+      1, std::memory_order_relaxed);
+
+  auto max = maxLatency_.load(std::memory_order_relaxed);
+  while (latency.count() > max &&
+         !maxLatency_.compare_exchange_weak(max, latency.count(),
+                                            std::memory_order_relaxed)) {
+  }
+}
+
+DeliveryPool::DispatchLatency DeliveryPool::takeDispatchLatency() {
+  // Passes recorded meanwhile land in this window or the next one
+  std::array<std::uint64_t, 64> counts;
+  DispatchLatency stats;
+  for (std::size_t i = 0; i < counts.size(); ++i) {
+    counts[i] = histogram_[i].exchange(0, std::memory_order_relaxed);
+    stats.passes += counts[i];
+  }
+  stats.max =
+      Clock::duration(maxLatency_.exchange(0, std::memory_order_relaxed));
+  if (stats.passes == 0) {
+    return stats;
+  }
+
+  const auto percentile = [&counts, &stats](std::uint64_t rank) {
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+      seen += counts[i];
+      if (seen >= rank) {
+        // Upper bound of the bucket, and never above the actual maximum
+        const std::chrono::nanoseconds bound(
+            (std::int64_t{1} << std::min<std::size_t>(i + 1, 62)) - 1);
+        return std::min<Clock::duration>(
+            std::chrono::duration_cast<Clock::duration>(bound), stats.max);
+      }
+    }
+    return stats.max;
+  };
+  stats.p50 = percentile((stats.passes + 1) / 2);
+  stats.p99 = percentile(stats.passes - stats.passes / 100);
+  return stats;
+}
+
+void DeliveryPool::onClientConnected(
+    [[maybe_unused]] const events::ClientConnectedEvent &event) {}
+
+void DeliveryPool::onClientDisconnected(
+    const events::ClientDisconnectedEvent &event) {
+  // Its stream finds the peer gone and ends
+  wake(event.peer);
+}
+
+void DeliveryPool::onMessageSent(const events::MessageSentEvent &event) {
+  // Streams of other rooms have nothing new
+  wakeRoom(event.room);
+}
+
+void DeliveryPool::onPrivateMessageSent(
+    const events::PrivateMessageSentEvent &event) {
+  // A recipient streaming from another node costs one pass over a partition
+  wake(event.recipientPeer);
+}
+
+} // namespace service
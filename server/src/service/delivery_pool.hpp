@@ -0,0 +1,151 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "service/events/chat_service_events.hpp"
+
+namespace service {
+
+// A stream the pool delivers to.
+class IDeliveryTarget {
+public:
+  virtual ~IDeliveryTarget() = default;
+
+  // Starts writing what is pending for the stream, without blocking.
+  // Called again on every wake of its partition, even with a write in
+  // flight, so it must tell when there is nothing to do.
+  virtual void deliver() = 0;
+};
+
+// Fixed pool of threads pushing messages to subscriber streams.
+//
+// Targets are split into partitions by peer hash, several per worker. A
+// publish wakes the partitions holding subscribers of its room and a private
+// message its recipient's; a woken partition is queued once, however many
+// wakes it gets before a worker reaches it. Each worker has its own queue of
+// partitions and takes from the others' when it runs dry, so a worker stuck
+// on a large partition does not hold the rest back. Workers only start
+// writes: completions come back through the target, which continues on the
+// gRPC thread reporting them.
+class DeliveryPool : public events::IServiceEventObserver {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Config {
+    // 0 for one per hardware thread
+    std::size_t workers = 0;
+    std::size_t partitionsPerWorker = 8;
+  };
+
+  // Dispatch latency: time from a partition's wake until its pass has
+  // started the writes of its targets, over the passes since the last
+  // takeDispatchLatency. Writes complete later, so this is not the time
+  // until a client has the message. Percentiles are rounded up to a power
+  // of two ns.
+  struct DispatchLatency {
+    std::uint64_t passes = 0;
+    Clock::duration p50{};
+    Clock::duration p99{};
+    Clock::duration max{};
+  };
+
+  explicit DeliveryPool(Config config);
+  DeliveryPool() : DeliveryPool(Config{}) {}
+  ~DeliveryPool() override;
+
+  // `room` is the room the target's stream follows, as given by the client.
+  void add(std::string_view peer, std::string_view room,
+           std::shared_ptr<IDeliveryTarget> target);
+  void remove(std::string_view peer, std::string_view room,
+              const IDeliveryTarget *target);
+
+  // Has the targets of `peer`'s partition, of the partitions following
+  // `room`, or of all, deliver.
+  void wake(std::string_view peer);
+  void wakeRoom(std::string_view room);
+  void wakeAll();
+
+  // Joins the workers. Targets are no longer woken afterwards.
+  void stop();
+
+  std::size_t workerCount() const { return workers_.size(); }
+  // Returns the dispatch latencies recorded since the previous call and
+  // starts over
+  DispatchLatency takeDispatchLatency();
+
+  // IServiceEventObserver: wakes the streams with something new to write,
+  // or to end
+  void onClientConnected(const events::ClientConnectedEvent &event) override;
+  void
+  onClientDisconnected(const events::ClientDisconnectedEvent &event) override;
+  void onMessageSent(const events::MessageSentEvent &event) override;
+  void
+  onPrivateMessageSent(const events::PrivateMessageSentEvent &event) override;
+
+  DeliveryPool(const DeliveryPool &) = delete;
+  DeliveryPool &operator=(const DeliveryPool &) = delete;
+  DeliveryPool(DeliveryPool &&) = delete;
+  DeliveryPool &operator=(DeliveryPool &&) = delete;
+
+private:
+  struct Partition {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<IDeliveryTarget>> targets;
+    // Set while the partition waits in a queue
+    std::atomic<bool> queued{false};
+    // Time of the wake that queued it, in Clock ticks
+    std::atomic<Clock::rep> wokenAt{0};
+  };
+
+  struct Worker {
+    std::mutex mutex;
+    std::deque<std::size_t> partitions;
+    std::jthread thread;
+  };
+
+  std::size_t partitionOf(std::string_view peer) const;
+  void schedule(std::size_t partition, Clock::time_point now);
+  // Own queue first, from the front; then the others', from the back
+  std::optional<std::size_t> take(std::size_t self);
+  void run(std::size_t self, const std::stop_token &stopToken);
+  void process(std::size_t partition,
+               std::vector<std::shared_ptr<IDeliveryTarget>> &scratch);
+  void record(Clock::duration latency);
+
+  std::vector<std::unique_ptr<Partition>> partitions_;
+
+  // Targets per partition of each room with a subscriber on this node
+  std::mutex roomsMutex_;
+  std::unordered_map<std::string, std::map<std::size_t, std::size_t>> rooms_;
+
+  // Partitions queued across workers; guarded by idleMutex_ when raised, so
+  // that a worker going idle cannot miss it
+  std::atomic<std::size_t> pending_{0};
+  std::mutex idleMutex_;
+  std::condition_variable_any idleCv_;
+
+  // Dispatch latencies, by power of two ns
+  std::array<std::atomic<std::uint64_t>, 64> histogram_{};
+  std::atomic<Clock::rep> maxLatency_{0};
+
+  // Declared last so that the threads are joined before members go away
+  std::vector<std::unique_ptr<Worker>> workers_;
+};
+
+} // namespace service
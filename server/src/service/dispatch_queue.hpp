@@ -0,0 +1,67 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace service {
+
+// Runs tasks one at a time, in the order they were posted, on a background
+// thread.
+//
+// Keeps the event dispatcher's fan-out off the gRPC callback threads, which
+// must not block. Tasks still queued when the queue is destroyed run before
+// it returns.
+class DispatchQueue {
+public:
+  using Task = std::function<void()>;
+
+  DispatchQueue()
+      : worker_([this](const std::stop_token &stopToken) { run(stopToken); }) {
+  }
+
+  DispatchQueue(const DispatchQueue &) = delete;
+  DispatchQueue &operator=(const DispatchQueue &) = delete;
+  DispatchQueue(DispatchQueue &&) = delete;
+  DispatchQueue &operator=(DispatchQueue &&) = delete;
+
+  void post(Task task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back(std::move(task));
+    }
+    queueCv_.notify_one();
+  }
+
+private:
+  void run(const std::stop_token &stopToken) {
+    std::vector<Task> batch;
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Once stopped, the wait only returns true while tasks remain
+    while (queueCv_.wait(lock, stopToken,
+                         [this] { return !queue_.empty(); })) {
+      batch.swap(queue_);
+      lock.unlock();
+
+      for (auto &task : batch) {
+        task();
+      }
+      batch.clear();
+
+      lock.lock();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable_any queueCv_;
+  std::vector<Task> queue_;
+
+  // Declared last so that the queue is drained before members go away
+  std::jthread worker_;
+};
+
+} // namespace service
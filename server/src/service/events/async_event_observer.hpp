@@ -0,0 +1,132 @@
+#pragma once
+
+#include "service/events/chat_service_events.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace events {
+
+// Forwards events to another observer from a background thread.
+//
+// Meant for observers doing slow work, such as database writes, that should
+// not hold the dispatcher lock every connect and message waits on. Events
+// reach the wrapped observer in notification order; those still queued when
+// the wrapper is destroyed are delivered before it returns.
+class AsyncEventObserver final : public IServiceEventObserver {
+public:
+  explicit AsyncEventObserver(std::shared_ptr<IServiceEventObserver> observer)
+      : observer_(std::move(observer)),
+        worker_([this](const std::stop_token &stopToken) { run(stopToken); }) {
+  }
+
+  AsyncEventObserver(const AsyncEventObserver &) = delete;
+  AsyncEventObserver &operator=(const AsyncEventObserver &) = delete;
+  AsyncEventObserver(AsyncEventObserver &&) = delete;
+  AsyncEventObserver &operator=(AsyncEventObserver &&) = delete;
+
+  void onClientConnected(const ClientConnectedEvent &event) override {
+    enqueue(event);
+  }
+
+  void onClientDisconnected(const ClientDisconnectedEvent &event) override {
+    enqueue(event);
+  }
+
+  void onMessageSent(const MessageSentEvent &event) override {
+    enqueue(event);
+  }
+
+  void onPrivateMessageSent(const PrivateMessageSentEvent &event) override {
+    enqueue(event);
+  }
+
+  // Blocks until every event queued so far has been delivered.
+  void flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const std::uint64_t target = queued_;
+    deliveredCv_.wait(lock, [this, target] { return delivered_ >= target; });
+  }
+
+  // Same, giving up at `deadline`; false when events were still pending.
+  bool flushUntil(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const std::uint64_t target = queued_;
+    return deliveredCv_.wait_until(
+        lock, deadline, [this, target] { return delivered_ >= target; });
+  }
+
+private:
+  using QueuedEvent =
+      std::variant<ClientConnectedEvent, ClientDisconnectedEvent,
+                   MessageSentEvent, PrivateMessageSentEvent>;
+
+  void enqueue(QueuedEvent event) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back(std::move(event));
+      ++queued_;
+    }
+    queueCv_.notify_one();
+  }
+
+  void run(const std::stop_token &stopToken) {
+    std::vector<QueuedEvent> batch;
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Once stopped, the wait only returns true while events remain
+    while (queueCv_.wait(lock, stopToken,
+                         [this] { return !queue_.empty(); })) {
+      batch.swap(queue_);
+      lock.unlock();
+
+      for (const auto &event : batch) {
+        deliver(event);
+      }
+
+      lock.lock();
+      delivered_ += batch.size();
+      batch.clear();
+      deliveredCv_.notify_all();
+    }
+  }
+
+  void deliver(const QueuedEvent &queued) {
+    std::visit(
+        [this](const auto &event) {
+          using Event = std::decay_t<decltype(event)>;
+          if constexpr (std::is_same_v<Event, ClientConnectedEvent>) {
+            observer_->onClientConnected(event);
+          } else if constexpr (std::is_same_v<Event, ClientDisconnectedEvent>) {
+            observer_->onClientDisconnected(event);
+          } else if constexpr (std::is_same_v<Event, MessageSentEvent>) {
+            observer_->onMessageSent(event);
+          } else {
+            observer_->onPrivateMessageSent(event);
+          }
+        },
+        queued);
+  }
+
+  const std::shared_ptr<IServiceEventObserver> observer_;
+
+  std::mutex mutex_;
+  std::condition_variable_any queueCv_;
+  std::condition_variable deliveredCv_;
+  std::vector<QueuedEvent> queue_;
+  std::uint64_t queued_ = 0;
+  std::uint64_t delivered_ = 0;
+
+  // Declared last so that the queue is drained before members go away
+  std::jthread worker_;
+};
+
+} // namespace events
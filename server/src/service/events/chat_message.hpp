@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include <google/protobuf/arena.h>
+#include <grpc/slice.h>
+#include <grpcpp/support/slice.h>
+
+#include "chat.pb.h"
+
+namespace events {
+
+// Immutable chat payload shared by every observer and subscriber stream.
+//
+// The message is built once on an arena whose first block is embedded here,
+// and encoded once into a refcounted slice, so fan-out neither copies the
+// content nor serializes it again for each stream.
+class ChatMessage {
+public:
+  ChatMessage(std::string author, std::string content, std::string room,
+              bool isPrivate)
+      : arena_(makeOptions(initialBlock_)),
+        message_(google::protobuf::Arena::CreateMessage<
+                 chat::InformClientsNewMessageResponse>(&arena_)) {
+    message_->set_author(std::move(author));
+    message_->set_content(std::move(content));
+    message_->set_room(std::move(room));
+    message_->set_isprivate(isPrivate);
+
+    grpc_slice slice = grpc_slice_malloc(message_->ByteSizeLong());
+    message_->SerializeWithCachedSizesToArray(GRPC_SLICE_START_PTR(slice));
+    wire_ = grpc::Slice(slice, grpc::Slice::STEAL_REF);
+  }
+
+  ChatMessage(const ChatMessage &) = delete;
+  ChatMessage &operator=(const ChatMessage &) = delete;
+  ChatMessage(ChatMessage &&) = delete;
+  ChatMessage &operator=(ChatMessage &&) = delete;
+
+  const chat::InformClientsNewMessageResponse &proto() const {
+    return *message_;
+  }
+
+  const std::string &author() const { return message_->author(); }
+  const std::string &content() const { return message_->content(); }
+  const std::string &room() const { return message_->room(); }
+  bool isprivate() const { return message_->isprivate(); }
+
+  // Serialized proto(); a ByteBuffer over it shares the bytes by refcount.
+  const grpc::Slice &wire() const { return wire_; }
+
+private:
+  static constexpr std::size_t kInitialBlockSize = 512;
+
+  static google::protobuf::ArenaOptions
+  makeOptions(std::array<char, kInitialBlockSize> &block) {
+    google::protobuf::ArenaOptions options;
+    options.initial_block = block.data();
+    options.initial_block_size = block.size();
+    return options;
+  }
+
+  // Declared before the arena, which must be destroyed first
+  alignas(std::max_align_t) std::array<char, kInitialBlockSize> initialBlock_;
+  google::protobuf::Arena arena_;
+  chat::InformClientsNewMessageResponse *message_;
+  grpc::Slice wire_;
+};
+
+using ChatMessagePtr = std::shared_ptr<const ChatMessage>;
+
+inline ChatMessagePtr makeChatMessage(std::string author, std::string content,
+                                      std::string room = {},
+                                      bool isPrivate = false) {
+  return std::make_shared<const ChatMessage>(
+      std::move(author), std::move(content), std::move(room), isPrivate);
+}
+
+} // namespace events
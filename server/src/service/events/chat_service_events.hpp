@@ -3,6 +3,8 @@
 #include <chrono>
 #include <string>
 
+#include "service/events/chat_message.hpp"
+
 namespace events {
 
 // Event types representing different gRPC events
@@ -11,6 +13,10 @@ struct ClientConnectedEvent {
   std::string pseudonym;
   std::string gender;
   std::string country;
+  // Node holding the client's stream, empty for this node
+  std::string node;
+  // Peer of the resumed session this connect replaces, if any
+  std::string resumedPeer;
 };
 
 struct ClientDisconnectedEvent {
@@ -22,7 +28,8 @@ struct ClientDisconnectedEvent {
 struct MessageSentEvent {
   std::string peer;
   std::string pseudonym;
-  std::string content;
+  std::string room;
+  ChatMessagePtr message;
 };
 
 struct PrivateMessageSentEvent {
@@ -30,7 +37,9 @@ struct PrivateMessageSentEvent {
   std::string senderPseudonym;
   std::string recipientPeer;
   std::string recipientPseudonym;
-  std::string content;
+  ChatMessagePtr message;
+  // Node holding the recipient's stream, empty for this node
+  std::string recipientNode;
 };
 
 // Simple virtual interface for event observers
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "service/events/chat_service_events.hpp"
+#include "service/events/message_bus.hpp"
 
 #include <memory>
 #include <mutex>
@@ -25,6 +26,12 @@ public:
     observers_.push_back(std::move(observer));
   }
 
+  // Publish every notified event on a bus - does not take ownership
+  void attachMessageBus(std::weak_ptr<IMessageBus> bus) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bus_ = std::move(bus);
+  }
+
   // Notify all observers of a client connection
   void notifyClientConnected(const ClientConnectedEvent &event) {
     std::lock_guard<std::mutex> lock(mutex_);
@@ -33,6 +40,7 @@ public:
         observer->onClientConnected(event);
       }
     }
+    publishLocked(event);
   }
 
   // Notify all observers of a client disconnection
@@ -43,6 +51,7 @@ public:
         observer->onClientDisconnected(event);
       }
     }
+    publishLocked(event);
   }
 
   // Notify all observers of a message sent
@@ -53,6 +62,7 @@ public:
         observer->onMessageSent(event);
       }
     }
+    publishLocked(event);
   }
 
   // Notify all observers of a private message sent
@@ -63,11 +73,20 @@ public:
         observer->onPrivateMessageSent(event);
       }
     }
+    publishLocked(event);
   }
 
 private:
+  // Published under the lock so that other nodes see events in order
+  template <typename Event> void publishLocked(const Event &event) {
+    if (auto bus = bus_.lock()) {
+      bus->publish(event);
+    }
+  }
+
   std::mutex mutex_;
   std::vector<std::weak_ptr<IServiceEventObserver>> observers_;
+  std::weak_ptr<IMessageBus> bus_;
 };
 
 } // namespace events
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "service/events/chat_service_events.hpp"
+
+#include <format>
+#include <iostream>
+
+namespace observers {
+
+// Prints connects, disconnects and messages to the console. Meant to run
+// behind an AsyncEventObserver, so that console writes never hold up a gRPC
+// thread or the dispatcher.
+class ConsoleEventLogger : public events::IServiceEventObserver {
+public:
+  void onClientConnected(const events::ClientConnectedEvent &event) override {
+    std::cout << (event.resumedPeer.empty()
+                      ? std::format("New client '{}' is now connected",
+                                    event.pseudonym)
+                      : std::format("Client '{}' resumed its session",
+                                    event.pseudonym))
+              << std::endl;
+  }
+
+  void
+  onClientDisconnected(const events::ClientDisconnectedEvent &event) override {
+    std::cout << std::format("'{}' is disconnected", event.pseudonym)
+              << std::endl;
+  }
+
+  void onMessageSent(const events::MessageSentEvent &event) override {
+    if (!event.message) {
+      return;
+    }
+    std::cout << std::format("[{}] [{}] {}", event.room, event.pseudonym,
+                             event.message->content())
+              << std::endl;
+  }
+
+  void
+  onPrivateMessageSent(const events::PrivateMessageSentEvent &event) override {
+    if (!event.message) {
+      return;
+    }
+    std::cout << std::format("[{}] -> [{}] (private): {}",
+                             event.senderPseudonym, event.recipientPseudonym,
+                             event.message->content())
+              << std::endl;
+  }
+};
+
+} // namespace observers
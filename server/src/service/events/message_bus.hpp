@@ -0,0 +1,28 @@
+#pragma once
+
+#include "service/events/chat_service_events.hpp"
+
+namespace events {
+
+class EventDispatcher;
+
+// Carries events between server nodes.
+//
+// A dispatcher with an attached bus publishes every event it notifies, after
+// its local observers. Events published by other nodes are delivered to the
+// dispatcher given to start(), which holds the domain observers of this node
+// but no bus, so nothing is echoed back.
+class IMessageBus {
+public:
+  virtual ~IMessageBus() = default;
+
+  virtual void publish(const ClientConnectedEvent &event) = 0;
+  virtual void publish(const ClientDisconnectedEvent &event) = 0;
+  virtual void publish(const MessageSentEvent &event) = 0;
+  virtual void publish(const PrivateMessageSentEvent &event) = 0;
+
+  // Begin delivering remote events; `remote` must outlive the bus.
+  virtual void start(EventDispatcher &remote) = 0;
+};
+
+} // namespace events
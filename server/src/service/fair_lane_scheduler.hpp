@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace service {
+
+// Weighted fair queueing across the lanes of one outbound stream.
+//
+// Start-time fair queueing: each lane has a finish tag that grows by the
+// bytes it writes divided by its weight, and the virtual time is the start
+// tag of the last write. The lane with the earliest start goes next, ties to
+// the lower index. Over a backlog, lanes share the stream in proportion to
+// their weights. A lane found empty restarts at the virtual time, so a
+// message arriving on an idle lane goes right after the write in flight,
+// however deep the other lanes are; callers report a lane idle as soon as
+// its last write leaves it empty, or the debt of that write delays the
+// next arrival. Not thread safe.
+template <std::size_t Lanes> class FairLaneScheduler {
+public:
+  // Weights of 0 count as 1
+  explicit FairLaneScheduler(const std::array<std::uint32_t, Lanes> &weights) {
+    for (std::size_t lane = 0; lane < Lanes; ++lane) {
+      weights_[lane] = std::max<std::uint32_t>(weights[lane], 1);
+    }
+  }
+
+  // Lanes in the order to try them
+  std::array<std::size_t, Lanes> order() const {
+    std::array<std::size_t, Lanes> lanes;
+    for (std::size_t lane = 0; lane < Lanes; ++lane) {
+      lanes[lane] = lane;
+    }
+    std::stable_sort(lanes.begin(), lanes.end(),
+                     [this](std::size_t left, std::size_t right) {
+                       return startOf(left) < startOf(right);
+                     });
+    return lanes;
+  }
+
+  // Records a write of `bytes` from `lane`.
+  void served(std::size_t lane, std::size_t bytes) {
+    virtualTime_ = startOf(lane);
+    finish_[lane] = virtualTime_ + (static_cast<std::uint64_t>(bytes) *
+                                    kScale / weights_[lane]);
+  }
+
+  // Records that `lane` had nothing to write.
+  void idle(std::size_t lane) {
+    finish_[lane] = std::min(finish_[lane], virtualTime_);
+  }
+
+private:
+  // Keeps the division by the weight from rounding small writes to nothing
+  static constexpr std::uint64_t kScale = 1024;
+
+  std::uint64_t startOf(std::size_t lane) const {
+    return std::max(finish_[lane], virtualTime_);
+  }
+
+  std::array<std::uint32_t, Lanes> weights_;
+  std::array<std::uint64_t, Lanes> finish_{};
+  std::uint64_t virtualTime_ = 0;
+};
+
+} // namespace service
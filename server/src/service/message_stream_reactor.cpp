@@ -0,0 +1,190 @@
+#include "service/message_stream_reactor.hpp"
+
+#include <chrono>
+#include <utility>
+
+namespace service {
+
+using namespace std::chrono_literals;
+
+MessageStreamReactor::MessageStreamReactor(
+    std::string_view peer, std::string_view room,
+    std::shared_ptr<domain::IMessageBroadcaster> messageBroadcaster,
+    std::shared_ptr<domain::IMessageSubscription> subscription,
+    std::shared_ptr<domain::IPrivateMessageBroadcaster>
+        privateMessageBroadcaster,
+    std::shared_ptr<DeliveryPool> deliveryPool,
+    std::size_t compressionMinBytes, std::stop_token drainToken,
+    domain::LivenessTracker::Stream liveness)
+    : peer_(peer), room_(room), deliveryPool_(std::move(deliveryPool)),
+      delivery_(std::make_shared<Delivery>(
+          this, peer, std::move(messageBroadcaster), std::move(subscription),
+          std::move(privateMessageBroadcaster), compressionMinBytes,
+          std::move(drainToken))),
+      liveness_(std::move(liveness)) {
+  // Operations started before gRPC binds the stream are queued by the
+  // reactor. The wake writes what was queued before the stream opened.
+  deliveryPool_->add(peer_, room_, delivery_);
+  deliveryPool_->wake(peer_);
+}
+
+void MessageStreamReactor::OnWriteDone(bool ok) { delivery_->writeDone(ok); }
+
+void MessageStreamReactor::OnCancel() { delivery_->cancel(); }
+
+void MessageStreamReactor::OnDone() {
+  deliveryPool_->remove(peer_, room_, delivery_.get());
+  delete this;
+}
+
+MessageStreamReactor::Delivery::Delivery(
+    MessageStreamReactor *reactor, std::string_view peer,
+    std::shared_ptr<domain::IMessageBroadcaster> messageBroadcaster,
+    std::shared_ptr<domain::IMessageSubscription> subscription,
+    std::shared_ptr<domain::IPrivateMessageBroadcaster>
+        privateMessageBroadcaster,
+    std::size_t compressionMinBytes, std::stop_token drainToken)
+    : peer_(peer), messageBroadcaster_(std::move(messageBroadcaster)),
+      subscription_(std::move(subscription)),
+      privateMessageBroadcaster_(std::move(privateMessageBroadcaster)),
+      compressionMinBytes_(compressionMinBytes),
+      drainToken_(std::move(drainToken)), reactor_(reactor) {}
+
+void MessageStreamReactor::Delivery::deliver() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // The write in flight continues on its completion
+  if (reactor_ == nullptr || writing_) {
+    return;
+  }
+
+  const auto next = nextLocked();
+  if (!next) {
+    finishLocked(lock, next.error());
+    return;
+  }
+  if (!*next) {
+    return;
+  }
+
+  writing_ = true;
+  MessageStreamReactor *reactor = reactor_;
+  lock.unlock();
+  reactor->StartWrite(&pendingWrite_, pendingOptions_);
+}
+
+void MessageStreamReactor::Delivery::writeDone(bool ok) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  writing_ = false;
+  if (cancelled_) {
+    finishLocked(lock, grpc::Status::CANCELLED);
+    return;
+  }
+  if (!ok) {
+    finishLocked(lock, grpc::Status(grpc::StatusCode::UNKNOWN,
+                                    writingPrivate_
+                                        ? "failed to write private message "
+                                          "to client stream"
+                                        : "failed to write to client stream"));
+    return;
+  }
+  lock.unlock();
+  deliver();
+}
+
+void MessageStreamReactor::Delivery::cancel() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cancelled_ = true;
+  // Otherwise the write in flight ends the stream on its completion
+  if (!writing_) {
+    finishLocked(lock, grpc::Status::CANCELLED);
+  }
+}
+
+std::expected<bool, grpc::Status>
+MessageStreamReactor::Delivery::nextLocked() {
+  for (const auto lane : lanes_.order()) {
+    auto message = takeLocked(static_cast<Lane>(lane));
+    if (!message) {
+      return std::unexpected(std::move(message.error()));
+    }
+    if (!*message) {
+      lanes_.idle(lane);
+      continue;
+    }
+
+    // Shares the payload's encoded bytes, nothing is serialized here
+    const std::size_t size = (*message)->wire().size();
+    lanes_.served(lane, size);
+    writingPrivate_ = lane == kPrivateLane;
+    // Found empty now rather than on the next try, which only comes once
+    // the room lane has caught up with this write
+    if (writingPrivate_ &&
+        privateMessageBroadcaster_->queueDepth(peer_).value_or(0) == 0) {
+      lanes_.idle(kPrivateLane);
+    }
+    pendingWrite_ = grpc::ByteBuffer(&(*message)->wire(), 1);
+    pendingOptions_ = grpc::WriteOptions();
+    if (size < compressionMinBytes_) {
+      pendingOptions_.set_no_compression();
+    }
+    return true;
+  }
+
+  // Both lanes are empty: the stream is done once the server drains
+  if (drainToken_.stop_requested()) {
+    return std::unexpected(grpc::Status(grpc::StatusCode::UNAVAILABLE,
+                                        "server is shutting down"));
+  }
+  return false;
+}
+
+std::expected<events::ChatMessagePtr, grpc::Status>
+MessageStreamReactor::Delivery::takeLocked(Lane lane) {
+  events::ChatMessagePtr message;
+  if (lane == kPrivateLane) {
+    const domain::NextPrivateMessageStatus status =
+        privateMessageBroadcaster_->nextPrivateMessage(peer_, 0ms, message);
+
+    if (status == domain::NextPrivateMessageStatus::kPeerMissing) {
+      return std::unexpected(grpc::Status(
+          grpc::StatusCode::PERMISSION_DENIED, "client not connected"));
+    }
+
+    if (status == domain::NextPrivateMessageStatus::kOverflow) {
+      return std::unexpected(
+          grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                       "private message queue overflowed"));
+    }
+    return message;
+  }
+
+  // The public lane reads without taking any broadcaster lock
+  const domain::NextMessageStatus status = subscription_->next(message);
+
+  if (status == domain::NextMessageStatus::kPeerMissing) {
+    return std::unexpected(grpc::Status(grpc::StatusCode::PERMISSION_DENIED,
+                                        "client not connected"));
+  }
+
+  if (status == domain::NextMessageStatus::kOverflow) {
+    return std::unexpected(
+        grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                     "client is too slow, message queue overflowed"));
+  }
+  return message;
+}
+
+void MessageStreamReactor::Delivery::finishLocked(
+    std::unique_lock<std::mutex> &lock, grpc::Status status) {
+  MessageStreamReactor *reactor = std::exchange(reactor_, nullptr);
+  lock.unlock();
+  if (reactor == nullptr) {
+    return;
+  }
+
+  // OnDone may run inline and delete the reactor; nothing of it is used
+  // after this
+  reactor->Finish(std::move(status));
+}
+
+} // namespace service
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <string_view>
+
+#include <grpcpp/grpcpp.h>
+
+#include "domain/liveness_tracker.hpp"
+#include "domain/message_broadcaster.hpp"
+#include "domain/private_message_broadcaster.hpp"
+#include "service/delivery_pool.hpp"
+#include "service/fair_lane_scheduler.hpp"
+
+namespace service {
+
+// Server side of one SubscribeMessages stream on the raw callback API.
+//
+// The stream has no thread of its own: the delivery pool has it write
+// whenever its peer may have something new, and each completed write moves
+// on to the next message. Private and public messages are two lanes under
+// weighted fair queueing: a direct message waits for the write in flight
+// at most, whatever the room's backlog, and a burst of direct messages
+// still leaves the room a share of the stream. Each payload's
+// pre-serialized wire bytes are written, so a message is encoded once no
+// matter how many streams deliver it; only messages of at least
+// `compressionMinBytes` may be compressed. The reactor deletes itself once
+// gRPC reports the call as done. When the server drains, the stream ends as
+// soon as everything queued for it has been written.
+class MessageStreamReactor final
+    : public grpc::ServerWriteReactor<grpc::ByteBuffer> {
+public:
+  // `room` is the room `messageBroadcaster` belongs to, `subscription` the
+  // peer's subscription to it
+  MessageStreamReactor(
+      std::string_view peer, std::string_view room,
+      std::shared_ptr<domain::IMessageBroadcaster> messageBroadcaster,
+      std::shared_ptr<domain::IMessageSubscription> subscription,
+      std::shared_ptr<domain::IPrivateMessageBroadcaster>
+          privateMessageBroadcaster,
+      std::shared_ptr<DeliveryPool> deliveryPool,
+      std::size_t compressionMinBytes = 0, std::stop_token drainToken = {},
+      domain::LivenessTracker::Stream liveness = {});
+
+  void OnWriteDone(bool ok) override;
+  void OnCancel() override;
+  void OnDone() override;
+
+private:
+  // What the pool holds of the stream; outlives the reactor while a pool
+  // worker still has it in hand
+  class Delivery final : public IDeliveryTarget {
+  public:
+    Delivery(MessageStreamReactor *reactor, std::string_view peer,
+             std::shared_ptr<domain::IMessageBroadcaster> messageBroadcaster,
+             std::shared_ptr<domain::IMessageSubscription> subscription,
+             std::shared_ptr<domain::IPrivateMessageBroadcaster>
+                 privateMessageBroadcaster,
+             std::size_t compressionMinBytes, std::stop_token drainToken);
+
+    void deliver() override;
+    void writeDone(bool ok);
+    void cancel();
+
+  private:
+    enum Lane : std::size_t { kPrivateLane, kPublicLane, kLaneCount };
+
+    // Shares of the stream when both lanes have a backlog
+    static constexpr std::array<std::uint32_t, kLaneCount> kLaneWeights{4, 1};
+
+    // Takes the next message into pendingWrite_ and returns true, false when
+    // there is none yet, or the status to end the stream with
+    std::expected<bool, grpc::Status> nextLocked();
+    // Null when the lane is empty
+    std::expected<events::ChatMessagePtr, grpc::Status> takeLocked(Lane lane);
+    // Ends the stream unless another call already did
+    void finishLocked(std::unique_lock<std::mutex> &lock, grpc::Status status);
+
+    const std::string peer_;
+    // Keeps the room alive for as long as its subscription
+    const std::shared_ptr<domain::IMessageBroadcaster> messageBroadcaster_;
+    const std::shared_ptr<domain::IMessageSubscription> subscription_;
+    const std::shared_ptr<domain::IPrivateMessageBroadcaster>
+        privateMessageBroadcaster_;
+    const std::size_t compressionMinBytes_;
+    const std::stop_token drainToken_;
+
+    std::mutex mutex_;
+    // Null once Finish is called
+    MessageStreamReactor *reactor_;
+    // Only one write may be in flight; the buffer must outlive it
+    bool writing_ = false;
+    bool writingPrivate_ = false;
+    bool cancelled_ = false;
+    grpc::ByteBuffer pendingWrite_;
+    grpc::WriteOptions pendingOptions_;
+    FairLaneScheduler<kLaneCount> lanes_{kLaneWeights};
+  };
+
+  const std::string peer_;
+  const std::string room_;
+  const std::shared_ptr<DeliveryPool> deliveryPool_;
+  const std::shared_ptr<Delivery> delivery_;
+  // Keeps the client alive for the idle reaper while the stream is open
+  domain::LivenessTracker::Stream liveness_;
+};
+
+} // namespace service
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace service::validation {
+
+// Approximate counts of 64-bit keys in fixed memory: `kDepth` rows of
+// `width` 16-bit counters, one counter per row for each key. A key's count
+// is the smallest of its counters, which other keys can only have raised,
+// so it is never underestimated. Adding only raises the counters at that
+// minimum (conservative update), which keeps collisions from piling up.
+// Keys must be well mixed. Not thread safe.
+class CountMinSketch {
+public:
+  static constexpr std::size_t kDepth = 4;
+
+  // `width` is rounded up to a power of two
+  explicit CountMinSketch(std::size_t width)
+      : mask_(std::bit_ceil(std::max<std::size_t>(width, 1)) - 1),
+        counters_(kDepth * (mask_ + 1), 0) {}
+
+  // Counts one more `key` and returns its new count.
+  std::uint32_t add(std::uint64_t key) {
+    const auto at = slots(key);
+    const auto count = minimum(at);
+    if (count == kMaxCount) {
+      return count;
+    }
+    for (const auto slot : at) {
+      if (counters_[slot] == count) {
+        counters_[slot] = static_cast<std::uint16_t>(count + 1);
+      }
+    }
+    return count + 1;
+  }
+
+  std::uint32_t estimate(std::uint64_t key) const {
+    return minimum(slots(key));
+  }
+
+  void clear() { std::fill(counters_.begin(), counters_.end(), 0); }
+
+private:
+  static constexpr std::uint32_t kMaxCount =
+      std::numeric_limits<std::uint16_t>::max();
+
+  // One counter per row, from the two halves of the key (Kirsch and
+  // Mitzenmacher)
+  std::array<std::size_t, kDepth> slots(std::uint64_t key) const {
+    const auto low = static_cast<std::uint32_t>(key);
+    const auto high = static_cast<std::uint32_t>(key >> 32) | 1;
+    std::array<std::size_t, kDepth> at;
+    for (std::size_t row = 0; row < kDepth; ++row) {
+      at[row] = row * (mask_ + 1) + ((low + row * high) & mask_);
+    }
+    return at;
+  }
+
+  std::uint32_t minimum(const std::array<std::size_t, kDepth> &at) const {
+    std::uint32_t count = kMaxCount;
+    for (const auto slot : at) {
+      count = std::min<std::uint32_t>(count, counters_[slot]);
+    }
+    return count;
+  }
+
+  std::size_t mask_;
+  std::vector<std::uint16_t> counters_;
+};
+
+} // namespace service::validation
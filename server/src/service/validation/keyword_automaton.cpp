@@ -0,0 +1,231 @@
+#include "service/validation/keyword_automaton.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace service::validation {
+namespace {
+
+constexpr std::uint32_t kAbsent = std::numeric_limits<std::uint32_t>::max();
+
+// Bytes that continue a word; non-ASCII ones belong to letters
+bool isWordByte(unsigned char byte) {
+  return (byte >= '0' && byte <= '9') || (byte >= 'a' && byte <= 'z') ||
+         (byte >= 'A' && byte <= 'Z') || byte >= 0x80;
+}
+
+unsigned char foldCase(unsigned char byte) {
+  return byte >= 'A' && byte <= 'Z' ? byte - 'A' + 'a' : byte;
+}
+
+} // namespace
+
+KeywordAutomaton::KeywordAutomaton()
+    : transitions_(1, 0), lengths_(1, 0), outputs_(1, 0) {}
+
+KeywordAutomaton
+KeywordAutomaton::compile(const std::vector<std::string> &keywords) {
+  KeywordAutomaton automaton;
+
+  // Bytes no keyword uses share class 0; a letter's two cases share one
+  std::size_t classCount = 1;
+  for (const auto &keyword : keywords) {
+    for (const char byte : keyword) {
+      auto &cls = automaton.classes_[foldCase(byte)];
+      if (cls == 0) {
+        cls = static_cast<std::uint8_t>(classCount++);
+      }
+    }
+  }
+  for (unsigned char byte = 'A'; byte <= 'Z'; ++byte) {
+    automaton.classes_[byte] = automaton.classes_[foldCase(byte)];
+  }
+  automaton.classCount_ = classCount;
+
+  // Trie of the keywords, in insertion order
+  std::vector<std::uint32_t> trie(classCount, kAbsent);
+  std::vector<std::uint32_t> lengths(1, 0);
+  for (const auto &keyword : keywords) {
+    if (keyword.empty()) {
+      continue;
+    }
+    std::uint32_t state = 0;
+    for (const unsigned char byte : keyword) {
+      const auto at = state * classCount + automaton.classes_[byte];
+      if (trie[at] == kAbsent) {
+        trie[at] = static_cast<std::uint32_t>(lengths.size());
+        lengths.push_back(0);
+        trie.resize(trie.size() + classCount, kAbsent);
+      }
+      state = trie[at];
+    }
+    if (lengths[state] == 0) {
+      lengths[state] = static_cast<std::uint32_t>(keyword.size());
+      ++automaton.keywordCount_;
+      automaton.maxLength_ = std::max(automaton.maxLength_, keyword.size());
+    }
+  }
+
+  // Breadth first numbering
+  const std::size_t stateCount = lengths.size();
+  if (stateCount * classCount >= kMatchBit) {
+    throw std::length_error("keyword list too large");
+  }
+  std::vector<std::uint32_t> order(1, 0);
+  order.reserve(stateCount);
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    for (std::size_t cls = 0; cls < classCount; ++cls) {
+      if (const auto child = trie[order[i] * classCount + cls];
+          child != kAbsent) {
+        order.push_back(child);
+      }
+    }
+  }
+  std::vector<std::uint32_t> renumbered(stateCount);
+  for (std::size_t i = 0; i < stateCount; ++i) {
+    renumbered[order[i]] = static_cast<std::uint32_t>(i);
+  }
+
+  // Missing transitions are those of the failure state, the longest proper
+  // suffix in the trie, whose row is complete since it is shallower
+  auto &transitions = automaton.transitions_;
+  transitions.assign(stateCount * classCount, 0);
+  automaton.lengths_.assign(stateCount, 0);
+  automaton.outputs_.assign(stateCount, 0);
+  std::vector<std::uint32_t> failures(stateCount, 0);
+  for (std::size_t state = 0; state < stateCount; ++state) {
+    automaton.lengths_[state] = lengths[order[state]];
+    const auto failure = failures[state];
+    for (std::size_t cls = 0; cls < classCount; ++cls) {
+      const auto child = trie[order[state] * classCount + cls];
+      if (child == kAbsent) {
+        transitions[state * classCount + cls] =
+            state == 0 ? 0 : transitions[failure * classCount + cls];
+        continue;
+      }
+      const auto next = renumbered[child];
+      transitions[state * classCount + cls] = next;
+      const auto nextFailure =
+          state == 0 ? 0 : transitions[failure * classCount + cls];
+      failures[next] = nextFailure;
+      automaton.outputs_[next] = automaton.lengths_[nextFailure] != 0
+                                     ? nextFailure
+                                     : automaton.outputs_[nextFailure];
+    }
+  }
+
+  // Entries hold the offset of the next state's row, saving the multiply
+  // in the scan, and flag the states where a keyword ends
+  for (auto &next : transitions) {
+    const bool match =
+        automaton.lengths_[next] != 0 || automaton.outputs_[next] != 0;
+    next = static_cast<std::uint32_t>(next * classCount) |
+           (match ? kMatchBit : 0);
+  }
+  return automaton;
+}
+
+bool KeywordAutomaton::matches(std::string_view text) const {
+  // Each step waits on the previous lookup, so longer texts are cut into
+  // segments scanned in lockstep, which overlaps the lookups. A segment
+  // starts one keyword length early, from the root: the states it reaches
+  // from there on are the same as from the start of the text.
+  const std::size_t overlap = maxLength_ == 0 ? 0 : maxLength_ - 1;
+  const std::size_t laneLength = (text.size() + kLanes - 1) / kLanes;
+  if (laneLength < kMinLaneLength || laneLength < overlap) {
+    return scan(text, 0, text.size());
+  }
+
+  std::array<std::size_t, kLanes> positions;
+  std::array<std::size_t, kLanes> ends;
+  std::array<std::uint32_t, kLanes> rows{};
+  for (std::size_t lane = 0; lane < kLanes; ++lane) {
+    positions[lane] = lane == 0 ? 0 : lane * laneLength - overlap;
+    ends[lane] = std::min(text.size(), (lane + 1) * laneLength);
+  }
+
+  const auto *bytes = reinterpret_cast<const unsigned char *>(text.data());
+  // The last lane is the shortest
+  const std::size_t steps = ends[kLanes - 1] - positions[kLanes - 1];
+  for (std::size_t step = 0; step < steps; ++step) {
+    bool found = false;
+    for (std::size_t lane = 0; lane < kLanes; ++lane) {
+      const auto next =
+          transitions_[rows[lane] + classes_[bytes[positions[lane]]]];
+      rows[lane] = next & ~kMatchBit;
+      ++positions[lane];
+      found |= (next & kMatchBit) != 0 &&
+               matchesAt(text, positions[lane],
+                         rows[lane] / static_cast<std::uint32_t>(classCount_));
+    }
+    if (found) {
+      return true;
+    }
+  }
+
+  for (std::size_t lane = 0; lane < kLanes; ++lane) {
+    if (scan(text, positions[lane], ends[lane], rows[lane])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool KeywordAutomaton::scan(std::string_view text, std::size_t begin,
+                            std::size_t end, std::uint32_t row) const {
+  const auto *bytes = reinterpret_cast<const unsigned char *>(text.data());
+  for (std::size_t i = begin; i < end; ++i) {
+    const auto next = transitions_[row + classes_[bytes[i]]];
+    row = next & ~kMatchBit;
+    if ((next & kMatchBit) != 0 &&
+        matchesAt(text, i + 1, row / static_cast<std::uint32_t>(classCount_))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool KeywordAutomaton::matchesAt(std::string_view text, std::size_t end,
+                                 std::uint32_t state) const {
+  const auto *bytes = reinterpret_cast<const unsigned char *>(text.data());
+  const bool endsWord = end == text.size() || !isWordByte(bytes[end]);
+  if (!endsWord) {
+    return false;
+  }
+  // Every keyword ending here: the state's own, then its failure chain's
+  for (auto match = lengths_[state] != 0 ? state : outputs_[state]; match != 0;
+       match = outputs_[match]) {
+    const auto start = end - lengths_[match];
+    if (start == 0 || !isWordByte(bytes[start - 1])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::expected<std::vector<std::string>, std::string>
+loadKeywordList(const std::filesystem::path &file) {
+  std::ifstream in(file);
+  if (!in) {
+    return std::unexpected("cannot open keyword list '" + file.string() + "'");
+  }
+
+  std::vector<std::string> keywords;
+  std::string line;
+  while (std::getline(in, line)) {
+    const auto first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') {
+      continue;
+    }
+    const auto last = line.find_last_not_of(" \t\r");
+    keywords.push_back(line.substr(first, last - first + 1));
+  }
+  if (in.bad()) {
+    return std::unexpected("cannot read keyword list '" + file.string() + "'");
+  }
+  return keywords;
+}
+
+} // namespace service::validation
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace service::validation {
+
+// Finds any of a set of keywords in a text in one pass, whatever the number
+// of keywords. Immutable once compiled, so it can be shared between threads.
+//
+// Keywords are matched as whole words, ignoring ASCII case: "ban" is found
+// in "Ban this" but not in "banner". An Aho-Corasick automaton is compiled
+// into a full transition table, one row per state and one column per class
+// of bytes the keywords use, so that each byte of the text costs one lookup
+// and no failure links are followed. States are numbered breadth first,
+// which keeps the shallow states most texts stay in close together. The
+// table takes 4 bytes per state and class: a few MB for thousands of
+// keywords.
+class KeywordAutomaton {
+public:
+  // Matches nothing
+  KeywordAutomaton();
+
+  // Empty keywords are ignored. Throws std::length_error if the table
+  // would not be addressable.
+  static KeywordAutomaton compile(const std::vector<std::string> &keywords);
+
+  // Whether `text` contains one of the keywords as a whole word
+  bool matches(std::string_view text) const;
+
+  std::size_t keywordCount() const { return keywordCount_; }
+  std::size_t stateCount() const { return lengths_.size(); }
+
+private:
+  // Set on transitions into a state where a keyword ends, itself or a
+  // suffix of it, so that the scan only looks further in that case
+  static constexpr std::uint32_t kMatchBit = 1u << 31;
+  // Segments of a text scanned together, and their minimum length
+  static constexpr std::size_t kLanes = 4;
+  static constexpr std::size_t kMinLaneLength = 16;
+
+  // Whether a keyword ends in [begin, end), reading from `row`
+  bool scan(std::string_view text, std::size_t begin, std::size_t end,
+            std::uint32_t row = 0) const;
+  bool matchesAt(std::string_view text, std::size_t end,
+                 std::uint32_t state) const;
+
+  std::array<std::uint8_t, 256> classes_{};
+  std::size_t classCount_ = 1;
+  // Row `state`, column `class`: the next state, with kMatchBit
+  std::vector<std::uint32_t> transitions_;
+  // Per state, length of the keyword ending there, 0 if none
+  std::vector<std::uint32_t> lengths_;
+  // Per state, the next state on its failure chain where a keyword ends
+  std::vector<std::uint32_t> outputs_;
+  std::size_t keywordCount_ = 0;
+  std::size_t maxLength_ = 0;
+};
+
+// Reads a keyword list: one keyword per line, surrounding blanks trimmed,
+// blank lines and lines starting with '#' skipped.
+std::expected<std::vector<std::string>, std::string>
+loadKeywordList(const std::filesystem::path &file);
+
+} // namespace service::validation
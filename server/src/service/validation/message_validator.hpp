@@ -1,14 +1,17 @@
 #pragma once
 
+#include <concepts>
+
 #include "service/validation/validation_types.hpp"
 
 namespace service::validation {
 
-class IMessageValidator {
-public:
-  virtual ~IMessageValidator() = default;
-
-  virtual ValidationResult validate(const ValidationContext &ctx) = 0;
+// A validation step. Steps are composed at compile time by
+// ValidationPipeline, so they are plain classes rather than an interface.
+template <typename T>
+concept MessageValidator = requires(T &validator,
+                                    const ValidationContext &ctx) {
+  { validator.validate(ctx) } -> std::same_as<ValidationResult>;
 };
 
 } // namespace service::validation
@@ -0,0 +1,344 @@
+#include "service/validation/utf8_scanner.hpp"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CHAT_UTF8_X86 1
+#include <immintrin.h>
+#endif
+
+namespace service::validation {
+namespace {
+
+bool isControl(std::uint8_t byte) {
+  return (byte < 0x20 && byte != '\t') || byte == 0x7F;
+}
+
+Utf8Scan scanScalar(std::string_view text) {
+  Utf8Scan scan;
+  const auto *bytes = reinterpret_cast<const std::uint8_t *>(text.data());
+  const std::size_t size = text.size();
+
+  std::size_t i = 0;
+  while (i < size) {
+    const std::uint8_t lead = bytes[i];
+    ++scan.codePoints;
+    if (lead < 0x80) {
+      scan.hasControl |= isControl(lead);
+      ++i;
+      continue;
+    }
+
+    // Length of the sequence and range of its second byte, which rules out
+    // overlong forms, surrogates and values past U+10FFFF
+    std::size_t length = 0;
+    std::uint8_t low = 0x80;
+    std::uint8_t high = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+      length = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+      length = 3;
+      low = lead == 0xE0 ? 0xA0 : 0x80;
+      high = lead == 0xED ? 0x9F : 0xBF;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+      length = 4;
+      low = lead == 0xF0 ? 0x90 : 0x80;
+      high = lead == 0xF4 ? 0x8F : 0xBF;
+    } else {
+      return {.valid = false};
+    }
+
+    if (size - i < length || bytes[i + 1] < low || bytes[i + 1] > high) {
+      return {.valid = false};
+    }
+    for (std::size_t k = 2; k < length; ++k) {
+      if ((bytes[i + k] & 0xC0) != 0x80) {
+        return {.valid = false};
+      }
+    }
+    // U+0080 to U+009F
+    scan.hasControl |= lead == 0xC2 && bytes[i + 1] < 0xA0;
+    i += length;
+  }
+  return scan;
+}
+
+#ifdef CHAT_UTF8_X86
+
+// Vectorized check after Keiser and Lemire, "Validating UTF-8 in less than
+// one instruction per byte". Each byte is classified together with the one
+// before it through three 16-entry lookups (high and low nibble of the
+// previous byte, high nibble of the current one); every bit of the result
+// is one kind of error, and their AND is non-zero only where a pair is
+// invalid. Continuations owed to a three or four byte lead two or three
+// bytes back are checked separately.
+
+constexpr std::uint8_t kTooShort = 1 << 0;
+constexpr std::uint8_t kTooLong = 1 << 1;
+constexpr std::uint8_t kOverlong3 = 1 << 2;
+constexpr std::uint8_t kTooLarge = 1 << 3;
+constexpr std::uint8_t kSurrogate = 1 << 4;
+constexpr std::uint8_t kOverlong2 = 1 << 5;
+constexpr std::uint8_t kTooLarge1000 = 1 << 6;
+constexpr std::uint8_t kOverlong4 = 1 << 6;
+constexpr std::uint8_t kTwoConts = 1 << 7;
+constexpr std::uint8_t kCarry = kTooShort | kTooLong | kTwoConts;
+
+using Table = std::array<std::uint8_t, 16>;
+
+// By high nibble of the previous byte
+constexpr Table kByte1High = {
+    kTooLong, kTooLong, kTooLong, kTooLong,
+    kTooLong, kTooLong, kTooLong, kTooLong,
+    kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+    kTooShort | kOverlong2,
+    kTooShort,
+    kTooShort | kOverlong3 | kSurrogate,
+    kTooShort | kTooLarge | kTooLarge1000 | kOverlong4};
+
+// By low nibble of the previous byte
+constexpr Table kByte1Low = {
+    kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+    kCarry | kOverlong2,
+    kCarry,
+    kCarry,
+    kCarry | kTooLarge,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000 | kSurrogate,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000};
+
+// By high nibble of the current byte
+constexpr Table kByte2High = {
+    kTooShort, kTooShort, kTooShort, kTooShort,
+    kTooShort, kTooShort, kTooShort, kTooShort,
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4,
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooShort, kTooShort, kTooShort, kTooShort};
+
+// The input runs through the same blocks as full chunks, padded with
+// spaces: ASCII that cuts short a trailing sequence without being a
+// control character. The padding is then taken off the count.
+constexpr std::uint8_t kPadding = ' ';
+
+#define CHAT_TARGET_SSE4 __attribute__((target("sse4.1,popcnt")))
+#define CHAT_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+
+struct Sse4State {
+  __m128i previous;
+  __m128i error;
+  __m128i control;
+  std::size_t codePoints;
+};
+
+CHAT_TARGET_SSE4 inline __m128i lookupSse4(const Table &table,
+                                           __m128i nibbles) {
+  return _mm_shuffle_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(table.data())),
+      nibbles);
+}
+
+CHAT_TARGET_SSE4 inline void scanBlockSse4(Sse4State &state, __m128i input) {
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  const __m128i prev1 = _mm_alignr_epi8(input, state.previous, 15);
+  const __m128i prev2 = _mm_alignr_epi8(input, state.previous, 14);
+  const __m128i prev3 = _mm_alignr_epi8(input, state.previous, 13);
+
+  const __m128i special = _mm_and_si128(
+      _mm_and_si128(
+          lookupSse4(kByte1High,
+                     _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+          lookupSse4(kByte1Low, _mm_and_si128(prev1, nibble))),
+      lookupSse4(kByte2High, _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+  // High bit set where a lead byte two or three back needs a continuation
+  const __m128i owed = _mm_and_si128(
+      _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(char(0xE0 - 0x80))),
+                   _mm_subs_epu8(prev3, _mm_set1_epi8(char(0xF0 - 0x80)))),
+      _mm_set1_epi8(char(0x80)));
+  state.error =
+      _mm_or_si128(state.error, _mm_xor_si128(owed, special));
+
+  const __m128i c0 = _mm_andnot_si128(
+      _mm_cmpeq_epi8(input, _mm_set1_epi8('\t')),
+      _mm_cmpeq_epi8(_mm_min_epu8(input, _mm_set1_epi8(0x1F)), input));
+  const __m128i del = _mm_cmpeq_epi8(input, _mm_set1_epi8(0x7F));
+  const __m128i c1 = _mm_and_si128(
+      _mm_cmpeq_epi8(prev1, _mm_set1_epi8(char(0xC2))),
+      _mm_cmpeq_epi8(_mm_min_epu8(input, _mm_set1_epi8(char(0x9F))), input));
+  state.control = _mm_or_si128(state.control,
+                               _mm_or_si128(c0, _mm_or_si128(del, c1)));
+
+  // Every byte but continuations starts a code point
+  state.codePoints += std::popcount(static_cast<std::uint32_t>(
+      _mm_movemask_epi8(_mm_cmpgt_epi8(input, _mm_set1_epi8(-65)))));
+  state.previous = input;
+}
+
+CHAT_TARGET_SSE4 Utf8Scan scanSse4(std::string_view text) {
+  const __m128i zero = _mm_setzero_si128();
+  Sse4State state{zero, zero, zero, 0};
+  const char *data = text.data();
+  std::size_t offset = 0;
+  for (; offset + 16 <= text.size(); offset += 16) {
+    scanBlockSse4(state, _mm_loadu_si128(
+                             reinterpret_cast<const __m128i *>(data + offset)));
+  }
+
+  const std::size_t rest = text.size() - offset;
+  std::array<char, 16> tail;
+  tail.fill(kPadding);
+  if (rest != 0) {
+    std::memcpy(tail.data(), data + offset, rest);
+  }
+  scanBlockSse4(state, _mm_loadu_si128(
+                           reinterpret_cast<const __m128i *>(tail.data())));
+
+  if (!_mm_testz_si128(state.error, state.error)) {
+    return {.valid = false};
+  }
+  return {.valid = true,
+          .hasControl = !_mm_testz_si128(state.control, state.control),
+          .codePoints = state.codePoints - (16 - rest)};
+}
+
+struct Avx2State {
+  __m256i previous;
+  __m256i error;
+  __m256i control;
+  std::size_t codePoints;
+};
+
+// Shuffles stay within 128-bit lanes, hence the table in both
+CHAT_TARGET_AVX2 inline __m256i lookupAvx2(const Table &table,
+                                           __m256i nibbles) {
+  return _mm256_shuffle_epi8(
+      _mm256_broadcastsi128_si256(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(table.data()))),
+      nibbles);
+}
+
+// The input shifted right by N bytes, continued from the previous block
+template <int N>
+CHAT_TARGET_AVX2 inline __m256i previousAvx2(__m256i input,
+                                             __m256i previous) {
+  return _mm256_alignr_epi8(
+      input, _mm256_permute2x128_si256(previous, input, 0x21), 16 - N);
+}
+
+CHAT_TARGET_AVX2 inline void scanBlockAvx2(Avx2State &state, __m256i input) {
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  const __m256i prev1 = previousAvx2<1>(input, state.previous);
+  const __m256i prev2 = previousAvx2<2>(input, state.previous);
+  const __m256i prev3 = previousAvx2<3>(input, state.previous);
+
+  const __m256i special = _mm256_and_si256(
+      _mm256_and_si256(
+          lookupAvx2(kByte1High,
+                     _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+          lookupAvx2(kByte1Low, _mm256_and_si256(prev1, nibble))),
+      lookupAvx2(kByte2High,
+                 _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+  const __m256i owed = _mm256_and_si256(
+      _mm256_or_si256(
+          _mm256_subs_epu8(prev2, _mm256_set1_epi8(char(0xE0 - 0x80))),
+          _mm256_subs_epu8(prev3, _mm256_set1_epi8(char(0xF0 - 0x80)))),
+      _mm256_set1_epi8(char(0x80)));
+  state.error =
+      _mm256_or_si256(state.error, _mm256_xor_si256(owed, special));
+
+  const __m256i c0 = _mm256_andnot_si256(
+      _mm256_cmpeq_epi8(input, _mm256_set1_epi8('\t')),
+      _mm256_cmpeq_epi8(_mm256_min_epu8(input, _mm256_set1_epi8(0x1F)),
+                        input));
+  const __m256i del = _mm256_cmpeq_epi8(input, _mm256_set1_epi8(0x7F));
+  const __m256i c1 = _mm256_and_si256(
+      _mm256_cmpeq_epi8(prev1, _mm256_set1_epi8(char(0xC2))),
+      _mm256_cmpeq_epi8(_mm256_min_epu8(input, _mm256_set1_epi8(char(0x9F))),
+                        input));
+  state.control = _mm256_or_si256(
+      state.control, _mm256_or_si256(c0, _mm256_or_si256(del, c1)));
+
+  state.codePoints += std::popcount(static_cast<std::uint32_t>(
+      _mm256_movemask_epi8(_mm256_cmpgt_epi8(input, _mm256_set1_epi8(-65)))));
+  state.previous = input;
+}
+
+CHAT_TARGET_AVX2 Utf8Scan scanAvx2(std::string_view text) {
+  const __m256i zero = _mm256_setzero_si256();
+  Avx2State state{zero, zero, zero, 0};
+  const char *data = text.data();
+  std::size_t offset = 0;
+  for (; offset + 32 <= text.size(); offset += 32) {
+    scanBlockAvx2(state, _mm256_loadu_si256(
+                             reinterpret_cast<const __m256i *>(data + offset)));
+  }
+
+  const std::size_t rest = text.size() - offset;
+  std::array<char, 32> tail;
+  tail.fill(kPadding);
+  if (rest != 0) {
+    std::memcpy(tail.data(), data + offset, rest);
+  }
+  scanBlockAvx2(state, _mm256_loadu_si256(
+                           reinterpret_cast<const __m256i *>(tail.data())));
+
+  if (!_mm256_testz_si256(state.error, state.error)) {
+    return {.valid = false};
+  }
+  return {.valid = true,
+          .hasControl = !_mm256_testz_si256(state.control, state.control),
+          .codePoints = state.codePoints - (32 - rest)};
+}
+
+#endif // CHAT_UTF8_X86
+
+} // namespace
+
+Utf8Kernel detectUtf8Kernel() {
+#ifdef CHAT_UTF8_X86
+  static const Utf8Kernel kernel = [] {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+      return Utf8Kernel::Avx2;
+    }
+    if (__builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("popcnt")) {
+      return Utf8Kernel::Sse4;
+    }
+    return Utf8Kernel::Scalar;
+  }();
+  return kernel;
+#else
+  return Utf8Kernel::Scalar;
+#endif
+}
+
+Utf8Scan scanUtf8(std::string_view text) {
+  return scanUtf8(text, detectUtf8Kernel());
+}
+
+Utf8Scan scanUtf8(std::string_view text, Utf8Kernel kernel) {
+  switch (kernel) {
+#ifdef CHAT_UTF8_X86
+  case Utf8Kernel::Avx2:
+    return scanAvx2(text);
+  case Utf8Kernel::Sse4:
+    return scanSse4(text);
+#endif
+  default:
+    return scanScalar(text);
+  }
+}
+
+} // namespace service::validation
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace service::validation {
+
+// Outcome of a single pass over a message
+struct Utf8Scan {
+  bool valid = true;
+  // Both only meaningful when `valid`
+  bool hasControl = false;
+  std::size_t codePoints = 0;
+};
+
+// Instruction sets scanUtf8() can run on, slowest first
+enum class Utf8Kernel { Scalar, Sse4, Avx2 };
+
+// The fastest kernel this CPU supports, detected once
+Utf8Kernel detectUtf8Kernel();
+
+// Checks that `text` is well-formed UTF-8 (no overlong forms, surrogates or
+// code points past U+10FFFF), counts its code points and looks for control
+// characters: C0 other than tab, DEL and C1.
+Utf8Scan scanUtf8(std::string_view text);
+
+// Same, on a given kernel, which must not be faster than the detected one
+Utf8Scan scanUtf8(std::string_view text, Utf8Kernel kernel);
+
+} // namespace service::validation
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <tuple>
+#include <utility>
+
+#include "service/validation/message_validator.hpp"
+
+namespace service::validation {
+
+// Runs its validators in order and stops at the first failure.
+//
+// The steps are members of a tuple and are called through their concrete
+// types, so the whole pipeline inlines into the caller: no virtual call, no
+// shared_ptr and no allocation on the success path.
+template <MessageValidator... Validators> class ValidationPipeline {
+public:
+  // One constructor argument per validator, in order
+  template <typename... Args>
+    requires(sizeof...(Args) == sizeof...(Validators))
+  explicit ValidationPipeline(Args &&...args)
+      : validators_(std::forward<Args>(args)...) {}
+
+  ValidationResult validate(const ValidationContext &ctx) {
+    auto result = ValidationResult::success();
+    std::apply(
+        [&](auto &...validators) {
+          static_cast<void>(((result = validators.validate(ctx)).valid && ...));
+        },
+        validators_);
+    return result;
+  }
+
+private:
+  std::tuple<Validators...> validators_;
+};
+
+} // namespace service::validation
@@ -1,29 +1,48 @@
 #pragma once
 
 #include <chrono>
+#include <cstddef>
 #include <string>
+#include <string_view>
 
 #include <grpcpp/grpcpp.h>
 
 namespace service::validation {
 
+// Borrows everything from the call, valid for the duration of validate()
 struct ValidationContext {
-  std::string peer;
-  std::string pseudonym;
-  std::string content;
+  std::string_view peer;
+  std::string_view pseudonym;
+  std::string_view content;
   std::chrono::steady_clock::time_point timestamp;
 };
 
+// Trivially copyable, so that neither outcome allocates: the error text is
+// a static string, formatted with the broken limit only when reported.
 struct ValidationResult {
   bool valid = true;
-  std::string errorMessage;
   grpc::StatusCode statusCode = grpc::StatusCode::OK;
+  // May contain one "{}", replaced by `limit`
+  std::string_view errorFormat;
+  std::size_t limit = 0;
+
+  static constexpr ValidationResult success() { return {}; }
+
+  static constexpr ValidationResult failure(std::string_view errorFormat,
+                                            grpc::StatusCode code,
+                                            std::size_t limit = 0) {
+    return {.valid = false,
+            .statusCode = code,
+            .errorFormat = errorFormat,
+            .limit = limit};
+  }
 
-  static ValidationResult success() { return {true, "", grpc::StatusCode::OK}; }
-
-  static ValidationResult failure(const std::string &message,
-                                  grpc::StatusCode code) {
-    return {false, message, code};
+  std::string errorMessage() const {
+    std::string message(errorFormat);
+    if (const auto at = message.find("{}"); at != std::string::npos) {
+      message.replace(at, 2, std::to_string(limit));
+    }
+    return message;
   }
 };
 
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "service/validation/keyword_automaton.hpp"
+#include "service/validation/validation_types.hpp"
+
+namespace service::validation {
+
+// Compiled banned terms, swapped as a whole when the list is reloaded.
+// Messages being checked keep the automaton they started with, so a reload
+// never waits for them, nor they for it.
+class BannedTerms {
+public:
+  BannedTerms() : current_(std::make_shared<const KeywordAutomaton>()) {}
+
+  std::shared_ptr<const KeywordAutomaton> current() const {
+    return current_.load(std::memory_order_acquire);
+  }
+
+  void replace(KeywordAutomaton automaton) {
+    current_.store(
+        std::make_shared<const KeywordAutomaton>(std::move(automaton)),
+        std::memory_order_release);
+  }
+
+private:
+  std::atomic<std::shared_ptr<const KeywordAutomaton>> current_;
+};
+
+class BannedTermsValidator {
+public:
+  // Without terms, every message passes
+  explicit BannedTermsValidator(std::shared_ptr<const BannedTerms> terms)
+      : terms_(std::move(terms)) {}
+
+  ValidationResult validate(const ValidationContext &ctx) const {
+    if (terms_ && terms_->current()->matches(ctx.content)) {
+      return ValidationResult::failure("Message contains a banned term",
+                                       grpc::StatusCode::INVALID_ARGUMENT);
+    }
+    return ValidationResult::success();
+  }
+
+private:
+  std::shared_ptr<const BannedTerms> terms_;
+};
+
+} // namespace service::validation
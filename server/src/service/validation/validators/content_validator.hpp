@@ -2,11 +2,12 @@
 
 #include <cstddef>
 
-#include "service/validation/message_validator.hpp"
+#include "service/validation/utf8_scanner.hpp"
+#include "service/validation/validation_types.hpp"
 
 namespace service::validation {
 
-class ContentValidator : public IMessageValidator {
+class ContentValidator {
 public:
   struct Config {
     std::size_t maxLength = 300;
@@ -15,25 +16,49 @@ public:
   ContentValidator() = default;
   explicit ContentValidator(Config config) : config_(config) {}
 
-  ValidationResult validate(const ValidationContext &ctx) override {
-    if (ctx.content.length() < config_.minLength) {
-      return ValidationResult::failure("Message is too short (< " +
-                                           std::to_string(config_.minLength) +
-                                           " characters)",
-                                       grpc::StatusCode::INVALID_ARGUMENT);
+  // Lengths are in code points
+  ValidationResult validate(const ValidationContext &ctx) const {
+    // A code point takes one to four bytes, which settles most lengths
+    // before the scan
+    if (ctx.content.size() < config_.minLength) {
+      return tooShort();
+    }
+    if (ctx.content.size() > 4 * config_.maxLength) {
+      return tooLong();
     }
 
-    if (ctx.content.length() > config_.maxLength) {
-      return ValidationResult::failure("Message is too long (> " +
-                                           std::to_string(config_.maxLength) +
-                                           " characters)",
+    const auto scan = scanUtf8(ctx.content);
+    if (!scan.valid) {
+      return ValidationResult::failure("Message is not valid UTF-8",
                                        grpc::StatusCode::INVALID_ARGUMENT);
     }
+    if (scan.hasControl) {
+      return ValidationResult::failure("Message contains control characters",
+                                       grpc::StatusCode::INVALID_ARGUMENT);
+    }
+    if (scan.codePoints < config_.minLength) {
+      return tooShort();
+    }
+    if (scan.codePoints > config_.maxLength) {
+      return tooLong();
+    }
 
     return ValidationResult::success();
   }
 
 private:
+  ValidationResult tooShort() const {
+    return ValidationResult::failure("Message is too short (< {} characters)",
+                                     grpc::StatusCode::INVALID_ARGUMENT,
+                                     config_.minLength);
+  }
+
+  ValidationResult tooLong() const {
+    return ValidationResult::failure("Message is too long (> {} characters)",
+                                     grpc::StatusCode::INVALID_ARGUMENT,
+                                     config_.maxLength);
+  }
+
   Config config_;
 };
 
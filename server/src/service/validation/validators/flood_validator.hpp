@@ -0,0 +1,126 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <utility>
+
+#include "service/validation/count_min_sketch.hpp"
+#include "service/validation/validation_types.hpp"
+
+namespace service::validation {
+
+// Rejects content repeated within a short window, by one peer or by many.
+//
+// Messages are reduced to a fingerprint: a hash of their letters, digits
+// and non-ASCII bytes, ASCII case folded, so that added spaces or
+// punctuation do not make a new message. Fingerprints are counted in a
+// count-min sketch, alone and combined with the sender, so memory stays
+// fixed however many messages go through. Counts cover the current window
+// and the one before it: content is remembered for one to two windows. Only
+// accepted messages are counted, so it belongs last in a pipeline.
+class FloodValidator {
+public:
+  struct Config {
+    std::chrono::milliseconds window{30000};
+    // Copies of a message one peer may send per window
+    std::uint32_t maxPerPeer = 3;
+    // Copies of a message all peers together may send per window
+    std::uint32_t maxGlobal = 20;
+    // Shorter messages ("ok", "lol") are common to everyone, and only
+    // limited per peer
+    std::size_t minGlobalLength = 16;
+    // Counters per row of each sketch; two sketches of four rows of 16-bit
+    // counters take 1 MB by default
+    std::size_t sketchWidth = std::size_t{1} << 16;
+  };
+
+  FloodValidator() : FloodValidator(Config{}) {}
+  explicit FloodValidator(Config config)
+      : config_(config), current_(config.sketchWidth),
+        previous_(config.sketchWidth) {}
+
+  ValidationResult validate(const ValidationContext &ctx) {
+    const auto [fingerprint, length] = fingerprintOf(ctx.content);
+    const auto peerKey =
+        mix(fingerprint ^ mix(std::hash<std::string_view>{}(ctx.peer)));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    rotateLocked(ctx.timestamp);
+
+    // Both checks pass before either count is raised: a refused copy
+    // counts neither against its sender nor against everyone
+    if (current_.estimate(peerKey) + previous_.estimate(peerKey) >=
+        config_.maxPerPeer) {
+      return ValidationResult::failure("You already sent this message",
+                                       grpc::StatusCode::RESOURCE_EXHAUSTED);
+    }
+    const bool global = length >= config_.minGlobalLength;
+    const auto copies =
+        current_.estimate(fingerprint) + previous_.estimate(fingerprint);
+    if (global && copies >= config_.maxGlobal) {
+      return ValidationResult::failure(
+          "This message has been sent too many times",
+          grpc::StatusCode::RESOURCE_EXHAUSTED);
+    }
+
+    current_.add(peerKey);
+    if (global) {
+      current_.add(fingerprint);
+    }
+    return ValidationResult::success();
+  }
+
+private:
+  // splitmix64 finalizer
+  static std::uint64_t mix(std::uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ULL;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+  }
+
+  // FNV-1a over the bytes that make the text; returns their count too
+  static std::pair<std::uint64_t, std::size_t>
+  fingerprintOf(std::string_view content) {
+    std::uint64_t hash = 0xCBF29CE484222325ULL;
+    std::size_t length = 0;
+    for (const char c : content) {
+      auto byte = static_cast<unsigned char>(c);
+      if (byte >= 'A' && byte <= 'Z') {
+        byte = static_cast<unsigned char>(byte - 'A' + 'a');
+      } else if (byte < 0x80 && !(byte >= 'a' && byte <= 'z') &&
+                 !(byte >= '0' && byte <= '9')) {
+        continue;
+      }
+      hash = (hash ^ byte) * 0x100000001B3ULL;
+      ++length;
+    }
+    return {mix(hash), length};
+  }
+
+  void rotateLocked(std::chrono::steady_clock::time_point now) {
+    if (now - windowStart_ < config_.window) {
+      return;
+    }
+    if (now - windowStart_ < 2 * config_.window) {
+      std::swap(current_, previous_);
+    } else {
+      previous_.clear();
+    }
+    current_.clear();
+    windowStart_ = now;
+  }
+
+  Config config_;
+  std::mutex mutex_;
+  std::chrono::steady_clock::time_point windowStart_;
+  CountMinSketch current_;
+  CountMinSketch previous_;
+};
+
+} // namespace service::validation
@@ -1,38 +1,72 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <cstddef>
+#include <functional>
 #include <mutex>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 
-#include "service/validation/message_validator.hpp"
+#include "service/validation/validation_types.hpp"
 
 namespace service::validation {
 
-class RateLimitValidator : public IMessageValidator {
+class RateLimitValidator {
 public:
   explicit RateLimitValidator(std::chrono::milliseconds minInterval)
       : minInterval_(minInterval) {}
 
-  ValidationResult validate(const ValidationContext &ctx) override {
+  ValidationResult validate(const ValidationContext &ctx) {
     std::lock_guard<std::mutex> lock(mutex_);
 
+    // Looked up by view: only a peer's first message allocates its entry
     auto it = lastMessageTime_.find(ctx.peer);
-    if (it != lastMessageTime_.end()) {
-      const auto elapsed = ctx.timestamp - it->second;
-      if (elapsed < minInterval_) {
-        return ValidationResult::failure("You are sending messages too fast",
-                                         grpc::StatusCode::RESOURCE_EXHAUSTED);
-      }
+    if (it == lastMessageTime_.end()) {
+      lastMessageTime_.emplace(std::string(ctx.peer), ctx.timestamp);
+      pruneLocked(ctx.timestamp);
+      return ValidationResult::success();
     }
 
-    lastMessageTime_[ctx.peer] = ctx.timestamp;
+    const auto elapsed = ctx.timestamp - it->second;
+    if (elapsed < minInterval_) {
+      return ValidationResult::failure("You are sending messages too fast",
+                                       grpc::StatusCode::RESOURCE_EXHAUSTED);
+    }
+    it->second = ctx.timestamp;
     return ValidationResult::success();
   }
 
 private:
+  // Entries older than the interval no longer limit anyone. Dropping them
+  // once the map has doubled keeps it proportional to recent senders, gone
+  // clients included, at an amortized constant cost per message.
+  void pruneLocked(std::chrono::steady_clock::time_point now) {
+    if (lastMessageTime_.size() < pruneAt_) {
+      return;
+    }
+    std::erase_if(lastMessageTime_, [this, now](const auto &entry) {
+      return now - entry.second >= minInterval_;
+    });
+    pruneAt_ = std::max<std::size_t>(kMinPruneSize,
+                                     2 * lastMessageTime_.size());
+  }
+
+  struct StringHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view value) const {
+      return std::hash<std::string_view>{}(value);
+    }
+  };
+
+  static constexpr std::size_t kMinPruneSize = 64;
+
   std::chrono::milliseconds minInterval_;
+  std::size_t pruneAt_ = kMinPruneSize;
   mutable std::mutex mutex_;
-  std::unordered_map<std::string, std::chrono::steady_clock::time_point>
+  std::unordered_map<std::string, std::chrono::steady_clock::time_point,
+                     StringHash, std::equal_to<>>
       lastMessageTime_;
 };
 
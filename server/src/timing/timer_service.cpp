@@ -0,0 +1,98 @@
+#include "timing/timer_service.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace timing {
+
+TimerService::TimerService(Config config)
+    : start_(Clock::now()),
+      tick_(std::max<Clock::duration>(config.tick,
+                                      std::chrono::milliseconds(1))) {
+  thread_ = std::jthread(
+      [this](const std::stop_token &stopToken) { run(stopToken); });
+}
+
+TimerService::~TimerService() { stop(); }
+
+TimerId TimerService::schedule(Clock::duration delay, Callback callback) {
+  return scheduleAfter(ticksIn(delay), std::move(callback), 0);
+}
+
+TimerId TimerService::scheduleEvery(Clock::duration interval,
+                                    Callback callback) {
+  const auto period = std::max<std::uint64_t>(ticksIn(interval), 1);
+  return scheduleAfter(period, std::move(callback), period);
+}
+
+bool TimerService::cancel(TimerId id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return wheel_.cancel(id);
+}
+
+void TimerService::stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  thread_.request_stop();
+  thread_.join();
+}
+
+void TimerService::run(const std::stop_token &stopToken) {
+  std::vector<TimerWheel::Fired> fired;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopToken.stop_requested()) {
+    if (wheel_.empty()) {
+      wakeCv_.wait(lock, stopToken, [this] { return !wheel_.empty(); });
+    } else {
+      // Timers are at least one tick ahead, so nothing new can be due
+      // before the next tick
+      wakeCv_.wait_until(lock, stopToken, start_ + (wheel_.now() + 1) * tick_,
+                         [] { return false; });
+    }
+    if (stopToken.stop_requested()) {
+      break;
+    }
+
+    wheel_.advance(tickAt(Clock::now()), fired);
+    if (fired.empty()) {
+      continue;
+    }
+    lock.unlock();
+    for (auto &timer : fired) {
+      timer.callback();
+    }
+    fired.clear();
+    lock.lock();
+  }
+}
+
+TimerId TimerService::scheduleAfter(std::uint64_t ticks, Callback callback,
+                                    std::uint64_t period) {
+  // The current tick is already under way: counting from the next one never
+  // fires early
+  const auto expiry = tickAt(Clock::now()) + 1 + ticks;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (wheel_.empty()) {
+    // Catches up with the time the thread slept, which costs nothing while
+    // no timer is pending, then wakes it
+    std::vector<TimerWheel::Fired> none;
+    wheel_.advance(tickAt(Clock::now()), none);
+    wakeCv_.notify_one();
+  }
+  return wheel_.schedule(expiry, std::move(callback), period);
+}
+
+std::uint64_t TimerService::ticksIn(Clock::duration duration) const {
+  if (duration <= Clock::duration::zero()) {
+    return 0;
+  }
+  return static_cast<std::uint64_t>((duration + tick_ - Clock::duration(1)) /
+                                    tick_);
+}
+
+std::uint64_t TimerService::tickAt(Clock::time_point now) const {
+  return static_cast<std::uint64_t>((now - start_) / tick_);
+}
+
+} // namespace timing
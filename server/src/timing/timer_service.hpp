@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "timing/timer_wheel.hpp"
+
+namespace timing {
+
+// Runs the server's timeouts and periodic jobs from a single thread.
+//
+// Timers sit in a hierarchical timing wheel, so scheduling and cancelling
+// are O(1) whatever the number pending. The thread wakes once per tick while
+// timers are pending and sleeps otherwise. Callbacks run on that thread,
+// outside the service's lock, and may schedule or cancel timers themselves;
+// a slow callback delays the ones after it.
+class TimerService {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Callback = TimerWheel::Callback;
+
+  struct Config {
+    // Resolution of the timers: delays are rounded up to whole ticks
+    std::chrono::milliseconds tick{10};
+  };
+
+  explicit TimerService(Config config);
+  TimerService() : TimerService(Config{}) {}
+  ~TimerService();
+
+  TimerId schedule(Clock::duration delay, Callback callback);
+
+  // Runs `callback` every `interval`, first after one interval.
+  TimerId scheduleEvery(Clock::duration interval, Callback callback);
+
+  // The timer does not fire after this returns, except once more when it
+  // was already due and its callback is about to run.
+  bool cancel(TimerId id);
+
+  // Joins the thread, waiting for a running callback. Timers still pending
+  // or scheduled afterwards never fire. Must not be called from a callback.
+  void stop();
+
+  TimerService(const TimerService &) = delete;
+  TimerService &operator=(const TimerService &) = delete;
+  TimerService(TimerService &&) = delete;
+  TimerService &operator=(TimerService &&) = delete;
+
+private:
+  TimerId scheduleAfter(std::uint64_t ticks, Callback callback,
+                        std::uint64_t period);
+  void run(const std::stop_token &stopToken);
+  std::uint64_t ticksIn(Clock::duration duration) const;
+  std::uint64_t tickAt(Clock::time_point now) const;
+
+  const Clock::time_point start_;
+  const Clock::duration tick_;
+
+  std::mutex mutex_;
+  std::condition_variable_any wakeCv_;
+  TimerWheel wheel_;
+
+  // Declared last so that the thread is joined before members go away
+  std::jthread thread_;
+};
+
+} // namespace timing
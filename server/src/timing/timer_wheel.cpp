@@ -0,0 +1,145 @@
+#include "timing/timer_wheel.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace timing {
+
+TimerId TimerWheel::schedule(std::uint64_t expiry, Callback callback,
+                             std::uint64_t period) {
+  std::uint32_t index = freeList_;
+  if (index == kNil) {
+    index = static_cast<std::uint32_t>(nodes_.size());
+    nodes_.emplace_back();
+  } else {
+    freeList_ = nodes_[index].next;
+  }
+
+  auto &node = nodes_[index];
+  node.expiry = std::max(expiry, now_ + 1);
+  node.period = period;
+  node.callback = std::move(callback);
+  // Generations skip zero, which marks invalid ids
+  node.generation = node.generation + 1 == 0 ? 1 : node.generation + 1;
+  node.active = true;
+  place(index);
+  ++size_;
+  return {.index = index, .generation = node.generation};
+}
+
+bool TimerWheel::cancel(TimerId id) {
+  if (!id || id.index >= nodes_.size()) {
+    return false;
+  }
+  auto &node = nodes_[id.index];
+  if (!node.active || node.generation != id.generation) {
+    return false;
+  }
+  unlink(id.index);
+  release(id.index);
+  return true;
+}
+
+void TimerWheel::advance(std::uint64_t tick, std::vector<Fired> &fired) {
+  if (size_ == 0) {
+    // Nothing to move down or fire on the way
+    now_ = std::max(now_, tick);
+    return;
+  }
+
+  while (now_ < tick) {
+    ++now_;
+
+    // Each level's slot comes up when the ones below wrap around; its
+    // timers move down before the tick's own slot fires
+    for (std::size_t level = 1; level < kLevels; ++level) {
+      if (((now_ >> (kLevelBits * (level - 1))) & kSlotMask) != 0) {
+        break;
+      }
+      const auto slot = static_cast<std::uint32_t>(
+          level * kSlots + ((now_ >> (kLevelBits * level)) & kSlotMask));
+      for (auto index = take(slot); index != kNil;) {
+        const auto next = nodes_[index].next;
+        place(index);
+        index = next;
+      }
+    }
+
+    const auto slot = static_cast<std::uint32_t>(now_ & kSlotMask);
+    for (auto index = take(slot); index != kNil;) {
+      auto &node = nodes_[index];
+      const auto next = node.next;
+      if (node.expiry > now_) {
+        // Far-out timer that wrapped around the top level
+        place(index);
+      } else if (node.period != 0) {
+        fired.push_back({.id = {.index = index, .generation = node.generation},
+                         .callback = node.callback});
+        node.expiry = now_ + node.period;
+        place(index);
+      } else {
+        fired.push_back({.id = {.index = index, .generation = node.generation},
+                         .callback = std::move(node.callback)});
+        release(index);
+      }
+      index = next;
+    }
+  }
+}
+
+void TimerWheel::place(std::uint32_t index) {
+  const std::uint64_t expiry = nodes_[index].expiry;
+  const std::uint64_t distance = expiry - now_;
+
+  std::size_t level = 0;
+  while (level + 1 < kLevels &&
+         distance >= (std::uint64_t{1} << (kLevelBits * (level + 1)))) {
+    ++level;
+  }
+  // Beyond the span, park in the top level slot furthest away
+  const std::uint64_t position =
+      distance < kSpan ? expiry : now_ + kSpan - 1;
+  link(index, static_cast<std::uint32_t>(
+                  level * kSlots +
+                  ((position >> (kLevelBits * level)) & kSlotMask)));
+}
+
+void TimerWheel::link(std::uint32_t index, std::uint32_t slot) {
+  auto &node = nodes_[index];
+  node.slot = slot;
+  node.prev = kNil;
+  node.next = heads_[slot];
+  if (node.next != kNil) {
+    nodes_[node.next].prev = index;
+  }
+  heads_[slot] = index;
+}
+
+void TimerWheel::unlink(std::uint32_t index) {
+  auto &node = nodes_[index];
+  if (node.prev != kNil) {
+    nodes_[node.prev].next = node.next;
+  } else {
+    heads_[node.slot] = node.next;
+  }
+  if (node.next != kNil) {
+    nodes_[node.next].prev = node.prev;
+  }
+  node.prev = kNil;
+  node.next = kNil;
+}
+
+void TimerWheel::release(std::uint32_t index) {
+  auto &node = nodes_[index];
+  node.active = false;
+  node.callback = nullptr;
+  node.next = freeList_;
+  freeList_ = index;
+  --size_;
+}
+
+std::uint32_t TimerWheel::take(std::uint32_t slot) {
+  return std::exchange(heads_[slot], kNil);
+}
+
+} // namespace timing
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace timing {
+
+// Identifies a scheduled timer; stays invalid once the timer is gone, even
+// if its storage is reused.
+struct TimerId {
+  std::uint32_t index = 0;
+  // Zero for the default, invalid id
+  std::uint32_t generation = 0;
+
+  explicit operator bool() const { return generation != 0; }
+  bool operator==(const TimerId &) const = default;
+};
+
+// Hierarchical timing wheel counting in abstract ticks. Not thread safe.
+//
+// Four levels of 64 slots cover 2^24 ticks: a timer goes in the coarsest
+// level its distance needs, and moves one level down each time that level's
+// slot comes up, so it is handled at most four times before it fires.
+// Timers are linked into their slot through indices into a node pool, which
+// makes scheduling and cancelling O(1) without allocating once the pool has
+// grown. Timers further out wait in the top level and are placed again when
+// they come up.
+class TimerWheel {
+public:
+  using Callback = std::function<void()>;
+
+  struct Fired {
+    TimerId id;
+    Callback callback;
+  };
+
+  explicit TimerWheel(std::uint64_t now = 0) : now_(now) { heads_.fill(kNil); }
+
+  // Runs `callback` at `expiry`, then every `period` ticks when not zero.
+  // Expiries already passed fire on the next tick.
+  TimerId schedule(std::uint64_t expiry, Callback callback,
+                   std::uint64_t period = 0);
+
+  // False when the timer already fired (for one-shot timers) or was
+  // cancelled.
+  bool cancel(TimerId id);
+
+  // Moves to `tick` and appends the timers that fired on the way, tick by
+  // tick. Periodic timers are scheduled again before they are returned.
+  void advance(std::uint64_t tick, std::vector<Fired> &fired);
+
+  std::uint64_t now() const { return now_; }
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+private:
+  static constexpr unsigned kLevelBits = 6;
+  static constexpr std::size_t kSlots = std::size_t{1} << kLevelBits;
+  static constexpr std::size_t kLevels = 4;
+  static constexpr std::uint64_t kSlotMask = kSlots - 1;
+  static constexpr std::uint64_t kSpan = std::uint64_t{1}
+                                         << (kLevelBits * kLevels);
+  static constexpr std::uint32_t kNil = UINT32_MAX;
+
+  struct Node {
+    std::uint64_t expiry = 0;
+    std::uint64_t period = 0;
+    Callback callback;
+    std::uint32_t generation = 0;
+    std::uint32_t slot = 0;
+    std::uint32_t prev = kNil;
+    // Next in the slot, or in the free list
+    std::uint32_t next = kNil;
+    bool active = false;
+  };
+
+  void place(std::uint32_t index);
+  void link(std::uint32_t index, std::uint32_t slot);
+  void unlink(std::uint32_t index);
+  void release(std::uint32_t index);
+  // Unlinks a slot's timers and returns the first; the rest follow `next`
+  std::uint32_t take(std::uint32_t slot);
+
+  std::uint64_t now_;
+  std::size_t size_ = 0;
+  std::array<std::uint32_t, kSlots * kLevels> heads_;
+  std::vector<Node> nodes_;
+  std::uint32_t freeList_ = kNil;
+};
+
+} // namespace timing
@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+
+#include "cluster/event_codec.hpp"
+
+#include <cstdint>
+#include <string>
+#include <variant>
+
+namespace cluster {
+namespace {
+
+template <typename Event>
+Event roundTrip(const Event &event, std::uint64_t sequence = 1) {
+  std::string frame;
+  encodeEvent(event, sequence, frame);
+
+  const auto bodySize = frameBodySize(frame);
+  EXPECT_TRUE(bodySize.has_value());
+  EXPECT_EQ(frame.size(), kFrameHeaderSize + *bodySize);
+
+  auto decoded = decodeEvent(std::string_view(frame).substr(kFrameHeaderSize));
+  EXPECT_TRUE(decoded.has_value());
+  EXPECT_EQ(decoded->sequence, sequence);
+  EXPECT_TRUE(std::holds_alternative<Event>(decoded->event));
+  return std::get<Event>(decoded->event);
+}
+
+TEST(EventCodecTest, ClientConnected_RoundTripsWithoutNode) {
+  const auto decoded = roundTrip(events::ClientConnectedEvent{
+      .peer = "ipv4:127.0.0.1:5000",
+      .pseudonym = "alice",
+      .gender = "female",
+      .country = "FR",
+      .node = "host:42",
+      .resumedPeer = "resume:alice",
+  });
+
+  EXPECT_EQ(decoded.peer, "ipv4:127.0.0.1:5000");
+  EXPECT_EQ(decoded.pseudonym, "alice");
+  EXPECT_EQ(decoded.gender, "female");
+  EXPECT_EQ(decoded.country, "FR");
+  EXPECT_EQ(decoded.resumedPeer, "resume:alice");
+  // The receiving bus knows the sender from the link's hello
+  EXPECT_TRUE(decoded.node.empty());
+}
+
+TEST(EventCodecTest, ClientDisconnected_RoundTrips) {
+  const auto decoded = roundTrip(events::ClientDisconnectedEvent{
+      .peer = "peer1",
+      .pseudonym = "bob",
+      .connectionDuration = std::chrono::seconds(42),
+  });
+
+  EXPECT_EQ(decoded.peer, "peer1");
+  EXPECT_EQ(decoded.pseudonym, "bob");
+  EXPECT_EQ(decoded.connectionDuration, std::chrono::seconds(42));
+}
+
+TEST(EventCodecTest, MessageSent_RoundTripsPayload) {
+  const auto decoded = roundTrip(events::MessageSentEvent{
+      .peer = "peer1",
+      .pseudonym = "alice",
+      .room = "lobby",
+      .message = events::makeChatMessage("alice", "Hello", "lobby"),
+  });
+
+  EXPECT_EQ(decoded.peer, "peer1");
+  EXPECT_EQ(decoded.pseudonym, "alice");
+  EXPECT_EQ(decoded.room, "lobby");
+  ASSERT_NE(decoded.message, nullptr);
+  EXPECT_EQ(decoded.message->author(), "alice");
+  EXPECT_EQ(decoded.message->content(), "Hello");
+  EXPECT_EQ(decoded.message->room(), "lobby");
+  EXPECT_FALSE(decoded.message->isprivate());
+}
+
+TEST(EventCodecTest, PrivateMessageSent_RoundTripsPayload) {
+  const auto decoded = roundTrip(events::PrivateMessageSentEvent{
+      .senderPeer = "peer1",
+      .senderPseudonym = "alice",
+      .recipientPeer = "peer2",
+      .recipientPseudonym = "bob",
+      .message = events::makeChatMessage("alice", "Psst", {}, true),
+  });
+
+  EXPECT_EQ(decoded.senderPeer, "peer1");
+  EXPECT_EQ(decoded.senderPseudonym, "alice");
+  EXPECT_EQ(decoded.recipientPeer, "peer2");
+  EXPECT_EQ(decoded.recipientPseudonym, "bob");
+  ASSERT_NE(decoded.message, nullptr);
+  EXPECT_EQ(decoded.message->content(), "Psst");
+  EXPECT_TRUE(decoded.message->isprivate());
+}
+
+TEST(EventCodecTest, NodeHello_RoundTrips) {
+  const auto decoded = roundTrip(NodeHello{.nodeId = "host:42"}, 0);
+
+  EXPECT_EQ(decoded.nodeId, "host:42");
+}
+
+TEST(EventCodecTest, PresenceSnapshot_RoundTripsEveryClient) {
+  const auto decoded = roundTrip(
+      PresenceSnapshot{.clients = {{.peer = "peer1", .pseudonym = "alice"},
+                                   {.peer = "peer2", .pseudonym = "bob"}}},
+      7);
+
+  ASSERT_EQ(decoded.clients.size(), 2);
+  EXPECT_EQ(decoded.clients[0].pseudonym, "alice");
+  EXPECT_EQ(decoded.clients[1].peer, "peer2");
+  EXPECT_TRUE(roundTrip(PresenceSnapshot{}).clients.empty());
+}
+
+TEST(EventCodecTest, ClaimMessages_RoundTrip) {
+  std::string frame;
+  encodeEvent(ClaimMessage(PseudonymClaimReply{
+                  .requestId = 3,
+                  .pseudonym = "alice",
+                  .result = domain::ClaimResult::kTaken,
+                  .token = 9}),
+              0, frame);
+  auto decoded = decodeEvent(std::string_view(frame).substr(kFrameHeaderSize));
+  ASSERT_TRUE(decoded.has_value());
+
+  const auto message = takeClaimMessage(decoded->event);
+  ASSERT_TRUE(message.has_value());
+  const auto &reply = std::get<PseudonymClaimReply>(*message);
+  EXPECT_EQ(reply.requestId, 3);
+  EXPECT_EQ(reply.pseudonym, "alice");
+  EXPECT_EQ(reply.result, domain::ClaimResult::kTaken);
+  EXPECT_EQ(reply.token, 9);
+
+  const auto claim = roundTrip(PseudonymClaim{
+      .requestId = 4, .pseudonym = "bob", .peer = "peer1", .token = 2});
+  EXPECT_EQ(claim.peer, "peer1");
+  EXPECT_EQ(claim.token, 2);
+  const auto release = roundTrip(
+      PseudonymRelease{.pseudonym = "bob", .peer = "peer1", .token = 2});
+  EXPECT_EQ(release.pseudonym, "bob");
+
+  RelayedEvent event = events::MessageSentEvent{};
+  EXPECT_FALSE(takeClaimMessage(event).has_value());
+}
+
+TEST(EventCodecTest, OriginNode_IsSetOnConnectedClients) {
+  RelayedEvent event =
+      PresenceSnapshot{.clients = {{.peer = "peer1", .pseudonym = "alice"}}};
+  setOriginNode(event, "host:42");
+  EXPECT_EQ(std::get<PresenceSnapshot>(event).clients[0].node, "host:42");
+
+  event = events::ClientConnectedEvent{.peer = "peer1", .pseudonym = "a"};
+  setOriginNode(event, "host:42");
+  EXPECT_EQ(std::get<events::ClientConnectedEvent>(event).node, "host:42");
+}
+
+TEST(EventCodecTest, MessageSent_WithoutPayloadStaysEmpty) {
+  const auto decoded =
+      roundTrip(events::MessageSentEvent{.peer = "peer1", .pseudonym = "a"});
+
+  EXPECT_EQ(decoded.message, nullptr);
+}
+
+TEST(EventCodecTest, FramesAppendBackToBack) {
+  std::string buffer;
+  encodeEvent(events::ClientConnectedEvent{.peer = "p1", .pseudonym = "a"}, 1,
+              buffer);
+  encodeEvent(events::ClientDisconnectedEvent{.peer = "p1", .pseudonym = "a"},
+              2, buffer);
+
+  std::string_view view(buffer);
+  const auto first = frameBodySize(view);
+  ASSERT_TRUE(first.has_value());
+  view.remove_prefix(kFrameHeaderSize + *first);
+
+  const auto second = frameBodySize(view);
+  ASSERT_TRUE(second.has_value());
+  const auto decoded = decodeEvent(view.substr(kFrameHeaderSize, *second));
+  ASSERT_TRUE(decoded.has_value());
+  EXPECT_EQ(decoded->sequence, 2);
+  EXPECT_TRUE(
+      std::holds_alternative<events::ClientDisconnectedEvent>(decoded->event));
+}
+
+TEST(EventCodecTest, TruncatedBody_IsRejected) {
+  std::string frame;
+  encodeEvent(events::ClientConnectedEvent{.peer = "peer1", .pseudonym = "a"}, 1,
+              frame);
+  const std::string_view body = std::string_view(frame).substr(kFrameHeaderSize);
+
+  EXPECT_FALSE(decodeEvent(body.substr(0, body.size() - 1)).has_value());
+  EXPECT_FALSE(decodeEvent({}).has_value());
+  EXPECT_FALSE(frameBodySize("ab").has_value());
+}
+
+TEST(EventCodecTest, UnknownKind_IsRejected) {
+  const std::string body(1, '\x7f');
+  EXPECT_FALSE(decodeEvent(body).has_value());
+}
+
+} // namespace
+} // namespace cluster
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include "cluster/hash_ring.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cluster {
+namespace {
+
+std::vector<std::string> makeKeys(std::size_t count) {
+  std::vector<std::string> keys;
+  for (std::size_t i = 0; i < count; ++i) {
+    keys.push_back("user" + std::to_string(i));
+  }
+  return keys;
+}
+
+HashRing makeRing(std::size_t nodes) {
+  HashRing ring;
+  for (std::size_t i = 0; i < nodes; ++i) {
+    ring.addNode("node" + std::to_string(i));
+  }
+  return ring;
+}
+
+TEST(HashRingTest, EmptyRing_HasNoOwner) {
+  HashRing ring;
+  EXPECT_TRUE(ring.ownerOf("alice").empty());
+}
+
+TEST(HashRingTest, Owner_DoesNotDependOnInsertionOrder) {
+  HashRing forward;
+  forward.addNode("a");
+  forward.addNode("b");
+  forward.addNode("c");
+  HashRing backward;
+  backward.addNode("c");
+  backward.addNode("b");
+  backward.addNode("a");
+  backward.addNode("a");
+
+  EXPECT_EQ(forward.nodes(), backward.nodes());
+  for (const auto &key : makeKeys(1000)) {
+    EXPECT_EQ(forward.ownerOf(key), backward.ownerOf(key));
+  }
+}
+
+TEST(HashRingTest, Keys_AreSpreadAcrossNodes) {
+  const HashRing ring = makeRing(4);
+  std::map<std::string, std::size_t> owned;
+  for (const auto &key : makeKeys(10000)) {
+    ++owned[ring.ownerOf(key)];
+  }
+
+  ASSERT_EQ(owned.size(), 4);
+  for (const auto &[node, count] : owned) {
+    EXPECT_GT(count, 1500) << node;
+    EXPECT_LT(count, 3500) << node;
+  }
+}
+
+TEST(HashRingTest, AddedNode_OnlyTakesKeysOver) {
+  const HashRing before = makeRing(4);
+  const HashRing after = makeRing(5);
+
+  std::size_t moved = 0;
+  const auto keys = makeKeys(10000);
+  for (const auto &key : keys) {
+    if (before.ownerOf(key) != after.ownerOf(key)) {
+      EXPECT_EQ(after.ownerOf(key), "node4");
+      ++moved;
+    }
+  }
+  // About a fifth of the keys move, all of them to the new node
+  EXPECT_GT(moved, keys.size() / 10);
+  EXPECT_LT(moved, keys.size() * 3 / 10);
+}
+
+TEST(HashRingTest, RemovedNode_RestoresPreviousOwners) {
+  const HashRing before = makeRing(4);
+  HashRing ring = makeRing(5);
+  ring.removeNode("node4");
+
+  EXPECT_EQ(ring.nodes(), before.nodes());
+  for (const auto &key : makeKeys(1000)) {
+    EXPECT_EQ(ring.ownerOf(key), before.ownerOf(key));
+  }
+}
+
+} // namespace
+} // namespace cluster
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include "cluster/loopback_message_bus.hpp"
+#include "domain/client_registry.hpp"
+#include "domain/private_message_broadcaster.hpp"
+#include "mock/mock_service_event_observer.hpp"
+
+#include <chrono>
+#include <memory>
+
+namespace cluster {
+namespace {
+
+using namespace std::chrono_literals;
+
+// One server node: local and remote dispatchers over the same domain state
+struct Node {
+  Node(const std::shared_ptr<LoopbackMessageBus::Hub> &hub,
+       const std::string &nodeId)
+      : bus(std::make_shared<LoopbackMessageBus>(hub, nodeId)) {
+    local.registerObserver(registry);
+    local.registerObserver(privateMessages);
+    local.registerObserver(localObserver);
+    remote.registerObserver(registry);
+    remote.registerObserver(privateMessages);
+    remote.registerObserver(remoteObserver);
+    bus->start(remote);
+    local.attachMessageBus(bus);
+  }
+
+  void connect(const std::string &peer, const std::string &pseudonym) {
+    local.notifyClientConnected({.peer = peer, .pseudonym = pseudonym});
+  }
+
+  std::shared_ptr<domain::ClientRegistry> registry =
+      std::make_shared<domain::ClientRegistry>();
+  std::shared_ptr<domain::PrivateMessageBroadcaster> privateMessages =
+      std::make_shared<domain::PrivateMessageBroadcaster>(*registry);
+  std::shared_ptr<mock::MockServiceEventObserver> localObserver =
+      std::make_shared<mock::MockServiceEventObserver>();
+  std::shared_ptr<mock::MockServiceEventObserver> remoteObserver =
+      std::make_shared<mock::MockServiceEventObserver>();
+  events::EventDispatcher local;
+  events::EventDispatcher remote;
+  std::shared_ptr<LoopbackMessageBus> bus;
+};
+
+class LoopbackMessageBusTest : public ::testing::Test {
+protected:
+  std::shared_ptr<LoopbackMessageBus::Hub> hub_ =
+      std::make_shared<LoopbackMessageBus::Hub>();
+  Node first_{hub_, "first"};
+  Node second_{hub_, "second"};
+  Node third_{hub_, "third"};
+};
+
+TEST_F(LoopbackMessageBusTest, Events_ReachEveryOtherNode) {
+  first_.connect("peer1", "alice");
+
+  EXPECT_TRUE(first_.remoteObserver->clientConnectedEvents.empty());
+  ASSERT_EQ(second_.remoteObserver->clientConnectedEvents.size(), 1);
+  ASSERT_EQ(third_.remoteObserver->clientConnectedEvents.size(), 1);
+  EXPECT_EQ(second_.remoteObserver->clientConnectedEvents[0].node, "first");
+  EXPECT_TRUE(first_.localObserver->clientConnectedEvents[0].node.empty());
+}
+
+TEST_F(LoopbackMessageBusTest, Roster_IsSharedAcrossNodes) {
+  first_.connect("peer1", "alice");
+  second_.connect("peer2", "bob");
+
+  std::string peer;
+  ASSERT_TRUE(first_.registry->getPeerForPseudonym("bob", peer));
+  EXPECT_EQ(peer, "peer2");
+  EXPECT_TRUE(first_.registry->isRemotePeer("peer2"));
+  EXPECT_FALSE(second_.registry->isRemotePeer("peer2"));
+  EXPECT_FALSE(third_.registry->isPseudonymAvailable("peer3", "alice"));
+
+  const auto location = third_.registry->locate("bob");
+  ASSERT_TRUE(location.has_value());
+  EXPECT_EQ(location->peer, "peer2");
+  EXPECT_EQ(location->node, "second");
+  EXPECT_TRUE(second_.registry->locate("bob")->node.empty());
+  EXPECT_FALSE(third_.registry->locate("carol").has_value());
+
+  second_.local.notifyClientDisconnected(
+      {.peer = "peer2", .pseudonym = "bob", .connectionDuration = 1s});
+  EXPECT_FALSE(first_.registry->isPeerConnected("peer2"));
+}
+
+TEST_F(LoopbackMessageBusTest, PrivateMessage_IsQueuedOnRecipientNodeOnly) {
+  first_.connect("peer1", "alice");
+  second_.connect("peer2", "bob");
+
+  second_.local.notifyPrivateMessageSent(
+      {.senderPeer = "peer2",
+       .senderPseudonym = "bob",
+       .recipientPeer = "peer1",
+       .recipientPseudonym = "alice",
+       .message = events::makeChatMessage("bob", "hi alice", {}, true),
+       .recipientNode = "first"});
+
+  events::ChatMessagePtr received;
+  EXPECT_EQ(first_.privateMessages->nextPrivateMessage("peer1", 0ms, received),
+            domain::NextPrivateMessageStatus::kOk);
+  ASSERT_NE(received, nullptr);
+  EXPECT_EQ(received->content(), "hi alice");
+  EXPECT_FALSE(second_.privateMessages->queueDepth("peer1").has_value());
+  EXPECT_FALSE(third_.privateMessages->queueDepth("peer1").has_value());
+  // Only the recipient's node is sent the message
+  EXPECT_EQ(first_.remoteObserver->privateMessageSentEvents.size(), 1);
+  EXPECT_TRUE(third_.remoteObserver->privateMessageSentEvents.empty());
+}
+
+TEST_F(LoopbackMessageBusTest, PrivateMessage_ToLocalRecipientStaysLocal) {
+  first_.connect("peer1", "alice");
+  first_.connect("peer2", "bob");
+
+  first_.local.notifyPrivateMessageSent(
+      {.senderPeer = "peer2",
+       .senderPseudonym = "bob",
+       .recipientPeer = "peer1",
+       .recipientPseudonym = "alice",
+       .message = events::makeChatMessage("bob", "hi alice", {}, true)});
+
+  EXPECT_EQ(first_.privateMessages->queueDepth("peer1"), 1U);
+  EXPECT_TRUE(second_.remoteObserver->privateMessageSentEvents.empty());
+  EXPECT_TRUE(third_.remoteObserver->privateMessageSentEvents.empty());
+}
+
+TEST_F(LoopbackMessageBusTest, DestroyedNode_StopsReceiving) {
+  {
+    Node transient(hub_, "transient");
+    first_.connect("peer1", "alice");
+    EXPECT_EQ(transient.remoteObserver->totalEventsReceived(), 1);
+  }
+
+  EXPECT_NO_THROW(first_.connect("peer2", "bob"));
+  EXPECT_EQ(second_.remoteObserver->clientConnectedEvents.size(), 2);
+}
+
+} // namespace
+} // namespace cluster
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include "cluster/pseudonym_leases.hpp"
+
+namespace cluster {
+namespace {
+
+using namespace std::chrono_literals;
+
+class PseudonymLeasesTest : public ::testing::Test {
+protected:
+  PseudonymLeases::Grant claim(const PseudonymLeases::Holder &holder,
+                               std::uint64_t token = 0) {
+    return leases_.claim("alice", holder, token, now_, now_ + 10s);
+  }
+
+  PseudonymLeases leases_;
+  PseudonymLeases::Clock::time_point now_{};
+  const PseudonymLeases::Holder first_{.node = "a", .peer = "peer1"};
+  const PseudonymLeases::Holder second_{.node = "b", .peer = "peer2"};
+};
+
+TEST_F(PseudonymLeasesTest, FreePseudonym_IsGranted) {
+  const auto grant = claim(first_);
+
+  EXPECT_TRUE(grant.granted);
+  EXPECT_NE(grant.token, 0);
+  EXPECT_TRUE(leases_.isHeld("alice", now_));
+}
+
+TEST_F(PseudonymLeasesTest, HeldPseudonym_IsRefusedToOthers) {
+  const auto first = claim(first_);
+  const auto second = claim(second_);
+
+  EXPECT_FALSE(second.granted);
+  EXPECT_EQ(second.token, first.token);
+}
+
+TEST_F(PseudonymLeasesTest, Renewal_KeepsTokenAndExtendsLease) {
+  const auto first = claim(first_);
+  now_ += 8s;
+  const auto renewed = claim(first_, first.token);
+  now_ += 8s;
+
+  EXPECT_TRUE(renewed.granted);
+  EXPECT_EQ(renewed.token, first.token);
+  EXPECT_TRUE(leases_.isHeld("alice", now_));
+}
+
+TEST_F(PseudonymLeasesTest, ExpiredLease_IsGrantedAgainWithLargerToken) {
+  const auto first = claim(first_);
+  now_ += 10s;
+
+  EXPECT_FALSE(leases_.isHeld("alice", now_));
+  const auto second = claim(second_);
+  EXPECT_TRUE(second.granted);
+  EXPECT_GT(second.token, first.token);
+
+  // The former holder is fenced off
+  EXPECT_FALSE(claim(first_, first.token).granted);
+  EXPECT_FALSE(leases_.release("alice", first_, first.token));
+  EXPECT_TRUE(leases_.isHeld("alice", now_));
+}
+
+TEST_F(PseudonymLeasesTest, Release_NeedsHolderAndToken) {
+  const auto grant = claim(first_);
+
+  EXPECT_FALSE(leases_.release("alice", second_, grant.token));
+  EXPECT_FALSE(leases_.release("alice", first_, grant.token + 1));
+  EXPECT_TRUE(leases_.release("alice", first_, grant.token));
+  EXPECT_TRUE(claim(second_).granted);
+}
+
+TEST_F(PseudonymLeasesTest, Expire_DropsOnlyLapsedLeases) {
+  claim(first_);
+  leases_.claim("bob", second_, 0, now_, now_ + 30s);
+  now_ += 20s;
+
+  EXPECT_EQ(leases_.expire(now_), 1);
+  EXPECT_EQ(leases_.size(), 1);
+  EXPECT_TRUE(leases_.isHeld("bob", now_));
+}
+
+} // namespace
+} // namespace cluster
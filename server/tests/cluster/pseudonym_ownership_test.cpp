@@ -0,0 +1,255 @@
+#include <gtest/gtest.h>
+
+#include "cluster/pseudonym_ownership.hpp"
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace cluster {
+namespace {
+
+using namespace std::chrono_literals;
+using domain::ClaimResult;
+
+// Nodes exchanging claim messages synchronously on a shared fake clock
+class PseudonymOwnershipTest : public ::testing::Test {
+protected:
+  class Transport : public IClaimTransport {
+  public:
+    Transport(PseudonymOwnershipTest &test, std::string node)
+        : test_(test), node_(std::move(node)) {}
+
+    void sendClaim(const std::string &node,
+                   const ClaimMessage &message) override {
+      if (!test_.dropMessages_) {
+        test_.nodes_.at(node)->receive(node_, message);
+      }
+    }
+
+  private:
+    PseudonymOwnershipTest &test_;
+    std::string node_;
+  };
+
+  void SetUp() override {
+    for (const std::string node : {"a", "b", "c"}) {
+      addNode(node);
+    }
+    updateMembers();
+    // Past the startup grace period
+    advance(6s);
+  }
+
+  void addNode(const std::string &node) {
+    const auto leaseLost = [this, node](const std::string &peer,
+                                        const std::string &pseudonym) {
+      lost_.push_back({.node = node, .peer = peer, .pseudonym = pseudonym});
+    };
+    auto ownership = std::make_shared<PseudonymOwnership>(
+        PseudonymOwnership::Config{.nodeId = node,
+                                   .leaseDuration = 6s,
+                                   .claimTimeout = 2s,
+                                   .leaseLost = leaseLost},
+        [this] { return now_; });
+    transports_.push_back(std::make_shared<Transport>(*this, node));
+    ownership->attachTransport(transports_.back());
+    nodes_[node] = std::move(ownership);
+  }
+
+  void updateMembers() {
+    for (const auto &[node, ownership] : nodes_) {
+      std::vector<std::string> others;
+      for (const auto &[other, unused] : nodes_) {
+        if (other != node) {
+          others.push_back(other);
+        }
+      }
+      ownership->setMembers(others);
+    }
+  }
+
+  // Moves the clock in steps short enough for the renewals
+  void advance(std::chrono::milliseconds duration,
+               const std::string &stopped = {}) {
+    for (auto elapsed = 0ms; elapsed < duration; elapsed += 500ms) {
+      now_ += 500ms;
+      for (const auto &[node, ownership] : nodes_) {
+        if (node != stopped) {
+          ownership->tick();
+        }
+      }
+    }
+  }
+
+  std::optional<ClaimResult> claim(const std::string &node,
+                                   const std::string &peer,
+                                   const std::string &pseudonym) {
+    std::optional<ClaimResult> result;
+    nodes_.at(node)->claim(peer, pseudonym,
+                           [&result](ClaimResult claimed) { result = claimed; });
+    return result;
+  }
+
+  std::string pseudonymOwnedBy(const std::string &owner) {
+    for (int i = 0;; ++i) {
+      std::string pseudonym = "user" + std::to_string(i);
+      if (nodes_.at("a")->ownerOf(pseudonym) == owner) {
+        return pseudonym;
+      }
+    }
+  }
+
+  struct LostLease {
+    std::string node;
+    std::string peer;
+    std::string pseudonym;
+
+    bool operator==(const LostLease &) const = default;
+  };
+
+  PseudonymOwnership::Clock::time_point now_{};
+  bool dropMessages_ = false;
+  std::vector<LostLease> lost_;
+  std::map<std::string, std::shared_ptr<PseudonymOwnership>> nodes_;
+  std::vector<std::shared_ptr<Transport>> transports_;
+};
+
+TEST_F(PseudonymOwnershipTest, Owners_AgreeAcrossNodes) {
+  for (int i = 0; i < 100; ++i) {
+    const std::string pseudonym = "user" + std::to_string(i);
+    EXPECT_EQ(nodes_["a"]->ownerOf(pseudonym),
+              nodes_["b"]->ownerOf(pseudonym));
+    EXPECT_EQ(nodes_["a"]->ownerOf(pseudonym),
+              nodes_["c"]->ownerOf(pseudonym));
+  }
+}
+
+TEST_F(PseudonymOwnershipTest, Pseudonym_IsGrantedOnceClusterWide) {
+  for (const std::string owner : {"a", "b", "c"}) {
+    const auto pseudonym = pseudonymOwnedBy(owner);
+
+    EXPECT_EQ(claim("a", "peer1", pseudonym), ClaimResult::kGranted) << owner;
+    EXPECT_EQ(claim("b", "peer2", pseudonym), ClaimResult::kTaken) << owner;
+    EXPECT_EQ(claim("c", "peer3", pseudonym), ClaimResult::kTaken) << owner;
+    // The holder may claim its pseudonym again
+    EXPECT_EQ(claim("a", "peer1", pseudonym), ClaimResult::kGranted) << owner;
+  }
+}
+
+TEST_F(PseudonymOwnershipTest, Disconnect_ReleasesLease) {
+  const auto pseudonym = pseudonymOwnedBy("c");
+  ASSERT_EQ(claim("a", "peer1", pseudonym), ClaimResult::kGranted);
+
+  nodes_["a"]->onClientDisconnected(
+      {.peer = "peer1", .pseudonym = pseudonym, .connectionDuration = 1s});
+
+  EXPECT_EQ(claim("b", "peer2", pseudonym), ClaimResult::kGranted);
+}
+
+TEST_F(PseudonymOwnershipTest, Renewals_KeepLeaseAlive) {
+  const auto pseudonym = pseudonymOwnedBy("b");
+  ASSERT_EQ(claim("a", "peer1", pseudonym), ClaimResult::kGranted);
+
+  advance(20s);
+
+  EXPECT_EQ(claim("c", "peer3", pseudonym), ClaimResult::kTaken);
+}
+
+TEST_F(PseudonymOwnershipTest, StoppedHolder_LeaseExpires) {
+  const auto pseudonym = pseudonymOwnedBy("b");
+  ASSERT_EQ(claim("a", "peer1", pseudonym), ClaimResult::kGranted);
+
+  advance(7s, "a");
+
+  EXPECT_EQ(claim("c", "peer3", pseudonym), ClaimResult::kGranted);
+}
+
+TEST_F(PseudonymOwnershipTest, StoppedHolder_LosesItsClientOnResume) {
+  // Renewed with the owner itself and with a remote one
+  for (const std::string owner : {"a", "b"}) {
+    lost_.clear();
+    const auto pseudonym = pseudonymOwnedBy(owner);
+    ASSERT_EQ(claim("a", "peer1", pseudonym), ClaimResult::kGranted) << owner;
+
+    advance(7s, "a");
+    ASSERT_EQ(claim("c", "peer3", pseudonym), ClaimResult::kGranted) << owner;
+    EXPECT_TRUE(lost_.empty()) << owner;
+
+    // The first renewal after the resume finds the lease taken
+    advance(500ms);
+    EXPECT_EQ(lost_, (std::vector<LostLease>{{"a", "peer1", pseudonym}}))
+        << owner;
+
+    // The new holder keeps it
+    advance(10s);
+    EXPECT_EQ(lost_.size(), 1U) << owner;
+    EXPECT_EQ(claim("b", "peer2", pseudonym), ClaimResult::kTaken) << owner;
+  }
+}
+
+TEST_F(PseudonymOwnershipTest, UnansweredClaim_TimesOut) {
+  dropMessages_ = true;
+  const auto pseudonym = pseudonymOwnedBy("b");
+
+  std::optional<ClaimResult> result;
+  nodes_["a"]->claim("peer1", pseudonym,
+                     [&result](ClaimResult claimed) { result = claimed; });
+  EXPECT_FALSE(result.has_value());
+
+  advance(2s);
+  EXPECT_EQ(result, ClaimResult::kUnavailable);
+}
+
+TEST_F(PseudonymOwnershipTest, NewOwner_AdoptsLeasesBeforeGrantingOthers) {
+  // Pseudonyms the node "d" will own once it joins
+  std::vector<std::string> moving;
+  {
+    HashRing ring;
+    for (const std::string node : {"a", "b", "c", "d"}) {
+      ring.addNode(node);
+    }
+    for (int i = 0; moving.size() < 2; ++i) {
+      const std::string pseudonym = "user" + std::to_string(i);
+      if (ring.ownerOf(pseudonym) == "d" &&
+          nodes_["a"]->ownerOf(pseudonym) != "a") {
+        moving.push_back(pseudonym);
+      }
+    }
+  }
+  ASSERT_EQ(claim("a", "peer1", moving[0]), ClaimResult::kGranted);
+
+  addNode("d");
+  updateMembers();
+  ASSERT_EQ(nodes_["b"]->ownerOf(moving[0]), "d");
+
+  // The holder renews with "d" at once; unknown pseudonyms wait for the
+  // grace period, as "d" cannot tell whether they are held
+  advance(500ms);
+  EXPECT_EQ(claim("b", "peer2", moving[0]), ClaimResult::kTaken);
+  EXPECT_EQ(claim("b", "peer2", moving[1]), ClaimResult::kUnavailable);
+
+  advance(6s);
+  EXPECT_EQ(claim("b", "peer2", moving[0]), ClaimResult::kTaken);
+  EXPECT_EQ(claim("b", "peer2", moving[1]), ClaimResult::kGranted);
+}
+
+TEST(PseudonymOwnershipStartupTest, FreshNode_WaitsOneLeasePeriod) {
+  auto now = PseudonymOwnership::Clock::time_point{};
+  PseudonymOwnership ownership({.nodeId = "solo", .leaseDuration = 6s},
+                               [&now] { return now; });
+
+  std::optional<ClaimResult> result;
+  const auto record = [&result](ClaimResult claimed) { result = claimed; };
+  ownership.claim("peer1", "alice", record);
+  EXPECT_EQ(result, ClaimResult::kUnavailable);
+
+  now += 6s;
+  ownership.claim("peer1", "alice", record);
+  EXPECT_EQ(result, ClaimResult::kGranted);
+}
+
+} // namespace
+} // namespace cluster
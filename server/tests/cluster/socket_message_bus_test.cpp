@@ -0,0 +1,469 @@
+#include <gtest/gtest.h>
+
+#include "cluster/socket_message_bus.hpp"
+#include "domain/client_registry.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace cluster {
+namespace {
+
+using namespace std::chrono_literals;
+
+// Records relayed events; they arrive on the bus receiver thread
+class RecordingObserver : public events::IServiceEventObserver {
+public:
+  void onClientConnected(const events::ClientConnectedEvent &event) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    connected_.push_back(event);
+    cv_.notify_all();
+  }
+
+  void onClientDisconnected(
+      [[maybe_unused]] const events::ClientDisconnectedEvent &event) override {}
+
+  void onMessageSent(const events::MessageSentEvent &event) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    messages_.push_back(event);
+    cv_.notify_all();
+  }
+
+  void onPrivateMessageSent(
+      const events::PrivateMessageSentEvent &event) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    privateMessages_.push_back(event);
+    cv_.notify_all();
+  }
+
+  bool waitForConnected(std::size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, 2s,
+                        [&] { return connected_.size() >= count; });
+  }
+
+  bool waitForMessages(std::size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, 2s, [&] { return messages_.size() >= count; });
+  }
+
+  bool waitForPrivateMessages(std::size_t count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, 2s,
+                        [&] { return privateMessages_.size() >= count; });
+  }
+
+  std::vector<events::ClientConnectedEvent> connected() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connected_;
+  }
+
+  std::vector<events::MessageSentEvent> messages() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return messages_;
+  }
+
+  std::vector<events::PrivateMessageSentEvent> privateMessages() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return privateMessages_;
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<events::ClientConnectedEvent> connected_;
+  std::vector<events::MessageSentEvent> messages_;
+  std::vector<events::PrivateMessageSentEvent> privateMessages_;
+};
+
+template <typename Predicate> bool waitUntil(Predicate predicate) {
+  const auto deadline = std::chrono::steady_clock::now() + 5s;
+  while (!predicate()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(10ms);
+  }
+  return true;
+}
+
+bool waitUntilConnected(const SocketMessageBus &bus, std::size_t peers) {
+  return waitUntil([&] { return bus.connectedPeers() >= peers; });
+}
+
+class SocketMessageBusTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    int pair[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+    leftRemote_.registerObserver(leftObserver_);
+    rightRemote_.registerObserver(rightObserver_);
+    left_ = std::make_unique<SocketMessageBus>(
+        SocketMessageBus::Config{.links = {pair[0]}, .nodeId = "left"});
+    right_ = std::make_unique<SocketMessageBus>(
+        SocketMessageBus::Config{.links = {pair[1]}, .nodeId = "right"});
+    left_->start(leftRemote_);
+    right_->start(rightRemote_);
+  }
+
+  events::EventDispatcher leftRemote_;
+  events::EventDispatcher rightRemote_;
+  std::shared_ptr<RecordingObserver> leftObserver_ =
+      std::make_shared<RecordingObserver>();
+  std::shared_ptr<RecordingObserver> rightObserver_ =
+      std::make_shared<RecordingObserver>();
+  std::unique_ptr<SocketMessageBus> left_;
+  std::unique_ptr<SocketMessageBus> right_;
+};
+
+TEST_F(SocketMessageBusTest, PublishedEvent_IsReplayedOnSibling) {
+  left_->publish(
+      events::ClientConnectedEvent{.peer = "peer1", .pseudonym = "alice"});
+
+  ASSERT_TRUE(rightObserver_->waitForConnected(1));
+  const auto connected = rightObserver_->connected();
+  EXPECT_EQ(connected[0].peer, "peer1");
+  EXPECT_EQ(connected[0].pseudonym, "alice");
+  EXPECT_EQ(connected[0].node, "left");
+  // No echo back to the publisher
+  EXPECT_TRUE(leftObserver_->connected().empty());
+}
+
+TEST_F(SocketMessageBusTest, EventsFlowBothWaysInOrder) {
+  for (int i = 0; i < 100; ++i) {
+    left_->publish(events::MessageSentEvent{
+        .peer = "peer1",
+        .pseudonym = "alice",
+        .message = events::makeChatMessage("alice", std::to_string(i))});
+  }
+  right_->publish(
+      events::MessageSentEvent{.peer = "peer2",
+                               .pseudonym = "bob",
+                               .message = events::makeChatMessage("bob", "hi")});
+
+  ASSERT_TRUE(rightObserver_->waitForMessages(100));
+  ASSERT_TRUE(leftObserver_->waitForMessages(1));
+
+  const auto messages = rightObserver_->messages();
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(messages[i].message->content(), std::to_string(i));
+  }
+  EXPECT_EQ(leftObserver_->messages()[0].message->author(), "bob");
+}
+
+TEST_F(SocketMessageBusTest, LargePayload_IsReassembled) {
+  const std::string content(256 * 1024, 'x');
+  left_->publish(events::MessageSentEvent{
+      .peer = "peer1",
+      .pseudonym = "alice",
+      .message = events::makeChatMessage("alice", content)});
+
+  ASSERT_TRUE(rightObserver_->waitForMessages(1));
+  EXPECT_EQ(rightObserver_->messages()[0].message->content(), content);
+}
+
+TEST_F(SocketMessageBusTest, PrivateMessage_IsSentToRecipientNodeOnly) {
+  // Once right's event is in, left has read the hello sent before it
+  right_->publish(
+      events::ClientConnectedEvent{.peer = "peer2", .pseudonym = "bob"});
+  ASSERT_TRUE(leftObserver_->waitForConnected(1));
+
+  const auto privateMessage = [](std::string recipientNode) {
+    return events::PrivateMessageSentEvent{
+        .senderPeer = "peer1",
+        .senderPseudonym = "alice",
+        .recipientPeer = "peer2",
+        .recipientPseudonym = "bob",
+        .message = events::makeChatMessage("alice", "psst", {}, true),
+        .recipientNode = std::move(recipientNode)};
+  };
+  left_->publish(privateMessage("elsewhere"));
+  left_->publish(privateMessage({}));
+  left_->publish(privateMessage("right"));
+  // Sent behind the private messages on the same link
+  left_->publish(events::MessageSentEvent{
+      .peer = "peer1",
+      .pseudonym = "alice",
+      .message = events::makeChatMessage("alice", "done")});
+
+  ASSERT_TRUE(rightObserver_->waitForMessages(1));
+  ASSERT_TRUE(rightObserver_->waitForPrivateMessages(1));
+  EXPECT_EQ(rightObserver_->privateMessages().size(), 1);
+}
+
+TEST_F(SocketMessageBusTest, ClosedSibling_DoesNotBreakPublisher) {
+  right_.reset();
+
+  EXPECT_NO_THROW(
+      left_->publish(events::ClientConnectedEvent{.peer = "peer1",
+                                                  .pseudonym = "alice"}));
+  EXPECT_NO_THROW(
+      left_->publish(events::ClientConnectedEvent{.peer = "peer2",
+                                                  .pseudonym = "bob"}));
+}
+
+TEST(SocketMessageBusSlowPeerTest, PeerThatNeverReads_IsDroppedNotWaitedOn) {
+  int pair[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+  events::EventDispatcher remote;
+  SocketMessageBus bus(SocketMessageBus::Config{
+      .links = {pair[0]}, .nodeId = "left", .maxOutboxBytes = 64 * 1024});
+  bus.start(remote);
+  ASSERT_EQ(bus.connectedPeers(), 1U);
+
+  // Nothing ever reads pair[1]: the socket buffers fill, then the outbox
+  const std::string content(4 * 1024, 'x');
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 1000; ++i) {
+    bus.publish(events::MessageSentEvent{
+        .peer = "peer1",
+        .pseudonym = "alice",
+        .message = events::makeChatMessage("alice", content)});
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 500ms);
+
+  EXPECT_TRUE(waitUntil([&] { return bus.connectedPeers() == 0; }));
+  ::close(pair[1]);
+}
+
+// Two nodes on a socket pair, each applying remote events to its registry
+class SocketMessageBusPresenceTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    int pair[2];
+    ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+    leftRemote_.registerObserver(leftRegistry_);
+    rightRemote_.registerObserver(rightRegistry_);
+    left_ = std::make_unique<SocketMessageBus>(
+        SocketMessageBus::Config{.links = {pair[0]},
+                                 .nodeId = "left",
+                                 .presence = leftRegistry_,
+                                 .snapshotInterval = 50ms});
+    right_ = std::make_unique<SocketMessageBus>(
+        SocketMessageBus::Config{.links = {pair[1]},
+                                 .nodeId = "right",
+                                 .presence = rightRegistry_,
+                                 .snapshotInterval = 50ms});
+  }
+
+  void start() {
+    left_->start(leftRemote_);
+    right_->start(rightRemote_);
+  }
+
+  bool rightLocates(const std::string &pseudonym) {
+    const auto location = rightRegistry_->locate(pseudonym);
+    return location.has_value() && location->node == "left";
+  }
+
+  std::shared_ptr<domain::ClientRegistry> leftRegistry_ =
+      std::make_shared<domain::ClientRegistry>();
+  std::shared_ptr<domain::ClientRegistry> rightRegistry_ =
+      std::make_shared<domain::ClientRegistry>();
+  events::EventDispatcher leftRemote_;
+  events::EventDispatcher rightRemote_;
+  std::unique_ptr<SocketMessageBus> left_;
+  std::unique_ptr<SocketMessageBus> right_;
+};
+
+TEST_F(SocketMessageBusPresenceTest, MissedEvents_AreRepairedBySnapshots) {
+  // Connected locally without the event reaching the bus
+  leftRegistry_->asObserver()->onClientConnected(
+      {.peer = "peer1", .pseudonym = "alice"});
+  start();
+
+  ASSERT_TRUE(waitUntil([&] { return rightLocates("alice"); }));
+  EXPECT_EQ(rightRegistry_->locate("alice")->peer, "peer1");
+
+  leftRegistry_->asObserver()->onClientDisconnected(
+      {.peer = "peer1", .pseudonym = "alice"});
+  EXPECT_TRUE(
+      waitUntil([&] { return !rightRegistry_->isPeerConnected("peer1"); }));
+}
+
+TEST_F(SocketMessageBusPresenceTest, SilentNode_ClientsExpire) {
+  leftRegistry_->asObserver()->onClientConnected(
+      {.peer = "peer1", .pseudonym = "alice"});
+  start();
+  ASSERT_TRUE(waitUntil([&] { return rightLocates("alice"); }));
+
+  left_.reset();
+
+  EXPECT_TRUE(
+      waitUntil([&] { return !rightRegistry_->isPeerConnected("peer1"); }));
+}
+
+TEST(SocketMessageBusOwnershipTest, Claims_ReachThePseudonymOwner) {
+  int pair[2];
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+  const auto makeOwnership = [](const std::string &node) {
+    return std::make_shared<PseudonymOwnership>(PseudonymOwnership::Config{
+        .nodeId = node, .leaseDuration = 300ms, .claimTimeout = 2s});
+  };
+  auto leftOwnership = makeOwnership("left");
+  auto rightOwnership = makeOwnership("right");
+  events::EventDispatcher leftRemote;
+  events::EventDispatcher rightRemote;
+  auto left = std::make_shared<SocketMessageBus>(SocketMessageBus::Config{
+      .links = {pair[0]}, .nodeId = "left", .ownership = leftOwnership});
+  auto right = std::make_shared<SocketMessageBus>(SocketMessageBus::Config{
+      .links = {pair[1]}, .nodeId = "right", .ownership = rightOwnership});
+  leftOwnership->attachTransport(left);
+  rightOwnership->attachTransport(right);
+  left->start(leftRemote);
+  right->start(rightRemote);
+
+  // A pseudonym of the right node, once both nodes see each other
+  std::string pseudonym;
+  ASSERT_TRUE(waitUntil([&] {
+    for (int i = 0; i < 64 && pseudonym.empty(); ++i) {
+      const std::string key = "user" + std::to_string(i);
+      if (leftOwnership->ownerOf(key) == "right") {
+        pseudonym = key;
+      }
+    }
+    return !pseudonym.empty() && rightOwnership->ownerOf(pseudonym) == "right";
+  }));
+
+  const auto claim = [](PseudonymOwnership &ownership,
+                        const std::string &peer, const std::string &name) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::optional<domain::ClaimResult> result;
+    ownership.claim(peer, name, [&](domain::ClaimResult claimed) {
+      std::lock_guard<std::mutex> lock(mutex);
+      result = claimed;
+      cv.notify_all();
+    });
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait_for(lock, 3s, [&] { return result.has_value(); });
+    return result;
+  };
+
+  // Fresh claims are refused for one lease period after the ring changed
+  ASSERT_TRUE(waitUntil([&] {
+    return claim(*leftOwnership, "peer1", pseudonym) ==
+           domain::ClaimResult::kGranted;
+  }));
+  EXPECT_EQ(claim(*rightOwnership, "peer2", pseudonym),
+            domain::ClaimResult::kTaken);
+
+  // The ownerships' transports may be holding the buses on their threads
+  left->stop();
+  right->stop();
+}
+
+TEST(SocketMessageBusNetworkTest, UnixListener_ReceivesFromPeer) {
+  const std::string address =
+      "unix:/tmp/chat_bus_test_" + std::to_string(::getpid()) + ".sock";
+  events::EventDispatcher receiverRemote;
+  events::EventDispatcher senderRemote;
+  auto observer = std::make_shared<RecordingObserver>();
+  receiverRemote.registerObserver(observer);
+
+  SocketMessageBus receiver({.listenAddress = address});
+  SocketMessageBus sender({.peerAddresses = {address}});
+  receiver.start(receiverRemote);
+  sender.start(senderRemote);
+  ASSERT_TRUE(waitUntilConnected(sender, 1));
+
+  sender.publish(events::ClientConnectedEvent{.peer = "p", .pseudonym = "a"});
+
+  ASSERT_TRUE(observer->waitForConnected(1));
+  EXPECT_EQ(observer->connected()[0].pseudonym, "a");
+  EXPECT_EQ(receiver.connectedPeers(), 0);
+}
+
+TEST(SocketMessageBusNetworkTest, TcpPeer_IsConnectedOnceListenerStarts) {
+  // Pick a free port, then release it for the node started later
+  std::string address;
+  {
+    SocketMessageBus probe({.listenAddress = "127.0.0.1:0"});
+    address = probe.listenAddress();
+  }
+  ASSERT_NE(address, "127.0.0.1:0");
+
+  events::EventDispatcher senderRemote;
+  SocketMessageBus sender({.peerAddresses = {address}});
+  sender.start(senderRemote);
+  std::this_thread::sleep_for(100ms);
+  EXPECT_EQ(sender.connectedPeers(), 0);
+
+  events::EventDispatcher receiverRemote;
+  auto observer = std::make_shared<RecordingObserver>();
+  receiverRemote.registerObserver(observer);
+  SocketMessageBus receiver({.listenAddress = address});
+  receiver.start(receiverRemote);
+  ASSERT_TRUE(waitUntilConnected(sender, 1));
+
+  sender.publish(events::MessageSentEvent{
+      .peer = "p",
+      .pseudonym = "a",
+      .message = events::makeChatMessage("a", "over tcp")});
+
+  ASSERT_TRUE(observer->waitForMessages(1));
+  EXPECT_EQ(observer->messages()[0].message->content(), "over tcp");
+}
+
+TEST(SocketMessageBusNetworkTest, StalledPeer_DoesNotHoldUpTheOthers) {
+  // A listener that never accepts, its queue full: connects to it hang
+  const int stalled = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  ASSERT_GE(stalled, 0);
+  sockaddr_in bound{};
+  bound.sin_family = AF_INET;
+  bound.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t length = sizeof(bound);
+  ASSERT_EQ(::bind(stalled, reinterpret_cast<sockaddr *>(&bound), length), 0);
+  ASSERT_EQ(::listen(stalled, 0), 0);
+  ASSERT_EQ(
+      ::getsockname(stalled, reinterpret_cast<sockaddr *>(&bound), &length),
+      0);
+  std::vector<int> fillers;
+  for (int i = 0; i < 4; ++i) {
+    const int fd =
+        ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    ::connect(fd, reinterpret_cast<sockaddr *>(&bound), length);
+    fillers.push_back(fd);
+  }
+  std::this_thread::sleep_for(50ms);
+
+  events::EventDispatcher receiverRemote;
+  SocketMessageBus receiver({.listenAddress = "127.0.0.1:0"});
+  receiver.start(receiverRemote);
+
+  events::EventDispatcher senderRemote;
+  SocketMessageBus sender(
+      {.peerAddresses = {"127.0.0.1:" + std::to_string(ntohs(bound.sin_port)),
+                         receiver.listenAddress()}});
+  const auto start = std::chrono::steady_clock::now();
+  sender.start(senderRemote);
+  ASSERT_TRUE(waitUntilConnected(sender, 1));
+  // A blocking connect would wait out its timeout on the stalled peer first
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 500ms);
+
+  sender.stop();
+  receiver.stop();
+  for (const int fd : fillers) {
+    ::close(fd);
+  }
+  ::close(stalled);
+}
+
+TEST(SocketMessageBusNetworkTest, InvalidListenAddress_Throws) {
+  EXPECT_THROW(SocketMessageBus({.listenAddress = "not-an-address"}),
+               std::system_error);
+}
+
+} // namespace
+} // namespace cluster
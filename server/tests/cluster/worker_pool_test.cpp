@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include "cluster/worker_pool.hpp"
+
+#include <cstdint>
+
+#include <unistd.h>
+
+namespace cluster {
+namespace {
+
+TEST(WorkerPoolTest, CpusForWorker_SplitsIntoContiguousSlices) {
+  const std::vector<int> cpus{0, 1, 2, 3, 4, 5, 6, 7};
+
+  EXPECT_EQ(cpusForWorker(cpus, 0, 2), (std::vector<int>{0, 1, 2, 3}));
+  EXPECT_EQ(cpusForWorker(cpus, 1, 2), (std::vector<int>{4, 5, 6, 7}));
+  EXPECT_EQ(cpusForWorker(cpus, 0, 3), (std::vector<int>{0, 1}));
+  EXPECT_EQ(cpusForWorker(cpus, 2, 3), (std::vector<int>{5, 6, 7}));
+}
+
+TEST(WorkerPoolTest, CpusForWorker_SharesCpusWhenOutnumbered) {
+  const std::vector<int> cpus{2, 5};
+
+  EXPECT_EQ(cpusForWorker(cpus, 0, 3), (std::vector<int>{2}));
+  EXPECT_EQ(cpusForWorker(cpus, 1, 3), (std::vector<int>{5}));
+  EXPECT_EQ(cpusForWorker(cpus, 2, 3), (std::vector<int>{2}));
+  EXPECT_TRUE(cpusForWorker({}, 0, 1).empty());
+}
+
+TEST(WorkerPoolTest, RunWorkers_ConnectsEveryPair) {
+  constexpr std::size_t kWorkers = 3;
+
+  const int status = runWorkers(
+      kWorkers, false, [](const WorkerContext &context) {
+        if (context.links.size() != kWorkers - 1) {
+          return 1;
+        }
+        const auto self = static_cast<std::uint8_t>(context.index);
+        for (const int fd : context.links) {
+          if (::write(fd, &self, 1) != 1) {
+            return 1;
+          }
+        }
+        unsigned seen = 0;
+        for (const int fd : context.links) {
+          std::uint8_t other = 0;
+          if (::read(fd, &other, 1) != 1 || other == self) {
+            return 1;
+          }
+          seen |= 1U << other;
+        }
+        return seen == (((1U << kWorkers) - 1) & ~(1U << self)) ? 0 : 1;
+      });
+
+  EXPECT_EQ(status, 0);
+}
+
+TEST(WorkerPoolTest, RunWorkers_ReportsWorkerFailure) {
+  const int status = runWorkers(2, false, [](const WorkerContext &context) {
+    if (context.index == 1) {
+      return 3;
+    }
+    // Stopped by the pool once its sibling failed
+    ::pause();
+    return 0;
+  });
+
+  EXPECT_EQ(status, 3);
+}
+
+} // namespace
+} // namespace cluster
@@ -208,7 +208,7 @@ TEST_F(DatabaseEventLoggerTest, OnMessageSent_CallsIncrementTxMessage) {
   events::MessageSentEvent event{
       .peer = "peer1",
       .pseudonym = "alice",
-      .content = "Hello, World!",
+      .message = events::makeChatMessage("alice", "Hello, World!"),
   };
 
   logger_->onMessageSent(event);
@@ -222,17 +222,17 @@ TEST_F(DatabaseEventLoggerTest,
   events::MessageSentEvent event1{
       .peer = "peer1",
       .pseudonym = "alice",
-      .content = "Message 1",
+      .message = events::makeChatMessage("alice", "Message 1"),
   };
   events::MessageSentEvent event2{
       .peer = "peer1",
       .pseudonym = "alice",
-      .content = "Message 2",
+      .message = events::makeChatMessage("alice", "Message 2"),
   };
   events::MessageSentEvent event3{
       .peer = "peer2",
       .pseudonym = "bob",
-      .content = "Message 3",
+      .message = events::makeChatMessage("bob", "Message 3"),
   };
 
   logger_->onMessageSent(event1);
@@ -251,7 +251,7 @@ TEST_F(DatabaseEventLoggerTest, OnMessageSent_DatabaseError_DoesNotThrow) {
   events::MessageSentEvent event{
       .peer = "peer1",
       .pseudonym = "alice",
-      .content = "Hello",
+      .message = events::makeChatMessage("alice", "Hello"),
   };
 
   EXPECT_NO_THROW(logger_->onMessageSent(event));
@@ -271,7 +271,7 @@ TEST_F(DatabaseEventLoggerTest,
   events::MessageSentEvent event{
       .peer = "peer1",
       .pseudonym = "alice",
-      .content = "Hello",
+      .message = events::makeChatMessage("alice", "Hello"),
   };
 
   EXPECT_NO_THROW(loggerWithExpiredDb->onMessageSent(event));
@@ -293,12 +293,12 @@ TEST_F(DatabaseEventLoggerTest, FullLifecycle_ConnectMessageDisconnect) {
   events::MessageSentEvent msg1{
       .peer = "peer1",
       .pseudonym = "alice",
-      .content = "Hello",
+      .message = events::makeChatMessage("alice", "Hello"),
   };
   events::MessageSentEvent msg2{
       .peer = "peer1",
       .pseudonym = "alice",
-      .content = "Goodbye",
+      .message = events::makeChatMessage("alice", "Goodbye"),
   };
   logger_->onMessageSent(msg1);
   logger_->onMessageSent(msg2);
@@ -111,6 +111,23 @@ TEST_F(ClientEventBroadcasterTest,
   EXPECT_EQ(response.event_type(), chat::ClientEventData::REMOVE);
 }
 
+TEST_F(ClientEventBroadcasterTest, BroadcastClientEvent_CarriesRosterVersion) {
+  connectClient("peer1", "alice");
+  chat::ClientEventData unused;
+  broadcaster_->nextClientEvent("peer1", std::chrono::milliseconds(0), unused);
+
+  connectClient("peer2", "bob");
+  broadcaster_->broadcastClientEvent("bob", chat::ClientEventData::ADD);
+
+  chat::ClientEventData response;
+  ASSERT_EQ(broadcaster_->nextClientEvent("peer1", std::chrono::milliseconds(0),
+                                          response),
+            NextClientEventStatus::kOk);
+  EXPECT_EQ(response.roster_version(), registry_.membershipVersion());
+  EXPECT_EQ(response.roster_version(),
+            registry_.getRosterSnapshot()->version);
+}
+
 TEST_F(ClientEventBroadcasterTest,
        NextClientEvent_MultiplePeers_IndependentIndices) {
   connectClient("peer1", "alice");
@@ -323,7 +340,7 @@ TEST_F(ClientEventBroadcasterTest, OnMessageSent_NoOp) {
   events::MessageSentEvent event{
       .peer = "peer1",
       .pseudonym = "alice",
-      .content = "Hello",
+      .message = events::makeChatMessage("alice", "Hello"),
   };
 
   // Should not crash and should not add any events
@@ -335,5 +352,19 @@ TEST_F(ClientEventBroadcasterTest, OnMessageSent_NoOp) {
   EXPECT_EQ(status, NextClientEventStatus::kNoEvent);
 }
 
+TEST_F(ClientEventBroadcasterTest, Drain_StopsWaitingForEvents) {
+  connectClient("peer1", "alice");
+  broadcaster_->normalizeClientEventIndex("peer1");
+
+  broadcaster_->drain();
+
+  const auto start = std::chrono::steady_clock::now();
+  chat::ClientEventData event;
+  EXPECT_EQ(
+      broadcaster_->nextClientEvent("peer1", std::chrono::seconds(10), event),
+      NextClientEventStatus::kNoEvent);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
 } // namespace
 } // namespace domain
@@ -1,7 +1,11 @@
 #include <gtest/gtest.h>
 
+#include "chat.pb.h"
 #include "domain/client_registry.hpp"
 
+#include <string>
+#include <vector>
+
 namespace domain {
 namespace {
 
@@ -132,6 +136,33 @@ TEST_F(ClientRegistryTest, OnClientDisconnected_UnknownPseudonym) {
   EXPECT_TRUE(registry_.isPeerConnected("peer1"));
 }
 
+TEST_F(ClientRegistryTest, OnClientDisconnected_RemovesOnlyTheEventPeer) {
+  // "bob" briefly on this node and on another one, as in a lease handover
+  connectClient("local", "bob");
+  events::ClientConnectedEvent remote;
+  remote.peer = "remote";
+  remote.pseudonym = "bob";
+  remote.node = "other";
+  registry_.asObserver()->onClientConnected(remote);
+
+  registry_.asObserver()->onClientDisconnected(
+      {.peer = "remote",
+       .pseudonym = "bob",
+       .connectionDuration = std::chrono::seconds(0)});
+
+  EXPECT_TRUE(registry_.isPeerConnected("local"));
+  EXPECT_FALSE(registry_.isPeerConnected("remote"));
+
+  // A stale event for a peer now connected as someone else changes nothing
+  connectClient("local", "alice");
+  registry_.asObserver()->onClientDisconnected(
+      {.peer = "local",
+       .pseudonym = "bob",
+       .connectionDuration = std::chrono::seconds(0)});
+  EXPECT_TRUE(registry_.isPeerConnected("local"));
+  EXPECT_EQ(registry_.locate("alice")->peer, "local");
+}
+
 TEST_F(ClientRegistryTest, OnClientConnected_OverwritesExistingPeer) {
   connectClient("peer1", "alice");
   connectClient("peer1", "bob");
@@ -144,5 +175,126 @@ TEST_F(ClientRegistryTest, OnClientConnected_OverwritesExistingPeer) {
   EXPECT_EQ(pseudonyms.size(), 1);
 }
 
+TEST_F(ClientRegistryTest, ReservePseudonym_HoldsItAgainstOtherPeers) {
+  EXPECT_TRUE(registry_.reservePseudonym("peer1", "alice"));
+
+  EXPECT_FALSE(registry_.reservePseudonym("peer2", "alice"));
+  EXPECT_FALSE(registry_.isPseudonymAvailable("peer2", "alice"));
+  EXPECT_TRUE(registry_.isPseudonymAvailable("peer1", "alice"));
+  EXPECT_TRUE(registry_.reservePseudonym("peer2", "bob"));
+}
+
+TEST_F(ClientRegistryTest, ReservePseudonym_FailsForConnectedPseudonym) {
+  connectClient("peer1", "alice");
+
+  EXPECT_FALSE(registry_.reservePseudonym("peer2", "alice"));
+}
+
+TEST_F(ClientRegistryTest, Reservation_EndsWithConnectEvent) {
+  ASSERT_TRUE(registry_.reservePseudonym("peer1", "alice"));
+  connectClient("peer1", "alice");
+  disconnectClient("alice");
+
+  EXPECT_TRUE(registry_.isPseudonymAvailable("peer2", "alice"));
+}
+
+TEST_F(ClientRegistryTest, CancelReservation_OnlyByItsPeer) {
+  ASSERT_TRUE(registry_.reservePseudonym("peer1", "alice"));
+
+  registry_.cancelReservation("peer2", "alice");
+  EXPECT_FALSE(registry_.isPseudonymAvailable("peer2", "alice"));
+
+  registry_.cancelReservation("peer1", "alice");
+  EXPECT_TRUE(registry_.isPseudonymAvailable("peer2", "alice"));
+}
+
+TEST_F(ClientRegistryTest, RosterSnapshot_IsSharedUntilMembershipChanges) {
+  connectClient("peer1", "alice");
+
+  const auto first = registry_.getRosterSnapshot();
+  EXPECT_EQ(registry_.getRosterSnapshot(), first);
+  ASSERT_EQ(first->pseudonyms.size(), 1);
+
+  connectClient("peer2", "bob");
+  const auto second = registry_.getRosterSnapshot();
+  EXPECT_NE(second, first);
+  EXPECT_GT(second->version, first->version);
+  EXPECT_EQ(second->pseudonyms.size(), 2);
+  // Earlier snapshots are left untouched
+  EXPECT_EQ(first->pseudonyms, std::vector<std::string>{"alice"});
+
+  disconnectClient("alice");
+  EXPECT_EQ(registry_.getRosterSnapshot()->pseudonyms,
+            std::vector<std::string>{"bob"});
+}
+
+TEST_F(ClientRegistryTest, RosterSnapshot_UnsharedOneFollowsConnects) {
+  registry_.getRosterSnapshot();
+  connectClient("peer1", "alice");
+  connectClient("peer2", "bob");
+
+  const auto roster = registry_.getRosterSnapshot();
+  EXPECT_EQ(roster->pseudonyms, (std::vector<std::string>{"alice", "bob"}));
+}
+
+TEST_F(ClientRegistryTest, RosterSnapshot_WireParsesAsConnectResponse) {
+  connectClient("peer1", "alice");
+  connectClient("peer2", "bob");
+  registry_.getRosterSnapshot();
+  // Long enough for a two-byte length prefix
+  connectClient("peer3", std::string(200, 'c'));
+
+  const auto roster = registry_.getRosterSnapshot();
+
+  chat::ConnectResponse header;
+  header.set_accepted(true);
+  chat::ConnectResponse response;
+  ASSERT_TRUE(
+      response.ParseFromString(header.SerializeAsString() + roster->wire));
+  EXPECT_TRUE(response.accepted());
+  std::vector<std::string> parsed(response.connected_pseudonyms().begin(),
+                                  response.connected_pseudonyms().end());
+  EXPECT_EQ(parsed, roster->pseudonyms);
+  EXPECT_EQ(parsed.size(), 3);
+}
+
+TEST_F(ClientRegistryTest, ReservePseudonym_ResumedSessionReplacesItsPeer) {
+  connectClient("peer1", "alice");
+
+  EXPECT_FALSE(registry_.reservePseudonym("peer2", "alice", "peer3"));
+  EXPECT_TRUE(registry_.reservePseudonym("peer2", "alice", "peer1"));
+}
+
+TEST_F(ClientRegistryTest, ResumedSession_KeepsRosterVersion) {
+  connectClient("peer1", "alice");
+  connectClient("peer2", "bob");
+  const auto roster = registry_.getRosterSnapshot();
+
+  registry_.asObserver()->onClientConnected(
+      {.peer = "peer3", .pseudonym = "alice", .resumedPeer = "peer1"});
+
+  EXPECT_EQ(registry_.membershipVersion(), roster->version);
+  EXPECT_EQ(registry_.getRosterSnapshot(), roster);
+  EXPECT_FALSE(registry_.isPeerConnected("peer1"));
+  std::string pseudonym;
+  ASSERT_TRUE(registry_.getPseudonymForPeer("peer3", pseudonym));
+  EXPECT_EQ(pseudonym, "alice");
+}
+
+TEST_F(ClientRegistryTest, RestoreClients_ContinuesFromSavedVersion) {
+  connectClient("peer1", "alice");
+
+  registry_.restoreClients({{.peer = "resume:alice", .pseudonym = "alice"},
+                            {.peer = "resume:bob", .pseudonym = "bob"}},
+                           40);
+
+  EXPECT_EQ(registry_.membershipVersion(), 40);
+  const auto roster = registry_.getRosterSnapshot();
+  EXPECT_EQ(roster->version, 40);
+  EXPECT_EQ(roster->pseudonyms.size(), 2);
+  EXPECT_TRUE(registry_.isPeerConnected("resume:bob"));
+  EXPECT_FALSE(registry_.isPeerConnected("resume:alice"));
+}
+
 } // namespace
 } // namespace domain
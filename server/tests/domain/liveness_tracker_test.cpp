@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include "domain/liveness_tracker.hpp"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace domain {
+namespace {
+
+using namespace std::chrono_literals;
+
+class LivenessTrackerTest : public ::testing::Test {
+protected:
+  LivenessTracker::Clock::time_point start_ = LivenessTracker::Clock::now();
+  std::shared_ptr<LivenessTracker> tracker_ =
+      std::make_shared<LivenessTracker>(
+          LivenessTracker::Config{.idleTimeout = 10s, .tick = 1s}, start_);
+
+  void connectClient(const std::string &peer, const std::string &pseudonym) {
+    tracker_->onClientConnected({.peer = peer, .pseudonym = pseudonym});
+  }
+
+  void disconnectClient(const std::string &peer) {
+    tracker_->onClientDisconnected(
+        {.peer = peer, .pseudonym = "", .connectionDuration = 0s});
+  }
+};
+
+TEST_F(LivenessTrackerTest, Advance_ReapsClientIdleForTheTimeout) {
+  connectClient("peer1", "alice");
+
+  EXPECT_TRUE(tracker_->advance(start_ + 9s).empty());
+  EXPECT_EQ(tracker_->advance(start_ + 12s),
+            std::vector<std::string>{"peer1"});
+  EXPECT_EQ(tracker_->size(), 0);
+  EXPECT_TRUE(tracker_->advance(start_ + 60s).empty());
+}
+
+TEST_F(LivenessTrackerTest, Touch_PushesTheDeadlineBack) {
+  connectClient("peer1", "alice");
+
+  tracker_->touch("peer1", start_ + 8s);
+
+  EXPECT_TRUE(tracker_->advance(start_ + 17s).empty());
+  EXPECT_EQ(tracker_->advance(start_ + 20s),
+            std::vector<std::string>{"peer1"});
+}
+
+TEST_F(LivenessTrackerTest, OpenStream_KeepsClientAliveUntilClosed) {
+  connectClient("peer1", "alice");
+
+  {
+    auto stream = tracker_->openStream("peer1", start_);
+    EXPECT_TRUE(tracker_->advance(start_ + 120s).empty());
+  }
+
+  EXPECT_EQ(tracker_->size(), 1);
+  EXPECT_EQ(tracker_->advance(start_ + 132s),
+            std::vector<std::string>{"peer1"});
+}
+
+TEST_F(LivenessTrackerTest, Disconnect_StopsTracking) {
+  connectClient("peer1", "alice");
+  disconnectClient("peer1");
+
+  EXPECT_EQ(tracker_->size(), 0);
+  EXPECT_TRUE(tracker_->advance(start_ + 60s).empty());
+}
+
+TEST_F(LivenessTrackerTest, StreamOfPreviousConnection_IsIgnored) {
+  connectClient("peer1", "alice");
+  auto stream = tracker_->openStream("peer1", start_);
+  disconnectClient("peer1");
+  connectClient("peer1", "alice");
+
+  // The old stream does not keep the new connection alive
+  EXPECT_EQ(tracker_->advance(start_ + 12s),
+            std::vector<std::string>{"peer1"});
+}
+
+TEST_F(LivenessTrackerTest, ResumedSession_ForgetsPreviousPeer) {
+  connectClient("peer1", "alice");
+  tracker_->onClientConnected(
+      {.peer = "peer2", .pseudonym = "alice", .resumedPeer = "peer1"});
+
+  EXPECT_EQ(tracker_->size(), 1);
+  EXPECT_EQ(tracker_->advance(start_ + 12s),
+            std::vector<std::string>{"peer2"});
+}
+
+TEST_F(LivenessTrackerTest, UnknownPeer_IsIgnored) {
+  tracker_->touch("peer1");
+  auto stream = tracker_->openStream("peer1");
+
+  EXPECT_EQ(tracker_->size(), 0);
+}
+
+} // namespace
+} // namespace domain
@@ -3,8 +3,11 @@
 #include "domain/client_registry.hpp"
 #include "domain/message_broadcaster.hpp"
 
+#include <atomic>
 #include <chrono>
+#include <string>
 #include <thread>
+#include <vector>
 
 namespace domain {
 namespace {
@@ -44,7 +47,7 @@ protected:
     events::MessageSentEvent event{
         .peer = peer,
         .pseudonym = pseudonym,
-        .content = content,
+        .message = events::makeChatMessage(pseudonym, content),
     };
     broadcaster_->onMessageSent(event);
   }
@@ -53,7 +56,7 @@ protected:
 // --- nextMessage Tests ---
 
 TEST_F(MessageBroadcasterTest, NextMessage_PeerNotConnected_ReturnsPeerMissing) {
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
   auto status = broadcaster_->nextMessage("unknown_peer",
                                           std::chrono::milliseconds(0), response);
   EXPECT_EQ(status, NextMessageStatus::kPeerMissing);
@@ -62,7 +65,7 @@ TEST_F(MessageBroadcasterTest, NextMessage_PeerNotConnected_ReturnsPeerMissing)
 TEST_F(MessageBroadcasterTest, NextMessage_NoMessages_ReturnsNoMessage) {
   connectClient("peer1", "alice");
 
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
   auto status =
       broadcaster_->nextMessage("peer1", std::chrono::milliseconds(10), response);
   EXPECT_EQ(status, NextMessageStatus::kNoMessage);
@@ -72,48 +75,48 @@ TEST_F(MessageBroadcasterTest, NextMessage_HasMessage_ReturnsOk) {
   connectClient("peer1", "alice");
 
   // Initialize peer's index first by calling nextMessage (will return NoMessage)
-  chat::InformClientsNewMessageResponse unused;
+  events::ChatMessagePtr unused;
   broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), unused);
 
   // Now send message - peer will see it
   sendMessage("peer1", "alice", "Hello!");
 
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
   auto status =
       broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response);
 
   EXPECT_EQ(status, NextMessageStatus::kOk);
-  EXPECT_EQ(response.author(), "alice");
-  EXPECT_EQ(response.content(), "Hello!");
+  EXPECT_EQ(response->author(), "alice");
+  EXPECT_EQ(response->content(), "Hello!");
 }
 
 TEST_F(MessageBroadcasterTest, NextMessage_MultipleMessages_ReturnsInOrder) {
   connectClient("peer1", "alice");
 
   // Initialize peer's index first
-  chat::InformClientsNewMessageResponse unused;
+  events::ChatMessagePtr unused;
   broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), unused);
 
   sendMessage("peer1", "alice", "First");
   sendMessage("peer1", "alice", "Second");
   sendMessage("peer1", "alice", "Third");
 
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
 
   auto status1 =
       broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response);
   EXPECT_EQ(status1, NextMessageStatus::kOk);
-  EXPECT_EQ(response.content(), "First");
+  EXPECT_EQ(response->content(), "First");
 
   auto status2 =
       broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response);
   EXPECT_EQ(status2, NextMessageStatus::kOk);
-  EXPECT_EQ(response.content(), "Second");
+  EXPECT_EQ(response->content(), "Second");
 
   auto status3 =
       broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response);
   EXPECT_EQ(status3, NextMessageStatus::kOk);
-  EXPECT_EQ(response.content(), "Third");
+  EXPECT_EQ(response->content(), "Third");
 }
 
 TEST_F(MessageBroadcasterTest, NextMessage_MultiplePeers_IndependentIndices) {
@@ -121,27 +124,27 @@ TEST_F(MessageBroadcasterTest, NextMessage_MultiplePeers_IndependentIndices) {
   connectClient("peer2", "bob");
 
   // Initialize both peers' indices first
-  chat::InformClientsNewMessageResponse unused;
+  events::ChatMessagePtr unused;
   broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), unused);
   broadcaster_->nextMessage("peer2", std::chrono::milliseconds(0), unused);
 
   sendMessage("peer1", "alice", "Message1");
   sendMessage("peer2", "bob", "Message2");
 
-  chat::InformClientsNewMessageResponse response1;
-  chat::InformClientsNewMessageResponse response2;
+  events::ChatMessagePtr response1;
+  events::ChatMessagePtr response2;
 
   // peer1 should see Message1 first
   auto status1 =
       broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response1);
   EXPECT_EQ(status1, NextMessageStatus::kOk);
-  EXPECT_EQ(response1.content(), "Message1");
+  EXPECT_EQ(response1->content(), "Message1");
 
   // peer2 should also see Message1 first (independent index)
   auto status2 =
       broadcaster_->nextMessage("peer2", std::chrono::milliseconds(0), response2);
   EXPECT_EQ(status2, NextMessageStatus::kOk);
-  EXPECT_EQ(response2.content(), "Message1");
+  EXPECT_EQ(response2->content(), "Message1");
 }
 
 TEST_F(MessageBroadcasterTest,
@@ -153,7 +156,7 @@ TEST_F(MessageBroadcasterTest,
     disconnectClient("alice");
   });
 
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
   auto status = broadcaster_->nextMessage("peer1", std::chrono::milliseconds(100),
                                           response);
   disconnectThread.join();
@@ -171,7 +174,7 @@ TEST_F(MessageBroadcasterTest,
   connectClient("peer2", "bob");
 
   // peer2 should NOT see the old message (starts at current position)
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
   auto status =
       broadcaster_->nextMessage("peer2", std::chrono::milliseconds(10), response);
   EXPECT_EQ(status, NextMessageStatus::kNoMessage);
@@ -204,7 +207,7 @@ TEST_F(MessageBroadcasterTest,
   EXPECT_TRUE(result);
 
   // After normalize, peer should start at current position (no old messages)
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
   auto status =
       broadcaster_->nextMessage("peer1", std::chrono::milliseconds(10), response);
   EXPECT_EQ(status, NextMessageStatus::kNoMessage);
@@ -216,23 +219,23 @@ TEST_F(MessageBroadcasterTest, OnMessageSent_AddsMessageToHistory) {
   connectClient("peer1", "alice");
 
   // Initialize peer's index first
-  chat::InformClientsNewMessageResponse unused;
+  events::ChatMessagePtr unused;
   broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), unused);
 
   events::MessageSentEvent event{
       .peer = "peer1",
       .pseudonym = "alice",
-      .content = "Test content",
+      .message = events::makeChatMessage("alice", "Test content"),
   };
   broadcaster_->onMessageSent(event);
 
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
   auto status =
       broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response);
 
   EXPECT_EQ(status, NextMessageStatus::kOk);
-  EXPECT_EQ(response.author(), "alice");
-  EXPECT_EQ(response.content(), "Test content");
+  EXPECT_EQ(response->author(), "alice");
+  EXPECT_EQ(response->content(), "Test content");
 }
 
 TEST_F(MessageBroadcasterTest, OnMessageSent_WakesWaitingPeers) {
@@ -242,7 +245,7 @@ TEST_F(MessageBroadcasterTest, OnMessageSent_WakesWaitingPeers) {
   std::atomic<bool> messageReceived{false};
 
   std::thread waitingThread([this, &status, &messageReceived]() {
-    chat::InformClientsNewMessageResponse response;
+    events::ChatMessagePtr response;
     status = broadcaster_->nextMessage("peer1", std::chrono::milliseconds(500),
                                        response);
     if (status == NextMessageStatus::kOk) {
@@ -262,6 +265,358 @@ TEST_F(MessageBroadcasterTest, OnMessageSent_WakesWaitingPeers) {
   EXPECT_TRUE(messageReceived.load());
 }
 
+// --- Slow consumer policy Tests ---
+
+TEST_F(MessageBroadcasterTest, QueueDepth_UnknownPeer_ReturnsNullopt) {
+  EXPECT_FALSE(broadcaster_->queueDepth("unknown_peer").has_value());
+}
+
+TEST_F(MessageBroadcasterTest, QueueDepth_CountsPendingMessages) {
+  connectClient("peer1", "alice");
+  broadcaster_->normalizeMessageIndex("peer1");
+
+  sendMessage("peer1", "alice", "First");
+  sendMessage("peer1", "alice", "Second");
+  EXPECT_EQ(broadcaster_->queueDepth("peer1"), 2U);
+
+  events::ChatMessagePtr response;
+  broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response);
+  EXPECT_EQ(broadcaster_->queueDepth("peer1"), 1U);
+}
+
+TEST_F(MessageBroadcasterTest, DropOldestPolicy_SkipsOverflowedMessages) {
+  broadcaster_ = std::make_unique<MessageBroadcaster>(
+      registry_, OutboundQueueConfig{
+                     .capacity = 2, .policy = SlowConsumerPolicy::kDropOldest});
+  connectClient("peer1", "alice");
+  broadcaster_->normalizeMessageIndex("peer1");
+
+  sendMessage("peer1", "alice", "First");
+  sendMessage("peer1", "alice", "Second");
+  sendMessage("peer1", "alice", "Third");
+
+  events::ChatMessagePtr response;
+  auto status =
+      broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response);
+  EXPECT_EQ(status, NextMessageStatus::kOk);
+  EXPECT_EQ(response->content(), "Second");
+  EXPECT_EQ(broadcaster_->queueDepth("peer1"), 1U);
+}
+
+TEST_F(MessageBroadcasterTest, CoalescePolicy_FoldsSameAuthorBacklog) {
+  broadcaster_ = std::make_unique<MessageBroadcaster>(
+      registry_, OutboundQueueConfig{
+                     .capacity = 2, .policy = SlowConsumerPolicy::kCoalesce});
+  connectClient("peer1", "alice");
+  connectClient("peer2", "bob");
+  broadcaster_->normalizeMessageIndex("peer1");
+
+  sendMessage("peer2", "bob", "First");
+  sendMessage("peer2", "bob", "Second");
+  sendMessage("peer2", "bob", "Third");
+  sendMessage("peer1", "alice", "Fourth");
+
+  events::ChatMessagePtr response;
+  auto status =
+      broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response);
+  EXPECT_EQ(status, NextMessageStatus::kOk);
+  EXPECT_EQ(response->author(), "bob");
+  EXPECT_EQ(response->content(), "Third");
+
+  status =
+      broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response);
+  EXPECT_EQ(status, NextMessageStatus::kOk);
+  EXPECT_EQ(response->content(), "Fourth");
+}
+
+TEST_F(MessageBroadcasterTest, CoalescePolicy_MergesConsecutiveMessages) {
+  broadcaster_ = std::make_unique<MessageBroadcaster>(
+      registry_, OutboundQueueConfig{
+                     .capacity = 3, .policy = SlowConsumerPolicy::kCoalesce});
+  connectClient("peer1", "alice");
+  broadcaster_->normalizeMessageIndex("peer1");
+
+  sendMessage("peer1", "alice", "First");
+  sendMessage("peer1", "alice", "Second");
+  sendMessage("peer1", "alice", "Third");
+  sendMessage("peer1", "alice", "Fourth");
+
+  events::ChatMessagePtr response;
+  auto status =
+      broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response);
+  EXPECT_EQ(status, NextMessageStatus::kOk);
+  EXPECT_EQ(response->content(), "Second\nThird\nFourth");
+  EXPECT_EQ(broadcaster_->queueDepth("peer1"), 0U);
+}
+
+TEST_F(MessageBroadcasterTest, CoalescePolicy_StopsAtTheByteCap) {
+  broadcaster_ = std::make_unique<MessageBroadcaster>(
+      registry_, OutboundQueueConfig{.capacity = 3,
+                                     .policy = SlowConsumerPolicy::kCoalesce,
+                                     .maxCoalescedBytes = 13});
+  connectClient("peer1", "alice");
+  broadcaster_->normalizeMessageIndex("peer1");
+
+  sendMessage("peer1", "alice", "First");
+  sendMessage("peer1", "alice", "Second");
+  sendMessage("peer1", "alice", "Third");
+  sendMessage("peer1", "alice", "Fourth");
+
+  // "Second\nThird" fits in 13 bytes, adding "Fourth" would not
+  events::ChatMessagePtr response;
+  auto status =
+      broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response);
+  EXPECT_EQ(status, NextMessageStatus::kOk);
+  EXPECT_EQ(response->content(), "Second\nThird");
+
+  status =
+      broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response);
+  EXPECT_EQ(status, NextMessageStatus::kOk);
+  EXPECT_EQ(response->content(), "Fourth");
+}
+
+TEST_F(MessageBroadcasterTest, CoalescePolicy_LeavesSharedPayloadUntouched) {
+  broadcaster_ = std::make_unique<MessageBroadcaster>(
+      registry_, OutboundQueueConfig{
+                     .capacity = 2, .policy = SlowConsumerPolicy::kCoalesce});
+  connectClient("peer1", "alice");
+  broadcaster_->normalizeMessageIndex("peer1");
+
+  sendMessage("peer1", "alice", "First");
+  const auto second = events::makeChatMessage("alice", "Second");
+  broadcaster_->onMessageSent(events::MessageSentEvent{
+      .peer = "peer1", .pseudonym = "alice", .message = second});
+  sendMessage("peer1", "alice", "Third");
+
+  // The merge is a private copy, other readers still see the original
+  events::ChatMessagePtr response;
+  broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response);
+  EXPECT_EQ(response->content(), "Second\nThird");
+  EXPECT_EQ(second->content(), "Second");
+}
+
+TEST_F(MessageBroadcasterTest, DisconnectPolicy_ReturnsOverflow) {
+  broadcaster_ = std::make_unique<MessageBroadcaster>(
+      registry_, OutboundQueueConfig{
+                     .capacity = 1, .policy = SlowConsumerPolicy::kDisconnect});
+  connectClient("peer1", "alice");
+  broadcaster_->normalizeMessageIndex("peer1");
+
+  sendMessage("peer1", "alice", "First");
+  sendMessage("peer1", "alice", "Second");
+
+  events::ChatMessagePtr response;
+  auto status =
+      broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response);
+  EXPECT_EQ(status, NextMessageStatus::kOverflow);
+  EXPECT_FALSE(broadcaster_->queueDepth("peer1").has_value());
+}
+
+TEST_F(MessageBroadcasterTest, IdleReader_IsHeldToTheCapacityByThePublisher) {
+  broadcaster_ = std::make_unique<MessageBroadcaster>(
+      registry_, OutboundQueueConfig{
+                     .capacity = 8, .policy = SlowConsumerPolicy::kDropOldest});
+  connectClient("peer1", "alice");
+  // Subscribed, then never reads
+  broadcaster_->normalizeMessageIndex("peer1");
+
+  for (int i = 0; i < 4000; ++i) {
+    sendMessage("peer1", "alice", std::to_string(i));
+  }
+
+  // At most a segment of the log past the capacity is still held for it
+  const auto depth = broadcaster_->queueDepth("peer1");
+  ASSERT_TRUE(depth.has_value());
+  EXPECT_LE(*depth, 8U + 256U);
+
+  events::ChatMessagePtr response;
+  EXPECT_EQ(
+      broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response),
+      NextMessageStatus::kOk);
+  EXPECT_EQ(response->content(), "3992");
+}
+
+TEST_F(MessageBroadcasterTest, IdleReader_IsDroppedByThePublisherOnDisconnect) {
+  broadcaster_ = std::make_unique<MessageBroadcaster>(
+      registry_, OutboundQueueConfig{
+                     .capacity = 8, .policy = SlowConsumerPolicy::kDisconnect});
+  connectClient("peer1", "alice");
+  broadcaster_->normalizeMessageIndex("peer1");
+
+  for (int i = 0; i < 256; ++i) {
+    sendMessage("peer1", "alice", std::to_string(i));
+  }
+  EXPECT_FALSE(broadcaster_->queueDepth("peer1").has_value());
+
+  events::ChatMessagePtr response;
+  EXPECT_EQ(
+      broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response),
+      NextMessageStatus::kOverflow);
+
+  // A new subscription starts over
+  broadcaster_->normalizeMessageIndex("peer1");
+  sendMessage("peer1", "alice", "again");
+  EXPECT_EQ(
+      broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response),
+      NextMessageStatus::kOk);
+  EXPECT_EQ(response->content(), "again");
+}
+
+// --- subscribe Tests ---
+
+TEST_F(MessageBroadcasterTest, Subscribe_PeerNotConnected_ReturnsNull) {
+  EXPECT_EQ(broadcaster_->subscribe("unknown_peer"), nullptr);
+}
+
+TEST_F(MessageBroadcasterTest, Subscribe_ReadsUntilThePeerLeaves) {
+  connectClient("peer1", "alice");
+  auto subscription = broadcaster_->subscribe("peer1");
+  ASSERT_NE(subscription, nullptr);
+
+  events::ChatMessagePtr response;
+  EXPECT_EQ(subscription->next(response), NextMessageStatus::kNoMessage);
+
+  sendMessage("peer1", "alice", "Hello");
+  EXPECT_EQ(subscription->pending(), 1U);
+  ASSERT_EQ(subscription->next(response), NextMessageStatus::kOk);
+  EXPECT_EQ(response->content(), "Hello");
+
+  events::ClientDisconnectedEvent event;
+  event.peer = "peer1";
+  event.pseudonym = "alice";
+  broadcaster_->onClientDisconnected(event);
+  sendMessage("peer2", "bob", "Too late");
+
+  EXPECT_EQ(subscription->next(response), NextMessageStatus::kPeerMissing);
+  EXPECT_EQ(subscription->pending(), 0U);
+}
+
+TEST_F(MessageBroadcasterTest, Subscribe_IsEndedByThePublisherOnDisconnect) {
+  broadcaster_ = std::make_unique<MessageBroadcaster>(
+      registry_, OutboundQueueConfig{
+                     .capacity = 8, .policy = SlowConsumerPolicy::kDisconnect});
+  connectClient("peer1", "alice");
+  auto subscription = broadcaster_->subscribe("peer1");
+  ASSERT_NE(subscription, nullptr);
+
+  for (int i = 0; i < 256; ++i) {
+    sendMessage("peer1", "alice", std::to_string(i));
+  }
+
+  events::ChatMessagePtr response;
+  EXPECT_EQ(subscription->next(response), NextMessageStatus::kOverflow);
+  EXPECT_EQ(subscription->pending(), 0U);
+
+  // Subscribing again starts a new read at the tail
+  auto renewed = broadcaster_->subscribe("peer1");
+  ASSERT_NE(renewed, nullptr);
+  EXPECT_NE(renewed, subscription);
+  sendMessage("peer1", "alice", "again");
+  ASSERT_EQ(renewed->next(response), NextMessageStatus::kOk);
+  EXPECT_EQ(response->content(), "again");
+}
+
+TEST_F(MessageBroadcasterTest, Subscribe_SharesTheCursorOfNextMessage) {
+  connectClient("peer1", "alice");
+  auto subscription = broadcaster_->subscribe("peer1");
+  ASSERT_NE(subscription, nullptr);
+  sendMessage("peer1", "alice", "First");
+  sendMessage("peer1", "alice", "Second");
+
+  events::ChatMessagePtr response;
+  ASSERT_EQ(subscription->next(response), NextMessageStatus::kOk);
+  EXPECT_EQ(response->content(), "First");
+  ASSERT_EQ(
+      broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response),
+      NextMessageStatus::kOk);
+  EXPECT_EQ(response->content(), "Second");
+  EXPECT_EQ(broadcaster_->queueDepth("peer1"), 0U);
+}
+
+TEST_F(MessageBroadcasterTest, NextMessage_SharesPublishedPayload) {
+  connectClient("peer1", "alice");
+  connectClient("peer2", "bob");
+  broadcaster_->normalizeMessageIndex("peer1");
+  broadcaster_->normalizeMessageIndex("peer2");
+
+  const auto message = events::makeChatMessage("alice", "Hello");
+  broadcaster_->onMessageSent(events::MessageSentEvent{
+      .peer = "peer1", .pseudonym = "alice", .message = message});
+
+  // Every subscriber receives the published payload itself, not a copy
+  events::ChatMessagePtr response1;
+  events::ChatMessagePtr response2;
+  broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response1);
+  broadcaster_->nextMessage("peer2", std::chrono::milliseconds(0), response2);
+  EXPECT_EQ(response1, message);
+  EXPECT_EQ(response2, message);
+}
+
+// --- Sharding Tests ---
+
+TEST_F(MessageBroadcasterTest, Sharded_ShardCountIsAtLeastOne) {
+  EXPECT_EQ(MessageBroadcaster(registry_, {}, 0).shardCount(), 1U);
+  EXPECT_EQ(MessageBroadcaster(registry_, {}, 4).shardCount(), 4U);
+}
+
+TEST_F(MessageBroadcasterTest, Sharded_EveryPeerReceivesEveryMessage) {
+  broadcaster_ = std::make_unique<MessageBroadcaster>(registry_,
+                                                      OutboundQueueConfig{}, 4);
+
+  constexpr int kPeerCount = 16;
+  for (int i = 0; i < kPeerCount; ++i) {
+    connectClient("peer" + std::to_string(i), "user" + std::to_string(i));
+    broadcaster_->normalizeMessageIndex("peer" + std::to_string(i));
+  }
+
+  sendMessage("peer0", "user0", "First");
+  sendMessage("peer1", "user1", "Second");
+
+  for (int i = 0; i < kPeerCount; ++i) {
+    const std::string peer = "peer" + std::to_string(i);
+    events::ChatMessagePtr response;
+
+    ASSERT_EQ(
+        broadcaster_->nextMessage(peer, std::chrono::milliseconds(0), response),
+        NextMessageStatus::kOk);
+    EXPECT_EQ(response->content(), "First");
+    ASSERT_EQ(
+        broadcaster_->nextMessage(peer, std::chrono::milliseconds(0), response),
+        NextMessageStatus::kOk);
+    EXPECT_EQ(response->content(), "Second");
+  }
+}
+
+TEST_F(MessageBroadcasterTest, Sharded_PublishWakesWaitersInAllShards) {
+  broadcaster_ = std::make_unique<MessageBroadcaster>(registry_,
+                                                      OutboundQueueConfig{}, 4);
+
+  constexpr int kPeerCount = 8;
+  std::vector<std::thread> waiters;
+  std::atomic<int> received{0};
+  for (int i = 0; i < kPeerCount; ++i) {
+    const std::string peer = "peer" + std::to_string(i);
+    connectClient(peer, "user" + std::to_string(i));
+    broadcaster_->normalizeMessageIndex(peer);
+    waiters.emplace_back([this, peer, &received]() {
+      events::ChatMessagePtr response;
+      if (broadcaster_->nextMessage(peer, std::chrono::milliseconds(500),
+                                    response) == NextMessageStatus::kOk) {
+        ++received;
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  sendMessage("peer0", "user0", "Wake up!");
+
+  for (auto &waiter : waiters) {
+    waiter.join();
+  }
+
+  EXPECT_EQ(received.load(), kPeerCount);
+}
+
 // --- Observer interface Tests ---
 
 TEST_F(MessageBroadcasterTest, OnClientConnected_NoOp) {
@@ -276,15 +631,103 @@ TEST_F(MessageBroadcasterTest, OnClientConnected_NoOp) {
   EXPECT_NO_THROW(broadcaster_->onClientConnected(event));
 }
 
-TEST_F(MessageBroadcasterTest, OnClientDisconnected_NoOp) {
+TEST_F(MessageBroadcasterTest,
+       OnClientDisconnected_CleansUpDisconnectedPeerIndices) {
+  connectClient("peer1", "alice");
+  broadcaster_->normalizeMessageIndex("peer1");
+  ASSERT_TRUE(broadcaster_->queueDepth("peer1").has_value());
+
+  disconnectClient("alice");
+
   events::ClientDisconnectedEvent event{
       .peer = "peer1",
       .pseudonym = "alice",
       .connectionDuration = std::chrono::seconds(60),
   };
+  broadcaster_->onClientDisconnected(event);
 
-  // Should not crash
-  EXPECT_NO_THROW(broadcaster_->onClientDisconnected(event));
+  EXPECT_FALSE(broadcaster_->queueDepth("peer1").has_value());
+}
+
+TEST_F(MessageBroadcasterTest, OnClientDisconnected_KeepsOtherPeersCursors) {
+  broadcaster_ = std::make_unique<MessageBroadcaster>(
+      registry_, OutboundQueueConfig{}, 4);
+  for (const std::string peer : {"peer1", "peer2", "peer3"}) {
+    connectClient(peer, peer + "-name");
+    broadcaster_->normalizeMessageIndex(peer);
+  }
+  sendMessage("peer1", "peer1-name", "hello");
+
+  disconnectClient("peer2-name");
+  broadcaster_->onClientDisconnected(
+      {.peer = "peer2",
+       .pseudonym = "peer2-name",
+       .connectionDuration = std::chrono::seconds(1)});
+
+  EXPECT_FALSE(broadcaster_->queueDepth("peer2").has_value());
+  EXPECT_EQ(broadcaster_->queueDepth("peer1"), 1U);
+  EXPECT_EQ(broadcaster_->queueDepth("peer3"), 1U);
+}
+
+TEST_F(MessageBroadcasterTest, OnMessageSent_SetsRoomOnPayload) {
+  connectClient("peer1", "alice");
+  broadcaster_->normalizeMessageIndex("peer1");
+
+  events::MessageSentEvent event{
+      .peer = "peer1",
+      .pseudonym = "alice",
+      .room = "cpp",
+      .message = events::makeChatMessage("alice", "Hello room", "cpp"),
+  };
+  broadcaster_->onMessageSent(event);
+
+  events::ChatMessagePtr response;
+  auto status =
+      broadcaster_->nextMessage("peer1", std::chrono::milliseconds(0), response);
+  EXPECT_EQ(status, NextMessageStatus::kOk);
+  EXPECT_EQ(response->room(), "cpp");
+}
+
+// --- drain Tests ---
+
+TEST_F(MessageBroadcasterTest, Drain_HandsOutPendingThenStopsWaiting) {
+  connectClient("peer1", "alice");
+  broadcaster_->normalizeMessageIndex("peer1");
+  sendMessage("peer1", "alice", "last words");
+
+  broadcaster_->drain();
+
+  events::ChatMessagePtr response;
+  EXPECT_EQ(broadcaster_->nextMessage("peer1", std::chrono::seconds(10),
+                                      response),
+            NextMessageStatus::kOk);
+  EXPECT_EQ(response->content(), "last words");
+
+  const auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(broadcaster_->nextMessage("peer1", std::chrono::seconds(10),
+                                      response),
+            NextMessageStatus::kNoMessage);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+TEST_F(MessageBroadcasterTest, Drain_WakesWaitingPeer) {
+  connectClient("peer1", "alice");
+  broadcaster_->normalizeMessageIndex("peer1");
+
+  std::atomic<NextMessageStatus> status{NextMessageStatus::kOk};
+  const auto start = std::chrono::steady_clock::now();
+  std::thread waitingThread([this, &status] {
+    events::ChatMessagePtr response;
+    status = broadcaster_->nextMessage("peer1", std::chrono::seconds(10),
+                                       response);
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  broadcaster_->drain();
+  waitingThread.join();
+
+  EXPECT_EQ(status.load(), NextMessageStatus::kNoMessage);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
 }
 
 } // namespace
@@ -3,6 +3,7 @@
 #include "domain/client_registry.hpp"
 #include "domain/private_message_broadcaster.hpp"
 
+#include <atomic>
 #include <chrono>
 #include <thread>
 
@@ -49,7 +50,7 @@ protected:
         .senderPseudonym = senderPseudonym,
         .recipientPeer = recipientPeer,
         .recipientPseudonym = recipientPseudonym,
-        .content = content,
+        .message = events::makeChatMessage(senderPseudonym, content, {}, true),
     };
     broadcaster_->onPrivateMessageSent(event);
   }
@@ -59,7 +60,7 @@ protected:
 
 TEST_F(PrivateMessageBroadcasterTest,
        NextPrivateMessage_PeerNotConnected_ReturnsPeerMissing) {
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
   auto status = broadcaster_->nextPrivateMessage(
       "unknown_peer", std::chrono::milliseconds(0), response);
   EXPECT_EQ(status, NextPrivateMessageStatus::kPeerMissing);
@@ -69,7 +70,7 @@ TEST_F(PrivateMessageBroadcasterTest,
        NextPrivateMessage_NoMessages_ReturnsNoMessage) {
   connectClient("peer1", "alice");
 
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
   auto status = broadcaster_->nextPrivateMessage(
       "peer1", std::chrono::milliseconds(10), response);
   EXPECT_EQ(status, NextPrivateMessageStatus::kNoMessage);
@@ -85,14 +86,14 @@ TEST_F(PrivateMessageBroadcasterTest, NextPrivateMessage_HasMessage_ReturnsOk) {
   // Send private message from alice to bob
   sendPrivateMessage("peer1", "alice", "peer2", "bob", "Hello Bob!");
 
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
   auto status = broadcaster_->nextPrivateMessage(
       "peer2", std::chrono::milliseconds(0), response);
 
   EXPECT_EQ(status, NextPrivateMessageStatus::kOk);
-  EXPECT_EQ(response.author(), "alice");
-  EXPECT_EQ(response.content(), "Hello Bob!");
-  EXPECT_TRUE(response.isprivate());
+  EXPECT_EQ(response->author(), "alice");
+  EXPECT_EQ(response->content(), "Hello Bob!");
+  EXPECT_TRUE(response->isprivate());
 }
 
 TEST_F(PrivateMessageBroadcasterTest,
@@ -106,22 +107,22 @@ TEST_F(PrivateMessageBroadcasterTest,
   sendPrivateMessage("peer1", "alice", "peer2", "bob", "Second");
   sendPrivateMessage("peer1", "alice", "peer2", "bob", "Third");
 
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
 
   auto status1 = broadcaster_->nextPrivateMessage(
       "peer2", std::chrono::milliseconds(0), response);
   EXPECT_EQ(status1, NextPrivateMessageStatus::kOk);
-  EXPECT_EQ(response.content(), "First");
+  EXPECT_EQ(response->content(), "First");
 
   auto status2 = broadcaster_->nextPrivateMessage(
       "peer2", std::chrono::milliseconds(0), response);
   EXPECT_EQ(status2, NextPrivateMessageStatus::kOk);
-  EXPECT_EQ(response.content(), "Second");
+  EXPECT_EQ(response->content(), "Second");
 
   auto status3 = broadcaster_->nextPrivateMessage(
       "peer2", std::chrono::milliseconds(0), response);
   EXPECT_EQ(status3, NextPrivateMessageStatus::kOk);
-  EXPECT_EQ(response.content(), "Third");
+  EXPECT_EQ(response->content(), "Third");
 }
 
 TEST_F(PrivateMessageBroadcasterTest,
@@ -137,14 +138,14 @@ TEST_F(PrivateMessageBroadcasterTest,
   sendPrivateMessage("peer1", "alice", "peer2", "bob", "Secret for Bob");
 
   // Bob should receive the message
-  chat::InformClientsNewMessageResponse bobResponse;
+  events::ChatMessagePtr bobResponse;
   auto bobStatus = broadcaster_->nextPrivateMessage(
       "peer2", std::chrono::milliseconds(0), bobResponse);
   EXPECT_EQ(bobStatus, NextPrivateMessageStatus::kOk);
-  EXPECT_EQ(bobResponse.content(), "Secret for Bob");
+  EXPECT_EQ(bobResponse->content(), "Secret for Bob");
 
   // Charlie should NOT receive the message
-  chat::InformClientsNewMessageResponse charlieResponse;
+  events::ChatMessagePtr charlieResponse;
   auto charlieStatus = broadcaster_->nextPrivateMessage(
       "peer3", std::chrono::milliseconds(10), charlieResponse);
   EXPECT_EQ(charlieStatus, NextPrivateMessageStatus::kNoMessage);
@@ -159,7 +160,7 @@ TEST_F(PrivateMessageBroadcasterTest,
     disconnectClient("alice");
   });
 
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
   auto status = broadcaster_->nextPrivateMessage(
       "peer1", std::chrono::milliseconds(100), response);
   disconnectThread.join();
@@ -179,19 +180,19 @@ TEST_F(PrivateMessageBroadcasterTest,
   sendPrivateMessage("peer2", "bob", "peer1", "alice", "Hi from Bob");
   sendPrivateMessage("peer3", "charlie", "peer1", "alice", "Hi from Charlie");
 
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
 
   auto status1 = broadcaster_->nextPrivateMessage(
       "peer1", std::chrono::milliseconds(0), response);
   EXPECT_EQ(status1, NextPrivateMessageStatus::kOk);
-  EXPECT_EQ(response.author(), "bob");
-  EXPECT_EQ(response.content(), "Hi from Bob");
+  EXPECT_EQ(response->author(), "bob");
+  EXPECT_EQ(response->content(), "Hi from Bob");
 
   auto status2 = broadcaster_->nextPrivateMessage(
       "peer1", std::chrono::milliseconds(0), response);
   EXPECT_EQ(status2, NextPrivateMessageStatus::kOk);
-  EXPECT_EQ(response.author(), "charlie");
-  EXPECT_EQ(response.content(), "Hi from Charlie");
+  EXPECT_EQ(response->author(), "charlie");
+  EXPECT_EQ(response->content(), "Hi from Charlie");
 }
 
 // --- normalizePrivateMessageIndex Tests ---
@@ -223,11 +224,11 @@ TEST_F(PrivateMessageBroadcasterTest,
   EXPECT_TRUE(result);
 
   // Message sent before normalize should still be available
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
   auto status = broadcaster_->nextPrivateMessage(
       "peer2", std::chrono::milliseconds(0), response);
   EXPECT_EQ(status, NextPrivateMessageStatus::kOk);
-  EXPECT_EQ(response.content(), "Message before init");
+  EXPECT_EQ(response->content(), "Message before init");
 }
 
 // --- onPrivateMessageSent Tests ---
@@ -243,18 +244,21 @@ TEST_F(PrivateMessageBroadcasterTest, OnPrivateMessageSent_AddsMessageToQueue) {
       .senderPseudonym = "alice",
       .recipientPeer = "peer2",
       .recipientPseudonym = "bob",
-      .content = "Test private content",
+      .message =
+          events::makeChatMessage("alice", "Test private content", {}, true),
   };
   broadcaster_->onPrivateMessageSent(event);
 
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
   auto status = broadcaster_->nextPrivateMessage(
       "peer2", std::chrono::milliseconds(0), response);
 
   EXPECT_EQ(status, NextPrivateMessageStatus::kOk);
-  EXPECT_EQ(response.author(), "alice");
-  EXPECT_EQ(response.content(), "Test private content");
-  EXPECT_TRUE(response.isprivate());
+  EXPECT_EQ(response->author(), "alice");
+  EXPECT_EQ(response->content(), "Test private content");
+  EXPECT_TRUE(response->isprivate());
+  // The queued payload is the event's payload, not a copy
+  EXPECT_EQ(response, event.message);
 }
 
 TEST_F(PrivateMessageBroadcasterTest, OnPrivateMessageSent_WakesWaitingPeer) {
@@ -268,7 +272,7 @@ TEST_F(PrivateMessageBroadcasterTest, OnPrivateMessageSent_WakesWaitingPeer) {
   std::atomic<bool> messageReceived{false};
 
   std::thread waitingThread([this, &status, &messageReceived]() {
-    chat::InformClientsNewMessageResponse response;
+    events::ChatMessagePtr response;
     status = broadcaster_->nextPrivateMessage(
         "peer2", std::chrono::milliseconds(500), response);
     if (status == NextPrivateMessageStatus::kOk) {
@@ -326,7 +330,7 @@ TEST_F(PrivateMessageBroadcasterTest,
 
   // Bob's queue should be cleaned up, attempting to get messages returns
   // PeerMissing
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
   auto status = broadcaster_->nextPrivateMessage(
       "peer2", std::chrono::milliseconds(0), response);
   EXPECT_EQ(status, NextPrivateMessageStatus::kPeerMissing);
@@ -336,13 +340,109 @@ TEST_F(PrivateMessageBroadcasterTest, OnMessageSent_NoOp) {
   events::MessageSentEvent event{
       .peer = "peer1",
       .pseudonym = "alice",
-      .content = "Public message",
+      .message = events::makeChatMessage("alice", "Public message"),
   };
 
   // Should not crash and should not affect private message queues
   EXPECT_NO_THROW(broadcaster_->onMessageSent(event));
 }
 
+// --- Slow consumer policy Tests ---
+
+TEST_F(PrivateMessageBroadcasterTest, QueueDepth_UnknownPeer_ReturnsNullopt) {
+  EXPECT_FALSE(broadcaster_->queueDepth("unknown_peer").has_value());
+}
+
+TEST_F(PrivateMessageBroadcasterTest, QueueDepth_CountsQueuedMessages) {
+  connectClient("peer1", "alice");
+  connectClient("peer2", "bob");
+  broadcaster_->normalizePrivateMessageIndex("peer2");
+
+  sendPrivateMessage("peer1", "alice", "peer2", "bob", "First");
+  sendPrivateMessage("peer1", "alice", "peer2", "bob", "Second");
+
+  EXPECT_EQ(broadcaster_->queueDepth("peer2"), 2U);
+}
+
+TEST_F(PrivateMessageBroadcasterTest, DropOldestPolicy_BoundsQueue) {
+  broadcaster_ = std::make_unique<PrivateMessageBroadcaster>(
+      registry_, OutboundQueueConfig{
+                     .capacity = 2, .policy = SlowConsumerPolicy::kDropOldest});
+  connectClient("peer1", "alice");
+  connectClient("peer2", "bob");
+  broadcaster_->normalizePrivateMessageIndex("peer2");
+
+  sendPrivateMessage("peer1", "alice", "peer2", "bob", "First");
+  sendPrivateMessage("peer1", "alice", "peer2", "bob", "Second");
+  sendPrivateMessage("peer1", "alice", "peer2", "bob", "Third");
+  EXPECT_EQ(broadcaster_->queueDepth("peer2"), 2U);
+
+  events::ChatMessagePtr response;
+  auto status = broadcaster_->nextPrivateMessage(
+      "peer2", std::chrono::milliseconds(0), response);
+  EXPECT_EQ(status, NextPrivateMessageStatus::kOk);
+  EXPECT_EQ(response->content(), "Second");
+}
+
+TEST_F(PrivateMessageBroadcasterTest, CoalescePolicy_FoldsSameAuthor) {
+  broadcaster_ = std::make_unique<PrivateMessageBroadcaster>(
+      registry_, OutboundQueueConfig{
+                     .capacity = 1, .policy = SlowConsumerPolicy::kCoalesce});
+  connectClient("peer1", "alice");
+  connectClient("peer2", "bob");
+  broadcaster_->normalizePrivateMessageIndex("peer2");
+
+  sendPrivateMessage("peer1", "alice", "peer2", "bob", "First");
+  sendPrivateMessage("peer1", "alice", "peer2", "bob", "Second");
+  EXPECT_EQ(broadcaster_->queueDepth("peer2"), 1U);
+
+  events::ChatMessagePtr response;
+  auto status = broadcaster_->nextPrivateMessage(
+      "peer2", std::chrono::milliseconds(0), response);
+  EXPECT_EQ(status, NextPrivateMessageStatus::kOk);
+  EXPECT_EQ(response->content(), "First\nSecond");
+}
+
+TEST_F(PrivateMessageBroadcasterTest, CoalescePolicy_DropsOldestPastTheCap) {
+  broadcaster_ = std::make_unique<PrivateMessageBroadcaster>(
+      registry_, OutboundQueueConfig{.capacity = 1,
+                                     .policy = SlowConsumerPolicy::kCoalesce,
+                                     .maxCoalescedBytes = 12});
+  connectClient("peer1", "alice");
+  connectClient("peer2", "bob");
+  broadcaster_->normalizePrivateMessageIndex("peer2");
+
+  sendPrivateMessage("peer1", "alice", "peer2", "bob", "First");
+  sendPrivateMessage("peer1", "alice", "peer2", "bob", "Second");
+  sendPrivateMessage("peer1", "alice", "peer2", "bob", "Third");
+  EXPECT_EQ(broadcaster_->queueDepth("peer2"), 1U);
+
+  // "First\nSecond" is at the cap, so "Third" replaces it
+  events::ChatMessagePtr response;
+  auto status = broadcaster_->nextPrivateMessage(
+      "peer2", std::chrono::milliseconds(0), response);
+  EXPECT_EQ(status, NextPrivateMessageStatus::kOk);
+  EXPECT_EQ(response->content(), "Third");
+}
+
+TEST_F(PrivateMessageBroadcasterTest, DisconnectPolicy_ReturnsOverflow) {
+  broadcaster_ = std::make_unique<PrivateMessageBroadcaster>(
+      registry_, OutboundQueueConfig{
+                     .capacity = 1, .policy = SlowConsumerPolicy::kDisconnect});
+  connectClient("peer1", "alice");
+  connectClient("peer2", "bob");
+  broadcaster_->normalizePrivateMessageIndex("peer2");
+
+  sendPrivateMessage("peer1", "alice", "peer2", "bob", "First");
+  sendPrivateMessage("peer1", "alice", "peer2", "bob", "Second");
+
+  events::ChatMessagePtr response;
+  auto status = broadcaster_->nextPrivateMessage(
+      "peer2", std::chrono::milliseconds(0), response);
+  EXPECT_EQ(status, NextPrivateMessageStatus::kOverflow);
+  EXPECT_FALSE(broadcaster_->queueDepth("peer2").has_value());
+}
+
 // --- Edge cases ---
 
 TEST_F(PrivateMessageBroadcasterTest,
@@ -354,7 +454,7 @@ TEST_F(PrivateMessageBroadcasterTest,
 
   sendPrivateMessage("peer1", "alice", "peer2", "bob", "Only message");
 
-  chat::InformClientsNewMessageResponse response;
+  events::ChatMessagePtr response;
 
   // First call consumes the message
   auto status1 = broadcaster_->nextPrivateMessage(
@@ -380,17 +480,44 @@ TEST_F(PrivateMessageBroadcasterTest,
   sendPrivateMessage("peer1", "alice", "peer2", "bob", "For Bob");
   sendPrivateMessage("peer1", "alice", "peer3", "charlie", "For Charlie");
 
-  chat::InformClientsNewMessageResponse bobResponse;
+  events::ChatMessagePtr bobResponse;
   auto bobStatus = broadcaster_->nextPrivateMessage(
       "peer2", std::chrono::milliseconds(0), bobResponse);
   EXPECT_EQ(bobStatus, NextPrivateMessageStatus::kOk);
-  EXPECT_EQ(bobResponse.content(), "For Bob");
+  EXPECT_EQ(bobResponse->content(), "For Bob");
 
-  chat::InformClientsNewMessageResponse charlieResponse;
+  events::ChatMessagePtr charlieResponse;
   auto charlieStatus = broadcaster_->nextPrivateMessage(
       "peer3", std::chrono::milliseconds(0), charlieResponse);
   EXPECT_EQ(charlieStatus, NextPrivateMessageStatus::kOk);
-  EXPECT_EQ(charlieResponse.content(), "For Charlie");
+  EXPECT_EQ(charlieResponse->content(), "For Charlie");
+}
+
+TEST_F(PrivateMessageBroadcasterTest, Drain_WakesWaitingPeer) {
+  connectClient("peer1", "alice");
+  broadcaster_->normalizePrivateMessageIndex("peer1");
+
+  std::atomic<NextPrivateMessageStatus> status{NextPrivateMessageStatus::kOk};
+  const auto start = std::chrono::steady_clock::now();
+  std::thread waitingThread([this, &status] {
+    events::ChatMessagePtr response;
+    status = broadcaster_->nextPrivateMessage(
+        "peer1", std::chrono::seconds(10), response);
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  broadcaster_->drain();
+  waitingThread.join();
+
+  EXPECT_EQ(status.load(), NextPrivateMessageStatus::kNoMessage);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+
+  // Later calls return at once
+  events::ChatMessagePtr response;
+  EXPECT_EQ(broadcaster_->nextPrivateMessage("peer1", std::chrono::seconds(10),
+                                             response),
+            NextPrivateMessageStatus::kNoMessage);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
 }
 
 } // namespace
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include "domain/client_registry.hpp"
+#include "domain/room_registry.hpp"
+
+#include <chrono>
+#include <string>
+
+namespace domain {
+namespace {
+
+class RoomRegistryTest : public ::testing::Test {
+protected:
+  ClientRegistry registry_;
+  std::unique_ptr<RoomRegistry> rooms_;
+
+  void SetUp() override { rooms_ = std::make_unique<RoomRegistry>(registry_); }
+
+  void connectClient(const std::string &peer, const std::string &pseudonym) {
+    events::ClientConnectedEvent event{
+        .peer = peer,
+        .pseudonym = pseudonym,
+        .gender = "male",
+        .country = "US",
+    };
+    registry_.asObserver()->onClientConnected(event);
+  }
+
+  void sendMessage(const std::string &peer, const std::string &pseudonym,
+                   const std::string &content, const std::string &room) {
+    events::MessageSentEvent event{
+        .peer = peer,
+        .pseudonym = pseudonym,
+        .room = room,
+        .message = events::makeChatMessage(pseudonym, content, room),
+    };
+    rooms_->onMessageSent(event);
+  }
+};
+
+TEST_F(RoomRegistryTest, NormalizeRoomId_EmptyIsDefaultRoom) {
+  EXPECT_EQ(RoomRegistry::normalizeRoomId(""), RoomRegistry::kDefaultRoom);
+  EXPECT_EQ(RoomRegistry::normalizeRoomId("cpp"), "cpp");
+}
+
+TEST_F(RoomRegistryTest, IsValidRoomId_LimitsLengthAndCharacters) {
+  EXPECT_TRUE(RoomRegistry::isValidRoomId(""));
+  EXPECT_TRUE(RoomRegistry::isValidRoomId("rust-lang_2.0"));
+  EXPECT_TRUE(RoomRegistry::isValidRoomId(
+      std::string(RoomRegistry::kMaxRoomIdLength, 'a')));
+
+  EXPECT_FALSE(RoomRegistry::isValidRoomId(
+      std::string(RoomRegistry::kMaxRoomIdLength + 1, 'a')));
+  EXPECT_FALSE(RoomRegistry::isValidRoomId("two words"));
+  EXPECT_FALSE(RoomRegistry::isValidRoomId("a/b"));
+  EXPECT_FALSE(RoomRegistry::isValidRoomId("caf\xc3\xa9"));
+}
+
+TEST_F(RoomRegistryTest, Room_SameIdReturnsSameBroadcaster) {
+  auto first = rooms_->room("cpp").value();
+  auto second = rooms_->room("cpp").value();
+
+  EXPECT_EQ(first, second);
+  // The default room is always there
+  EXPECT_EQ(rooms_->roomCount(), 2U);
+}
+
+TEST_F(RoomRegistryTest, Room_EmptyIdSharesDefaultRoom) {
+  EXPECT_EQ(rooms_->room("").value(),
+            rooms_->room(RoomRegistry::kDefaultRoom).value());
+}
+
+TEST_F(RoomRegistryTest, Room_RejectsInvalidIds) {
+  const auto room = rooms_->room("a/b");
+  ASSERT_FALSE(room.has_value());
+  EXPECT_EQ(room.error(), RoomError::kInvalidId);
+  EXPECT_EQ(rooms_->roomCount(), 1U);
+}
+
+TEST_F(RoomRegistryTest, Room_IsRemovedWithItsLastSubscriber) {
+  auto first = rooms_->room("cpp").value();
+  auto second = rooms_->room("cpp").value();
+  EXPECT_EQ(rooms_->roomCount(), 2U);
+
+  first.reset();
+  EXPECT_EQ(rooms_->roomCount(), 2U);
+  second.reset();
+  EXPECT_EQ(rooms_->roomCount(), 1U);
+}
+
+TEST_F(RoomRegistryTest, Room_IsRefusedPastTheLimit) {
+  rooms_ = std::make_unique<RoomRegistry>(registry_, OutboundQueueConfig{}, 1,
+                                          2);
+  auto cppRoom = rooms_->room("cpp").value();
+
+  const auto rustRoom = rooms_->room("rust");
+  ASSERT_FALSE(rustRoom.has_value());
+  EXPECT_EQ(rustRoom.error(), RoomError::kLimitReached);
+  // Existing rooms can still be joined
+  EXPECT_EQ(rooms_->room("cpp").value(), cppRoom);
+
+  cppRoom.reset();
+  EXPECT_TRUE(rooms_->room("rust").has_value());
+}
+
+TEST_F(RoomRegistryTest, OnMessageSent_OnlyDeliveredToTargetRoom) {
+  connectClient("peer1", "alice");
+  connectClient("peer2", "bob");
+
+  auto cppRoom = rooms_->room("cpp").value();
+  auto rustRoom = rooms_->room("rust").value();
+  cppRoom->normalizeMessageIndex("peer1");
+  rustRoom->normalizeMessageIndex("peer2");
+
+  sendMessage("peer1", "alice", "Hello C++", "cpp");
+
+  events::ChatMessagePtr response;
+  EXPECT_EQ(
+      cppRoom->nextMessage("peer1", std::chrono::milliseconds(0), response),
+      NextMessageStatus::kOk);
+  EXPECT_EQ(response->content(), "Hello C++");
+  EXPECT_EQ(response->room(), "cpp");
+
+  EXPECT_EQ(
+      rustRoom->nextMessage("peer2", std::chrono::milliseconds(10), response),
+      NextMessageStatus::kNoMessage);
+}
+
+TEST_F(RoomRegistryTest, OnMessageSent_EmptyRoomGoesToDefaultRoom) {
+  connectClient("peer1", "alice");
+
+  auto defaultRoom = rooms_->room("").value();
+  defaultRoom->normalizeMessageIndex("peer1");
+
+  sendMessage("peer1", "alice", "Hello", "");
+
+  events::ChatMessagePtr response;
+  EXPECT_EQ(
+      defaultRoom->nextMessage("peer1", std::chrono::milliseconds(0), response),
+      NextMessageStatus::kOk);
+  EXPECT_EQ(response->content(), "Hello");
+}
+
+TEST_F(RoomRegistryTest, OnMessageSent_DropsMessagesToMissingRooms) {
+  connectClient("peer1", "alice");
+
+  sendMessage("peer1", "alice", "Anyone?", "nowhere");
+
+  EXPECT_EQ(rooms_->roomCount(), 1U);
+  // Joining afterwards does not replay it
+  auto room = rooms_->room("nowhere").value();
+  room->normalizeMessageIndex("peer1");
+  events::ChatMessagePtr response;
+  EXPECT_EQ(room->nextMessage("peer1", std::chrono::milliseconds(0), response),
+            NextMessageStatus::kNoMessage);
+}
+
+TEST_F(RoomRegistryTest, Drain_AppliesToRoomsCreatedLater) {
+  connectClient("peer1", "alice");
+  auto cppRoom = rooms_->room("cpp").value();
+
+  rooms_->drain();
+
+  const auto start = std::chrono::steady_clock::now();
+  for (const auto *roomId : {"cpp", "rust"}) {
+    auto room = rooms_->room(roomId).value();
+    room->normalizeMessageIndex("peer1");
+    events::ChatMessagePtr response;
+    EXPECT_EQ(room->nextMessage("peer1", std::chrono::seconds(10), response),
+              NextMessageStatus::kNoMessage);
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+} // namespace
+} // namespace domain
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include "domain/session_store.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace domain {
+namespace {
+
+using namespace std::chrono_literals;
+
+class SessionStoreTest : public ::testing::Test {
+protected:
+  int tokens_ = 0;
+  SessionStore store_{[this] { return "token" + std::to_string(++tokens_); }};
+  std::filesystem::path file_ =
+      std::filesystem::temp_directory_path() /
+      ("session_store_test_" +
+       std::string(
+           ::testing::UnitTest::GetInstance()->current_test_info()->name()));
+
+  void TearDown() override {
+    std::filesystem::remove(file_);
+    std::filesystem::remove(file_.string() + ".tmp");
+  }
+
+  static events::ClientConnectedEvent client(const std::string &peer,
+                                             const std::string &pseudonym) {
+    return {.peer = peer,
+            .pseudonym = pseudonym,
+            .gender = "female",
+            .country = "FR"};
+  }
+
+  void disconnect(const std::string &peer, const std::string &pseudonym) {
+    store_.onClientDisconnected({.peer = peer,
+                                 .pseudonym = pseudonym,
+                                 .connectionDuration = 0s});
+  }
+};
+
+TEST_F(SessionStoreTest, Open_IssuesATokenPerClient) {
+  const auto alice = store_.open(client("peer1", "alice"));
+  const auto bob = store_.open(client("peer2", "bob"));
+
+  EXPECT_NE(alice, bob);
+  EXPECT_EQ(store_.holder(alice, "alice"), "peer1");
+  EXPECT_EQ(store_.holder(bob, "bob"), "peer2");
+  EXPECT_EQ(store_.size(), 2);
+}
+
+TEST_F(SessionStoreTest, Open_WithTokenMovesTheSession) {
+  const auto token = store_.open(client("peer1", "alice"));
+
+  EXPECT_EQ(store_.open(client("peer2", "alice"), token), token);
+  EXPECT_EQ(store_.holder(token, "alice"), "peer2");
+  EXPECT_EQ(store_.size(), 1);
+
+  // The previous connection no longer ends the session
+  disconnect("peer1", "alice");
+  EXPECT_EQ(store_.holder(token, "alice"), "peer2");
+}
+
+TEST_F(SessionStoreTest, Open_IgnoresTokenOfAnotherPseudonym) {
+  const auto token = store_.open(client("peer1", "alice"));
+
+  EXPECT_NE(store_.open(client("peer2", "bob"), token), token);
+  EXPECT_FALSE(store_.holder(token, "bob").has_value());
+  EXPECT_EQ(store_.holder(token, "alice"), "peer1");
+}
+
+TEST_F(SessionStoreTest, Disconnect_EndsTheSession) {
+  const auto token = store_.open(client("peer1", "alice"));
+
+  disconnect("peer1", "alice");
+
+  EXPECT_FALSE(store_.holder(token, "alice").has_value());
+  EXPECT_EQ(store_.size(), 0);
+}
+
+TEST_F(SessionStoreTest, Restore_HoldsSessionsUntilResumedOrExpired) {
+  const auto now = SessionStore::Clock::now();
+  const auto clients = store_.restore(
+      {{.token = "a", .peer = "old1", .pseudonym = "alice"},
+       {.token = "b", .peer = "old2", .pseudonym = "bob"}},
+      now + 60s);
+
+  ASSERT_EQ(clients.size(), 2);
+  EXPECT_EQ(clients[0].peer, "resume:alice");
+  EXPECT_EQ(store_.holder("a", "alice"), "resume:alice");
+
+  store_.open(client("peer1", "alice"), "a");
+  EXPECT_TRUE(store_.expire(now + 30s).empty());
+
+  const auto expired = store_.expire(now + 60s);
+  ASSERT_EQ(expired.size(), 1);
+  EXPECT_EQ(expired[0].pseudonym, "bob");
+  EXPECT_EQ(expired[0].peer, "resume:bob");
+  EXPECT_EQ(store_.holder("a", "alice"), "peer1");
+  EXPECT_EQ(store_.size(), 1);
+}
+
+TEST_F(SessionStoreTest, Checkpoint_RoundTrips) {
+  store_.open(client("peer1", "alice"));
+  store_.open(client("peer2", std::string(300, 'b')));
+
+  ASSERT_FALSE(saveSessionCheckpoint(
+      file_, {.membershipVersion = 42, .sessions = store_.sessions()}));
+  const auto checkpoint = loadSessionCheckpoint(file_);
+
+  ASSERT_TRUE(checkpoint.has_value()) << checkpoint.error();
+  EXPECT_EQ(checkpoint->membershipVersion, 42);
+  ASSERT_EQ(checkpoint->sessions.size(), 2);
+  SessionStore restored;
+  restored.restore(checkpoint->sessions, SessionStore::Clock::now() + 60s);
+  for (const auto &session : store_.sessions()) {
+    EXPECT_TRUE(restored.holder(session.token, session.pseudonym).has_value());
+  }
+  EXPECT_FALSE(std::filesystem::exists(file_.string() + ".tmp"));
+}
+
+TEST_F(SessionStoreTest, Checkpoint_MissingFileIsEmpty) {
+  const auto checkpoint = loadSessionCheckpoint(file_);
+
+  ASSERT_TRUE(checkpoint.has_value());
+  EXPECT_EQ(checkpoint->membershipVersion, 0);
+  EXPECT_TRUE(checkpoint->sessions.empty());
+}
+
+TEST_F(SessionStoreTest, Checkpoint_RejectsTruncatedFile) {
+  store_.open(client("peer1", "alice"));
+  ASSERT_FALSE(saveSessionCheckpoint(
+      file_, {.membershipVersion = 1, .sessions = store_.sessions()}));
+  std::filesystem::resize_file(file_, std::filesystem::file_size(file_) - 1);
+
+  EXPECT_FALSE(loadSessionCheckpoint(file_).has_value());
+
+  std::ofstream(file_, std::ios::trunc) << "not a checkpoint";
+  EXPECT_FALSE(loadSessionCheckpoint(file_).has_value());
+}
+
+} // namespace
+} // namespace domain
@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+
+#include "domain/spmc_append_log.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace domain {
+namespace {
+
+using SmallLog = SpmcAppendLog<int, 4>;
+
+TEST(SpmcAppendLogTest, NewCursor_StartsAtTail) {
+  SmallLog log;
+  log.append(1);
+  log.append(2);
+
+  auto cursor = log.subscribe();
+  int value = 0;
+
+  EXPECT_EQ(cursor->position(), 2U);
+  EXPECT_EQ(cursor->pending(), 0U);
+  EXPECT_FALSE(cursor->next(value));
+}
+
+TEST(SpmcAppendLogTest, Next_ReadsEntriesInOrderAcrossSegments) {
+  SmallLog log;
+  auto cursor = log.subscribe();
+
+  for (int i = 0; i < 10; ++i) {
+    log.append(i);
+  }
+
+  EXPECT_EQ(cursor->pending(), 10U);
+  for (int i = 0; i < 10; ++i) {
+    int value = -1;
+    ASSERT_TRUE(cursor->next(value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_EQ(cursor->pending(), 0U);
+}
+
+TEST(SpmcAppendLogTest, Cursors_AreIndependent) {
+  SmallLog log;
+  auto first = log.subscribe();
+  auto second = log.subscribe();
+
+  log.append(7);
+  log.append(8);
+
+  int value = 0;
+  ASSERT_TRUE(first->next(value));
+  ASSERT_TRUE(first->next(value));
+  EXPECT_EQ(value, 8);
+
+  ASSERT_TRUE(second->next(value));
+  EXPECT_EQ(value, 7);
+  EXPECT_EQ(second->pending(), 1U);
+}
+
+TEST(SpmcAppendLogTest, SkipTo_MovesForwardAndClampsToTail) {
+  SmallLog log;
+  auto cursor = log.subscribe();
+  for (int i = 0; i < 10; ++i) {
+    log.append(i);
+  }
+
+  cursor->skipTo(6);
+  int value = 0;
+  ASSERT_TRUE(cursor->next(value));
+  EXPECT_EQ(value, 6);
+
+  cursor->skipTo(2);
+  EXPECT_EQ(cursor->position(), 7U);
+
+  cursor->skipTo(100);
+  EXPECT_EQ(cursor->position(), 10U);
+  EXPECT_FALSE(cursor->next(value));
+}
+
+TEST(SpmcAppendLogTest, Reclaim_FreesSegmentsPassedByEveryCursor) {
+  SmallLog log;
+  auto fast = log.subscribe();
+  auto slow = log.subscribe();
+
+  for (int i = 0; i < 12; ++i) {
+    log.append(i);
+  }
+  EXPECT_EQ(log.liveSegmentCount(), 3U);
+
+  int value = 0;
+  while (fast->next(value)) {
+  }
+  // The slow cursor still pins every segment
+  log.append(12);
+  EXPECT_EQ(log.liveSegmentCount(), 4U);
+
+  slow->skipTo(9);
+  for (int i = 13; i < 17; ++i) {
+    log.append(i);
+  }
+  EXPECT_EQ(log.liveSegmentCount(), 3U);
+
+  ASSERT_TRUE(slow->next(value));
+  EXPECT_EQ(value, 9);
+}
+
+TEST(SpmcAppendLogTest, Reclaim_FreesWhatAnIdleCursorWasMovedPast) {
+  SmallLog log;
+  // Never read by its owner
+  auto idle = log.subscribe();
+
+  for (int i = 0; i < 16; ++i) {
+    log.append(i);
+  }
+  EXPECT_EQ(log.liveSegmentCount(), 4U);
+
+  // What a producer enforcing a capacity of 4 does
+  idle->skipTo(log.size() - 4);
+  log.reclaim();
+  EXPECT_EQ(log.liveSegmentCount(), 2U);
+
+  int value = 0;
+  ASSERT_TRUE(idle->next(value));
+  EXPECT_EQ(value, 12);
+}
+
+TEST(SpmcAppendLogTest, Reclaim_WithoutCursorsFreesOldSegments) {
+  SmallLog log;
+  for (int i = 0; i < 20; ++i) {
+    log.append(i);
+  }
+
+  // Only the tail segment and its predecessor survive the last rollover
+  EXPECT_EQ(log.liveSegmentCount(), 2U);
+}
+
+TEST(SpmcAppendLogTest, ConcurrentReaders_SeeEveryEntry) {
+  SpmcAppendLog<int, 16> log;
+  constexpr int kEntries = 10000;
+  constexpr int kReaders = 4;
+
+  std::vector<std::unique_ptr<SpmcAppendLog<int, 16>::Cursor>> cursors;
+  for (int i = 0; i < kReaders; ++i) {
+    cursors.push_back(log.subscribe());
+  }
+
+  std::atomic<int> mismatches{0};
+  std::vector<std::thread> readers;
+  for (auto &cursor : cursors) {
+    readers.emplace_back([&cursor, &mismatches]() {
+      int expected = 0;
+      while (expected < kEntries) {
+        int value = 0;
+        if (cursor->next(value)) {
+          if (value != expected) {
+            ++mismatches;
+          }
+          ++expected;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  for (int i = 0; i < kEntries; ++i) {
+    log.append(i);
+  }
+
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(mismatches.load(), 0);
+}
+
+} // namespace
+} // namespace domain
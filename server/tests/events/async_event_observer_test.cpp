@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include "mock/mock_service_event_observer.hpp"
+#include "service/events/async_event_observer.hpp"
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace events {
+namespace {
+
+TEST(AsyncEventObserverTest, Events_AreDeliveredInOrder) {
+  auto observer = std::make_shared<mock::MockServiceEventObserver>();
+  AsyncEventObserver async(observer);
+
+  for (int i = 0; i < 100; ++i) {
+    async.onClientConnected(
+        {.peer = "peer" + std::to_string(i), .pseudonym = "user"});
+  }
+  async.onClientDisconnected({.peer = "peer0", .pseudonym = "user"});
+  async.onMessageSent({.peer = "peer1", .pseudonym = "user"});
+  async.onPrivateMessageSent({.senderPeer = "peer1"});
+  async.flush();
+
+  ASSERT_EQ(observer->clientConnectedEvents.size(), 100);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(observer->clientConnectedEvents[i].peer,
+              "peer" + std::to_string(i));
+  }
+  EXPECT_EQ(observer->clientDisconnectedEvents.size(), 1);
+  EXPECT_EQ(observer->messageSentEvents.size(), 1);
+  EXPECT_EQ(observer->privateMessageSentEvents.size(), 1);
+}
+
+TEST(AsyncEventObserverTest, Destruction_DeliversQueuedEvents) {
+  auto observer = std::make_shared<mock::MockServiceEventObserver>();
+  {
+    AsyncEventObserver async(observer);
+    for (int i = 0; i < 1000; ++i) {
+      async.onMessageSent({.peer = "peer1", .pseudonym = "alice"});
+    }
+  }
+
+  EXPECT_EQ(observer->messageSentEvents.size(), 1000);
+}
+
+TEST(AsyncEventObserverTest, FlushUntil_ReportsDeliveredEvents) {
+  auto observer = std::make_shared<mock::MockServiceEventObserver>();
+  AsyncEventObserver async(observer);
+  async.onClientConnected({.peer = "peer1", .pseudonym = "alice"});
+
+  EXPECT_TRUE(async.flushUntil(std::chrono::steady_clock::now() +
+                               std::chrono::seconds(10)));
+  EXPECT_EQ(observer->clientConnectedEvents.size(), 1);
+}
+
+TEST(AsyncEventObserverTest, Flush_WithNothingQueuedReturns) {
+  AsyncEventObserver async(std::make_shared<mock::MockServiceEventObserver>());
+  async.flush();
+  SUCCEED();
+}
+
+} // namespace
+} // namespace events
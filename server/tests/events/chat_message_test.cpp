@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+
+#include "service/events/chat_message.hpp"
+
+#include <string>
+
+namespace events {
+namespace {
+
+TEST(ChatMessageTest, MakeChatMessage_SetsAllFields) {
+  const auto message = makeChatMessage("alice", "Hello", "cpp", true);
+
+  EXPECT_EQ(message->author(), "alice");
+  EXPECT_EQ(message->content(), "Hello");
+  EXPECT_EQ(message->room(), "cpp");
+  EXPECT_TRUE(message->isprivate());
+}
+
+TEST(ChatMessageTest, MakeChatMessage_AllocatesOnArena) {
+  const auto message = makeChatMessage("alice", "Hello");
+
+  EXPECT_NE(message->proto().GetArena(), nullptr);
+}
+
+TEST(ChatMessageTest, MakeChatMessage_OutlivesOtherReferences) {
+  ChatMessagePtr copy;
+  {
+    const auto message = makeChatMessage("alice", std::string(2048, 'x'));
+    copy = message;
+  }
+
+  EXPECT_EQ(copy->content().size(), 2048U);
+}
+
+TEST(ChatMessageTest, Wire_ParsesBackToSameMessage) {
+  const auto message = makeChatMessage("alice", std::string(300, 'x'), "cpp");
+
+  chat::InformClientsNewMessageResponse parsed;
+  ASSERT_TRUE(parsed.ParseFromArray(message->wire().begin(),
+                                    static_cast<int>(message->wire().size())));
+  EXPECT_EQ(parsed.author(), "alice");
+  EXPECT_EQ(parsed.content(), std::string(300, 'x'));
+  EXPECT_EQ(parsed.room(), "cpp");
+}
+
+TEST(ChatMessageTest, Wire_IsSharedNotCopied) {
+  const auto message = makeChatMessage("alice", std::string(300, 'x'));
+
+  const grpc::Slice first = message->wire();
+  const grpc::Slice second = message->wire();
+  EXPECT_EQ(first.begin(), second.begin());
+}
+
+} // namespace
+} // namespace events
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 
+#include "mock/mock_message_bus.hpp"
 #include "mock/mock_service_event_observer.hpp"
 #include "service/events/chat_service_events_dispatcher.hpp"
 
@@ -35,7 +36,9 @@ protected:
   makeMessageEvent(const std::string &peer = "peer1",
                    const std::string &pseudonym = "alice",
                    const std::string &content = "Hello, World!") {
-    return {.peer = peer, .pseudonym = pseudonym, .content = content};
+    return {.peer = peer,
+            .pseudonym = pseudonym,
+            .message = events::makeChatMessage(pseudonym, content)};
   }
 };
 
@@ -84,7 +87,7 @@ TEST_F(EventDispatcherTest, RegisterObserver_NotifiesOnMessageSent) {
   ASSERT_EQ(observer->messageSentEvents.size(), 1);
   EXPECT_EQ(observer->messageSentEvents[0].peer, "peer1");
   EXPECT_EQ(observer->messageSentEvents[0].pseudonym, "alice");
-  EXPECT_EQ(observer->messageSentEvents[0].content, "Test message");
+  EXPECT_EQ(observer->messageSentEvents[0].message->content(), "Test message");
 }
 
 TEST_F(EventDispatcherTest, MultipleObservers_AllReceiveEvents) {
@@ -160,5 +163,30 @@ TEST_F(EventDispatcherTest, RegisterSameObserverTwice_ReceivesEventsTwice) {
   EXPECT_EQ(observer->clientConnectedEvents.size(), 2);
 }
 
+TEST_F(EventDispatcherTest, AttachedMessageBus_PublishesEveryEvent) {
+  auto observer = std::make_shared<mock::MockServiceEventObserver>();
+  auto bus = std::make_shared<mock::MockMessageBus>();
+  dispatcher_.registerObserver(observer);
+  dispatcher_.attachMessageBus(bus);
+
+  dispatcher_.notifyClientConnected(makeConnectedEvent("peer1", "alice"));
+  dispatcher_.notifyMessageSent(makeMessageEvent("peer1", "alice"));
+  dispatcher_.notifyPrivateMessageSent(
+      {.senderPeer = "peer1", .senderPseudonym = "alice"});
+  dispatcher_.notifyClientDisconnected(makeDisconnectedEvent("peer1", "bob"));
+
+  EXPECT_EQ(observer->totalEventsReceived(), 4);
+  EXPECT_EQ(bus->published,
+            (std::vector<std::string>{"alice", "alice", "alice", "bob"}));
+}
+
+TEST_F(EventDispatcherTest, ExpiredMessageBus_IsSkipped) {
+  auto bus = std::make_shared<mock::MockMessageBus>();
+  dispatcher_.attachMessageBus(bus);
+  bus.reset();
+
+  EXPECT_NO_THROW(dispatcher_.notifyClientConnected(makeConnectedEvent()));
+}
+
 } // namespace
 } // namespace events
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "service/events/message_bus.hpp"
+
+#include <string>
+#include <vector>
+
+namespace mock {
+
+class MockMessageBus : public events::IMessageBus {
+public:
+  // Pseudonym or sender of each published event, in order
+  std::vector<std::string> published;
+  events::EventDispatcher *remote = nullptr;
+
+  void publish(const events::ClientConnectedEvent &event) override {
+    published.push_back(event.pseudonym);
+  }
+
+  void publish(const events::ClientDisconnectedEvent &event) override {
+    published.push_back(event.pseudonym);
+  }
+
+  void publish(const events::MessageSentEvent &event) override {
+    published.push_back(event.pseudonym);
+  }
+
+  void publish(const events::PrivateMessageSentEvent &event) override {
+    published.push_back(event.senderPseudonym);
+  }
+
+  void start(events::EventDispatcher &dispatcher) override {
+    remote = &dispatcher;
+  }
+};
+
+} // namespace mock
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include "service/arena_message_allocator.hpp"
+
+#include <string>
+
+#include <google/protobuf/empty.pb.h>
+
+#include "chat.pb.h"
+
+namespace service {
+namespace {
+
+using SendMessageAllocator =
+    ArenaMessageAllocator<chat::SendMessageRequest, google::protobuf::Empty>;
+
+TEST(ArenaMessageAllocatorTest, AllocateMessages_SharesOneArenaPerCall) {
+  SendMessageAllocator allocator;
+  auto *holder = allocator.AllocateMessages();
+
+  ASSERT_NE(holder->request(), nullptr);
+  ASSERT_NE(holder->response(), nullptr);
+  EXPECT_NE(holder->request()->GetArena(), nullptr);
+  EXPECT_EQ(holder->request()->GetArena(), holder->response()->GetArena());
+
+  holder->Release();
+}
+
+TEST(ArenaMessageAllocatorTest, AllocateMessages_UsesDistinctArenasPerCall) {
+  SendMessageAllocator allocator;
+  auto *first = allocator.AllocateMessages();
+  auto *second = allocator.AllocateMessages();
+
+  EXPECT_NE(first->request()->GetArena(), second->request()->GetArena());
+
+  first->Release();
+  second->Release();
+}
+
+TEST(ArenaMessageAllocatorTest, Request_HoldsContentLargerThanInitialBlock) {
+  ArenaMessageAllocator<chat::SendMessageRequest, google::protobuf::Empty, 256>
+      allocator;
+  auto *holder = allocator.AllocateMessages();
+  const std::string content(4096, 'x');
+
+  holder->request()->set_content(content);
+
+  EXPECT_EQ(holder->request()->content(), content);
+  holder->Release();
+}
+
+} // namespace
+} // namespace service
@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include "service/validation/count_min_sketch.hpp"
+
+#include <cstdint>
+#include <random>
+
+namespace service::validation {
+namespace {
+
+TEST(CountMinSketchTest, Add_CountsEachKey) {
+  CountMinSketch sketch(1024);
+
+  EXPECT_EQ(sketch.add(42), 1);
+  EXPECT_EQ(sketch.add(42), 2);
+  EXPECT_EQ(sketch.add(7), 1);
+  EXPECT_EQ(sketch.estimate(42), 2);
+  EXPECT_EQ(sketch.estimate(99), 0);
+}
+
+TEST(CountMinSketchTest, Estimate_StaysCloseWhenLoaded) {
+  // Ten keys per counter of a row
+  CountMinSketch sketch(1024);
+  std::mt19937_64 random(3);
+  for (int i = 0; i < 10240; ++i) {
+    sketch.add(random());
+  }
+  for (int i = 0; i < 5; ++i) {
+    sketch.add(0x123456789ABCDEFULL);
+  }
+
+  const auto estimate = sketch.estimate(0x123456789ABCDEFULL);
+  EXPECT_GE(estimate, 5);
+  EXPECT_LE(estimate, 10);
+}
+
+TEST(CountMinSketchTest, Clear_ForgetsCounts) {
+  CountMinSketch sketch(16);
+  sketch.add(1);
+  sketch.add(1);
+
+  sketch.clear();
+
+  EXPECT_EQ(sketch.estimate(1), 0);
+}
+
+} // namespace
+} // namespace service::validation
@@ -0,0 +1,257 @@
+#include <gtest/gtest.h>
+
+#include "service/delivery_pool.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace service {
+namespace {
+
+using namespace std::chrono_literals;
+
+// Counts its deliveries; optionally blocks in them until released
+class FakeTarget final : public IDeliveryTarget {
+public:
+  void deliver() override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++deliveries_;
+    cv_.notify_all();
+    cv_.wait(lock, [this] { return !blocked_; });
+  }
+
+  void block() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    blocked_ = true;
+  }
+
+  void release() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      blocked_ = false;
+    }
+    cv_.notify_all();
+  }
+
+  // Waits until at least `count` deliveries happened
+  bool waitFor(int count) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, 5s,
+                        [this, count] { return deliveries_ >= count; });
+  }
+
+  int deliveries() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return deliveries_;
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  int deliveries_ = 0;
+  bool blocked_ = false;
+};
+
+TEST(DeliveryPoolTest, WakeAll_DeliversToEveryTarget) {
+  DeliveryPool pool({.workers = 2, .partitionsPerWorker = 4});
+  std::vector<std::shared_ptr<FakeTarget>> targets;
+  for (int i = 0; i < 50; ++i) {
+    targets.push_back(std::make_shared<FakeTarget>());
+    pool.add("peer" + std::to_string(i), "", targets.back());
+  }
+
+  pool.wakeAll();
+
+  for (const auto &target : targets) {
+    ASSERT_TRUE(target->waitFor(1));
+  }
+}
+
+TEST(DeliveryPoolTest, Wake_DeliversToThePeerPartitionOnly) {
+  // A single partition per worker, and two workers: peers hashing to the
+  // other partition are not woken
+  DeliveryPool pool({.workers = 2, .partitionsPerWorker = 1});
+  auto woken = std::make_shared<FakeTarget>();
+  pool.add("peer0", "", woken);
+
+  std::vector<std::shared_ptr<FakeTarget>> others;
+  std::hash<std::string_view> hash;
+  for (int i = 1; others.size() < 5; ++i) {
+    const std::string peer = "peer" + std::to_string(i);
+    if (hash(peer) % 2 != hash("peer0") % 2) {
+      others.push_back(std::make_shared<FakeTarget>());
+      pool.add(peer, "", others.back());
+    }
+  }
+
+  pool.wake("peer0");
+  ASSERT_TRUE(woken->waitFor(1));
+  std::this_thread::sleep_for(20ms);
+  for (const auto &other : others) {
+    EXPECT_EQ(other->deliveries(), 0);
+  }
+}
+
+TEST(DeliveryPoolTest, Remove_StopsDeliveries) {
+  DeliveryPool pool({.workers = 1, .partitionsPerWorker = 1});
+  auto target = std::make_shared<FakeTarget>();
+  pool.add("peer", "", target);
+  pool.wake("peer");
+  ASSERT_TRUE(target->waitFor(1));
+
+  pool.remove("peer", "", target.get());
+  pool.wakeAll();
+  std::this_thread::sleep_for(20ms);
+  EXPECT_EQ(target->deliveries(), 1);
+}
+
+TEST(DeliveryPoolTest, BlockedPartition_DoesNotHoldTheOthersBack) {
+  DeliveryPool pool({.workers = 2, .partitionsPerWorker = 4});
+  auto stuck = std::make_shared<FakeTarget>();
+  stuck->block();
+  pool.add("stuck", "", stuck);
+  pool.wake("stuck");
+  ASSERT_TRUE(stuck->waitFor(1));
+
+  // Whichever worker owns their partitions, the idle one takes them
+  std::vector<std::shared_ptr<FakeTarget>> targets;
+  std::vector<std::string> peers;
+  std::hash<std::string_view> hash;
+  for (int i = 0; peers.size() < 50; ++i) {
+    const std::string peer = "peer" + std::to_string(i);
+    if (hash(peer) % 8 != hash("stuck") % 8) {
+      peers.push_back(peer);
+      targets.push_back(std::make_shared<FakeTarget>());
+      pool.add(peer, "", targets.back());
+    }
+  }
+  for (const auto &peer : peers) {
+    pool.wake(peer);
+  }
+  for (const auto &target : targets) {
+    EXPECT_TRUE(target->waitFor(1));
+  }
+
+  stuck->release();
+}
+
+TEST(DeliveryPoolTest, Wakes_AreCoalescedWhileQueued) {
+  DeliveryPool pool({.workers = 1, .partitionsPerWorker = 2});
+  auto stuck = std::make_shared<FakeTarget>();
+  stuck->block();
+  pool.add("stuck", "", stuck);
+  pool.wake("stuck");
+  ASSERT_TRUE(stuck->waitFor(1));
+
+  // The only worker is busy: the wakes below queue the partitions once
+  auto target = std::make_shared<FakeTarget>();
+  std::hash<std::string_view> hash;
+  std::string peer;
+  for (int i = 0; peer.empty(); ++i) {
+    const std::string candidate = "peer" + std::to_string(i);
+    if (hash(candidate) % 2 != hash("stuck") % 2) {
+      peer = candidate;
+    }
+  }
+  pool.add(peer, "", target);
+  for (int i = 0; i < 10; ++i) {
+    pool.wake(peer);
+  }
+
+  stuck->release();
+  ASSERT_TRUE(target->waitFor(1));
+  std::this_thread::sleep_for(20ms);
+  EXPECT_EQ(target->deliveries(), 1);
+}
+
+TEST(DeliveryPoolTest, MessageSent_WakesTheRoomPartitionsOnly) {
+  // A partition per target, so that a wake reaches nobody else
+  DeliveryPool pool({.workers = 1, .partitionsPerWorker = 64});
+  std::hash<std::string_view> hash;
+  std::vector<std::string> peers;
+  for (int i = 0; peers.size() < 2; ++i) {
+    const std::string peer = "peer" + std::to_string(i);
+    if (peers.empty() || hash(peer) % 64 != hash(peers[0]) % 64) {
+      peers.push_back(peer);
+    }
+  }
+  auto inRoom = std::make_shared<FakeTarget>();
+  auto elsewhere = std::make_shared<FakeTarget>();
+  pool.add(peers[0], "lobby", inRoom);
+  pool.add(peers[1], "", elsewhere);
+
+  events::MessageSentEvent event;
+  event.room = "lobby";
+  pool.onMessageSent(event);
+  ASSERT_TRUE(inRoom->waitFor(1));
+  std::this_thread::sleep_for(20ms);
+  EXPECT_EQ(elsewhere->deliveries(), 0);
+
+  // The default room is named either way
+  event.room = "general";
+  pool.onMessageSent(event);
+  ASSERT_TRUE(elsewhere->waitFor(1));
+
+  // Nobody follows the room once its last target is removed
+  pool.remove(peers[0], "lobby", inRoom.get());
+  event.room = "lobby";
+  pool.onMessageSent(event);
+  std::this_thread::sleep_for(20ms);
+  EXPECT_EQ(inRoom->deliveries(), 1);
+}
+
+TEST(DeliveryPoolTest, PrivateMessageSent_WakesTheRecipient) {
+  DeliveryPool pool({.workers = 1, .partitionsPerWorker = 1});
+  auto target = std::make_shared<FakeTarget>();
+  pool.add("recipient", "", target);
+
+  events::PrivateMessageSentEvent event;
+  event.recipientPeer = "recipient";
+  pool.onPrivateMessageSent(event);
+
+  EXPECT_TRUE(target->waitFor(1));
+}
+
+TEST(DeliveryPoolTest, DispatchLatency_CountsThePassesSinceTheLastTake) {
+  DeliveryPool pool({.workers = 2, .partitionsPerWorker = 2});
+  auto target = std::make_shared<FakeTarget>();
+  pool.add("peer", "", target);
+
+  EXPECT_EQ(pool.takeDispatchLatency().passes, 0U);
+  pool.wake("peer");
+  ASSERT_TRUE(target->waitFor(1));
+  pool.wakeAll();
+  ASSERT_TRUE(target->waitFor(2));
+  // Recorded right after the target's delivery
+  std::this_thread::sleep_for(20ms);
+
+  const auto stats = pool.takeDispatchLatency();
+  EXPECT_EQ(stats.passes, 5U);
+  EXPECT_GT(stats.max.count(), 0);
+  EXPECT_LE(stats.p50, stats.p99);
+  EXPECT_LE(stats.p99, stats.max);
+
+  // The next window starts empty
+  const auto next = pool.takeDispatchLatency();
+  EXPECT_EQ(next.passes, 0U);
+  EXPECT_EQ(next.max.count(), 0);
+
+  pool.wake("peer");
+  ASSERT_TRUE(target->waitFor(3));
+  std::this_thread::sleep_for(20ms);
+  EXPECT_EQ(pool.takeDispatchLatency().passes, 1U);
+}
+
+TEST(DeliveryPoolTest, Workers_DefaultToHardwareThreads) {
+  DeliveryPool pool;
+  EXPECT_EQ(pool.workerCount(),
+            std::max(1u, std::thread::hardware_concurrency()));
+}
+
+} // namespace
+} // namespace service
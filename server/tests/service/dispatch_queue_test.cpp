@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include "service/dispatch_queue.hpp"
+
+#include <future>
+#include <thread>
+#include <vector>
+
+namespace service {
+namespace {
+
+TEST(DispatchQueueTest, Tasks_RunInOrderOffTheCallerThread) {
+  std::vector<int> ran;
+  std::thread::id worker;
+  std::promise<void> done;
+  {
+    DispatchQueue queue;
+    for (int i = 0; i < 100; ++i) {
+      queue.post([&ran, &worker, i] {
+        worker = std::this_thread::get_id();
+        ran.push_back(i);
+      });
+    }
+    queue.post([&done] { done.set_value(); });
+    done.get_future().wait();
+  }
+
+  ASSERT_EQ(ran.size(), 100U);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(ran[i], i);
+  }
+  EXPECT_NE(worker, std::this_thread::get_id());
+}
+
+TEST(DispatchQueueTest, Destruction_RunsQueuedTasks) {
+  int ran = 0;
+  {
+    DispatchQueue queue;
+    for (int i = 0; i < 1000; ++i) {
+      queue.post([&ran] { ++ran; });
+    }
+  }
+
+  EXPECT_EQ(ran, 1000);
+}
+
+} // namespace
+} // namespace service
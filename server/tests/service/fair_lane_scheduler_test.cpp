@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include "service/fair_lane_scheduler.hpp"
+
+#include <array>
+#include <cstddef>
+
+namespace service {
+namespace {
+
+constexpr std::size_t kPrivate = 0;
+constexpr std::size_t kPublic = 1;
+
+// Serves `writes` writes of `bytes` each with every lane backlogged;
+// returns the writes per lane
+std::array<int, 2> serveBacklog(FairLaneScheduler<2> &scheduler, int writes,
+                                std::array<std::size_t, 2> bytes) {
+  std::array<int, 2> served{};
+  for (int i = 0; i < writes; ++i) {
+    const auto lane = scheduler.order()[0];
+    scheduler.served(lane, bytes[lane]);
+    ++served[lane];
+  }
+  return served;
+}
+
+TEST(FairLaneSchedulerTest, Ties_GoToTheLowerLane) {
+  FairLaneScheduler<2> scheduler({1, 1});
+  EXPECT_EQ(scheduler.order()[0], kPrivate);
+  EXPECT_EQ(scheduler.order()[1], kPublic);
+}
+
+TEST(FairLaneSchedulerTest, Backlog_IsSharedByWeight) {
+  FairLaneScheduler<2> scheduler({4, 1});
+  const auto served = serveBacklog(scheduler, 1000, {200, 200});
+  EXPECT_EQ(served[kPrivate], 800);
+  EXPECT_EQ(served[kPublic], 200);
+}
+
+TEST(FairLaneSchedulerTest, Backlog_IsSharedInBytes) {
+  // Equal weights, public messages four times larger
+  FairLaneScheduler<2> scheduler({1, 1});
+  const auto served = serveBacklog(scheduler, 1000, {100, 400});
+  EXPECT_EQ(served[kPrivate], 800);
+  EXPECT_EQ(served[kPublic], 200);
+}
+
+TEST(FairLaneSchedulerTest, IdleLane_GoesNextWhateverTheOtherBacklog) {
+  FairLaneScheduler<2> scheduler({1, 4});
+  for (int i = 0; i < 1000; ++i) {
+    const auto order = scheduler.order();
+    // The private lane is tried, found empty, and the room is served
+    if (order[0] == kPrivate) {
+      scheduler.idle(kPrivate);
+    }
+    scheduler.served(kPublic, 300);
+  }
+
+  EXPECT_EQ(scheduler.order()[0], kPrivate);
+}
+
+TEST(FairLaneSchedulerTest, IdleLane_DropsTheDebtOfItsLastBurst) {
+  FairLaneScheduler<2> scheduler({1, 1});
+  // A large private message puts the lane far ahead of the room
+  scheduler.served(kPrivate, 100000);
+  EXPECT_EQ(scheduler.order()[0], kPublic);
+
+  scheduler.idle(kPrivate);
+  scheduler.served(kPublic, 300);
+  EXPECT_EQ(scheduler.order()[0], kPrivate);
+}
+
+TEST(FairLaneSchedulerTest, LaneReportedIdleAfterItsWrite_GoesNext) {
+  const auto roomWritesBeforePrivate = [](bool reportIdle) {
+    FairLaneScheduler<2> scheduler({4, 1});
+    // A direct message empties the private lane
+    scheduler.served(kPrivate, 350);
+    if (reportIdle) {
+      scheduler.idle(kPrivate);
+    }
+    // The room writes until the next direct message is picked
+    int writes = 0;
+    while (scheduler.order()[0] == kPublic) {
+      scheduler.served(kPublic, 30);
+      ++writes;
+    }
+    return writes;
+  };
+
+  EXPECT_EQ(roomWritesBeforePrivate(false), 3);
+  EXPECT_EQ(roomWritesBeforePrivate(true), 0);
+}
+
+TEST(FairLaneSchedulerTest, ZeroWeight_CountsAsOne) {
+  FairLaneScheduler<2> scheduler({0, 1});
+  const auto served = serveBacklog(scheduler, 100, {200, 200});
+  EXPECT_EQ(served[kPrivate], 50);
+  EXPECT_EQ(served[kPublic], 50);
+}
+
+} // namespace
+} // namespace service
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+
+#include "service/validation/keyword_automaton.hpp"
+
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace service::validation {
+namespace {
+
+// Whole-word search, one keyword at a time
+bool naiveMatches(const std::vector<std::string> &keywords,
+                  const std::string &text) {
+  const auto isWord = [](unsigned char byte) {
+    return std::isalnum(byte) != 0 || byte >= 0x80;
+  };
+  for (const auto &keyword : keywords) {
+    for (auto at = text.find(keyword); at != std::string::npos;
+         at = text.find(keyword, at + 1)) {
+      const auto end = at + keyword.size();
+      if ((at == 0 || !isWord(text[at - 1])) &&
+          (end == text.size() || !isWord(text[end]))) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+TEST(KeywordAutomatonTest, Default_MatchesNothing) {
+  const KeywordAutomaton automaton;
+
+  EXPECT_FALSE(automaton.matches("anything"));
+  EXPECT_FALSE(automaton.matches(""));
+  EXPECT_EQ(automaton.keywordCount(), 0);
+}
+
+TEST(KeywordAutomatonTest, Matches_WholeWordsOnly) {
+  const auto automaton = KeywordAutomaton::compile({"ban", "spam"});
+
+  EXPECT_TRUE(automaton.matches("ban"));
+  EXPECT_TRUE(automaton.matches("please ban this, now"));
+  EXPECT_TRUE(automaton.matches("no spam!"));
+  EXPECT_FALSE(automaton.matches("banner"));
+  EXPECT_FALSE(automaton.matches("urban"));
+  EXPECT_FALSE(automaton.matches("spammer ban2"));
+  EXPECT_FALSE(automaton.matches("b\xC3\xA0n ban\xC3\xA9"));
+}
+
+TEST(KeywordAutomatonTest, Matches_IgnoringAsciiCase) {
+  const auto automaton = KeywordAutomaton::compile({"Spam"});
+
+  EXPECT_TRUE(automaton.matches("SPAM"));
+  EXPECT_TRUE(automaton.matches("some spam"));
+}
+
+TEST(KeywordAutomatonTest, Matches_KeywordsEndingInsideOthers) {
+  // "he" ends within "she" and "hers"; only whole words count
+  const auto automaton = KeywordAutomaton::compile({"he", "she", "hers"});
+
+  EXPECT_TRUE(automaton.matches("ushers, she"));
+  EXPECT_TRUE(automaton.matches("ushe he"));
+  EXPECT_FALSE(automaton.matches("ushers"));
+  // A keyword at the end of another that is not a whole word
+  const auto suffixes = KeywordAutomaton::compile({"abcd", "cd"});
+  EXPECT_TRUE(suffixes.matches("xab cd"));
+  EXPECT_TRUE(suffixes.matches("abcd"));
+  EXPECT_FALSE(suffixes.matches("xabcd"));
+}
+
+TEST(KeywordAutomatonTest, Compile_CountsDistinctKeywords) {
+  const auto automaton = KeywordAutomaton::compile({"a", "A", "", "ab"});
+
+  EXPECT_EQ(automaton.keywordCount(), 2);
+  EXPECT_EQ(automaton.stateCount(), 3);
+}
+
+TEST(KeywordAutomatonTest, Matches_AgreesWithNaiveSearch) {
+  std::mt19937 random(99);
+  // A small alphabet, so that keywords overlap and share prefixes
+  std::uniform_int_distribution<int> letter(0, 3);
+  std::uniform_int_distribution<int> length(1, 5);
+  const auto word = [&](int size) {
+    std::string text;
+    for (int i = 0; i < size; ++i) {
+      const int pick = letter(random);
+      text += pick == 3 ? ' ' : static_cast<char>('a' + pick);
+    }
+    return text;
+  };
+
+  for (int round = 0; round < 200; ++round) {
+    std::vector<std::string> keywords;
+    for (int i = 0; i < 8; ++i) {
+      auto keyword = word(length(random));
+      // Keywords are words: trimmed of the separator
+      std::erase(keyword, ' ');
+      if (!keyword.empty()) {
+        keywords.push_back(keyword);
+      }
+    }
+    const auto automaton = KeywordAutomaton::compile(keywords);
+    for (int i = 0; i < 20; ++i) {
+      // Long texts are scanned in segments
+      const auto text = word(i % 2 == 0 ? 30 : 200);
+      EXPECT_EQ(automaton.matches(text), naiveMatches(keywords, text))
+          << "'" << text << "'";
+    }
+  }
+}
+
+TEST(KeywordAutomatonTest, LoadKeywordList_SkipsBlanksAndComments) {
+  const auto file =
+      std::filesystem::temp_directory_path() / "keyword_automaton_test.txt";
+  {
+    std::ofstream out(file);
+    out << "# banned\n  spam \r\n\n\tscam\n";
+  }
+
+  const auto keywords = loadKeywordList(file);
+  std::filesystem::remove(file);
+
+  ASSERT_TRUE(keywords.has_value());
+  EXPECT_EQ(*keywords, (std::vector<std::string>{"spam", "scam"}));
+  EXPECT_FALSE(loadKeywordList(file).has_value());
+}
+
+} // namespace
+} // namespace service::validation
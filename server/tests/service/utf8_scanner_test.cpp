@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+
+#include "service/validation/utf8_scanner.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace service::validation {
+namespace {
+
+// Every kernel this CPU can run
+std::vector<Utf8Kernel> supportedKernels() {
+  std::vector<Utf8Kernel> kernels = {Utf8Kernel::Scalar};
+  if (detectUtf8Kernel() >= Utf8Kernel::Sse4) {
+    kernels.push_back(Utf8Kernel::Sse4);
+  }
+  if (detectUtf8Kernel() >= Utf8Kernel::Avx2) {
+    kernels.push_back(Utf8Kernel::Avx2);
+  }
+  return kernels;
+}
+
+class Utf8ScannerTest : public ::testing::TestWithParam<Utf8Kernel> {
+protected:
+  Utf8Scan scan(std::string_view text) { return scanUtf8(text, GetParam()); }
+
+  // At every offset within a SIMD block, and across block boundaries
+  void expectValidAtEveryOffset(const std::string &text,
+                                std::size_t codePoints, bool hasControl) {
+    for (std::size_t prefix = 0; prefix < 40; ++prefix) {
+      const auto result = scan(std::string(prefix, 'a') + text);
+      ASSERT_TRUE(result.valid) << "prefix " << prefix;
+      EXPECT_EQ(result.codePoints, prefix + codePoints) << "prefix " << prefix;
+      EXPECT_EQ(result.hasControl, hasControl) << "prefix " << prefix;
+    }
+  }
+
+  void expectInvalidAtEveryOffset(const std::string &text) {
+    for (std::size_t prefix = 0; prefix < 40; ++prefix) {
+      EXPECT_FALSE(scan(std::string(prefix, 'a') + text).valid)
+          << "prefix " << prefix;
+      EXPECT_FALSE(scan(std::string(prefix, 'a') + text + "bc").valid)
+          << "prefix " << prefix;
+    }
+  }
+};
+
+TEST_P(Utf8ScannerTest, CountsCodePoints) {
+  EXPECT_EQ(scan("").codePoints, 0);
+  expectValidAtEveryOffset("hello", 5, false);
+  // Two, three and four byte sequences
+  expectValidAtEveryOffset("h\xC3\xA9llo", 5, false);
+  expectValidAtEveryOffset("\xE4\xBD\xA0\xE5\xA5\xBD", 2, false);
+  expectValidAtEveryOffset("\xF0\x9F\x99\x82!", 2, false);
+  // Largest code point
+  expectValidAtEveryOffset("\xF4\x8F\xBF\xBF", 1, false);
+}
+
+TEST_P(Utf8ScannerTest, RejectsMalformedSequences) {
+  // Lone continuation, invalid leads
+  expectInvalidAtEveryOffset("\x80");
+  expectInvalidAtEveryOffset("\xFF");
+  expectInvalidAtEveryOffset("\xF5\x80\x80\x80");
+  // Truncated sequences
+  expectInvalidAtEveryOffset("\xC3");
+  expectInvalidAtEveryOffset("\xE4\xBD");
+  expectInvalidAtEveryOffset("\xF0\x9F\x99");
+  // Overlong forms
+  expectInvalidAtEveryOffset("\xC0\xAF");
+  expectInvalidAtEveryOffset("\xE0\x80\xAF");
+  expectInvalidAtEveryOffset("\xF0\x80\x80\xAF");
+  // Surrogate, past U+10FFFF
+  expectInvalidAtEveryOffset("\xED\xA0\x80");
+  expectInvalidAtEveryOffset("\xF4\x90\x80\x80");
+  // Too many continuations
+  expectInvalidAtEveryOffset("\xC3\xA9\xA9");
+}
+
+TEST_P(Utf8ScannerTest, FindsControlCharacters) {
+  expectValidAtEveryOffset("tab\tis fine", 11, false);
+  expectValidAtEveryOffset(std::string("nul\0", 4), 4, true);
+  expectValidAtEveryOffset("line\nbreak", 10, true);
+  expectValidAtEveryOffset("\x1B[2J", 4, true);
+  expectValidAtEveryOffset("del\x7F", 4, true);
+  // U+009B, the C1 CSI; U+00A0 is not a control
+  expectValidAtEveryOffset("\xC2\x9B", 1, true);
+  expectValidAtEveryOffset("\xC2\xA0", 1, false);
+}
+
+TEST_P(Utf8ScannerTest, AgreesWithScalarOnRandomInput) {
+  const std::vector<std::string> valid = {
+      "a", " ", "\t", "\n", "\xC3\xA9", "\xC2\x85", "\xE2\x82\xAC",
+      "\xF0\x9F\x98\x80"};
+  const std::vector<std::string> broken = {"\x80", "\xC3", "\xE2\x82",
+                                           "\xED\xA0\x80",
+                                           "\xF4\x90\x80\x80"};
+  std::mt19937 random(1234);
+  std::uniform_int_distribution<std::size_t> pickValid(0, valid.size() - 1);
+  std::uniform_int_distribution<std::size_t> pickBroken(0, broken.size() - 1);
+
+  for (int round = 0; round < 2000; ++round) {
+    // Half the inputs get one broken fragment somewhere
+    const std::size_t count = round % 120;
+    const std::size_t brokenAt = round % 2 == 0 ? round % (count + 1) : count;
+    std::string text;
+    for (std::size_t i = 0; i < count; ++i) {
+      text += i == brokenAt ? broken[pickBroken(random)]
+                            : valid[pickValid(random)];
+    }
+
+    const auto expected = scanUtf8(text, Utf8Kernel::Scalar);
+    const auto result = scan(text);
+    ASSERT_EQ(result.valid, expected.valid) << "round " << round;
+    if (expected.valid) {
+      EXPECT_EQ(result.codePoints, expected.codePoints) << "round " << round;
+      EXPECT_EQ(result.hasControl, expected.hasControl) << "round " << round;
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(Kernels, Utf8ScannerTest,
+                         ::testing::ValuesIn(supportedKernels()));
+
+} // namespace
+} // namespace service::validation
@@ -0,0 +1,224 @@
+#include <gtest/gtest.h>
+
+#include "service/validation/validation_pipeline.hpp"
+#include "service/validation/validators/banned_terms_validator.hpp"
+#include "service/validation/validators/content_validator.hpp"
+#include "service/validation/validators/flood_validator.hpp"
+#include "service/validation/validators/rate_limit_validator.hpp"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace service::validation {
+namespace {
+
+using namespace std::chrono_literals;
+
+static_assert(std::is_trivially_copyable_v<ValidationResult>);
+
+// Records the calls it gets and answers a fixed result
+class RecordingValidator {
+public:
+  RecordingValidator(std::vector<int> &calls, int id, bool valid)
+      : calls_(calls), id_(id), valid_(valid) {}
+
+  ValidationResult validate(const ValidationContext &) {
+    calls_.push_back(id_);
+    return valid_ ? ValidationResult::success()
+                  : ValidationResult::failure(
+                        "rejected by {}", grpc::StatusCode::INVALID_ARGUMENT,
+                        static_cast<std::size_t>(id_));
+  }
+
+private:
+  std::vector<int> &calls_;
+  int id_;
+  bool valid_;
+};
+
+ValidationContext makeContext(std::string_view content,
+                              std::chrono::steady_clock::time_point timestamp =
+                                  std::chrono::steady_clock::now()) {
+  return {.peer = "peer1",
+          .pseudonym = "alice",
+          .content = content,
+          .timestamp = timestamp};
+}
+
+TEST(ValidationPipelineTest, Validate_RunsEveryValidatorInOrder) {
+  std::vector<int> calls;
+  ValidationPipeline<RecordingValidator, RecordingValidator> pipeline(
+      RecordingValidator(calls, 1, true), RecordingValidator(calls, 2, true));
+
+  EXPECT_TRUE(pipeline.validate(makeContext("hello")).valid);
+  EXPECT_EQ(calls, (std::vector<int>{1, 2}));
+}
+
+TEST(ValidationPipelineTest, Validate_StopsAtFirstFailure) {
+  std::vector<int> calls;
+  ValidationPipeline<RecordingValidator, RecordingValidator, RecordingValidator>
+      pipeline(RecordingValidator(calls, 1, true),
+               RecordingValidator(calls, 2, false),
+               RecordingValidator(calls, 3, true));
+
+  const auto result = pipeline.validate(makeContext("hello"));
+
+  EXPECT_FALSE(result.valid);
+  EXPECT_EQ(result.errorMessage(), "rejected by 2");
+  EXPECT_EQ(calls, (std::vector<int>{1, 2}));
+}
+
+TEST(ValidationPipelineTest, ContentValidator_ReportsBrokenLimit) {
+  ValidationPipeline<ContentValidator> pipeline(
+      ContentValidator::Config{.maxLength = 5, .minLength = 2});
+
+  EXPECT_TRUE(pipeline.validate(makeContext("hello")).valid);
+
+  const auto tooShort = pipeline.validate(makeContext("h"));
+  EXPECT_EQ(tooShort.statusCode, grpc::StatusCode::INVALID_ARGUMENT);
+  EXPECT_EQ(tooShort.errorMessage(), "Message is too short (< 2 characters)");
+  EXPECT_EQ(pipeline.validate(makeContext("hello!")).errorMessage(),
+            "Message is too long (> 5 characters)");
+}
+
+TEST(ValidationPipelineTest, ContentValidator_CountsCodePoints) {
+  ValidationPipeline<ContentValidator> pipeline(
+      ContentValidator::Config{.maxLength = 2, .minLength = 2});
+
+  // Two code points in six bytes
+  EXPECT_TRUE(pipeline.validate(makeContext("\xE4\xBD\xA0\xE5\xA5\xBD")).valid);
+  EXPECT_EQ(pipeline.validate(makeContext("\xC3\xA9")).errorMessage(),
+            "Message is too short (< 2 characters)");
+}
+
+TEST(ValidationPipelineTest, ContentValidator_RejectsBadText) {
+  ValidationPipeline<ContentValidator> pipeline(ContentValidator::Config{});
+
+  const auto invalid = pipeline.validate(makeContext("hello \xC3("));
+  EXPECT_EQ(invalid.statusCode, grpc::StatusCode::INVALID_ARGUMENT);
+  EXPECT_EQ(invalid.errorMessage(), "Message is not valid UTF-8");
+  EXPECT_EQ(pipeline.validate(makeContext("hello\x1B[2J")).errorMessage(),
+            "Message contains control characters");
+  EXPECT_TRUE(pipeline.validate(makeContext("hello\tworld")).valid);
+}
+
+TEST(ValidationPipelineTest, BannedTermsValidator_UsesReplacedTerms) {
+  auto terms = std::make_shared<BannedTerms>();
+  ValidationPipeline<BannedTermsValidator> pipeline(terms);
+
+  EXPECT_TRUE(pipeline.validate(makeContext("buy cheap pills")).valid);
+
+  terms->replace(KeywordAutomaton::compile({"cheap pills"}));
+  const auto banned = pipeline.validate(makeContext("buy cheap pills"));
+  EXPECT_EQ(banned.statusCode, grpc::StatusCode::INVALID_ARGUMENT);
+  EXPECT_EQ(banned.errorMessage(), "Message contains a banned term");
+
+  // A check in progress keeps the terms it started with
+  const auto previous = terms->current();
+  terms->replace(KeywordAutomaton());
+  EXPECT_TRUE(previous->matches("buy cheap pills"));
+  EXPECT_TRUE(pipeline.validate(makeContext("buy cheap pills")).valid);
+}
+
+TEST(ValidationPipelineTest, BannedTermsValidator_PassesWithoutTerms) {
+  ValidationPipeline<BannedTermsValidator> pipeline(nullptr);
+
+  EXPECT_TRUE(pipeline.validate(makeContext("anything")).valid);
+}
+
+ValidationContext makeContext(std::string_view peer, std::string_view content,
+                              std::chrono::steady_clock::time_point timestamp) {
+  return {.peer = peer,
+          .pseudonym = "alice",
+          .content = content,
+          .timestamp = timestamp};
+}
+
+TEST(ValidationPipelineTest, FloodValidator_LimitsCopiesPerPeer) {
+  ValidationPipeline<FloodValidator> pipeline(FloodValidator::Config{
+      .window = 10s, .maxPerPeer = 2, .maxGlobal = 100});
+  const auto start = std::chrono::steady_clock::now();
+
+  EXPECT_TRUE(pipeline.validate(makeContext("p1", "Buy now", start)).valid);
+  // Case, spaces and punctuation do not make a new message
+  EXPECT_TRUE(pipeline.validate(makeContext("p1", "buy  NOW!", start)).valid);
+  const auto third = pipeline.validate(makeContext("p1", "buy now", start));
+  EXPECT_EQ(third.statusCode, grpc::StatusCode::RESOURCE_EXHAUSTED);
+  EXPECT_EQ(third.errorMessage(), "You already sent this message");
+  EXPECT_TRUE(pipeline.validate(makeContext("p2", "buy now", start)).valid);
+  EXPECT_TRUE(pipeline.validate(makeContext("p1", "buy later", start)).valid);
+
+  // Forgotten after two windows
+  EXPECT_FALSE(
+      pipeline.validate(makeContext("p1", "buy now", start + 15s)).valid);
+  EXPECT_TRUE(
+      pipeline.validate(makeContext("p1", "buy now", start + 40s)).valid);
+}
+
+TEST(ValidationPipelineTest, FloodValidator_LimitsCopiesAcrossPeers) {
+  ValidationPipeline<FloodValidator> pipeline(FloodValidator::Config{
+      .window = 10s, .maxPerPeer = 5, .maxGlobal = 3, .minGlobalLength = 8});
+  const auto start = std::chrono::steady_clock::now();
+
+  for (const auto *peer : {"p1", "p2", "p3"}) {
+    EXPECT_TRUE(
+        pipeline.validate(makeContext(peer, "cheap pills here", start)).valid);
+    // Short messages are only limited per peer
+    EXPECT_TRUE(pipeline.validate(makeContext(peer, "lol", start)).valid);
+  }
+
+  const auto fourth =
+      pipeline.validate(makeContext("p4", "cheap pills here", start));
+  EXPECT_EQ(fourth.errorMessage(), "This message has been sent too many times");
+  EXPECT_TRUE(pipeline.validate(makeContext("p4", "lol", start)).valid);
+}
+
+TEST(ValidationPipelineTest, FloodValidator_CountsOnlyAcceptedCopies) {
+  ValidationPipeline<FloodValidator> pipeline(
+      FloodValidator::Config{.window = 10s,
+                             .maxPerPeer = 1,
+                             .maxGlobal = 1,
+                             .minGlobalLength = 1});
+  const auto start = std::chrono::steady_clock::now();
+
+  EXPECT_TRUE(pipeline.validate(makeContext("p2", "spam", start)).valid);
+  EXPECT_FALSE(pipeline.validate(makeContext("p1", "spam", start)).valid);
+
+  // The copy refused to p1 was not counted as its own
+  const auto later = pipeline.validate(makeContext("p1", "spam", start + 10s));
+  EXPECT_EQ(later.errorMessage(), "This message has been sent too many times");
+}
+
+TEST(ValidationPipelineTest, FloodValidator_IgnoresCopiesRefusedForTheRate) {
+  ValidationPipeline<RateLimitValidator, FloodValidator> pipeline(
+      1s, FloodValidator::Config{.window = 10s, .maxPerPeer = 2});
+  const auto start = std::chrono::steady_clock::now();
+
+  EXPECT_TRUE(pipeline.validate(makeContext("p1", "spam", start)).valid);
+  EXPECT_FALSE(
+      pipeline.validate(makeContext("p1", "spam", start + 100ms)).valid);
+  EXPECT_TRUE(pipeline.validate(makeContext("p1", "spam", start + 1s)).valid);
+
+  const auto third = pipeline.validate(makeContext("p1", "spam", start + 2s));
+  EXPECT_EQ(third.errorMessage(), "You already sent this message");
+}
+
+TEST(ValidationPipelineTest, RateLimitValidator_RejectsMessagesTooClose) {
+  ValidationPipeline<ContentValidator, RateLimitValidator> pipeline(
+      ContentValidator::Config{}, 1s);
+  const auto start = std::chrono::steady_clock::now();
+
+  EXPECT_TRUE(pipeline.validate(makeContext("hello", start)).valid);
+  const auto tooFast = pipeline.validate(makeContext("hello", start + 500ms));
+  EXPECT_EQ(tooFast.statusCode, grpc::StatusCode::RESOURCE_EXHAUSTED);
+  EXPECT_EQ(tooFast.errorMessage(), "You are sending messages too fast");
+  // A message the content check rejects does not count against the rate
+  EXPECT_FALSE(pipeline.validate(makeContext("h", start + 1s)).valid);
+  EXPECT_TRUE(pipeline.validate(makeContext("hello", start + 1s)).valid);
+}
+
+} // namespace
+} // namespace service::validation
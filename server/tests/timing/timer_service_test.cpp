@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+#include "timing/timer_service.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+namespace timing {
+namespace {
+
+using namespace std::chrono_literals;
+
+TEST(TimerServiceTest, Schedule_RunsCallbackAfterDelay) {
+  TimerService timers({.tick = 1ms});
+  std::promise<TimerService::Clock::time_point> fired;
+
+  const auto start = TimerService::Clock::now();
+  timers.schedule(20ms, [&fired] {
+    fired.set_value(TimerService::Clock::now());
+  });
+
+  auto future = fired.get_future();
+  ASSERT_EQ(future.wait_for(5s), std::future_status::ready);
+  EXPECT_GE(future.get() - start, 20ms);
+}
+
+TEST(TimerServiceTest, ScheduleEvery_RepeatsUntilCancelled) {
+  TimerService timers({.tick = 1ms});
+  std::atomic<int> runs = 0;
+  std::promise<void> thirdRun;
+
+  const auto id = timers.scheduleEvery(5ms, [&runs, &thirdRun] {
+    if (++runs == 3) {
+      thirdRun.set_value();
+    }
+  });
+
+  ASSERT_EQ(thirdRun.get_future().wait_for(5s), std::future_status::ready);
+  EXPECT_TRUE(timers.cancel(id));
+  // At most the run already due when it was cancelled
+  std::this_thread::sleep_for(30ms);
+  EXPECT_LE(runs.load(), 4);
+}
+
+TEST(TimerServiceTest, Cancel_PreventsCallback) {
+  TimerService timers({.tick = 1ms});
+  std::atomic<bool> fired = false;
+
+  const auto id = timers.schedule(50ms, [&fired] { fired = true; });
+  EXPECT_TRUE(timers.cancel(id));
+
+  std::this_thread::sleep_for(80ms);
+  EXPECT_FALSE(fired.load());
+  EXPECT_FALSE(timers.cancel(id));
+}
+
+TEST(TimerServiceTest, Callback_CanScheduleAnotherTimer) {
+  TimerService timers({.tick = 1ms});
+  std::promise<void> second;
+
+  timers.schedule(1ms, [&timers, &second] {
+    timers.schedule(1ms, [&second] { second.set_value(); });
+  });
+
+  EXPECT_EQ(second.get_future().wait_for(5s), std::future_status::ready);
+}
+
+TEST(TimerServiceTest, Stop_DropsPendingTimers) {
+  std::atomic<bool> fired = false;
+  {
+    TimerService timers({.tick = 1ms});
+    timers.schedule(1h, [&fired] { fired = true; });
+    timers.stop();
+    timers.schedule(1ms, [&fired] { fired = true; });
+    std::this_thread::sleep_for(10ms);
+  }
+
+  EXPECT_FALSE(fired.load());
+}
+
+} // namespace
+} // namespace timing
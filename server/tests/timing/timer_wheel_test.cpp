@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+
+#include "timing/timer_wheel.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace timing {
+namespace {
+
+class TimerWheelTest : public ::testing::Test {
+protected:
+  TimerWheel wheel_;
+  std::vector<TimerWheel::Fired> fired_;
+  std::vector<std::uint64_t> firedAt_;
+
+  TimerId scheduleRecorded(std::uint64_t expiry, std::uint64_t period = 0) {
+    return wheel_.schedule(
+        expiry, [this] { firedAt_.push_back(wheel_.now()); }, period);
+  }
+
+  // Advances one tick at a time, running callbacks as the service would
+  void runUntil(std::uint64_t tick) {
+    while (wheel_.now() < tick) {
+      wheel_.advance(wheel_.now() + 1, fired_);
+      for (auto &timer : fired_) {
+        timer.callback();
+      }
+      fired_.clear();
+    }
+  }
+};
+
+TEST_F(TimerWheelTest, Advance_FiresAtExpiryOnEachLevel) {
+  const std::vector<std::uint64_t> expiries = {1,    63,    64,     65,
+                                               4095, 4096,  4097,   262143,
+                                               262144, 300000};
+  for (const auto expiry : expiries) {
+    scheduleRecorded(expiry);
+  }
+
+  runUntil(300000);
+
+  EXPECT_EQ(firedAt_, expiries);
+  EXPECT_TRUE(wheel_.empty());
+}
+
+TEST_F(TimerWheelTest, Advance_FiresRandomExpiriesOnTime) {
+  std::mt19937_64 random(42);
+  std::uniform_int_distribution<std::uint64_t> distance(1, 100000);
+  std::vector<std::uint64_t> expected;
+
+  // Scheduled from moving points in time, so that timers start anywhere in
+  // the upper levels' slots
+  for (std::uint64_t now = 0; now < 20000; now += 997) {
+    runUntil(now);
+    for (int i = 0; i < 50; ++i) {
+      const auto expiry = now + distance(random);
+      wheel_.schedule(expiry, [this, expiry] {
+        EXPECT_EQ(wheel_.now(), expiry);
+        firedAt_.push_back(expiry);
+      });
+      expected.push_back(expiry);
+    }
+  }
+  runUntil(200000);
+
+  EXPECT_EQ(firedAt_.size(), expected.size());
+  EXPECT_TRUE(std::is_sorted(firedAt_.begin(), firedAt_.end()));
+}
+
+TEST_F(TimerWheelTest, Advance_FiresTimersBeyondTheSpan) {
+  const std::uint64_t expiry = (std::uint64_t{1} << 24) + 12345;
+  scheduleRecorded(expiry);
+
+  wheel_.advance(expiry - 1, fired_);
+  EXPECT_TRUE(fired_.empty());
+  wheel_.advance(expiry, fired_);
+
+  ASSERT_EQ(fired_.size(), 1);
+  EXPECT_TRUE(wheel_.empty());
+}
+
+TEST_F(TimerWheelTest, Schedule_PastExpiryFiresOnNextTick) {
+  runUntil(100);
+  scheduleRecorded(50);
+
+  runUntil(101);
+
+  EXPECT_EQ(firedAt_, std::vector<std::uint64_t>{101});
+}
+
+TEST_F(TimerWheelTest, Cancel_RemovesTimer) {
+  const auto first = scheduleRecorded(10);
+  scheduleRecorded(10);
+  const auto far = scheduleRecorded(5000);
+
+  EXPECT_TRUE(wheel_.cancel(first));
+  EXPECT_TRUE(wheel_.cancel(far));
+  EXPECT_FALSE(wheel_.cancel(first));
+  runUntil(10000);
+
+  EXPECT_EQ(firedAt_, std::vector<std::uint64_t>{10});
+}
+
+TEST_F(TimerWheelTest, Cancel_StaleIdDoesNotHitReusedTimer) {
+  const auto fired = scheduleRecorded(5);
+  runUntil(5);
+  // Reuses the node of the fired timer
+  const auto reused = scheduleRecorded(10);
+
+  EXPECT_FALSE(wheel_.cancel(fired));
+  EXPECT_FALSE(wheel_.cancel(TimerId{}));
+  runUntil(10);
+  EXPECT_EQ(firedAt_, (std::vector<std::uint64_t>{5, 10}));
+  EXPECT_NE(fired, reused);
+}
+
+TEST_F(TimerWheelTest, PeriodicTimer_RepeatsUntilCancelled) {
+  const auto id = scheduleRecorded(100, 100);
+
+  runUntil(350);
+  EXPECT_EQ(firedAt_, (std::vector<std::uint64_t>{100, 200, 300}));
+
+  EXPECT_TRUE(wheel_.cancel(id));
+  runUntil(1000);
+  EXPECT_EQ(firedAt_.size(), 3);
+}
+
+TEST_F(TimerWheelTest, Advance_JumpsWhenEmpty) {
+  wheel_.advance(std::uint64_t{1} << 40, fired_);
+
+  EXPECT_EQ(wheel_.now(), std::uint64_t{1} << 40);
+}
+
+} // namespace
+} // namespace timing